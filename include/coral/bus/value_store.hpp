@@ -0,0 +1,131 @@
+/**
+\file
+\brief  Defines the coral::bus::ValueStore class and related types.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_BUS_VALUE_STORE_HPP_INCLUDED
+#define CORAL_BUS_VALUE_STORE_HPP_INCLUDED
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <coral/model.hpp>
+
+
+namespace coral
+{
+namespace bus
+{
+
+
+/**
+\brief  The location of a value in a ValueStore.
+
+A value-initialised `ValueSlot{}` does not refer to any slot.
+*/
+struct ValueSlot
+{
+    /// The data type of the value, which selects the array it is stored in.
+    coral::model::DataType dataType;
+
+    /// The position of the value in the array.
+    std::size_t index;
+};
+
+
+/**
+\brief  A store of variable values, with one contiguous array per data type.
+
+This is used on the data plane, where values are exchanged between slaves
+every time step, instead of coral::model::ScalarValue.  Values of the same
+type are stored next to each other and can be copied in bulk, without any
+branching on the data type of each value.  Conversion to and from
+ScalarValue is only done at API boundaries, with Get() and Set().
+
+The pointers returned by Reals(), Integers(), Booleans() and Strings() are
+invalidated by Add() and Resize() for the same data type, and by Clear().
+*/
+class ValueStore
+{
+public:
+    /// Constructs an empty store.
+    ValueStore() noexcept;
+
+    ValueStore(const ValueStore&) = delete;
+    ValueStore& operator=(const ValueStore&) = delete;
+
+    ValueStore(ValueStore&&) noexcept;
+    ValueStore& operator=(ValueStore&&) noexcept;
+
+    /**
+    \brief  Adds a slot for a value of the given type and returns it.
+
+    The value is initialised to zero, `false` or an empty string.
+    */
+    ValueSlot Add(coral::model::DataType dataType);
+
+    /**
+    \brief  Sets the number of slots for values of the given type.
+
+    Existing values are kept, and new ones are initialised as by Add().
+    */
+    void Resize(coral::model::DataType dataType, std::size_t size);
+
+    /// Returns the number of slots for values of the given type.
+    std::size_t Size(coral::model::DataType dataType) const noexcept;
+
+    /// Removes all slots.
+    void Clear() noexcept;
+
+    /// Returns the array of real values.
+    double* Reals() noexcept { return m_reals.data(); }
+    const double* Reals() const noexcept { return m_reals.data(); }
+
+    /// Returns the array of integer values.
+    int* Integers() noexcept { return m_integers.data(); }
+    const int* Integers() const noexcept { return m_integers.data(); }
+
+    /// Returns the array of boolean values.
+    bool* Booleans() noexcept { return m_booleans.get(); }
+    const bool* Booleans() const noexcept { return m_booleans.get(); }
+
+    /// Returns the array of string values.
+    std::string* Strings() noexcept { return m_strings.data(); }
+    const std::string* Strings() const noexcept { return m_strings.data(); }
+
+    /**
+    \brief  Returns the value in a slot.
+    \throws std::out_of_range if there is no such slot.
+    */
+    coral::model::ScalarValue Get(ValueSlot slot) const;
+
+    /**
+    \brief  Sets the value in a slot.
+    \throws std::out_of_range
+        If there is no such slot.
+    \throws std::invalid_argument
+        If `value` does not have the data type of the slot.
+    */
+    void Set(ValueSlot slot, const coral::model::ScalarValue& value);
+
+private:
+    void CheckSlot(ValueSlot slot) const;
+
+    std::vector<double> m_reals;
+    std::vector<int> m_integers;
+    // std::vector<bool> is not an array of bool, so we manage this ourselves.
+    std::unique_ptr<bool[]> m_booleans;
+    std::size_t m_booleanCount;
+    std::size_t m_booleanCapacity;
+    std::vector<std::string> m_strings;
+};
+
+
+}} // namespace
+#endif // header guard
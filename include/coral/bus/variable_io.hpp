@@ -12,11 +12,15 @@
 #define CORAL_BUS_VARIABLE_IO_HPP_INCLUDED
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <queue>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include <coral/bus/value_store.hpp>
 #include <coral/model.hpp>
 #include <coral/net.hpp>
 
@@ -86,8 +90,67 @@ public:
         coral::model::VariableID variableID,
         coral::model::ScalarValue value);
 
+    /**
+    \brief  Publishes the values of several variables of the same type.
+
+    The value of `variables[i]` is taken from the slot with data type
+    `dataType` and index `i` in `values`, for all `i` in the range
+    [0, `values.Size(dataType)`).
+
+    \pre Bind() has been called successfully on this instance.
+    */
+    void Publish(
+        coral::model::StepID stepID,
+        coral::model::SlaveID slaveID,
+        coral::model::DataType dataType,
+        const coral::model::VariableID* variables,
+        const ValueStore& values);
+
+    /**
+    \brief  Publishes the values of several variables of the same type which
+            have changed since they were last published by this function.
+
+    This works like the other bulk Publish() function, except that values
+    which are equal to the ones published in the previous call for the same
+    data type are left out.  All values are published in the first call for
+    each data type, if the number of values has changed, and after
+    ForgetPublishedValues().  `variables` must list the same variables, in
+    the same order, in every call for a given data type.
+
+    The recipients only know that the other values are unchanged once
+    PublishStepComplete() has been called for the time step.
+
+    \pre Bind() has been called successfully on this instance.
+    */
+    void PublishChanges(
+        coral::model::StepID stepID,
+        coral::model::SlaveID slaveID,
+        coral::model::DataType dataType,
+        const coral::model::VariableID* variables,
+        const ValueStore& values);
+
+    /**
+    \brief  Tells subscribers that all the values for a time step have been
+            published, and that the variables whose values have not been
+            published are unchanged.
+
+    \pre Bind() has been called successfully on this instance.
+    */
+    void PublishStepComplete(
+        coral::model::StepID stepID,
+        coral::model::SlaveID slaveID);
+
+    /// Makes the next PublishChanges() call for each data type publish all values.
+    void ForgetPublishedValues() noexcept;
+
 private:
     std::unique_ptr<zmq::socket_t> m_socket;
+
+    // The values last published with PublishChanges(), and buffers for
+    // the change flags and the indices of the values which have changed.
+    ValueStore m_published;
+    std::vector<unsigned char> m_changeMask;
+    std::vector<std::size_t> m_changed;
 };
 
 
@@ -137,6 +200,11 @@ public:
     \brief  Waits until the values of all subscribed-to variables have been
             received for the given time step.
 
+    If the slave which owns a variable has said that it has published all
+    its values for the time step (see VariablePublisher::PublishStepComplete()),
+    and no value has been received for the variable, it keeps the value it
+    had at the previous Update() call.
+
     \param [in] stepID      The timestep ID for which we should wait for
                             variable data.
     \param [in] timeout     How long to wait without receiving any data.
@@ -163,13 +231,70 @@ public:
 
     \pre Update() has been called successfully.
     */
-    const coral::model::ScalarValue& Value(const coral::model::Variable& variable)
+    coral::model::ScalarValue Value(const coral::model::Variable& variable)
         const;
 
+    /**
+    \brief  Returns where the value of the given variable which was acquired
+            with the last Update() call is stored in Values().
+
+    The slot stays the same from one Update() call to the next, unless
+    SlotRevision() changes.
+
+    \param [in] variable    A variable identifier. The variable must be one
+                            which has previously been subscribed to with
+                            Subscribe().
+
+    \pre Update() has been called successfully.
+    */
+    ValueSlot Slot(const coral::model::Variable& variable) const;
+
+    /**
+    \brief  Returns the values of all subscribed-to variables which were
+            acquired with the last Update() call.
+
+    This is the fast alternative to Value(), for callers that look up the
+    slots of their variables once, with Slot(), and then read the values
+    directly from the arrays every time step.
+    */
+    const ValueStore& Values() const;
+
+    /**
+    \brief  A number which changes whenever the slot of one or more
+            subscribed-to variables in Values() changes.
+
+    This happens when a variable receives its first value, when it receives
+    a value of a different type than before, and when the store is
+    compacted after unsubscriptions.
+    */
+    std::uint64_t SlotRevision() const;
+
 private:
     typedef std::queue<std::pair<coral::model::StepID, coral::model::ScalarValue>>
         ValueQueue;
 
+    // The current value of a variable, which is stored in m_store, and
+    // values for later time steps that have arrived in the meantime.
+    struct Entry
+    {
+        ValueSlot slot;
+        bool hasValue;
+        coral::model::StepID stepID;
+        ValueQueue laterValues;
+    };
+
+    // The number of variables we are subscribed to from a slave, and the
+    // last time step for which it has published all its values.
+    struct Publisher
+    {
+        std::size_t subscriptionCount;
+        coral::model::StepID completedStepID;
+    };
+
+    // Moves the values of all subscribed-to variables into a new store,
+    // leaving out slots which are no longer used.
+    void CompactStore();
+
     // A hash function for Variable objects, so we can put them in a
     // std::unordered_map (below)
     struct VariableHash
@@ -182,7 +307,10 @@ private:
 
     coral::model::StepID m_currentStepID;
     std::unique_ptr<zmq::socket_t> m_socket;
-    std::unordered_map<coral::model::Variable, ValueQueue, VariableHash> m_values;
+    std::unordered_map<coral::model::Variable, Entry, VariableHash> m_values;
+    std::unordered_map<coral::model::SlaveID, Publisher> m_publishers;
+    ValueStore m_store;
+    std::uint64_t m_slotRevision;
 };
 
 
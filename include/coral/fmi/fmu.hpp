@@ -10,6 +10,8 @@
 #ifndef CORAL_FMI_FMU_HPP
 #define CORAL_FMI_FMU_HPP
 
+#include <boost/filesystem/path.hpp>
+
 #include <coral/model.hpp>
 #include <coral/slave/instance.hpp>
 
@@ -62,6 +64,9 @@ public:
     /// Returns the coral::fmi::Importer which was used to import this %FMU.
     virtual std::shared_ptr<coral::fmi::Importer> Importer() const = 0;
 
+    /// Returns the path to the directory in which this %FMU was unpacked.
+    virtual const boost::filesystem::path& Directory() const = 0;
+
     virtual ~FMU() { }
 };
 
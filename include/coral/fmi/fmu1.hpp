@@ -10,6 +10,7 @@
 #ifndef CORAL_FMI_FMU1_HPP
 #define CORAL_FMI_FMU1_HPP
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
@@ -25,6 +26,8 @@
 // Forward declarations to avoid external dependency on FMI Library
 struct fmi1_import_t;
 typedef unsigned int fmi1_value_reference_t;
+typedef char fmi1_boolean_t;
+typedef const char* fmi1_string_t;
 
 
 namespace coral
@@ -77,7 +80,7 @@ public:
     std::shared_ptr<SlaveInstance1> InstantiateSlave1();
 
     /// Returns the path to the directory in which this %FMU was unpacked.
-    const boost::filesystem::path& Directory() const;
+    const boost::filesystem::path& Directory() const override;
 
     /**
     \brief  Returns the FMI value reference for the variable with the given ID.
@@ -92,6 +95,29 @@ public:
     fmi1_value_reference_t FMIValueReference(coral::model::VariableID variable)
         const;
 
+    /**
+    \brief  The IDs and FMI value references of a group of variables.
+
+    `variables[i]` and `valueReferences[i]` refer to the same variable, so
+    `valueReferences.data()` can be passed directly to the FMI functions
+    which get or set several values at once.
+    */
+    struct ValueReferenceTable
+    {
+        std::vector<coral::model::VariableID> variables;
+        std::vector<fmi1_value_reference_t> valueReferences;
+    };
+
+    /**
+    \brief  Returns the IDs and FMI value references of all variables with
+            the given causality and data type, ordered by ID.
+
+    The tables are built when the %FMU is loaded, so this is cheap to call.
+    */
+    const ValueReferenceTable& ValueReferences(
+        coral::model::Causality causality,
+        coral::model::DataType dataType) const;
+
     /// Returns the underlying C API handle (for FMI Library)
     fmi1_import_t* FmilibHandle() const;
 
@@ -102,6 +128,7 @@ private:
     fmi1_import_t* m_handle;
     std::unique_ptr<coral::model::SlaveTypeDescription> m_description;
     std::vector<fmi1_value_reference_t> m_valueReferences;
+    std::vector<ValueReferenceTable> m_valueReferenceTables;
     std::vector<std::weak_ptr<SlaveInstance1>> m_instances;
 
 #ifdef _WIN32
@@ -154,6 +181,37 @@ public:
     bool SetBooleanVariable(coral::model::VariableID variable, bool value) override;
     bool SetStringVariable(coral::model::VariableID variable, const std::string& value) override;
 
+    std::unique_ptr<coral::slave::VariableGroup> PrepareVariables(
+        coral::model::DataType dataType,
+        const coral::model::VariableID* variables,
+        std::size_t count) const override;
+
+    void GetRealVariables(
+        const coral::slave::VariableGroup& variables,
+        double* values) const override;
+    void GetIntegerVariables(
+        const coral::slave::VariableGroup& variables,
+        int* values) const override;
+    void GetBooleanVariables(
+        const coral::slave::VariableGroup& variables,
+        bool* values) const override;
+    void GetStringVariables(
+        const coral::slave::VariableGroup& variables,
+        std::string* values) const override;
+
+    bool SetRealVariables(
+        const coral::slave::VariableGroup& variables,
+        const double* values) override;
+    bool SetIntegerVariables(
+        const coral::slave::VariableGroup& variables,
+        const int* values) override;
+    bool SetBooleanVariables(
+        const coral::slave::VariableGroup& variables,
+        const bool* values) override;
+    bool SetStringVariables(
+        const coral::slave::VariableGroup& variables,
+        const std::string* values) override;
+
     // coral::fmi::SlaveInstance methods
     std::shared_ptr<coral::fmi::FMU> FMU() const override;
 
@@ -164,6 +222,13 @@ public:
     fmi1_import_t* FmilibHandle() const;
 
 private:
+    // Returns the FMI value references of `variables`, after checking that
+    // the group was prepared by this instance and has the data type
+    // `dataType`.
+    const std::vector<fmi1_value_reference_t>& ValueReferences(
+        const coral::slave::VariableGroup& variables,
+        coral::model::DataType dataType) const;
+
     std::shared_ptr<coral::fmi::FMU1> m_fmu;
     fmi1_import_t* m_handle;
 
@@ -173,6 +238,10 @@ private:
     std::string m_instanceName;
     coral::model::TimePoint m_startTime = 0.0;
     coral::model::TimePoint m_stopTime  = coral::model::ETERNITY;
+
+    // Scratch space for the functions that get or set several values at once.
+    mutable std::vector<fmi1_boolean_t> m_booleanBuffer;
+    mutable std::vector<fmi1_string_t> m_stringBuffer;
 };
 
 
@@ -10,6 +10,7 @@
 #ifndef CORAL_FMI_FMU2_HPP
 #define CORAL_FMI_FMU2_HPP
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
@@ -25,6 +26,9 @@
 // Forward declarations to avoid external dependency on FMI Library
 struct fmi2_import_t;
 typedef unsigned int fmi2_value_reference_t;
+typedef int fmi2_boolean_t;
+typedef const char* fmi2_string_t;
+typedef void* fmi2_component_t;
 
 
 namespace coral
@@ -35,6 +39,7 @@ namespace fmi
 #ifdef _WIN32
 class AdditionalPath;
 #endif
+class FMI2Library;
 class SlaveInstance2;
 
 
@@ -43,6 +48,10 @@ class SlaveInstance2;
 
 This class is an implementation of coral::fmi::FMU specialised for FMUs that
 implement FMI v2.0.
+
+The model description is parsed and the %FMU's shared library is loaded only
+once per FMU2 object, and shared by all slave instances created from it.
+Each instance has its own FMI component.
 */
 class FMU2 : public coral::fmi::FMU, public std::enable_shared_from_this<FMU2>
 {
@@ -73,11 +82,16 @@ public:
 
     This is equivalent to InstantiateSlave(), except that the returned object
     is statically typed as an FMI 2.0 slave.
+
+    \throws std::runtime_error
+        If the %FMU has the `canBeInstantiatedOnlyOncePerProcess` capability
+        and an instance of it already exists.  Such FMUs must be run in
+        separate processes, one instance each (as coralslave does).
     */
     std::shared_ptr<SlaveInstance2> InstantiateSlave2();
 
     /// Returns the path to the directory in which this %FMU was unpacked.
-    const boost::filesystem::path& Directory() const;
+    const boost::filesystem::path& Directory() const override;
 
     /**
     \brief  Returns the FMI value reference for the variable with the given ID.
@@ -92,6 +106,29 @@ public:
     fmi2_value_reference_t FMIValueReference(coral::model::VariableID variable)
         const;
 
+    /**
+    \brief  The IDs and FMI value references of a group of variables.
+
+    `variables[i]` and `valueReferences[i]` refer to the same variable, so
+    `valueReferences.data()` can be passed directly to the FMI functions
+    which get or set several values at once.
+    */
+    struct ValueReferenceTable
+    {
+        std::vector<coral::model::VariableID> variables;
+        std::vector<fmi2_value_reference_t> valueReferences;
+    };
+
+    /**
+    \brief  Returns the IDs and FMI value references of all variables with
+            the given causality and data type, ordered by ID.
+
+    The tables are built when the %FMU is loaded, so this is cheap to call.
+    */
+    const ValueReferenceTable& ValueReferences(
+        coral::model::Causality causality,
+        coral::model::DataType dataType) const;
+
     /// Returns the underlying C API handle (for FMI Library)
     fmi2_import_t* FmilibHandle() const;
 
@@ -102,8 +139,12 @@ private:
     fmi2_import_t* m_handle;
     std::unique_ptr<coral::model::SlaveTypeDescription> m_description;
     std::vector<fmi2_value_reference_t> m_valueReferences;
+    std::vector<ValueReferenceTable> m_valueReferenceTables;
     std::vector<std::weak_ptr<SlaveInstance2>> m_instances;
 
+    // Loaded by the first call to InstantiateSlave2().
+    std::shared_ptr<const FMI2Library> m_library;
+
 #ifdef _WIN32
     // Workaround for VIPROMA-67 (FMU DLL search paths on Windows).
     std::unique_ptr<AdditionalPath> m_additionalDllSearchPath;
@@ -117,7 +158,9 @@ class SlaveInstance2 : public coral::fmi::SlaveInstance
 private:
     // Only FMU2 is allowed to instantiate this class.
     friend std::shared_ptr<SlaveInstance2> coral::fmi::FMU2::InstantiateSlave2();
-    SlaveInstance2(std::shared_ptr<coral::fmi::FMU2> fmu);
+    SlaveInstance2(
+        std::shared_ptr<coral::fmi::FMU2> fmu,
+        std::shared_ptr<const FMI2Library> library);
 
 public:
     // Disable copy and move.
@@ -154,23 +197,70 @@ public:
     bool SetBooleanVariable(coral::model::VariableID variable, bool value) override;
     bool SetStringVariable(coral::model::VariableID variable, const std::string& value) override;
 
+    std::unique_ptr<coral::slave::VariableGroup> PrepareVariables(
+        coral::model::DataType dataType,
+        const coral::model::VariableID* variables,
+        std::size_t count) const override;
+
+    void GetRealVariables(
+        const coral::slave::VariableGroup& variables,
+        double* values) const override;
+    void GetIntegerVariables(
+        const coral::slave::VariableGroup& variables,
+        int* values) const override;
+    void GetBooleanVariables(
+        const coral::slave::VariableGroup& variables,
+        bool* values) const override;
+    void GetStringVariables(
+        const coral::slave::VariableGroup& variables,
+        std::string* values) const override;
+
+    bool SetRealVariables(
+        const coral::slave::VariableGroup& variables,
+        const double* values) override;
+    bool SetIntegerVariables(
+        const coral::slave::VariableGroup& variables,
+        const int* values) override;
+    bool SetBooleanVariables(
+        const coral::slave::VariableGroup& variables,
+        const bool* values) override;
+    bool SetStringVariables(
+        const coral::slave::VariableGroup& variables,
+        const std::string* values) override;
+
     // coral::fmi::SlaveInstance methods
     std::shared_ptr<coral::fmi::FMU> FMU() const override;
 
     /// Returns the same object as FMU(), only statically typed as an FMU2.
     std::shared_ptr<coral::fmi::FMU2> FMU2() const;
 
-    /// Returns the underlying C API handle (for FMI Library)
-    fmi2_import_t* FmilibHandle() const;
+    /**
+    \brief  Returns the underlying FMI component.
+
+    This is null until Setup() has been called.
+    */
+    fmi2_component_t Component() const;
 
 private:
+    // Returns the FMI value references of `variables`, after checking that
+    // the group was prepared by this instance and has the data type
+    // `dataType`.
+    const std::vector<fmi2_value_reference_t>& ValueReferences(
+        const coral::slave::VariableGroup& variables,
+        coral::model::DataType dataType) const;
+
     std::shared_ptr<coral::fmi::FMU2> m_fmu;
-    fmi2_import_t* m_handle;
+    std::shared_ptr<const FMI2Library> m_library;
+    fmi2_component_t m_component = nullptr;
 
     bool m_setupComplete = false;
     bool m_simStarted = false;
 
     std::string m_instanceName;
+
+    // Scratch space for the functions that get or set several values at once.
+    mutable std::vector<fmi2_boolean_t> m_booleanBuffer;
+    mutable std::vector<fmi2_string_t> m_stringBuffer;
 };
 
 
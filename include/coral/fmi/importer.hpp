@@ -10,6 +10,7 @@
 #ifndef CORAL_FMI_IMPORTER_HPP
 #define CORAL_FMI_IMPORTER_HPP
 
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
@@ -34,6 +35,24 @@ namespace fmi
 class FMU;
 
 
+/// How much of an %FMU's contents an Importer unpacks.
+enum class UnpackMode
+{
+    /// Unpack the entire %FMU.
+    full,
+
+    /**
+    \brief  Unpack only what is needed to use the %FMU on this platform.
+
+    The model description and the binaries for the current platform are
+    unpacked on import, while the `resources` directory is unpacked when
+    the first slave is instantiated.  Documentation, sources and binaries
+    for other platforms are never unpacked.
+    */
+    selective
+};
+
+
 /**
 \brief  Imports and caches FMUs.
 
@@ -46,12 +65,16 @@ time they are imported.  This is a huge time-saver when large and/or many FMUs
 are loaded.  The path to this cache may be supplied by the user, in which case
 it is not automatically emptied on destruction.  Thus, if the same path is
 supplied each time, the cache becomes persistent between program runs.
-It may be cleared manually by calling CleanCache().
-
-\warning
-    Currently there are no synchronisation mechanisms to protect the cache from
-    concurrent use, so accessing the same cache from multiple
-    instances/processes will likely cause problems.
+Unused FMUs may be removed from it by calling CleanCache(), and the cache
+may be kept below a certain size with SetCacheSizeLimit().
+
+FMUs are stored in the cache under a key computed from the names, sizes and
+CRC-32 checksums of the files they contain, so an %FMU is unpacked anew if,
+and only if, its contents have changed.  The same cache may be used by
+several Importer objects at once, also in different processes.  An %FMU is
+unpacked by only one of them, while the others wait for it to finish, and an
+%FMU is never removed from the cache while an FMU object refers to it.
+This is ensured with advisory file locks (see coral::util::FileLock).
 */
 class Importer : public std::enable_shared_from_this<Importer>
 {
@@ -64,9 +87,12 @@ public:
     \param [in] cachePath
         The path to the directory which will hold the %FMU cache.  If it does
         not exist already, it will be created.
+    \param [in] unpackMode
+        How much of each %FMU to unpack.
     */
     static std::shared_ptr<Importer> Create(
-        const boost::filesystem::path& cachePath);
+        const boost::filesystem::path& cachePath,
+        UnpackMode unpackMode = UnpackMode::full);
 
     /**
     \brief  Creates a new %FMU importer that uses a temporary cache directory.
@@ -74,13 +100,17 @@ public:
     A new cache directory will be created in a location suitable for temporary
     files under the conventions of the operating system.  It will be completely
     removed again on destruction.
+
+    \param [in] unpackMode
+        How much of each %FMU to unpack.
     */
-    static std::shared_ptr<Importer> Create();
+    static std::shared_ptr<Importer> Create(
+        UnpackMode unpackMode = UnpackMode::full);
 
 private:
     // Private constructors, to force use of factory functions.
-    Importer(const boost::filesystem::path& cachePath);
-    Importer(coral::util::TempDir tempDir);
+    Importer(const boost::filesystem::path& cachePath, UnpackMode unpackMode);
+    Importer(coral::util::TempDir tempDir, UnpackMode unpackMode);
 
 public:
     /**
@@ -115,12 +145,40 @@ public:
         const boost::filesystem::path& unpackedFMUPath);
 
     /**
-    \brief  Removes unused files and directories from the %FMU cache.
+    \brief  Unpacks the parts of an %FMU whose unpacking has been deferred.
+
+    When an %FMU is imported in UnpackMode::selective, some of its contents
+    are only unpacked when the first slave is instantiated.  This function
+    unpacks them right away, so that `fmu.Directory()` holds everything
+    needed to instantiate the %FMU, e.g. so it can be passed to
+    ImportUnpacked() in another process.  For other FMUs, it does nothing.
+
+    \param [in] fmu
+        An %FMU which was imported with this importer.
+    */
+    void CompleteUnpacking(const FMU& fmu);
+
+    /**
+    \brief  Removes unused FMUs from the cache.
+
+    FMUs are removed in order of least recent use, until the total size of
+    the cache is at most `maxSize` bytes.  FMUs which are in use, i.e., for
+    which there exist FMU objects, whether created by this or another
+    Importer, are never removed.  With the default `maxSize` of zero, all
+    unused FMUs are removed.
+    */
+    void CleanCache(std::uint64_t maxSize = 0);
+
+    /**
+    \brief  Sets a limit on the size of the cache.
+
+    If set, CleanCache() is called with `maxSize` as its argument whenever
+    Import() has unpacked an %FMU.  By default, there is no limit.
 
-    This will remove all %FMU contents from the cache, except the ones for
-    which there currently exist FMU objects.
+    \param [in] maxSize
+        The maximum size of the cache, in bytes.  Zero means no limit.
     */
-    void CleanCache();
+    void SetCacheSizeLimit(std::uint64_t maxSize);
 
     /// Returns the last FMI Library error message.
     std::string LastErrorMessage();
@@ -131,16 +189,33 @@ public:
 private:
     void PrunePtrCaches();
 
+    struct CacheEntryLock
+    {
+        std::weak_ptr<FMU> fmu;
+        std::unique_ptr<coral::util::FileLock> lock;
+    };
+
     // Note: The order of these declarations is important!
     std::unique_ptr<coral::util::TempDir> m_tempCacheDir; // Only used when no cache dir is given
     std::unique_ptr<jm_callbacks> m_callbacks;
     std::unique_ptr<fmi_import_context_t, void (*)(fmi_import_context_t*)> m_handle;
 
     boost::filesystem::path m_fmuDir;
+    boost::filesystem::path m_lockDir;
     boost::filesystem::path m_workDir;
+    UnpackMode m_unpackMode;
+    std::uint64_t m_cacheSizeLimit;
 
     std::map<boost::filesystem::path, std::weak_ptr<FMU>> m_pathCache;
     std::map<std::string, std::weak_ptr<FMU>> m_guidCache;
+
+    // Shared locks on the cache entries of the FMUs we have imported, which
+    // prevent other importers from removing them.  Keyed by unpack directory.
+    std::map<boost::filesystem::path, CacheEntryLock> m_cacheLocks;
+
+    // Maps the unpack directories of selectively imported FMUs to the FMU
+    // files, for FMUs whose resources have not been unpacked yet.
+    std::map<boost::filesystem::path, boost::filesystem::path> m_deferredUnpacks;
 };
 
 
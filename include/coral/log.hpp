@@ -10,6 +10,7 @@
 #ifndef CORAL_LOG_HPP
 #define CORAL_LOG_HPP
 
+#include <atomic>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -34,6 +35,32 @@ enum Level
     error
 };
 
+/**
+\brief  Log message categories.
+
+Each log message belongs to a category, which corresponds to the subsystem
+that produced it.  In addition to the per-sink level filtering, a minimum
+level may be set for each category with `SetCategoryLevel()`.  This makes it
+possible to e.g. enable trace logging for the data exchange between slaves
+without also getting (and paying for) trace messages from the master/slave
+control communication.
+*/
+enum Category
+{
+    /// Messages that do not belong to any particular subsystem.
+    general,
+
+    /// Networking, including the exchange of variable values between slaves.
+    net,
+
+    /// Master/slave control communication.
+    bus,
+
+    /// FMU import and FMI function calls.
+    fmi
+};
+
+
 /**
 \brief  Reads a log level from a string.
 
@@ -44,6 +71,16 @@ the one that matches.
 Level ParseLevel(std::string str);
 
 
+/**
+\brief  Reads a log category from a string.
+
+This will remove leading and trailing whitespace, convert the string to
+lowercase, compare it to the names of the `Category` constants and return
+the one that matches.
+*/
+Category ParseCategory(std::string str);
+
+
 /// Writes a plain C string to the global logger.
 void Log(Level level, const char* message) noexcept;
 
@@ -56,36 +93,77 @@ void Log(Level level, const boost::format& message) noexcept;
 
 namespace detail
 {
+    const int categoryCount = fmi + 1;
+
+    // The lowest level of messages which will be written to any sink, per
+    // category.  This is updated by AddSink() and SetCategoryLevel(), and
+    // read by IsEnabled(), which must not need to take a lock.
+    extern std::atomic<int> effectiveLevels[categoryCount];
+
     // These are intended for use in the macros below
-    void LogLoc(Level level, const char* file, int line, const char* message) noexcept;
-    void LogLoc(Level level, const char* file, int line, const std::string& message) noexcept;
-    void LogLoc(Level level, const char* file, int line, const boost::format& message) noexcept;
+    void LogLoc(Level level, Category category, const char* file, int line, const char* message) noexcept;
+    void LogLoc(Level level, Category category, const char* file, int line, const std::string& message) noexcept;
+    void LogLoc(Level level, Category category, const char* file, int line, const boost::format& message) noexcept;
 }
 
 
 /**
-\def    CORAL_LOG_TRACE(args)
+\brief  Returns whether a message with the given level and category would be
+        written to at least one sink.
+
+This is a cheap, lock-free check which may be used to avoid the cost of
+constructing log messages that would be filtered out anyway.  The logging
+macros below use it to skip evaluation of their arguments altogether.
+*/
+inline bool IsEnabled(Level level, Category category = general) noexcept
+{
+    return level >= detail::effectiveLevels[category].load(std::memory_order_relaxed);
+}
+
+
+/**
+\def    CORAL_LOG_CAT_TRACE(category, args)
 \brief  If the macro CORAL_LOG_TRACE_ENABLED is defined, this is equivalent
         to calling `Log(trace, args)`, except that the file and line number
         are also logged.  Otherwise, it is a no-op.
+
+`args` are only evaluated if `IsEnabled(trace, category)` is `true`.
+*/
+/**
+\def    CORAL_LOG_TRACE(args)
+\brief  Equivalent to `CORAL_LOG_CAT_TRACE(coral::log::general, args)`.
 */
 #ifdef CORAL_LOG_TRACE_ENABLED
-#   define CORAL_LOG_TRACE(...) coral::log::detail::LogLoc(coral::log::trace, __FILE__, __LINE__, __VA_ARGS__)
+#   define CORAL_LOG_CAT_TRACE(category, ...) \
+        (coral::log::IsEnabled(coral::log::trace, category) \
+            ? coral::log::detail::LogLoc(coral::log::trace, category, __FILE__, __LINE__, __VA_ARGS__) \
+            : (void)0)
 #else
-#   define CORAL_LOG_TRACE(...) ((void)0)
+#   define CORAL_LOG_CAT_TRACE(category, ...) ((void)0)
 #endif
+#define CORAL_LOG_TRACE(...) CORAL_LOG_CAT_TRACE(coral::log::general, __VA_ARGS__)
 
 /**
-\def    CORAL_LOG_DEBUG(args)
+\def    CORAL_LOG_CAT_DEBUG(category, args)
 \brief  If either of the macros CORAL_LOG_DEBUG_ENABLED or CORAL_LOG_TRACE_ENABLED
         are defined, this is equivalent to calling `Log(debug, args)`, except
         that the file and line number are also logged.  Otherwise, it is a no-op.
+
+`args` are only evaluated if `IsEnabled(debug, category)` is `true`.
+*/
+/**
+\def    CORAL_LOG_DEBUG(args)
+\brief  Equivalent to `CORAL_LOG_CAT_DEBUG(coral::log::general, args)`.
 */
 #if defined(CORAL_LOG_DEBUG_ENABLED) || defined(CORAL_LOG_TRACE_ENABLED)
-#   define CORAL_LOG_DEBUG(...) coral::log::detail::LogLoc(coral::log::debug, __FILE__, __LINE__, __VA_ARGS__)
+#   define CORAL_LOG_CAT_DEBUG(category, ...) \
+        (coral::log::IsEnabled(coral::log::debug, category) \
+            ? coral::log::detail::LogLoc(coral::log::debug, category, __FILE__, __LINE__, __VA_ARGS__) \
+            : (void)0)
 #else
-#   define CORAL_LOG_DEBUG(...) ((void)0)
+#   define CORAL_LOG_CAT_DEBUG(category, ...) ((void)0)
 #endif
+#define CORAL_LOG_DEBUG(...) CORAL_LOG_CAT_DEBUG(coral::log::general, __VA_ARGS__)
 
 
 /**
@@ -101,6 +179,24 @@ with the new one. Subsequent calls will add new sinks.
 void AddSink(std::shared_ptr<std::ostream> stream, Level level = error);
 
 
+/**
+\brief Removes all sinks which write to the given stream.
+
+If no sinks remain, the default sink is restored, and the next call to
+`AddSink()` will replace it again.
+*/
+void RemoveSink(const std::shared_ptr<std::ostream>& stream);
+
+
+/**
+\brief Sets the minimum level of messages to log for the given category.
+
+This filter applies in addition to the per-sink level.  By default, all
+categories have level `trace`, i.e., only the sink levels apply.
+*/
+void SetCategoryLevel(Category category, Level level);
+
+
 /// Convenience function for making a `std::shared_ptr` to `std::clog`.
 std::shared_ptr<std::ostream> CLogPtr() noexcept;
 
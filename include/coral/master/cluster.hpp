@@ -36,7 +36,8 @@ namespace master
  *  and to instantiate slaves on specific providers.
  *
  *  Slave providers are discovered automatically by listening for UDP
- *  broadcast messages that they broadcast periodically.
+ *  broadcast messages that they broadcast periodically, and which they also
+ *  send in response to a probe when the object is created.
  *
  *  \remark
  *  When an object of this class is created, it will spawn a background thread
@@ -91,6 +92,10 @@ public:
      *  Returns the slave types which are offered by all slave providers
      *  discovered so far.
      *
+     *  The slave type descriptions include variable descriptions, which are
+     *  requested from the slave providers the first time they are needed.
+     *  If the variables are not needed, `GetSlaveTypeCatalog()` is cheaper.
+     *
      *  \warning
      *      After an object of this class has been constructed, it may
      *      take some time for it to discover all slave providers.
@@ -101,6 +106,73 @@ public:
     */
     std::vector<SlaveType> GetSlaveTypes(std::chrono::milliseconds timeout);
 
+    /**
+     *  \brief
+     *  Returns full descriptions of specific slave types.
+     *
+     *  This is like `GetSlaveTypes(std::chrono::milliseconds)`, except that
+     *  only the slave types with the given UUIDs are returned, in the same
+     *  order.  Only the descriptions that are not already cached are
+     *  requested from the slave providers.
+     *
+     *  \param [in] slaveTypeUUIDs
+     *      The UUIDs of the slave types.  Must be nonempty.
+     *  \param [in] timeout
+     *      The communications timeout used to detect loss of communication
+     *      with slave providers.  A negative value means no timeout.
+     *
+     *  \throws std::runtime_error
+     *      If one of the slave types is not offered by any known slave
+     *      provider, or if its description could not be obtained.
+    */
+    std::vector<SlaveType> GetSlaveTypes(
+        const std::vector<std::string>& slaveTypeUUIDs,
+        std::chrono::milliseconds timeout);
+
+    /**
+     *  \brief
+     *  Returns the slave types which are offered by all slave providers
+     *  discovered so far, without variable descriptions.
+     *
+     *  Each slave provider's catalog is requested when the provider is
+     *  discovered, and again only if the provider advertises a new catalog
+     *  version, so this function normally returns without communicating with
+     *  the slave providers.
+     *
+     *  \param [in] timeout
+     *      How long to wait for catalog requests which are in progress.
+     *      A negative value means no timeout.
+    */
+    std::vector<SlaveType> GetSlaveTypeCatalog(std::chrono::milliseconds timeout);
+
+    /**
+     *  \brief
+     *  Waits until the given slave types are offered by the slave providers
+     *  that have been discovered, or until a timeout.
+     *
+     *  Slave providers are asked to announce themselves when the object is
+     *  constructed, and the slave types offered by each provider are
+     *  requested as soon as it has been discovered.  This function returns as
+     *  soon as all the named slave types are available, and can therefore be
+     *  used instead of waiting a fixed amount of time before calling
+     *  `GetSlaveTypes()`.
+     *
+     *  If `slaveTypeNames` is empty, the function instead waits until at
+     *  least one slave provider has reported its slave types, and no new
+     *  slave providers have been discovered for a short while.
+     *
+     *  \param [in] slaveTypeNames
+     *      The names of the required slave types.
+     *  \param [in] timeout
+     *      The maximum amount of time to wait.
+     *
+     *  \returns
+     *      Whether the slave types became available before the timeout.
+     */
+    bool WaitForSlaveTypes(
+        const std::vector<std::string>& slaveTypeNames,
+        std::chrono::milliseconds timeout);
+
     /**
      *  \brief
      *  Requests that a slave be spawned by a specific slave provider.
@@ -130,6 +202,46 @@ public:
         const std::string& slaveTypeUUID,
         std::chrono::milliseconds timeout);
 
+    /// A number of slaves to be instantiated with `InstantiateSlaves()`.
+    struct InstantiationRequest
+    {
+        /// The ID of the slave provider that should instantiate the slaves.
+        std::string slaveProviderID;
+
+        /// The UUID of the slave type.
+        std::string slaveTypeUUID;
+
+        /// The number of slaves.
+        int count;
+    };
+
+    /**
+     *  \brief
+     *  Requests that several slaves be spawned.
+     *
+     *  This has the same effect as calling `InstantiateSlave()` once for
+     *  each slave, but each slave provider receives a single request for
+     *  all the slaves it should instantiate, and starts them concurrently.
+     *  The function therefore takes roughly as long as the slowest slave
+     *  takes to start, rather than the sum of all startup times.
+     *
+     *  If any of the slaves could not be instantiated, an exception is thrown
+     *  once all slave providers have replied.
+     *
+     *  \param [in] requests
+     *      The slaves to instantiate.
+     *  \param [in] timeout
+     *      How much time each slave gets to start up.
+     *      A negative value means no limit.
+     *
+     *  \returns
+     *      The slave locators, `requests[0].count` locators for the first
+     *      request, followed by `requests[1].count` for the second, etc.
+     */
+    std::vector<coral::net::SlaveLocator> InstantiateSlaves(
+        const std::vector<InstantiationRequest>& requests,
+        std::chrono::milliseconds timeout);
+
 private:
     class Private;
     std::unique_ptr<Private> m_private;
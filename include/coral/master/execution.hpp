@@ -13,12 +13,14 @@
 #include <chrono>
 #include <future>
 #include <iterator>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include <coral/config.h>
 #include <coral/master/execution_options.hpp>
+#include <coral/master/step_statistics.hpp>
 #include <coral/model.hpp>
 #include <coral/net.hpp>
 
@@ -292,6 +294,20 @@ public:
      */
     void AcceptStep(std::chrono::milliseconds timeout);
 
+    /**
+     *  \brief
+     *  Returns timing statistics for the time steps performed so far,
+     *  per slave.
+     *
+     *  Each slave measures the time it spends calculating, publishing its
+     *  outputs and waiting for its inputs in each time step, and reports
+     *  this to the master.  The statistics are updated for every
+     *  successful `AcceptStep()` call.  Slaves which do not report their
+     *  timings (e.g. because they run an older version of Coral) are
+     *  counted with zero durations.
+     */
+    std::map<coral::model::SlaveID, SlaveStepStatistics> StepStatistics();
+
     /**
      *  \brief
      *  Terminates the execution.
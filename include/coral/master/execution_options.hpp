@@ -58,6 +58,31 @@ struct ExecutionOptions
      *  A negative value means no timeout.
      */
     std::chrono::milliseconds slaveVariableRecvTimeout = std::chrono::seconds(1);
+
+    /**
+     *  \brief
+     *  Whether time step commands should be broadcast to the slaves.
+     *
+     *  If this is enabled, the STEP and ACCEPT_STEP commands are published
+     *  once, on a channel which all slaves subscribe to, instead of being
+     *  sent to each slave in turn.  The slaves still acknowledge them
+     *  individually.  This reduces the per-step overhead in the master for
+     *  executions with many slaves.  Slaves which don't support it receive
+     *  the commands as usual.
+     */
+    bool broadcastStepCommands = false;
+
+    /**
+     *  \brief
+     *  Whether slaves should only publish output values which have changed.
+     *
+     *  If this is enabled, each slave compares its output values with the
+     *  ones it published in the previous time step and only sends those
+     *  which differ, followed by a message which marks the end of the step.
+     *  This saves bandwidth and CPU time for models whose outputs are mostly
+     *  constant.  It requires that all slaves in the execution support it.
+     */
+    bool deltaPublication = false;
 };
 
 
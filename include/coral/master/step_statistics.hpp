@@ -0,0 +1,118 @@
+/**
+\file
+\brief Timing statistics for the time steps performed by slaves.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_MASTER_STEP_STATISTICS_HPP
+#define CORAL_MASTER_STEP_STATISTICS_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+
+namespace coral
+{
+namespace master
+{
+
+
+/**
+ *  \brief
+ *  The wall-clock time a slave spent in the different phases of one time
+ *  step, as measured and reported by the slave itself.
+ *
+ *  Durations which the slave has not reported are zero.
+ */
+struct SlaveStepTimings
+{
+    /// Time spent performing the actual calculations (i.e., in `DoStep()`).
+    std::chrono::nanoseconds doStep = std::chrono::nanoseconds(0);
+
+    /// Time spent publishing output variable values.
+    std::chrono::nanoseconds publish = std::chrono::nanoseconds(0);
+
+    /// Time spent waiting for input variable values from other slaves.
+    std::chrono::nanoseconds dataWait = std::chrono::nanoseconds(0);
+};
+
+
+/**
+ *  \brief
+ *  A histogram of durations.
+ *
+ *  The durations are sorted into logarithmically spaced buckets, with four
+ *  buckets per power of two, so percentiles are accurate to within about
+ *  20%.  The minimum, maximum and mean are exact.
+ */
+class DurationHistogram
+{
+public:
+    /// Constructs an empty histogram.
+    DurationHistogram() noexcept;
+
+    /// Adds a duration to the histogram.  Negative durations count as zero.
+    void Add(std::chrono::nanoseconds duration) noexcept;
+
+    /// Returns the number of durations that have been added.
+    std::uint64_t Count() const noexcept;
+
+    /// Returns the shortest duration, or zero if the histogram is empty.
+    std::chrono::nanoseconds Min() const noexcept;
+
+    /// Returns the longest duration, or zero if the histogram is empty.
+    std::chrono::nanoseconds Max() const noexcept;
+
+    /// Returns the mean duration, or zero if the histogram is empty.
+    std::chrono::nanoseconds Mean() const noexcept;
+
+    /**
+     *  \brief
+     *  Returns an approximation of the given percentile, or zero if the
+     *  histogram is empty.
+     *
+     *  \param [in] percentile
+     *      A number in the range [0, 100].
+     *
+     *  \throws std::invalid_argument if `percentile` is out of range.
+     */
+    std::chrono::nanoseconds Percentile(double percentile) const;
+
+private:
+    static const int bucketCount = 256;
+    std::array<std::uint64_t, bucketCount> m_buckets;
+    std::uint64_t m_count;
+    std::int64_t m_min;
+    std::int64_t m_max;
+    double m_sum;
+};
+
+
+/**
+ *  \brief
+ *  Timing statistics for the time steps performed by one slave.
+ *
+ *  \see Execution::StepStatistics()
+ */
+struct SlaveStepStatistics
+{
+    /// Time spent performing the actual calculations.
+    DurationHistogram doStep;
+
+    /// Time spent publishing output variable values.
+    DurationHistogram publish;
+
+    /// Time spent waiting for input variable values from other slaves.
+    DurationHistogram dataWait;
+
+    /// Adds the timings for one time step.
+    void Add(const SlaveStepTimings& timings) noexcept;
+};
+
+
+}} // namespace
+#endif // header guard
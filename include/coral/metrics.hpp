@@ -0,0 +1,257 @@
+/**
+\file
+\brief  Main header file for coral::metrics.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_METRICS_HPP
+#define CORAL_METRICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <coral/config.h>
+
+
+namespace coral
+{
+/**
+\brief  Process-wide performance metrics.
+
+Metrics are registered by name in a global registry, with `GetCounter()`,
+`GetGauge()` and `GetHistogram()`, and are exported in the Prometheus text
+format with `WritePrometheusText()` or periodically with an `Exporter`.
+
+Registering a metric takes a lock, so code on hot paths should look up its
+metrics once and hold on to the returned references.  Updating a metric is
+lock free, and the references stay valid for the lifetime of the process.
+*/
+namespace metrics
+{
+
+
+/// A list of label name/value pairs which identify a metric within a family.
+typedef std::vector<std::pair<std::string, std::string>> Labels;
+
+
+/// A monotonically increasing counter.
+class Counter
+{
+public:
+    Counter() noexcept : m_value(0) { }
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+
+    /// Increments the counter by `n`.
+    void Increment(std::uint64_t n = 1) noexcept
+    {
+        m_value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /// Returns the current value.
+    std::uint64_t Value() const noexcept
+    {
+        return m_value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::uint64_t> m_value;
+};
+
+
+/// A value which may go up and down.
+class Gauge
+{
+public:
+    Gauge() noexcept : m_value(0.0) { }
+    Gauge(const Gauge&) = delete;
+    Gauge& operator=(const Gauge&) = delete;
+
+    /// Sets the value.
+    void Set(double value) noexcept
+    {
+        m_value.store(value, std::memory_order_relaxed);
+    }
+
+    /// Adds `delta` (which may be negative) to the value.
+    void Add(double delta) noexcept;
+
+    /// Returns the current value.
+    double Value() const noexcept
+    {
+        return m_value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<double> m_value;
+};
+
+
+/**
+\brief  A histogram of non-negative integer values, e.g. durations in
+        nanoseconds.
+
+The values are sorted into logarithmically spaced buckets, with four buckets
+per power of two, in the manner of HDR histograms.  Quantiles computed from
+the histogram are thus accurate to within about 20%.
+*/
+class Histogram
+{
+public:
+    /// The number of buckets.
+    static const int bucketCount = 256;
+
+    /// A consistent copy of a histogram's state.
+    struct Snapshot
+    {
+        std::uint64_t count = 0;
+        std::int64_t sum = 0;
+        std::vector<std::uint64_t> buckets;
+
+        /**
+        \brief  Returns an approximation of the given quantile, or zero if
+                the histogram is empty.
+
+        \param [in] q   A number in the range [0, 1].
+        */
+        std::int64_t Quantile(double q) const;
+    };
+
+    Histogram() noexcept;
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    /// Records a value.  Negative values count as zero.
+    void Record(std::int64_t value) noexcept;
+
+    /**
+    \brief  Records the time elapsed since `start`, in nanoseconds.
+    */
+    void RecordSince(std::chrono::steady_clock::time_point start) noexcept
+    {
+        Record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    /**
+    \brief  Returns a copy of the histogram's state.
+
+    If values are recorded concurrently, the snapshot may not include all
+    of them, but it is always internally consistent.
+    */
+    Snapshot Take() const;
+
+private:
+    std::atomic<std::uint64_t> m_buckets[bucketCount];
+    std::atomic<std::int64_t> m_sum;
+};
+
+
+/**
+\brief  Returns the counter with the given name and labels, creating it if
+        it doesn't exist.
+
+\param [in] name
+    The metric name.  Should follow the Prometheus naming conventions.
+\param [in] help
+    A description of the metric.  Only used the first time a metric with
+    this name is registered with a non-empty description, so code which
+    merely reads a metric may pass an empty string.
+\param [in] labels
+    Labels which distinguish this counter from others with the same name.
+\param [in] unit
+    A factor by which the value is multiplied on export.  Only used the first
+    time a metric with this name is registered.  This makes it possible to
+    e.g. count nanoseconds and export seconds.
+
+\throws std::logic_error if a metric with the same name but a different type
+    has already been registered.
+*/
+Counter& GetCounter(
+    const std::string& name,
+    const std::string& help,
+    const Labels& labels = Labels(),
+    double unit = 1.0);
+
+
+/**
+\brief  Returns the gauge with the given name and labels, creating it if
+        it doesn't exist.
+
+\see GetCounter()
+*/
+Gauge& GetGauge(
+    const std::string& name,
+    const std::string& help,
+    const Labels& labels = Labels());
+
+
+/**
+\brief  Returns the histogram with the given name and labels, creating it if
+        it doesn't exist.
+
+The histogram is exported as a Prometheus summary.
+
+\see GetCounter()
+*/
+Histogram& GetHistogram(
+    const std::string& name,
+    const std::string& help,
+    const Labels& labels = Labels(),
+    double unit = 1.0);
+
+
+/// Writes all registered metrics to `out` in the Prometheus text format.
+void WritePrometheusText(std::ostream& out);
+
+
+/**
+\brief  Exports the metrics periodically, in a background thread.
+
+The metrics may be written to a file, which is replaced atomically every
+time, so it is suitable for e.g. the node_exporter "textfile" collector.
+They may also be served over HTTP on a local port, in which case any request
+to that port receives the current metrics.
+*/
+class Exporter
+{
+public:
+    /**
+    \brief  Starts the export thread.
+
+    \param [in] outputFile
+        The file to write.  If empty, no file is written.
+    \param [in] httpPort
+        The port on which to serve the metrics over HTTP, on the loopback
+        interface.  If zero, no HTTP server is started.
+    \param [in] interval
+        How often to write the file.
+    */
+    Exporter(
+        const std::string& outputFile,
+        std::uint16_t httpPort,
+        std::chrono::milliseconds interval);
+
+    /// Stops the export thread, after writing the file one last time.
+    ~Exporter() noexcept;
+
+    Exporter(const Exporter&) = delete;
+    Exporter& operator=(const Exporter&) = delete;
+
+private:
+    class Private;
+    std::unique_ptr<Private> m_private;
+};
+
+
+}} // namespace
+#endif // header guard
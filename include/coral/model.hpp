@@ -295,6 +295,55 @@ bool operator==(const Variable& a, const Variable& b);
 bool operator!=(const Variable& a, const Variable& b);
 
 
+/**
+\brief  A linear transformation, `y = gain*x + offset`, which is applied to
+        real values as they are passed from an output to an input.
+
+This can be used for simple scaling and unit conversions, e.g. from radians
+to degrees, without adding a separate slave to do it.
+*/
+class LinearTransform
+{
+public:
+    /// Constructs a transformation with the given gain and offset.
+    explicit LinearTransform(double gain = 1.0, double offset = 0.0) noexcept
+        : m_gain(gain), m_offset(offset) { }
+
+    double Gain() const noexcept { return m_gain; }
+    double Offset() const noexcept { return m_offset; }
+
+    /// Whether this transformation leaves all values unchanged.
+    bool IsIdentity() const noexcept { return m_gain == 1.0 && m_offset == 0.0; }
+
+private:
+    double m_gain;
+    double m_offset;
+};
+
+
+/**
+\brief  Ways to combine the values of several output variables into the
+        value of one input variable.
+*/
+enum Aggregation
+{
+    /// The input is connected to a single output.
+    NO_AGGREGATION      = 0,
+
+    /// The input is set to the sum of the outputs.
+    SUM_AGGREGATION     = 1,
+
+    /// The input is set to the smallest of the outputs.
+    MIN_AGGREGATION     = 1 << 1,
+
+    /// The input is set to the largest of the outputs.
+    MAX_AGGREGATION     = 1 << 2,
+
+    /// The input is set to the arithmetic mean of the outputs.
+    MEAN_AGGREGATION    = 1 << 3,
+};
+
+
 /**
 \brief  An object which represents the action of assigning an initial value to
         a variable, or to connect it to another variable.
@@ -317,7 +366,8 @@ public:
     */
     VariableSetting(
         VariableID inputVar,
-        const coral::model::Variable& outputVar);
+        const coral::model::Variable& outputVar,
+        const LinearTransform& transform = LinearTransform());
 
     /**
     \brief  Indicates an input variable which should both be given a specific
@@ -330,7 +380,23 @@ public:
     VariableSetting(
         VariableID inputVar,
         const ScalarValue& value,
-        const coral::model::Variable& outputVar);
+        const coral::model::Variable& outputVar,
+        const LinearTransform& transform = LinearTransform());
+
+    /**
+    \brief  Indicates a real input variable which should be connected to
+            several output variables, and be given an aggregate of their
+            values.
+
+    The transformation, if any, is applied to the aggregate value.
+
+    \pre `aggregation != NO_AGGREGATION` and `outputVars` is not empty.
+    */
+    VariableSetting(
+        VariableID inputVar,
+        const std::vector<coral::model::Variable>& outputVars,
+        coral::model::Aggregation aggregation,
+        const LinearTransform& transform = LinearTransform());
 
     /// The variable ID.
     VariableID Variable() const noexcept;
@@ -349,16 +415,45 @@ public:
 
     /**
     \brief  The output to which the variable is to be connected, if any.
-    \pre `IsConnectionChange() == true`
+    \pre `IsConnectionChange() == true` and `Aggregation() == NO_AGGREGATION`
     */
     const coral::model::Variable& ConnectedOutput() const;
 
+    /**
+    \brief  How the values of several outputs are to be combined into the
+            value of the variable, or `NO_AGGREGATION` if it is connected to
+            a single output.
+    \pre `IsConnectionChange() == true`
+    */
+    coral::model::Aggregation Aggregation() const;
+
+    /**
+    \brief  The outputs to which the variable is to be connected, and whose
+            values are aggregated.
+    \pre `IsConnectionChange() == true` and `Aggregation() != NO_AGGREGATION`
+    */
+    const std::vector<coral::model::Variable>& AggregatedOutputs() const;
+
+    /**
+    \brief  The transformation which is applied to values passed through the
+            connection.
+
+    This is the identity transformation unless another one was specified.
+    It may only be different from the identity for real variables.
+
+    \pre `IsConnectionChange() == true`
+    */
+    const LinearTransform& Transform() const;
+
 private:
     VariableID m_variable;
     bool m_hasValue;
     ScalarValue m_value;
     bool m_isConnectionChange;
     coral::model::Variable m_connectedOutput;
+    coral::model::Aggregation m_aggregation;
+    std::vector<coral::model::Variable> m_aggregatedOutputs;
+    LinearTransform m_transform;
 };
 
 
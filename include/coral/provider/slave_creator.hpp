@@ -12,6 +12,7 @@
 
 #include <chrono>
 #include <string>
+#include <vector>
 
 #include <coral/model.hpp>
 #include <coral/net.hpp>
@@ -77,6 +78,48 @@ public:
     */
     virtual std::string InstantiationFailureDescription() const = 0;
 
+    /**
+    \brief  Creates several new instances of this slave type.
+
+    This is used when a master requests many slaves at once.  The default
+    implementation simply calls Instantiate() `count` times, but
+    implementations which are able to start several slaves concurrently
+    should override it to do so.
+
+    The slave provider may call this function concurrently for different
+    SlaveCreator objects, but never for the same one.
+
+    If the function returns `false`, InstantiationFailureDescription() must
+    return a textual description of the reasons for this.  `slaveLocators`
+    must then be left untouched.
+
+    \param [in] count
+        The number of slaves to create.
+    \param [in] timeout
+        How long the master will wait for each slave to start up.  See
+        Instantiate().
+    \param [out] slaveLocators
+        On success, the locators for the new slaves are appended to this.
+
+    \returns `true` if all slaves were successfully instantiated, `false`
+        otherwise.
+    */
+    virtual bool InstantiateBatch(
+        int count,
+        std::chrono::milliseconds timeout,
+        std::vector<coral::net::SlaveLocator>& slaveLocators)
+    {
+        std::vector<coral::net::SlaveLocator> newLocators(count);
+        for (auto& locator : newLocators) {
+            if (!Instantiate(timeout, locator)) return false;
+        }
+        slaveLocators.insert(
+            slaveLocators.end(),
+            newLocators.begin(),
+            newLocators.end());
+        return true;
+    }
+
     // Virtual destructor to allow deletion through base class reference.
     virtual ~SlaveCreator() { }
 };
@@ -10,7 +10,10 @@
 #ifndef CORAL_SLAVE_INSTANCE_HPP
 #define CORAL_SLAVE_INSTANCE_HPP
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <vector>
 #include <coral/model.hpp>
 
 namespace coral
@@ -19,6 +22,40 @@ namespace slave
 {
 
 
+/**
+\brief  A group of variables with the same data type, prepared for getting or
+        setting their values in bulk.
+
+Objects of this class are created by Instance::PrepareVariables(), and may
+only be used with the instance that created them.  Instances may return a
+subclass which holds whatever they need to access the variables quickly.
+*/
+class VariableGroup
+{
+public:
+    /// Constructs a group of `count` variables, all of type `dataType`.
+    VariableGroup(
+        coral::model::DataType dataType,
+        const coral::model::VariableID* variables,
+        std::size_t count);
+
+    virtual ~VariableGroup() { }
+
+    /// The data type of the variables.
+    coral::model::DataType DataType() const noexcept;
+
+    /// The IDs of the variables.
+    const std::vector<coral::model::VariableID>& Variables() const noexcept;
+
+    /// The number of variables in the group.
+    std::size_t Size() const noexcept;
+
+private:
+    coral::model::DataType m_dataType;
+    std::vector<coral::model::VariableID> m_variables;
+};
+
+
 /**
 \brief  An interface for classes that represent slave instances.
 
@@ -180,6 +217,116 @@ public:
     */
     virtual bool SetStringVariable(coral::model::VariableID variable, const std::string& value) = 0;
 
+    /**
+    \brief  Prepares a group of variables for getting or setting their values
+            in bulk.
+
+    The returned object can be passed to GetRealVariables(),
+    SetRealVariables() and so on, and must only be used with this instance.
+    The idea is that the work of looking up the variables, e.g. translating
+    them to FMI value references, is done once, here, rather than on every
+    call.
+
+    The default implementation checks the data types against the ones in
+    TypeDescription(), and returns a plain VariableGroup.  Subclasses which
+    override the bulk functions will typically also override this one, to
+    return a subclass of VariableGroup which holds what they need.
+
+    \param [in] dataType
+        The data type of the variables.
+    \param [in] variables
+        The IDs of the variables.  A variable may be included more than once.
+    \param [in] count
+        The number of elements in `variables`.
+
+    \throws std::logic_error
+        If any of the variables does not have the data type `dataType`.
+    \throws std::out_of_range
+        If there is no variable with one of the IDs.
+    */
+    virtual std::unique_ptr<VariableGroup> PrepareVariables(
+        coral::model::DataType dataType,
+        const coral::model::VariableID* variables,
+        std::size_t count) const;
+
+    /**
+    \brief  Gets the values of several real variables at once.
+
+    On return, `values[i]` contains the value of the variable whose ID is
+    `variables.Variables()[i]`, for `i` in the range [0, `variables.Size()`).
+
+    The default implementation calls GetRealVariable() for each variable.
+    Subclasses which can get several values with a single call to the model,
+    like FMI slaves, should override it.
+
+    \param [in] variables
+        A group of variables prepared with PrepareVariables() on this
+        instance.
+    \param [out] values
+        An array with room for `variables.Size()` values.
+
+    \throws std::logic_error
+        If `variables` is not a group of real variables.
+    */
+    virtual void GetRealVariables(
+        const VariableGroup& variables,
+        double* values) const;
+
+    /// Gets the values of several integer variables at once, like GetRealVariables().
+    virtual void GetIntegerVariables(
+        const VariableGroup& variables,
+        int* values) const;
+
+    /// Gets the values of several boolean variables at once, like GetRealVariables().
+    virtual void GetBooleanVariables(
+        const VariableGroup& variables,
+        bool* values) const;
+
+    /// Gets the values of several string variables at once, like GetRealVariables().
+    virtual void GetStringVariables(
+        const VariableGroup& variables,
+        std::string* values) const;
+
+    /**
+    \brief  Sets the values of several real variables at once.
+
+    Sets the variable whose ID is `variables.Variables()[i]` to `values[i]`,
+    for `i` in the range [0, `variables.Size()`).
+
+    The default implementation calls SetRealVariable() for each variable.
+    Subclasses which can set several values with a single call to the model,
+    like FMI slaves, should override it.
+
+    \param [in] variables
+        A group of variables prepared with PrepareVariables() on this
+        instance.
+    \param [in] values
+        An array of `variables.Size()` values.
+
+    \returns
+        Whether all values were set successfully.
+    \throws std::logic_error
+        If `variables` is not a group of real variables.
+    */
+    virtual bool SetRealVariables(
+        const VariableGroup& variables,
+        const double* values);
+
+    /// Sets the values of several integer variables at once, like SetRealVariables().
+    virtual bool SetIntegerVariables(
+        const VariableGroup& variables,
+        const int* values);
+
+    /// Sets the values of several boolean variables at once, like SetRealVariables().
+    virtual bool SetBooleanVariables(
+        const VariableGroup& variables,
+        const bool* values);
+
+    /// Sets the values of several string variables at once, like SetRealVariables().
+    virtual bool SetStringVariables(
+        const VariableGroup& variables,
+        const std::string* values);
+
     // Because it's an interface:
     virtual ~Instance() { }
 };
@@ -10,9 +10,11 @@
 #ifndef CORAL_SLAVE_LOGGING_HPP_INCLUDED
 #define CORAL_SLAVE_LOGGING_HPP_INCLUDED
 
+#include <cstddef>
 #include <fstream>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <coral/slave/instance.hpp>
 
@@ -64,11 +66,65 @@ public:
     bool SetIntegerVariable(coral::model::VariableID variable, int value) override;
     bool SetBooleanVariable(coral::model::VariableID variable, bool value) override;
     bool SetStringVariable(coral::model::VariableID variable, const std::string& value) override;
+    std::unique_ptr<VariableGroup> PrepareVariables(
+        coral::model::DataType dataType,
+        const coral::model::VariableID* variables,
+        std::size_t count) const override;
+    void GetRealVariables(
+        const VariableGroup& variables,
+        double* values) const override;
+    void GetIntegerVariables(
+        const VariableGroup& variables,
+        int* values) const override;
+    void GetBooleanVariables(
+        const VariableGroup& variables,
+        bool* values) const override;
+    void GetStringVariables(
+        const VariableGroup& variables,
+        std::string* values) const override;
+    bool SetRealVariables(
+        const VariableGroup& variables,
+        const double* values) override;
+    bool SetIntegerVariables(
+        const VariableGroup& variables,
+        const int* values) override;
+    bool SetBooleanVariables(
+        const VariableGroup& variables,
+        const bool* values) override;
+    bool SetStringVariables(
+        const VariableGroup& variables,
+        const std::string* values) override;
 
 private:
+    // Adds a column for `variable` to m_columns and the variable to the
+    // array for its data type.
+    void AddColumn(const coral::model::VariableDescription& variable);
+
     std::shared_ptr<Instance> m_instance;
     std::string m_outputFilePrefix;
     std::ofstream m_outputStream;
+
+    // The variables of each data type, and the same prepared for getting
+    // their values in bulk, and for each column in the output file, the data type of its
+    // variable and the variable's position in the corresponding array.
+    struct Column
+    {
+        coral::model::DataType dataType;
+        std::size_t index;
+    };
+    std::vector<Column> m_columns;
+    std::vector<coral::model::VariableID> m_realVariables;
+    std::vector<coral::model::VariableID> m_integerVariables;
+    std::vector<coral::model::VariableID> m_booleanVariables;
+    std::vector<coral::model::VariableID> m_stringVariables;
+    std::unique_ptr<VariableGroup> m_realGroup;
+    std::unique_ptr<VariableGroup> m_integerGroup;
+    std::unique_ptr<VariableGroup> m_booleanGroup;
+    std::unique_ptr<VariableGroup> m_stringGroup;
+    std::vector<double> m_realValues;
+    std::vector<int> m_integerValues;
+    std::unique_ptr<bool[]> m_booleanValues;
+    std::vector<std::string> m_stringValues;
 };
 
 
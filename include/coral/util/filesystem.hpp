@@ -73,5 +73,83 @@ private:
 };
 
 
+/// Lock modes for FileLock.
+enum class FileLockMode
+{
+    /// Any number of shared locks may be held on a file at the same time.
+    shared,
+
+    /// An exclusive lock excludes all other locks on the same file.
+    exclusive
+};
+
+
+/**
+ *  \brief  An RAII object that holds an advisory lock on a file.
+ *
+ *  The lock is acquired on construction and released on destruction.  It is
+ *  advisory, meaning that it only excludes other FileLock objects, not
+ *  ordinary file access.  Two FileLock objects for the same file exclude
+ *  each other regardless of whether they are in the same thread, in
+ *  different threads or in different processes.
+ *
+ *  The file is created if it does not exist, and it is not removed again.
+ *  Code which removes lock files must take into account that a lock may end
+ *  up being held on a file which has since been removed; see IsCurrent().
+*/
+class FileLock
+{
+public:
+    /**
+     *  \brief  Acquires a lock on a file.
+     *
+     *  \param [in] path
+     *      The file to lock.  It will be created if it does not exist.
+     *  \param [in] mode
+     *      Whether to acquire a shared or an exclusive lock.
+     *  \param [in] wait
+     *      If `true`, the constructor blocks until the lock can be acquired.
+     *      If `false`, it returns immediately, and Locked() tells whether
+     *      the lock was acquired.
+     *  \throws std::runtime_error
+     *      If the file could not be opened or locked.
+    */
+    FileLock(
+        const boost::filesystem::path& path,
+        FileLockMode mode,
+        bool wait = true);
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+    /// Destructor.  Releases the lock.
+    ~FileLock() noexcept;
+
+    /// Returns whether the lock is held.
+    bool Locked() const noexcept;
+
+    /**
+     *  \brief  Returns whether the locked file is still the one found at the
+     *          path it was opened with.
+     *
+     *  This is not the case if the file has been removed, and possibly
+     *  replaced by a new one, after it was opened.  Such a lock does not
+     *  exclude locks acquired through the path afterwards, so it should be
+     *  released and acquired anew.
+     *
+     *  \pre Locked() returns `true`.
+    */
+    bool IsCurrent() const;
+
+private:
+    boost::filesystem::path m_path;
+#ifdef _WIN32
+    void* m_handle;
+#else
+    int m_fd;
+#endif
+};
+
+
 }} // namespace
 #endif // header guard
@@ -0,0 +1,34 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORALBENCH_BENCHMARKS_HPP
+#define CORALBENCH_BENCHMARKS_HPP
+
+#include <string>
+#include <vector>
+
+
+// Each of these functions implements one coral_bench command.  They take the
+// command-line arguments that follow the command name, and return the
+// program's exit code.
+
+/// Runs co-simulations with synthetic slaves.
+int CosimBenchmark(const std::vector<std::string>& args);
+
+/// Measures the socket dispatch cost of `coral::net::Reactor`.
+int ReactorBenchmark(const std::vector<std::string>& args);
+
+/// Measures the startup latency of slave processes.
+int SpawnBenchmark(const std::vector<std::string>& args);
+
+/// Measures the throughput of `coral::util::zip::Archive::ExtractAll()`.
+int ZipBenchmark(const std::vector<std::string>& args);
+
+/// Runs a synthetic slave in a child process, for `CosimBenchmark()`.
+int SyntheticSlaveProcess(const std::vector<std::string>& args);
+
+
+#endif // header guard
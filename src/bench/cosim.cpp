@@ -0,0 +1,553 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+#include <zmq.hpp>
+
+#include <coral/log.hpp>
+#include <coral/master/execution.hpp>
+#include <coral/master/step_statistics.hpp>
+#include <coral/metrics.hpp>
+#include <coral/net.hpp>
+#include <coral/net/zmqx.hpp>
+#include <coral/slave/runner.hpp>
+#include <coral/util.hpp>
+#include <coral/util/console.hpp>
+
+#include "options.hpp"
+#include "result.hpp"
+#include "synthetic_slave.hpp"
+
+
+namespace
+{
+    enum class Topology { none, ring, scatter, gather };
+
+    Topology ParseTopology(const std::string& s)
+    {
+        if (s == "none") return Topology::none;
+        if (s == "ring") return Topology::ring;
+        if (s == "scatter") return Topology::scatter;
+        if (s == "gather") return Topology::gather;
+        throw std::invalid_argument("Invalid topology: " + s);
+    }
+
+
+    struct CosimParams
+    {
+        std::size_t slaveCount = 2;
+        std::size_t steps = 1000;
+        std::size_t warmupSteps = 10;
+        SyntheticSlaveParams slave;
+        Topology topology = Topology::ring;
+        std::size_t fanIn = 1;
+        bool multiProcess = false;
+        bool broadcast = false;
+        bool delta = false;
+        coral::model::TimeDuration stepSize = 0.1;
+        std::chrono::milliseconds timeout = std::chrono::seconds(10);
+    };
+
+
+    // The amount of variable data sent and received by all slaves.
+    struct DataVolume
+    {
+        std::uint64_t published = 0;
+        std::uint64_t received = 0;
+    };
+
+
+    DataVolume CurrentDataVolume()
+    {
+        DataVolume v;
+        v.published = coral::metrics::GetCounter(
+            "coral_data_published_bytes_total", std::string()).Value();
+        v.received = coral::metrics::GetCounter(
+            "coral_data_received_bytes_total", std::string()).Value();
+        return v;
+    }
+
+
+    // =========================================================================
+    // Slave management
+    // =========================================================================
+
+    // Slaves which run in threads in this process, or in child processes.
+    struct RunningSlaves
+    {
+        // If the benchmark fails, the slave threads will exit when their
+        // communication timeout expires.
+        ~RunningSlaves()
+        {
+            for (auto& t : threads) if (t.joinable()) t.join();
+        }
+
+        std::vector<coral::net::SlaveLocator> locators;
+
+        // In-process mode only
+        std::vector<std::thread> threads;
+        DataVolume startVolume;
+
+        // Multi-process mode only
+        std::unique_ptr<zmq::socket_t> feedbackSocket;
+    };
+
+
+    std::chrono::seconds SlaveCommTimeout(const CosimParams& params)
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(params.timeout)
+            + std::chrono::seconds(1);
+    }
+
+
+    void StartThreadSlaves(const CosimParams& params, RunningSlaves& slaves)
+    {
+        slaves.startVolume = CurrentDataVolume();
+        for (std::size_t i = 0; i < params.slaveCount; ++i) {
+            // The runner binds its sockets on construction, so we create it
+            // here to ensure that it's ready before the master connects.
+            auto runner = std::make_shared<coral::slave::Runner>(
+                std::make_shared<SyntheticSlave>(params.slave),
+                coral::net::Endpoint("inproc", coral::util::RandomUUID()),
+                coral::net::Endpoint("inproc", coral::util::RandomUUID()),
+                SlaveCommTimeout(params));
+            slaves.locators.emplace_back(
+                runner->BoundControlEndpoint(),
+                runner->BoundDataPubEndpoint());
+            slaves.threads.emplace_back([runner] () { runner->Run(); });
+        }
+    }
+
+
+    void StartProcessSlaves(const CosimParams& params, RunningSlaves& slaves)
+    {
+        slaves.feedbackSocket = std::make_unique<zmq::socket_t>(
+            coral::net::zmqx::GlobalContext(), ZMQ_PULL);
+        const auto feedbackPort = coral::net::zmqx::BindToEphemeralPort(
+            *slaves.feedbackSocket, "127.0.0.1");
+        const auto feedbackEndpoint =
+            "tcp://127.0.0.1:" + std::to_string(feedbackPort);
+
+        const auto exe = coral::util::ThisExePath().string();
+        const auto args = std::vector<std::string>{
+            "synthetic-slave",
+            "--feedback", feedbackEndpoint,
+            "--variables", std::to_string(params.slave.variableCount),
+            "--types", DataTypesToString(params.slave.dataTypes),
+            "--step-cost-us", std::to_string(params.slave.stepCost.count()),
+            "--comm-timeout", std::to_string(SlaveCommTimeout(params).count())
+        };
+        for (std::size_t i = 0; i < params.slaveCount; ++i) {
+            coral::util::SpawnProcess(exe, args);
+        }
+
+        std::vector<zmq::message_t> msg;
+        while (slaves.locators.size() < params.slaveCount) {
+            if (!coral::net::zmqx::WaitForIncoming(
+                    *slaves.feedbackSocket, params.timeout)) {
+                throw std::runtime_error("Timeout waiting for slave processes");
+            }
+            coral::net::zmqx::Receive(*slaves.feedbackSocket, msg);
+            const auto status = coral::net::zmqx::ToString(msg.at(0));
+            if (status == "OK" && msg.size() == 3) {
+                slaves.locators.emplace_back(
+                    coral::net::Endpoint(coral::net::zmqx::ToString(msg[1])),
+                    coral::net::Endpoint(coral::net::zmqx::ToString(msg[2])));
+            } else if (status == "ERROR" && msg.size() == 2) {
+                throw std::runtime_error(
+                    "Slave process failed: " + coral::net::zmqx::ToString(msg[1]));
+            } else {
+                throw std::runtime_error("Invalid message from slave process");
+            }
+        }
+    }
+
+
+    // Waits for all slaves to shut down after the execution has been
+    // terminated, and returns the amount of data they moved.
+    DataVolume StopSlaves(const CosimParams& params, RunningSlaves& slaves)
+    {
+        if (!slaves.feedbackSocket) {
+            for (auto& t : slaves.threads) t.join();
+            slaves.threads.clear();
+            const auto endVolume = CurrentDataVolume();
+            DataVolume v;
+            v.published = endVolume.published - slaves.startVolume.published;
+            v.received = endVolume.received - slaves.startVolume.received;
+            return v;
+        }
+
+        DataVolume v;
+        std::vector<zmq::message_t> msg;
+        for (std::size_t i = 0; i < params.slaveCount; ++i) {
+            if (!coral::net::zmqx::WaitForIncoming(
+                    *slaves.feedbackSocket, params.timeout)) {
+                throw std::runtime_error(
+                    "Timeout waiting for slave processes to shut down");
+            }
+            coral::net::zmqx::Receive(*slaves.feedbackSocket, msg);
+            if (msg.size() != 3 || coral::net::zmqx::ToString(msg[0]) != "STATS") {
+                throw std::runtime_error("Invalid message from slave process");
+            }
+            v.published += boost::lexical_cast<std::uint64_t>(
+                coral::net::zmqx::ToString(msg[1]));
+            v.received += boost::lexical_cast<std::uint64_t>(
+                coral::net::zmqx::ToString(msg[2]));
+        }
+        return v;
+    }
+
+
+    // =========================================================================
+    // Benchmark
+    // =========================================================================
+
+    // Returns the index of the slave whose output `variable` should be
+    // connected to input `variable` of slave `slave`, or -1 for none.
+    std::ptrdiff_t SourceSlave(
+        const CosimParams& params,
+        std::size_t slave,
+        std::size_t variable)
+    {
+        const auto n = params.slaveCount;
+        switch (params.topology) {
+            case Topology::none:
+                return -1;
+            case Topology::ring:
+                if (params.fanIn == 0) return -1;
+                return (slave + n - 1 - variable % std::min(params.fanIn, n - 1)) % n;
+            case Topology::scatter:
+                return slave == 0 ? -1 : 0;
+            case Topology::gather:
+                return slave == 0 ? 1 + variable % (n - 1) : -1;
+        }
+        return -1;
+    }
+
+
+    struct ConnectionStats
+    {
+        std::size_t connections = 0;
+        std::size_t maxFanIn = 0;
+        std::size_t maxFanOut = 0;
+    };
+
+
+    std::vector<coral::master::SlaveConfig> MakeConnections(
+        const CosimParams& params,
+        const std::vector<coral::model::SlaveID>& ids,
+        ConnectionStats& stats)
+    {
+        std::vector<coral::master::SlaveConfig> configs;
+        std::vector<std::set<std::size_t>> consumers(ids.size());
+        for (std::size_t s = 0; s < ids.size(); ++s) {
+            std::vector<coral::model::VariableSetting> settings;
+            std::set<std::size_t> sources;
+            for (std::size_t i = 0; i < params.slave.variableCount; ++i) {
+                const auto src = SourceSlave(params, s, i);
+                if (src < 0) continue;
+                settings.emplace_back(
+                    SyntheticSlave::InputID(params.slave, i),
+                    coral::model::Variable(
+                        ids[src],
+                        SyntheticSlave::OutputID(params.slave, i)));
+                sources.insert(src);
+                consumers[src].insert(s);
+            }
+            stats.connections += settings.size();
+            stats.maxFanIn = std::max(stats.maxFanIn, sources.size());
+            if (!settings.empty()) configs.emplace_back(ids[s], settings);
+        }
+        for (const auto& c : consumers) {
+            stats.maxFanOut = std::max(stats.maxFanOut, c.size());
+        }
+        return configs;
+    }
+
+
+    double Microseconds(std::chrono::nanoseconds d)
+    {
+        return d.count() / 1000.0;
+    }
+
+
+    double Seconds(std::chrono::steady_clock::duration d)
+    {
+        return std::chrono::duration<double>(d).count();
+    }
+
+
+    BenchmarkResult RunCosim(const CosimParams& params)
+    {
+        using clock = std::chrono::steady_clock;
+        const auto setupStart = clock::now();
+
+        RunningSlaves slaves;
+        if (params.multiProcess) {
+            StartProcessSlaves(params, slaves);
+        } else {
+            StartThreadSlaves(params, slaves);
+        }
+
+        coral::master::ExecutionOptions executionOptions;
+        executionOptions.broadcastStepCommands = params.broadcast;
+        executionOptions.deltaPublication = params.delta;
+        auto execution = coral::master::Execution("coral_bench", executionOptions);
+        std::vector<coral::master::AddedSlave> addedSlaves;
+        for (std::size_t i = 0; i < slaves.locators.size(); ++i) {
+            addedSlaves.emplace_back(slaves.locators[i], "s" + std::to_string(i));
+        }
+        execution.Reconstitute(addedSlaves, params.timeout);
+
+        std::vector<coral::model::SlaveID> ids;
+        for (const auto& s : addedSlaves) ids.push_back(s.info.ID());
+        ConnectionStats connectionStats;
+        auto configs = MakeConnections(params, ids, connectionStats);
+        execution.Reconfigure(configs, params.timeout);
+        const auto setupTime = clock::now() - setupStart;
+
+        const auto step = [&] () {
+            if (execution.Step(params.stepSize, params.timeout)
+                    != coral::master::StepResult::completed) {
+                throw std::runtime_error("Time step failed");
+            }
+            execution.AcceptStep(params.timeout);
+        };
+        for (std::size_t i = 0; i < params.warmupSteps; ++i) step();
+
+        coral::master::DurationHistogram stepLatency;
+        const auto runStart = clock::now();
+        for (std::size_t i = 0; i < params.steps; ++i) {
+            const auto stepStart = clock::now();
+            step();
+            stepLatency.Add(clock::now() - stepStart);
+        }
+        const auto runTime = clock::now() - runStart;
+
+        // The mean of the slaves' own per-step timings, to separate
+        // computation from communication overhead.
+        double doStepSum = 0.0, dataWaitSum = 0.0;
+        const auto slaveStats = execution.StepStatistics();
+        for (const auto& s : slaveStats) {
+            doStepSum += Microseconds(s.second.doStep.Mean());
+            dataWaitSum += Microseconds(s.second.dataWait.Mean());
+        }
+        const auto slaveCount = static_cast<double>(
+            std::max(slaveStats.size(), std::size_t(1)));
+
+        execution.Terminate();
+        const auto volume = StopSlaves(params, slaves);
+        const auto totalSteps = params.warmupSteps + params.steps;
+
+        BenchmarkResult result("cosim");
+        result
+            .Add("mode", params.multiProcess ? "processes" : "threads")
+            .Add("commands", params.broadcast ? "broadcast" : "direct")
+            .Add("publication", params.delta ? "delta" : "full")
+            .Add("slaves", static_cast<std::uint64_t>(params.slaveCount))
+            .Add("variables", static_cast<std::uint64_t>(params.slave.variableCount))
+            .Add("types", DataTypesToString(params.slave.dataTypes))
+            .Add("connections", static_cast<std::uint64_t>(connectionStats.connections))
+            .Add("max_fan_in", static_cast<std::uint64_t>(connectionStats.maxFanIn))
+            .Add("max_fan_out", static_cast<std::uint64_t>(connectionStats.maxFanOut))
+            .Add("step_cost_us", static_cast<std::int64_t>(params.slave.stepCost.count()))
+            .Add("steps", static_cast<std::uint64_t>(params.steps))
+            .Add("setup_s", Seconds(setupTime))
+            .Add("run_s", Seconds(runTime))
+            .Add("steps_per_s", params.steps / Seconds(runTime))
+            .Add("step_mean_us", Microseconds(stepLatency.Mean()))
+            .Add("step_p50_us", Microseconds(stepLatency.Percentile(50)))
+            .Add("step_p90_us", Microseconds(stepLatency.Percentile(90)))
+            .Add("step_p99_us", Microseconds(stepLatency.Percentile(99)))
+            .Add("step_max_us", Microseconds(stepLatency.Max()))
+            .Add("slave_do_step_mean_us", doStepSum / slaveCount)
+            .Add("slave_data_wait_mean_us", dataWaitSum / slaveCount)
+            .Add("published_bytes_per_step",
+                static_cast<double>(volume.published) / totalSteps)
+            .Add("received_bytes_per_step",
+                static_cast<double>(volume.received) / totalSteps);
+        return result;
+    }
+
+
+    void AddSyntheticSlaveOptions(
+        boost::program_options::options_description& options)
+    {
+        namespace po = boost::program_options;
+        options.add_options()
+            ("variables", po::value<std::size_t>()->default_value(10),
+                "The number of input variables per slave, which is also the "
+                "number of output variables.")
+            ("types", po::value<std::string>()->default_value("real"),
+                "A comma-separated list of variable data types, which are "
+                "assigned to the variables round-robin.  Available types are: "
+                "real, integer, boolean, string.")
+            ("step-cost-us", po::value<int>()->default_value(0),
+                "How long each slave keeps the CPU busy per time step, in "
+                "microseconds.");
+    }
+
+
+    SyntheticSlaveParams UseSyntheticSlaveOptions(
+        const boost::program_options::variables_map& args)
+    {
+        SyntheticSlaveParams params;
+        params.variableCount = args["variables"].as<std::size_t>();
+        params.dataTypes = ParseDataTypes(args["types"].as<std::string>());
+        params.stepCost =
+            std::chrono::microseconds(args["step-cost-us"].as<int>());
+        return params;
+    }
+}
+
+
+int CosimBenchmark(const std::vector<std::string>& args)
+{
+    namespace po = boost::program_options;
+    po::options_description options("Options");
+    options.add_options()
+        ("slaves", po::value<std::string>()->default_value("2,10,100"),
+            "A comma-separated list of slave counts.  The benchmark is run "
+            "once for each.")
+        ("steps", po::value<std::size_t>()->default_value(1000),
+            "The number of time steps to measure.")
+        ("warmup-steps", po::value<std::size_t>()->default_value(10),
+            "The number of time steps to perform before measuring.")
+        ("topology", po::value<std::string>()->default_value("ring"),
+            "How the slaves are connected.  'ring': each slave receives "
+            "inputs from the --fan-in slaves before it.  'scatter': slave 0 "
+            "feeds all others.  'gather': all others feed slave 0.  'none': "
+            "no connections.")
+        ("fan-in", po::value<std::size_t>()->default_value(1),
+            "The number of slaves each slave receives inputs from, for the "
+            "ring topology.")
+        ("processes",
+            "Run each slave in a separate process rather than in a thread.")
+        ("broadcast",
+            "Broadcast the time step commands to all slaves rather than "
+            "sending them to each slave in turn.")
+        ("delta",
+            "Make the slaves publish only the output values which have "
+            "changed since the previous time step.")
+        ("step-size", po::value<double>()->default_value(0.1),
+            "The simulated time step size.")
+        ("timeout-ms", po::value<int>()->default_value(10000),
+            "The communications timeout, in milliseconds.");
+    AddOutputOptions(options);
+    AddSyntheticSlaveOptions(options);
+    coral::util::AddLoggingOptions(options);
+
+    const auto argValues = coral::util::ParseArguments(
+        args, options,
+        po::options_description(), po::positional_options_description(),
+        std::cerr,
+        "coral_bench cosim",
+        "Runs co-simulations with synthetic slaves and measures the step rate, "
+        "step latency and amount of data transferred.  Results are written "
+        "as one JSON object per line.");
+    if (!argValues) return 0;
+    coral::util::UseLoggingArguments(*argValues, "coral_bench");
+
+    CosimParams params;
+    params.steps = (*argValues)["steps"].as<std::size_t>();
+    params.warmupSteps = (*argValues)["warmup-steps"].as<std::size_t>();
+    params.slave = UseSyntheticSlaveOptions(*argValues);
+    params.topology = ParseTopology((*argValues)["topology"].as<std::string>());
+    params.fanIn = (*argValues)["fan-in"].as<std::size_t>();
+    params.multiProcess = !!argValues->count("processes");
+    params.broadcast = !!argValues->count("broadcast");
+    params.delta = !!argValues->count("delta");
+    params.stepSize = (*argValues)["step-size"].as<double>();
+    params.timeout =
+        std::chrono::milliseconds((*argValues)["timeout-ms"].as<int>());
+    if (params.steps == 0) throw std::runtime_error("Invalid steps value");
+
+    std::ofstream outputFile;
+    auto& out = UseOutputArguments(*argValues, outputFile);
+
+    for (const auto n : ParseSizeList((*argValues)["slaves"].as<std::string>())) {
+        if (n < 2) throw std::runtime_error("At least two slaves are required");
+        params.slaveCount = n;
+        std::cerr << "Running with " << n << " slaves..." << std::endl;
+        RunCosim(params).Write(out);
+    }
+    return 0;
+}
+
+
+int SyntheticSlaveProcess(const std::vector<std::string>& args)
+{
+    namespace po = boost::program_options;
+    po::options_description options("Options");
+    options.add_options()
+        ("feedback", po::value<std::string>(),
+            "The endpoint to which the slave's own endpoints and its final "
+            "statistics should be sent.")
+        ("comm-timeout", po::value<int>()->default_value(60),
+            "How long to wait for commands from the master before shutting "
+            "down, in seconds.");
+    AddSyntheticSlaveOptions(options);
+    coral::util::AddLoggingOptions(options);
+    const auto argValues = coral::util::ParseArguments(
+        args, options,
+        po::options_description(), po::positional_options_description(),
+        std::cerr,
+        "coral_bench synthetic-slave",
+        "Runs a synthetic slave.  Used internally by 'coral_bench cosim "
+        "--processes'.");
+    if (!argValues) return 0;
+    coral::util::UseLoggingArguments(*argValues, "coral_bench_slave");
+    if (!argValues->count("feedback")) {
+        throw std::runtime_error("No feedback endpoint specified");
+    }
+
+    auto feedbackSocket =
+        zmq::socket_t(coral::net::zmqx::GlobalContext(), ZMQ_PUSH);
+    feedbackSocket.setsockopt(ZMQ_LINGER, 1000 /* ms */);
+    feedbackSocket.connect((*argValues)["feedback"].as<std::string>());
+    try {
+        auto runner = coral::slave::Runner(
+            std::make_shared<SyntheticSlave>(UseSyntheticSlaveOptions(*argValues)),
+            coral::net::Endpoint("tcp://127.0.0.1:*"),
+            coral::net::Endpoint("tcp://127.0.0.1:*"),
+            std::chrono::seconds((*argValues)["comm-timeout"].as<int>()));
+        const auto ceps = runner.BoundControlEndpoint().URL();
+        const auto deps = runner.BoundDataPubEndpoint().URL();
+        feedbackSocket.send("OK", 2, ZMQ_SNDMORE);
+        feedbackSocket.send(ceps.data(), ceps.size(), ZMQ_SNDMORE);
+        feedbackSocket.send(deps.data(), deps.size());
+
+        runner.Run();
+
+        const auto volume = CurrentDataVolume();
+        const auto published = std::to_string(volume.published);
+        const auto received = std::to_string(volume.received);
+        feedbackSocket.send("STATS", 5, ZMQ_SNDMORE);
+        feedbackSocket.send(published.data(), published.size(), ZMQ_SNDMORE);
+        feedbackSocket.send(received.data(), received.size());
+    } catch (const std::exception& e) {
+        feedbackSocket.send("ERROR", 5, ZMQ_SNDMORE);
+        feedbackSocket.send(e.what(), std::strlen(e.what()));
+        throw;
+    }
+    return 0;
+}
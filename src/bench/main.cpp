@@ -0,0 +1,77 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef _WIN32
+#   include <sys/resource.h>
+#endif
+
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include <coral/config.h>
+#include <coral/log.hpp>
+#include <coral/util/console.hpp>
+
+#include "benchmarks.hpp"
+
+
+namespace
+{
+    const std::string self = "coral_bench";
+
+    // Every ZeroMQ socket uses at least one file descriptor, so large
+    // benchmarks easily exceed the default soft limit.
+    void RaiseFileDescriptorLimit()
+    {
+#ifndef _WIN32
+        rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0
+                && limit.rlim_cur < limit.rlim_max) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+#endif
+    }
+}
+
+
+int main(int argc, const char** argv)
+{
+    if (argc < 2) {
+        std::cerr <<
+            "Benchmarks (" CORAL_PROGRAM_NAME_VERSION ")\n\n"
+            "Measures the performance of various parts of Coral.  Results are\n"
+            "written to standard output as one JSON object per line.\n\n"
+            "Usage:\n"
+            "  " << self << " <benchmark> [benchmark-specific args]\n\n"
+            "Benchmarks:\n"
+            "  cosim    Co-simulation with synthetic slaves.\n"
+            "  reactor  Socket dispatch cost versus number of sockets.\n"
+            "  spawn    Slave process startup latency.\n"
+            "  zip      Archive extraction throughput versus number of threads.\n"
+            "\n"
+            "Run \"" << self << " <benchmark> --help\" for benchmark-specific information.\n";
+        return 0;
+    }
+    const auto command = std::string(argv[1]);
+    const auto args = coral::util::CommandLine(argc-2, argv+2);
+    try {
+        RaiseFileDescriptorLimit();
+        if (command == "cosim") return CosimBenchmark(args);
+        else if (command == "reactor") return ReactorBenchmark(args);
+        else if (command == "spawn") return SpawnBenchmark(args);
+        else if (command == "zip") return ZipBenchmark(args);
+        else if (command == "synthetic-slave") return SyntheticSlaveProcess(args);
+        else {
+            coral::log::Log(coral::log::error, "Invalid benchmark: " + command);
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        coral::log::Log(coral::log::error, e.what());
+        return 255;
+    }
+}
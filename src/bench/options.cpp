@@ -0,0 +1,45 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include "options.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+
+
+std::vector<std::size_t> ParseSizeList(const std::string& list)
+{
+    std::vector<std::string> items;
+    boost::split(items, list, boost::is_any_of(","));
+    std::vector<std::size_t> sizes;
+    for (const auto& item : items) {
+        sizes.push_back(boost::lexical_cast<std::size_t>(item));
+    }
+    return sizes;
+}
+
+
+void AddOutputOptions(boost::program_options::options_description& options)
+{
+    namespace po = boost::program_options;
+    options.add_options()
+        ("output", po::value<std::string>(),
+            "Append results to this file rather than writing them to "
+            "standard output.");
+}
+
+
+std::ostream& UseOutputArguments(
+    const boost::program_options::variables_map& args,
+    std::ofstream& file)
+{
+    if (!args.count("output")) return std::cout;
+    file.open(args["output"].as<std::string>(), std::ios_base::app);
+    if (!file) throw std::runtime_error("Failed to open output file");
+    return file;
+}
@@ -0,0 +1,40 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORALBENCH_OPTIONS_HPP
+#define CORALBENCH_OPTIONS_HPP
+
+#include <cstddef>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+
+
+/// Parses a comma-separated list of sizes, e.g. "10,100,1000".
+std::vector<std::size_t> ParseSizeList(const std::string& list);
+
+
+/// Adds the `--output` option, which is common to all benchmarks.
+void AddOutputOptions(boost::program_options::options_description& options);
+
+
+/**
+\brief  Returns the stream to which results should be written, based on the
+        options added by `AddOutputOptions()`.
+
+If an output file was specified, it is opened in append mode using `file`,
+and `file` is returned.  Otherwise, `std::cout` is returned.
+
+\throws std::runtime_error if the file could not be opened.
+*/
+std::ostream& UseOutputArguments(
+    const boost::program_options::variables_map& args,
+    std::ofstream& file);
+
+
+#endif // header guard
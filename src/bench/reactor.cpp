@@ -0,0 +1,164 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include "benchmarks.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <zmq.hpp>
+
+#include <coral/net/reactor.hpp>
+#include <coral/util/console.hpp>
+
+#include "options.hpp"
+#include "result.hpp"
+
+
+namespace
+{
+    struct ReactorParams
+    {
+        std::size_t socketCount = 1;
+        std::size_t messages = 100000;
+        std::size_t warmupMessages = 1000;
+
+        // Whether the receiving socket should be removed from and re-added
+        // to the reactor for every message.
+        bool churn = false;
+    };
+
+
+    double Seconds(std::chrono::steady_clock::duration d)
+    {
+        return std::chrono::duration<double>(d).count();
+    }
+
+
+    // Sets up `socketCount` pairs of connected sockets, and passes a single
+    // message around between them, so that exactly one of the sockets
+    // watched by the reactor is ready in each iteration of the messaging
+    // loop.  The time per message is thus the cost of one poll and one
+    // dispatch, as a function of the number of sockets.
+    BenchmarkResult RunReactor(const ReactorParams& params)
+    {
+        using clock = std::chrono::steady_clock;
+        const auto n = params.socketCount;
+
+        // A private context, so we can control the socket limit.
+        zmq::context_t context(1, static_cast<int>(2*n + 16));
+        std::vector<zmq::socket_t> receivers;
+        std::vector<zmq::socket_t> senders;
+        receivers.reserve(n);
+        senders.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto endpoint = "inproc://coral_bench_reactor_" + std::to_string(i);
+            receivers.emplace_back(context, ZMQ_PAIR);
+            receivers.back().bind(endpoint);
+            senders.emplace_back(context, ZMQ_PAIR);
+            senders.back().connect(endpoint);
+        }
+
+        coral::net::Reactor reactor;
+        std::size_t remaining = 0;
+        coral::net::Reactor::SocketHandler handler;
+        handler = [&] (coral::net::Reactor& r, zmq::socket_t& s) {
+            zmq::message_t msg;
+            s.recv(&msg);
+            if (params.churn) {
+                r.RemoveSocket(s);
+                r.AddSocket(s, handler);
+            }
+            if (--remaining == 0) {
+                r.Stop();
+                return;
+            }
+            const auto next = (static_cast<std::size_t>(&s - receivers.data()) + 1) % n;
+            senders[next].send("", 0);
+        };
+
+        const auto registerStart = clock::now();
+        for (auto& s : receivers) reactor.AddSocket(s, handler);
+        const auto registerTime = clock::now() - registerStart;
+
+        const auto run = [&] (std::size_t messages) {
+            remaining = messages;
+            senders.front().send("", 0);
+            const auto start = clock::now();
+            reactor.Run();
+            return clock::now() - start;
+        };
+        if (params.warmupMessages > 0) run(params.warmupMessages);
+        const auto runTime = run(params.messages);
+
+        BenchmarkResult result("reactor");
+        result
+            .Add("sockets", static_cast<std::uint64_t>(n))
+            .Add("churn", params.churn ? "yes" : "no")
+            .Add("messages", static_cast<std::uint64_t>(params.messages))
+            .Add("register_us_per_socket",
+                Seconds(registerTime) * 1e6 / n)
+            .Add("run_s", Seconds(runTime))
+            .Add("messages_per_s", params.messages / Seconds(runTime))
+            .Add("dispatch_us", Seconds(runTime) * 1e6 / params.messages);
+        return result;
+    }
+}
+
+
+int ReactorBenchmark(const std::vector<std::string>& args)
+{
+    namespace po = boost::program_options;
+    po::options_description options("Options");
+    options.add_options()
+        ("sockets", po::value<std::string>()->default_value("1,10,100,1000,5000"),
+            "A comma-separated list of socket counts.  The benchmark is run "
+            "once for each.")
+        ("messages", po::value<std::size_t>()->default_value(100000),
+            "The number of messages to dispatch.")
+        ("warmup-messages", po::value<std::size_t>()->default_value(1000),
+            "The number of messages to dispatch before measuring.")
+        ("churn",
+            "Remove and re-add the receiving socket for every message, to "
+            "measure the cost of changing the set of sockets.");
+    AddOutputOptions(options);
+    coral::util::AddLoggingOptions(options);
+
+    const auto argValues = coral::util::ParseArguments(
+        args, options,
+        po::options_description(), po::positional_options_description(),
+        std::cerr,
+        "coral_bench reactor",
+        "Measures the cost of dispatching a message with coral::net::Reactor, "
+        "as a function of the number of sockets it watches.  Only one socket "
+        "has an incoming message at any time.  Results are written as one "
+        "JSON object per line.");
+    if (!argValues) return 0;
+    coral::util::UseLoggingArguments(*argValues, "coral_bench");
+
+    ReactorParams params;
+    params.messages = (*argValues)["messages"].as<std::size_t>();
+    params.warmupMessages = (*argValues)["warmup-messages"].as<std::size_t>();
+    params.churn = !!argValues->count("churn");
+    if (params.messages == 0) throw std::runtime_error("Invalid messages value");
+
+    std::ofstream outputFile;
+    auto& out = UseOutputArguments(*argValues, outputFile);
+
+    for (const auto n : ParseSizeList((*argValues)["sockets"].as<std::string>())) {
+        if (n < 1) throw std::runtime_error("At least one socket is required");
+        params.socketCount = n;
+        std::cerr << "Running with " << n << " sockets..." << std::endl;
+        RunReactor(params).Write(out);
+    }
+    return 0;
+}
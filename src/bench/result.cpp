@@ -0,0 +1,86 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include "result.hpp"
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+
+namespace
+{
+    std::string JsonString(const std::string& s)
+    {
+        std::ostringstream out;
+        out << '"';
+        for (const char c : s) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                    << static_cast<int>(c);
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+        return out.str();
+    }
+}
+
+
+BenchmarkResult::BenchmarkResult(const std::string& name)
+{
+    Add("benchmark", name);
+}
+
+
+BenchmarkResult& BenchmarkResult::Add(const std::string& key, double value)
+{
+    if (std::isfinite(value)) {
+        std::ostringstream s;
+        s << std::setprecision(10) << value;
+        m_fields.emplace_back(key, s.str());
+    } else {
+        m_fields.emplace_back(key, "null");
+    }
+    return *this;
+}
+
+
+BenchmarkResult& BenchmarkResult::Add(const std::string& key, std::int64_t value)
+{
+    m_fields.emplace_back(key, std::to_string(value));
+    return *this;
+}
+
+
+BenchmarkResult& BenchmarkResult::Add(const std::string& key, std::uint64_t value)
+{
+    m_fields.emplace_back(key, std::to_string(value));
+    return *this;
+}
+
+
+BenchmarkResult& BenchmarkResult::Add(
+    const std::string& key,
+    const std::string& value)
+{
+    m_fields.emplace_back(key, JsonString(value));
+    return *this;
+}
+
+
+void BenchmarkResult::Write(std::ostream& out) const
+{
+    out << '{';
+    for (std::size_t i = 0; i < m_fields.size(); ++i) {
+        if (i > 0) out << ',';
+        out << JsonString(m_fields[i].first) << ':' << m_fields[i].second;
+    }
+    out << '}' << std::endl;
+}
@@ -0,0 +1,44 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORALBENCH_RESULT_HPP
+#define CORALBENCH_RESULT_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/**
+\brief  The parameters and measurements of one benchmark run.
+
+Results are written as JSON objects, one per line, so that the output of
+several runs may be concatenated and processed line by line.  The fields are
+written in the order they were added.
+*/
+class BenchmarkResult
+{
+public:
+    /// Creates a result with a `benchmark` field which contains `name`.
+    explicit BenchmarkResult(const std::string& name);
+
+    BenchmarkResult& Add(const std::string& key, double value);
+    BenchmarkResult& Add(const std::string& key, std::int64_t value);
+    BenchmarkResult& Add(const std::string& key, std::uint64_t value);
+    BenchmarkResult& Add(const std::string& key, const std::string& value);
+
+    /// Writes the result as a single-line JSON object.
+    void Write(std::ostream& out) const;
+
+private:
+    // Keys and JSON-encoded values.
+    std::vector<std::pair<std::string, std::string>> m_fields;
+};
+
+
+#endif // header guard
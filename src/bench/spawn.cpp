@@ -0,0 +1,201 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <zmq.hpp>
+
+#include <coral/fmi/fmu.hpp>
+#include <coral/fmi/importer.hpp>
+#include <coral/net/zmqx.hpp>
+#include <coral/util.hpp>
+#include <coral/util/console.hpp>
+
+#include "options.hpp"
+#include "result.hpp"
+
+
+namespace
+{
+#ifdef _WIN32
+    const std::string DEFAULT_SLAVE_EXE = "coralslave.exe";
+#else
+    const std::string DEFAULT_SLAVE_EXE = "coralslave";
+#endif
+
+
+    struct SpawnParams
+    {
+        std::string slaveExe;
+        std::size_t repetitions = 10;
+        std::chrono::milliseconds timeout = std::chrono::seconds(30);
+    };
+
+
+    double Seconds(std::chrono::steady_clock::duration d)
+    {
+        return std::chrono::duration<double>(d).count();
+    }
+
+
+    // Starts a slave in the same way as coralslaveprovider does, and returns
+    // the time from just before the process is spawned until the slave
+    // reports that it is ready.  `fmuArgs` tells the slave where the FMU is.
+    std::chrono::steady_clock::duration SpawnSlave(
+        const SpawnParams& params,
+        const std::vector<std::string>& fmuArgs)
+    {
+        zmq::socket_t statusSocket(coral::net::zmqx::GlobalContext(), ZMQ_PULL);
+        const auto statusPort =
+            coral::net::zmqx::BindToEphemeralPort(statusSocket, "127.0.0.1");
+
+        auto args = fmuArgs;
+        args.push_back("--coralslaveprovider-endpoint=tcp://127.0.0.1:"
+            + std::to_string(statusPort));
+        // Nobody connects to the slaves, so we let them shut down quickly.
+        args.push_back("--hangaround-time=1");
+        args.push_back("--no-output");
+
+        const auto start = std::chrono::steady_clock::now();
+        coral::util::SpawnProcess(params.slaveExe, args);
+        if (!coral::net::zmqx::WaitForIncoming(statusSocket, params.timeout)) {
+            throw std::runtime_error("Timeout waiting for slave to start");
+        }
+        std::vector<zmq::message_t> msg;
+        coral::net::zmqx::Receive(statusSocket, msg);
+        const auto t = std::chrono::steady_clock::now() - start;
+
+        const auto status = coral::net::zmqx::ToString(msg.at(0));
+        if (status == "ERROR" && msg.size() == 2) {
+            throw std::runtime_error(
+                "Slave failed: " + coral::net::zmqx::ToString(msg[1]));
+        } else if (status != "OK" || msg.size() < 3) {
+            throw std::runtime_error("Invalid message from slave");
+        }
+        return t;
+    }
+
+
+    // Spawns one slave untimed, to warm up the file system and FMU caches,
+    // and then `params.repetitions` timed ones.
+    void RunSpawn(
+        const std::string& fmuName,
+        const std::string& mode,
+        const std::vector<std::string>& fmuArgs,
+        const SpawnParams& params,
+        std::ostream& out)
+    {
+        std::cerr << "Spawning slaves for " << fmuName << " (" << mode << ")..."
+            << std::endl;
+        SpawnSlave(params, fmuArgs);
+
+        std::vector<std::chrono::steady_clock::duration> times;
+        for (std::size_t r = 0; r < params.repetitions; ++r) {
+            times.push_back(SpawnSlave(params, fmuArgs));
+        }
+        std::sort(times.begin(), times.end());
+        auto total = std::chrono::steady_clock::duration::zero();
+        for (const auto t : times) total += t;
+
+        BenchmarkResult result("spawn");
+        result
+            .Add("fmu", fmuName)
+            .Add("mode", mode)
+            .Add("repetitions", static_cast<std::uint64_t>(params.repetitions))
+            .Add("best_s", Seconds(times.front()))
+            .Add("median_s", Seconds(times[times.size() / 2]))
+            .Add("mean_s", Seconds(total / params.repetitions))
+            .Add("worst_s", Seconds(times.back()));
+        result.Write(out);
+    }
+}
+
+
+int SpawnBenchmark(const std::vector<std::string>& args)
+{
+    namespace po = boost::program_options;
+    po::options_description options("Options");
+    options.add_options()
+        ("fmu", po::value<std::vector<std::string>>(),
+            "An FMU to start slaves for.  May be specified several times.")
+        ("repetitions", po::value<std::size_t>()->default_value(10),
+            "The number of slaves to start for each FMU and mode.")
+        ("slave-exe", po::value<std::string>(),
+            "The path to the slave executable.  By default, the CORAL_SLAVE_EXE "
+            "environment variable is used, or if it isn't set, the slave "
+            "executable in the same directory as this program.")
+        ("timeout", po::value<int>()->default_value(30),
+            "The number of seconds to wait for each slave to start.");
+    AddOutputOptions(options);
+    coral::util::AddLoggingOptions(options);
+
+    const auto argValues = coral::util::ParseArguments(
+        args, options,
+        po::options_description(), po::positional_options_description(),
+        std::cerr,
+        "coral_bench spawn",
+        "Measures the time from a slave process is started until it is ready "
+        "to accept a master connection, when it is given the FMU file (mode "
+        "\"fmu\") and when it is given the directory of an FMU which has "
+        "already been unpacked, as coralslaveprovider does (mode "
+        "\"unpacked\").  Results are written as one JSON object per line.");
+    if (!argValues) return 0;
+    coral::util::UseLoggingArguments(*argValues, "coral_bench");
+
+    SpawnParams params;
+    params.repetitions = (*argValues)["repetitions"].as<std::size_t>();
+    params.timeout = std::chrono::seconds((*argValues)["timeout"].as<int>());
+    if (params.repetitions == 0) throw std::runtime_error("Invalid repetitions value");
+    if (params.timeout <= std::chrono::milliseconds(0)) {
+        throw std::runtime_error("Invalid timeout value");
+    }
+    if (argValues->count("slave-exe")) {
+        params.slaveExe = (*argValues)["slave-exe"].as<std::string>();
+    } else if (const auto slaveExeEnv = std::getenv("CORAL_SLAVE_EXE")) {
+        params.slaveExe = slaveExeEnv;
+    } else {
+        params.slaveExe = (coral::util::ThisExePath().parent_path()
+            / DEFAULT_SLAVE_EXE).string();
+    }
+    if (!boost::filesystem::exists(params.slaveExe)) {
+        throw std::runtime_error("Slave executable not found: " + params.slaveExe);
+    }
+    if (!argValues->count("fmu")) throw std::runtime_error("No FMUs specified");
+
+    std::ofstream outputFile;
+    auto& out = UseOutputArguments(*argValues, outputFile);
+
+    // The FMUs are unpacked in the same way as coralslaveprovider does it,
+    // and kept alive until we're done, so they stay in the cache.
+    const auto importer = coral::fmi::Importer::Create(
+        boost::filesystem::temp_directory_path() / "coral" / "cache",
+        coral::fmi::UnpackMode::selective);
+    for (const auto& fmuPath : (*argValues)["fmu"].as<std::vector<std::string>>()) {
+        const auto fmuName = boost::filesystem::path(fmuPath).filename().string();
+        const auto fmu = importer->Import(fmuPath);
+        importer->CompleteUnpacking(*fmu);
+        RunSpawn(fmuName, "fmu", {fmuPath}, params, out);
+        RunSpawn(
+            fmuName,
+            "unpacked",
+            {"--unpacked-fmu=" + fmu->Directory().string()},
+            params,
+            out);
+    }
+    return 0;
+}
@@ -0,0 +1,228 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include "synthetic_slave.hpp"
+
+#include <cassert>
+#include <sstream>
+#include <stdexcept>
+#include <boost/algorithm/string.hpp>
+
+
+namespace
+{
+    coral::model::ScalarValue DefaultValue(coral::model::DataType type)
+    {
+        switch (type) {
+            case coral::model::REAL_DATATYPE:    return 0.0;
+            case coral::model::INTEGER_DATATYPE: return 0;
+            case coral::model::BOOLEAN_DATATYPE: return false;
+            case coral::model::STRING_DATATYPE:  return std::string();
+        }
+        assert(false);
+        return 0.0;
+    }
+
+    // The function which maps an input value to an output value.  It is
+    // chosen so that the published values change in every time step.
+    coral::model::ScalarValue Transform(const coral::model::ScalarValue& input)
+    {
+        switch (coral::model::DataTypeOf(input)) {
+            case coral::model::REAL_DATATYPE:
+                return boost::get<double>(input) + 1.0;
+            case coral::model::INTEGER_DATATYPE:
+                return boost::get<int>(input) + 1;
+            case coral::model::BOOLEAN_DATATYPE:
+                return !boost::get<bool>(input);
+            case coral::model::STRING_DATATYPE:
+                return boost::get<std::string>(input);
+        }
+        assert(false);
+        return input;
+    }
+
+    // Keeps the CPU busy, as opposed to sleeping, to mimic an FMU.
+    void BusyWait(std::chrono::microseconds duration)
+    {
+        if (duration <= std::chrono::microseconds(0)) return;
+        const auto end = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < end) { }
+    }
+}
+
+
+std::vector<coral::model::DataType> ParseDataTypes(const std::string& list)
+{
+    std::vector<std::string> names;
+    boost::split(names, list, boost::is_any_of(","));
+    std::vector<coral::model::DataType> types;
+    for (const auto& name : names) {
+        if (name == "real") types.push_back(coral::model::REAL_DATATYPE);
+        else if (name == "integer") types.push_back(coral::model::INTEGER_DATATYPE);
+        else if (name == "boolean") types.push_back(coral::model::BOOLEAN_DATATYPE);
+        else if (name == "string") types.push_back(coral::model::STRING_DATATYPE);
+        else throw std::invalid_argument("Invalid data type: " + name);
+    }
+    return types;
+}
+
+
+std::string DataTypesToString(const std::vector<coral::model::DataType>& types)
+{
+    std::ostringstream s;
+    for (std::size_t i = 0; i < types.size(); ++i) {
+        if (i > 0) s << ',';
+        switch (types[i]) {
+            case coral::model::REAL_DATATYPE:    s << "real";    break;
+            case coral::model::INTEGER_DATATYPE: s << "integer"; break;
+            case coral::model::BOOLEAN_DATATYPE: s << "boolean"; break;
+            case coral::model::STRING_DATATYPE:  s << "string";  break;
+        }
+    }
+    return s.str();
+}
+
+
+SyntheticSlave::SyntheticSlave(const SyntheticSlaveParams& params)
+    : m_params(params)
+{
+    if (params.dataTypes.empty()) {
+        throw std::invalid_argument("No data types specified");
+    }
+    std::vector<coral::model::VariableDescription> variables;
+    for (std::size_t i = 0; i < params.variableCount; ++i) {
+        variables.emplace_back(
+            InputID(params, i),
+            "in" + std::to_string(i),
+            params.dataTypes[i % params.dataTypes.size()],
+            coral::model::INPUT_CAUSALITY,
+            coral::model::DISCRETE_VARIABILITY);
+    }
+    for (std::size_t i = 0; i < params.variableCount; ++i) {
+        variables.emplace_back(
+            OutputID(params, i),
+            "out" + std::to_string(i),
+            params.dataTypes[i % params.dataTypes.size()],
+            coral::model::OUTPUT_CAUSALITY,
+            coral::model::DISCRETE_VARIABILITY);
+    }
+    for (const auto& v : variables) {
+        m_values.push_back(DefaultValue(v.DataType()));
+    }
+    m_typeDescription = coral::model::SlaveTypeDescription(
+        "no.viproma.coral.bench.synthetic",
+        "ed8a5e4c-0d6a-4a3a-9c52-2b5f7a8f0c31",
+        "Synthetic slave used for benchmarking",
+        "Coral developers",
+        "1",
+        variables);
+}
+
+
+coral::model::VariableID SyntheticSlave::InputID(
+    const SyntheticSlaveParams& /*params*/,
+    std::size_t i)
+{
+    return static_cast<coral::model::VariableID>(i);
+}
+
+
+coral::model::VariableID SyntheticSlave::OutputID(
+    const SyntheticSlaveParams& params,
+    std::size_t i)
+{
+    return static_cast<coral::model::VariableID>(params.variableCount + i);
+}
+
+
+coral::model::SlaveTypeDescription SyntheticSlave::TypeDescription() const
+{
+    return m_typeDescription;
+}
+
+
+void SyntheticSlave::Setup(
+    const std::string& /*slaveName*/,
+    const std::string& /*executionName*/,
+    coral::model::TimePoint /*startTime*/,
+    coral::model::TimePoint /*stopTime*/,
+    bool /*adaptiveStepSize*/,
+    double /*relativeTolerance*/)
+{
+}
+
+
+void SyntheticSlave::StartSimulation() { }
+
+
+void SyntheticSlave::EndSimulation() { }
+
+
+bool SyntheticSlave::DoStep(
+    coral::model::TimePoint /*currentT*/,
+    coral::model::TimeDuration /*deltaT*/)
+{
+    BusyWait(m_params.stepCost);
+    for (std::size_t i = 0; i < m_params.variableCount; ++i) {
+        m_values[OutputID(m_params, i)] =
+            Transform(m_values[InputID(m_params, i)]);
+    }
+    return true;
+}
+
+
+double SyntheticSlave::GetRealVariable(coral::model::VariableID variable) const
+{
+    return boost::get<double>(m_values.at(variable));
+}
+
+
+int SyntheticSlave::GetIntegerVariable(coral::model::VariableID variable) const
+{
+    return boost::get<int>(m_values.at(variable));
+}
+
+
+bool SyntheticSlave::GetBooleanVariable(coral::model::VariableID variable) const
+{
+    return boost::get<bool>(m_values.at(variable));
+}
+
+
+std::string SyntheticSlave::GetStringVariable(coral::model::VariableID variable) const
+{
+    return boost::get<std::string>(m_values.at(variable));
+}
+
+
+bool SyntheticSlave::SetRealVariable(coral::model::VariableID variable, double value)
+{
+    m_values.at(variable) = value;
+    return true;
+}
+
+
+bool SyntheticSlave::SetIntegerVariable(coral::model::VariableID variable, int value)
+{
+    m_values.at(variable) = value;
+    return true;
+}
+
+
+bool SyntheticSlave::SetBooleanVariable(coral::model::VariableID variable, bool value)
+{
+    m_values.at(variable) = value;
+    return true;
+}
+
+
+bool SyntheticSlave::SetStringVariable(
+    coral::model::VariableID variable,
+    const std::string& value)
+{
+    m_values.at(variable) = value;
+    return true;
+}
@@ -0,0 +1,106 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORALBENCH_SYNTHETIC_SLAVE_HPP
+#define CORALBENCH_SYNTHETIC_SLAVE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <coral/model.hpp>
+#include <coral/slave/instance.hpp>
+
+
+/// Parameters for a `SyntheticSlave`.
+struct SyntheticSlaveParams
+{
+    /// The number of input variables, which is also the number of outputs.
+    std::size_t variableCount = 10;
+
+    /// The data types of the variables, assigned round-robin.
+    std::vector<coral::model::DataType> dataTypes =
+        std::vector<coral::model::DataType>{coral::model::REAL_DATATYPE};
+
+    /// How long each `DoStep()` call should keep the CPU busy.
+    std::chrono::microseconds stepCost = std::chrono::microseconds(0);
+};
+
+
+/**
+\brief  Parses a comma-separated list of data type names (real, integer,
+        boolean, string).
+
+\throws std::invalid_argument if the list is empty or contains an unknown
+    type name.
+*/
+std::vector<coral::model::DataType> ParseDataTypes(const std::string& list);
+
+
+/// The inverse of `ParseDataTypes()`.
+std::string DataTypesToString(const std::vector<coral::model::DataType>& types);
+
+
+/**
+\brief  A slave which doesn't model anything, but which has a configurable
+        number of variables and a configurable computational cost.
+
+Variables `0` to `n-1` are inputs, and variables `n` to `2n-1` are outputs,
+where `n` is `SyntheticSlaveParams::variableCount`.  Input `i` and output
+`n+i` have the same data type, and in each time step, the output is set to
+a simple function of the input.
+*/
+class SyntheticSlave : public coral::slave::Instance
+{
+public:
+    explicit SyntheticSlave(const SyntheticSlaveParams& params);
+
+    /// Returns the ID of the `i`th input variable.
+    static coral::model::VariableID InputID(
+        const SyntheticSlaveParams& params,
+        std::size_t i);
+
+    /// Returns the ID of the `i`th output variable.
+    static coral::model::VariableID OutputID(
+        const SyntheticSlaveParams& params,
+        std::size_t i);
+
+    // coral::slave::Instance methods
+    coral::model::SlaveTypeDescription TypeDescription() const override;
+
+    void Setup(
+        const std::string& slaveName,
+        const std::string& executionName,
+        coral::model::TimePoint startTime,
+        coral::model::TimePoint stopTime,
+        bool adaptiveStepSize,
+        double relativeTolerance) override;
+
+    void StartSimulation() override;
+    void EndSimulation() override;
+
+    bool DoStep(
+        coral::model::TimePoint currentT,
+        coral::model::TimeDuration deltaT) override;
+
+    double GetRealVariable(coral::model::VariableID variable) const override;
+    int GetIntegerVariable(coral::model::VariableID variable) const override;
+    bool GetBooleanVariable(coral::model::VariableID variable) const override;
+    std::string GetStringVariable(coral::model::VariableID variable) const override;
+
+    bool SetRealVariable(coral::model::VariableID variable, double value) override;
+    bool SetIntegerVariable(coral::model::VariableID variable, int value) override;
+    bool SetBooleanVariable(coral::model::VariableID variable, bool value) override;
+    bool SetStringVariable(coral::model::VariableID variable, const std::string& value) override;
+
+private:
+    SyntheticSlaveParams m_params;
+    coral::model::SlaveTypeDescription m_typeDescription;
+    std::vector<coral::model::ScalarValue> m_values;
+};
+
+
+#endif // header guard
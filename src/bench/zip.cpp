@@ -0,0 +1,237 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <zip.h>
+
+#include <coral/util/console.hpp>
+#include <coral/util/filesystem.hpp>
+#include <coral/util/zip.hpp>
+
+#include "options.hpp"
+#include "result.hpp"
+
+
+namespace
+{
+    struct ZipParams
+    {
+        std::size_t repetitions = 3;
+        std::vector<std::size_t> threadCounts;
+    };
+
+
+    double Seconds(std::chrono::steady_clock::duration d)
+    {
+        return std::chrono::duration<double>(d).count();
+    }
+
+
+    // Writes a file whose contents are a mix of random bytes and repeated
+    // text, so that it compresses to roughly half its size, like a typical
+    // mix of binaries and resources in an FMU.
+    void WriteSyntheticFile(
+        const boost::filesystem::path& path,
+        std::size_t size,
+        std::mt19937& rng)
+    {
+        const std::size_t blockSize = 4096;
+        const std::string text = "The quick brown fox jumps over the lazy dog. ";
+        std::vector<char> block(blockSize);
+        std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+        for (std::size_t written = 0, b = 0; written < size; written += blockSize, ++b) {
+            if (b % 2 == 0) {
+                for (auto& c : block) c = static_cast<char>(rng());
+            } else {
+                for (std::size_t i = 0; i < blockSize; ++i) block[i] = text[i % text.size()];
+            }
+            out.write(block.data(), std::min(blockSize, size - written));
+        }
+        if (!out) throw std::runtime_error("Failed to write file: " + path.string());
+    }
+
+
+    // Creates an archive with `fileCount` files of `fileSize` bytes each,
+    // spread over a few subdirectories.
+    void CreateSyntheticArchive(
+        const boost::filesystem::path& archivePath,
+        const boost::filesystem::path& workDir,
+        std::size_t fileCount,
+        std::size_t fileSize)
+    {
+        std::mt19937 rng;
+        std::vector<std::pair<std::string, boost::filesystem::path>> files;
+        for (std::size_t i = 0; i < fileCount; ++i) {
+            const auto name = "dir" + std::to_string(i % 4) + "/file" + std::to_string(i);
+            const auto path = workDir / ("file" + std::to_string(i));
+            WriteSyntheticFile(path, fileSize, rng);
+            files.emplace_back(name, path);
+        }
+
+        int errorCode = 0;
+        const auto archive = zip_open(
+            archivePath.string().c_str(), ZIP_CREATE | ZIP_TRUNCATE, &errorCode);
+        if (archive == nullptr) {
+            throw std::runtime_error("Failed to create archive: " + archivePath.string());
+        }
+        try {
+            for (const auto& f : files) {
+                const auto source = zip_source_file(archive, f.second.string().c_str(), 0, -1);
+                if (source == nullptr) throw coral::util::zip::Exception(archive);
+                if (zip_file_add(archive, f.first.c_str(), source, ZIP_FL_OVERWRITE) < 0) {
+                    zip_source_free(source);
+                    throw coral::util::zip::Exception(archive);
+                }
+            }
+            if (zip_close(archive) != 0) throw coral::util::zip::Exception(archive);
+        } catch (...) {
+            zip_discard(archive);
+            throw;
+        }
+    }
+
+
+    std::uint64_t DirectorySize(const boost::filesystem::path& dir)
+    {
+        std::uint64_t size = 0;
+        for (auto it = boost::filesystem::recursive_directory_iterator(dir);
+             it != boost::filesystem::recursive_directory_iterator();
+             ++it)
+        {
+            if (boost::filesystem::is_regular_file(it->status())) {
+                size += boost::filesystem::file_size(it->path());
+            }
+        }
+        return size;
+    }
+
+
+    // Extracts `archivePath` once untimed, to warm up the file cache, and
+    // then `params.repetitions` times for each thread count.
+    void RunZip(
+        const std::string& name,
+        const boost::filesystem::path& archivePath,
+        const ZipParams& params,
+        std::ostream& out)
+    {
+        using clock = std::chrono::steady_clock;
+        const auto archive = coral::util::zip::Archive(archivePath);
+        std::uint64_t totalSize = 0;
+        {
+            coral::util::TempDir target;
+            archive.ExtractAll(target.Path());
+            totalSize = DirectorySize(target.Path());
+        }
+
+        for (const auto threads : params.threadCounts) {
+            std::cerr << "Extracting " << name << " with "
+                << (threads == 0 ? std::string("auto") : std::to_string(threads))
+                << " threads..." << std::endl;
+            auto best = clock::duration::max();
+            auto total = clock::duration::zero();
+            for (std::size_t r = 0; r < params.repetitions; ++r) {
+                coral::util::TempDir target;
+                const auto start = clock::now();
+                archive.ExtractAll(target.Path(), static_cast<unsigned>(threads));
+                const auto t = clock::now() - start;
+                best = std::min(best, t);
+                total += t;
+            }
+            const auto mean = total / params.repetitions;
+            BenchmarkResult result("zip");
+            result
+                .Add("archive", name)
+                .Add("entries", archive.EntryCount())
+                .Add("bytes", totalSize)
+                .Add("threads", static_cast<std::uint64_t>(threads))
+                .Add("repetitions", static_cast<std::uint64_t>(params.repetitions))
+                .Add("best_s", Seconds(best))
+                .Add("mean_s", Seconds(mean))
+                .Add("mb_per_s", totalSize / Seconds(best) / (1024*1024));
+            result.Write(out);
+        }
+    }
+}
+
+
+int ZipBenchmark(const std::vector<std::string>& args)
+{
+    namespace po = boost::program_options;
+    po::options_description options("Options");
+    options.add_options()
+        ("archive", po::value<std::vector<std::string>>(),
+            "An archive to extract, e.g. test_data/ziptest.zip.  May be "
+            "specified several times.")
+        ("repetitions", po::value<std::size_t>()->default_value(3),
+            "The number of times to extract each archive with each thread "
+            "count.")
+        ("synthetic-file-size", po::value<std::size_t>()->default_value(16),
+            "The size of each file in the synthetic archive, in MiB.")
+        ("synthetic-files", po::value<std::size_t>()->default_value(64),
+            "The number of files in the synthetic archive.  Zero means that no "
+            "synthetic archive is created.")
+        ("threads", po::value<std::string>()->default_value("1,2,4,8,0"),
+            "A comma-separated list of thread counts, where 0 means that the "
+            "number is chosen automatically.  Each archive is extracted with "
+            "each of them.");
+    AddOutputOptions(options);
+    coral::util::AddLoggingOptions(options);
+
+    const auto argValues = coral::util::ParseArguments(
+        args, options,
+        po::options_description(), po::positional_options_description(),
+        std::cerr,
+        "coral_bench zip",
+        "Measures the throughput of coral::util::zip::Archive::ExtractAll() "
+        "as a function of the number of threads.  The archives given with "
+        "--archive are extracted, along with a synthetic archive whose files "
+        "are half random and half repetitive data.  Results are written as "
+        "one JSON object per line.");
+    if (!argValues) return 0;
+    coral::util::UseLoggingArguments(*argValues, "coral_bench");
+
+    ZipParams params;
+    params.repetitions = (*argValues)["repetitions"].as<std::size_t>();
+    params.threadCounts = ParseSizeList((*argValues)["threads"].as<std::string>());
+    if (params.repetitions == 0) throw std::runtime_error("Invalid repetitions value");
+    const auto syntheticFiles = (*argValues)["synthetic-files"].as<std::size_t>();
+    const auto syntheticFileSize =
+        (*argValues)["synthetic-file-size"].as<std::size_t>() * 1024 * 1024;
+
+    std::ofstream outputFile;
+    auto& out = UseOutputArguments(*argValues, outputFile);
+
+    if (argValues->count("archive")) {
+        for (const auto& a : (*argValues)["archive"].as<std::vector<std::string>>()) {
+            RunZip(boost::filesystem::path(a).filename().string(), a, params, out);
+        }
+    }
+    if (syntheticFiles > 0) {
+        coral::util::TempDir workDir;
+        const auto archivePath = workDir.Path() / "synthetic.zip";
+        std::cerr << "Creating synthetic archive..." << std::endl;
+        {
+            coral::util::TempDir filesDir;
+            CreateSyntheticArchive(
+                archivePath, filesDir.Path(), syntheticFiles, syntheticFileSize);
+        }
+        RunZip("synthetic", archivePath, params, out);
+    }
+    return 0;
+}
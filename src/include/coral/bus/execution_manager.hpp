@@ -207,6 +207,16 @@ public:
     /// Terminates the entire execution and all associated slaves.
     void Terminate();
 
+    /**
+    \brief  Returns the timings reported by a slave for its most recent
+            time step.
+
+    \throws std::invalid_argument if there is no slave with the given ID.
+    \see SlaveController::LastStepTimings()
+    */
+    coral::master::SlaveStepTimings LastStepTimings(
+        coral::model::SlaveID slave) const;
+
 private:
     std::unique_ptr<ExecutionManagerPrivate> m_private;
 };
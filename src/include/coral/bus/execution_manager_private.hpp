@@ -13,6 +13,7 @@
 // For the sake of maintainability, we can skip the headers which are already
 // included by execution_manager.hpp, and which are only needed here because
 // ExecutionManagerPrivate duplicates ExecutionManager's method signatures.
+#include <chrono>
 #include <functional>
 #include <map>
 #include <memory>
@@ -21,10 +22,12 @@
 #include <boost/noncopyable.hpp>
 
 #include <coral/config.h>
+#include <coral/metrics.hpp>
 #include <coral/model.hpp>
 #include <coral/net.hpp>
 
 #include <coral/bus/execution_manager.hpp>
+#include <coral/bus/slave_control_channel.hpp>
 #include <coral/bus/slave_controller.hpp>
 #include <coral/bus/slave_setup.hpp>
 
@@ -141,19 +144,32 @@ public:
         Slave(const Slave&) = delete;
         Slave& operator=(const Slave&) = delete;
 
-        CORAL_DEFINE_DEFAULT_MOVE(Slave, slave, locator, description)
+        CORAL_DEFINE_DEFAULT_MOVE(Slave, slave, locator, description, stepLatency)
 
         std::unique_ptr<coral::bus::SlaveController> slave;
         coral::net::SlaveLocator locator;
         coral::model::SlaveDescription description;
+
+        // The time from a STEP command is sent until this slave has replied,
+        // in nanoseconds.
+        coral::metrics::Histogram* stepLatency;
     };
 
     // Data which is available to the state objects
     coral::net::Reactor& reactor;
+
+    // Carries the control connections to all slaves.  Must be declared
+    // before `slaves`, so it outlives them.
+    coral::bus::SlaveControlRouter controlRouter;
+
     coral::bus::SlaveSetup slaveSetup;
     coral::model::SlaveID lastSlaveID;
     std::map<coral::model::SlaveID, Slave> slaves;
 
+    // The time from STEP commands are sent until all slaves have replied,
+    // in nanoseconds.
+    coral::metrics::Histogram& stepLatency;
+
 private:
     // Make class nonmovable in addition to noncopyable, because we leak
     // pointers to it in lambda functions.
@@ -179,6 +195,15 @@ private:
 
     // Whether a RESEND_VARS is needed before the next STEP.
     bool m_resendVarsNeeded;
+
+    // Metrics which are updated by AdvanceSimTime().  The real-time factor
+    // is smoothed over several steps, starting from the time of the
+    // previous call.
+    coral::metrics::Counter& m_stepCount;
+    coral::metrics::Gauge& m_simTime;
+    coral::metrics::Gauge& m_realTimeFactor;
+    std::chrono::steady_clock::time_point m_lastAdvanceTime;
+    double m_smoothedRealTimeFactor;
 };
 
 
@@ -11,7 +11,10 @@
 #define CORAL_BUS_SLAVE_AGENT_HPP
 
 #include <chrono>
+#include <cstdint>
 #include <exception>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -20,6 +23,7 @@
 #include <zmq.hpp>
 
 #include <coral/config.h>
+#include <coral/bus/value_store.hpp>
 #include <coral/bus/variable_io.hpp>
 #include <coral/model.hpp>
 #include <coral/net.hpp>
@@ -111,6 +115,20 @@ private:
     */
     void RequestReply(std::vector<zmq::message_t>& msg);
 
+    // Receives a command from the master on `socket`, which is either the
+    // control socket or the broadcast socket, and sends the reply on the
+    // control socket.
+    void HandleCommand(coral::net::Reactor& reactor, zmq::socket_t& socket);
+
+    // Receives a message on the broadcast socket.  Returns whether it is a
+    // command which should be acted on, in which case `msg` contains the
+    // command without its topic frame.
+    bool ReceiveBroadcast(std::vector<zmq::message_t>& msg);
+
+    // Binds the broadcast socket, subscribes to commands and to `topic`,
+    // and returns the bound endpoint.
+    std::string BindBroadcastSocket(const std::string& topic);
+
     // Each of these functions correspond to one of the slave's possible states.
     // On input, `msg` is a message from the master node, and when the function
     // returns, `msg` must contain the reply.  If the message triggers a state
@@ -141,7 +159,8 @@ private:
     // Performs the time step for ReadyHandler()
     bool Step(const coralproto::execution::StepData& stepData);
 
-    // Publishes all variable values (used by HandleResendVars() and Step()).
+    // Publishes all variable values (used by HandleResendVars() and Step()),
+    // or only the changed ones if m_deltaPublication is set.
     void PublishAll();
 
     // A pointer to the handler function for the current state.
@@ -188,9 +207,21 @@ private:
 
         // Establishes a connection between a remote output variable and one of
         // our input variables, breaking any existing connections to that input.
+        // If the input is real, `transform` is applied to the values received.
         void Couple(
             coral::model::Variable remoteOutput,
-            coral::model::VariableID localInput);
+            coral::model::VariableID localInput,
+            const coral::model::LinearTransform& transform);
+
+        // Establishes connections between several remote output variables and
+        // one of our real input variables, breaking any existing connections
+        // to that input.  The input is given the aggregate of their values,
+        // to which `transform` is applied.
+        void Couple(
+            const std::vector<coral::model::Variable>& remoteOutputs,
+            coral::model::VariableID localInput,
+            coral::model::Aggregation aggregation,
+            const coral::model::LinearTransform& transform);
 
         // Waits until all data has been received for the time step specified
         // by `stepID` and updates the slave instance with the new values.
@@ -200,17 +231,75 @@ private:
             std::chrono::milliseconds timeout);
 
     private:
-        // Breaks a connection to a local input variable, if any.
+        // Breaks the connections to a local input variable, if any.
         void Decouple(coral::model::VariableID localInput);
 
+        // Groups the connected inputs by the data type of the values we
+        // receive for them, looks up where those values are stored, and
+        // prepares each group for bulk access with the slave instance.
+        void GroupInputs(const coral::slave::Instance& slaveInstance);
+
         // A bidirectional mapping between output variables and input variables.
+        // An input is only mapped to several outputs if it is in
+        // m_aggregations.
         typedef boost::bimap<
             boost::bimaps::multiset_of<coral::model::Variable, VariableLess>,
-            coral::model::VariableID>
+            boost::bimaps::multiset_of<coral::model::VariableID>>
             ConnectionBimap;
 
         ConnectionBimap m_connections;
         coral::bus::VariableSubscriber m_subscriber;
+
+        // The transformations of connected inputs, except identities.
+        std::map<coral::model::VariableID, coral::model::LinearTransform> m_transforms;
+
+        // The aggregations of inputs which are connected to several outputs.
+        std::map<coral::model::VariableID, coral::model::Aggregation> m_aggregations;
+
+        // The connected inputs of one data type, the same prepared for
+        // setting their values in bulk, and the index of the value for each
+        // of them in the subscriber's value store.  Real inputs which are
+        // given an aggregate come last, and have no index here.
+        struct Inputs
+        {
+            std::vector<coral::model::VariableID> variables;
+            std::unique_ptr<coral::slave::VariableGroup> group;
+            std::vector<std::size_t> sources;
+        };
+        Inputs m_realInputs;
+        Inputs m_integerInputs;
+        Inputs m_booleanInputs;
+        Inputs m_stringInputs;
+
+        // Real inputs which are given an aggregate of several values, and the
+        // indices of those values in the subscriber's value store.  The
+        // values for input `i` are `sources[offsets[i]]` up to, but not
+        // including, `sources[offsets[i+1]]`, and the aggregate is stored
+        // at `targets[i]` in m_inputValues.  There is one set for each type
+        // of aggregation, so they can be computed without branching.
+        struct Aggregates
+        {
+            std::vector<std::size_t> targets;
+            std::vector<std::size_t> offsets;
+            std::vector<std::size_t> sources;
+        };
+        Aggregates m_sums;
+        Aggregates m_minima;
+        Aggregates m_maxima;
+        Aggregates m_means;
+
+        // The gain and offset for each real input, which are only used if at
+        // least one of the transformations is not an identity.
+        std::vector<double> m_realGains;
+        std::vector<double> m_realOffsets;
+        bool m_transformReals = false;
+
+        // The input values, in the same order as the inputs above, and
+        // whether the grouping is up to date with m_connections and the
+        // subscriber's slots.
+        coral::bus::ValueStore m_inputValues;
+        bool m_inputsGrouped = false;
+        std::uint64_t m_slotRevision = 0;
     };
 
     coral::slave::Instance& m_slaveInstance;
@@ -223,6 +312,32 @@ private:
     coral::model::SlaveID m_id; // The slave's ID number in the current execution
 
     coral::model::StepID m_currentStepID; // ID of ongoing or just completed step
+
+    // Our output variables, grouped by data type and prepared so PublishAll()
+    // can get their values in bulk, and the values.  The value of
+    // `m_realOutputs->Variables()[i]` is in slot `i` of the real array, and
+    // so on.
+    std::unique_ptr<coral::slave::VariableGroup> m_realOutputs;
+    std::unique_ptr<coral::slave::VariableGroup> m_integerOutputs;
+    std::unique_ptr<coral::slave::VariableGroup> m_booleanOutputs;
+    std::unique_ptr<coral::slave::VariableGroup> m_stringOutputs;
+    coral::bus::ValueStore m_outputValues;
+
+    // Whether only changed output values are published (see
+    // SetupData::delta_publication in execution.proto).
+    bool m_deltaPublication;
+
+    // Time spent in the different phases of the current step, which is
+    // reported to the master in the STEP_OK and READY replies.
+    coralproto::execution::StepTimings m_stepTimings;
+
+    // A socket on which the master may publish commands which are common to
+    // all slaves (see SetupData::broadcast_topic in execution.proto), and
+    // whether the master has activated it by publishing our own topic.
+    coral::net::Reactor& m_reactor;
+    std::unique_ptr<zmq::socket_t> m_broadcast;
+    std::string m_broadcastTopic;
+    bool m_broadcastActive;
 };
 
 
@@ -0,0 +1,229 @@
+/**
+\file
+\brief  Defines the coral::bus::SlaveControlRouter and
+        coral::bus::SlaveControlChannel classes.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_BUS_SLAVE_CONTROL_CHANNEL_HPP
+#define CORAL_BUS_SLAVE_CONTROL_CHANNEL_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <zmq.hpp>
+
+#include <coral/config.h>
+#include <coral/net.hpp>
+#include <coral/net/reactor.hpp>
+
+
+namespace coral
+{
+namespace bus
+{
+
+class SlaveControlChannel;
+
+
+/**
+\brief  Multiplexes the master's control connections to all its slaves over
+        a single socket.
+
+The router owns one ROUTER socket which connects to every slave's control
+endpoint, each connection with its own routing ID.  Replies are received by
+a single reactor handler and dispatched by routing ID to the channel that
+the request came from.  Sending a command is therefore just a write to a
+shared socket, and the master uses one socket and one poll item no matter
+how many slaves it controls.
+
+This requires a ZeroMQ version which supports the `ZMQ_CONNECT_RID` socket
+option (4.1 or later).  With older versions, each channel falls back to
+having its own socket.
+
+Optionally, commands which are the same for all slaves can be published once
+with Broadcast() instead of being sent on each channel.  The slaves still
+reply on their respective channels.  See `SetupData::broadcast_topic` in
+execution.proto for a description of the subscription handshake.
+
+The router must outlive all channels created with it.
+*/
+class SlaveControlRouter
+{
+public:
+    /// Creates a router whose replies are received via `reactor`.
+    explicit SlaveControlRouter(coral::net::Reactor& reactor);
+
+    ~SlaveControlRouter() noexcept;
+
+    SlaveControlRouter(const SlaveControlRouter&) = delete;
+    SlaveControlRouter& operator=(const SlaveControlRouter&) = delete;
+
+    /// The reactor used to receive replies.
+    coral::net::Reactor& Reactor() noexcept;
+
+    /**
+    \brief  Opens a new channel to the slave whose control endpoint is
+            `endpoint`.
+
+    The connection is established in the background, and messages sent
+    before that are queued.  Each call creates a new connection with its own
+    routing ID, so replies meant for a previously closed channel are never
+    delivered to a new one.  There should be at most one open channel per
+    endpoint, since closing a channel disconnects from its endpoint.
+    */
+    SlaveControlChannel Connect(const coral::net::Endpoint& endpoint);
+
+    /**
+    \brief  Enables broadcasting of commands.
+
+    Only slaves which are set up after this will receive broadcasts.
+    */
+    void EnableBroadcast();
+
+    /// Returns whether EnableBroadcast() has been called.
+    bool BroadcastEnabled() const noexcept;
+
+    /// Returns whether a call to Broadcast() would reach any slaves.
+    bool HasBroadcastReceivers() const noexcept;
+
+    /**
+    \brief  Publishes a command to all slaves which receive broadcasts.
+
+    Slaves which have completed the subscription handshake since the last
+    call are switched over first, so that this is the first command they
+    act on.  After the call, SlaveControlChannel::ReceivesBroadcasts() is
+    true for their channels.  The message content will be cleared on return.
+
+    \pre BroadcastEnabled()
+    */
+    void Broadcast(std::vector<zmq::message_t>& msg);
+
+private:
+    friend class SlaveControlChannel;
+    typedef std::function<void(std::vector<zmq::message_t>&)> ReplyHandler;
+
+    struct Peer
+    {
+        std::string id;
+        std::string endpoint;
+        std::shared_ptr<ReplyHandler> onReply;
+        std::string broadcastEndpoint;
+        bool broadcastSubscribed = false;
+        bool receivesBroadcasts = false;
+#ifndef ZMQ_CONNECT_RID
+        std::unique_ptr<zmq::socket_t> socket;
+#endif
+    };
+
+    void Send(Peer& peer, std::vector<zmq::message_t>& msg);
+    void SetReplyHandler(Peer& peer, ReplyHandler handler);
+    std::string BroadcastTopic(const Peer& peer) const;
+    void ConnectBroadcast(Peer& peer, const std::string& endpoint);
+    void Disconnect(Peer& peer) noexcept;
+    void ReceiveReplies(zmq::socket_t& socket);
+    void ReceiveSubscriptions(zmq::socket_t& socket);
+    void Dispatch(const std::string& peerID, std::vector<zmq::message_t>& msg);
+
+    coral::net::Reactor& m_reactor;
+    std::uint64_t m_nextPeerID;
+    std::unordered_map<std::string, Peer> m_peers;
+#ifdef ZMQ_CONNECT_RID
+    zmq::socket_t m_socket;
+#endif
+
+    std::unique_ptr<zmq::socket_t> m_broadcastSocket;
+    std::vector<Peer*> m_pendingBroadcastReceivers;
+    std::size_t m_broadcastReceiverCount;
+};
+
+
+/**
+\brief  A handle for one slave's control connection in a SlaveControlRouter.
+
+The channel is closed when the handle is destroyed.  This type is moveable,
+non-copyable and default-constructible.
+*/
+class SlaveControlChannel
+{
+public:
+    /// The type of the function that is called when a reply is received.
+    typedef std::function<void(std::vector<zmq::message_t>&)> ReplyHandler;
+
+    /// Constructs a handle which does not refer to any channel.
+    SlaveControlChannel() noexcept;
+
+    SlaveControlChannel(SlaveControlChannel&&) noexcept;
+    SlaveControlChannel& operator=(SlaveControlChannel&&) noexcept;
+    ~SlaveControlChannel() noexcept;
+
+    /**
+    \brief  Sends a request to the slave.
+
+    The message content will be cleared on return.
+    */
+    void Send(std::vector<zmq::message_t>& msg);
+
+    /**
+    \brief  Sets the function which is called with every reply from the slave.
+
+    The handler may be replaced, and the channel closed, from within the
+    handler itself.
+    */
+    void SetReplyHandler(ReplyHandler handler);
+
+    /**
+    \brief  Closes the channel.
+
+    Replies which arrive after this are discarded.  If the handle does not
+    refer to a channel, this function has no effect.
+    */
+    void Close() noexcept;
+
+    /// Returns whether the handle refers to an open channel.
+    explicit operator bool() const noexcept;
+
+    /**
+    \brief  Returns the topic which the slave should subscribe to in order to
+            receive broadcasts, or an empty string if broadcasting is disabled.
+    */
+    std::string BroadcastTopic() const;
+
+    /**
+    \brief  Connects the router's broadcast socket to the slave's subscriber
+            socket.
+
+    If the endpoint is a TCP endpoint with a wildcard address, the address of
+    the slave's control endpoint is used instead.
+    */
+    void ConnectBroadcast(const std::string& endpoint);
+
+    /**
+    \brief  Returns whether the slave acts on commands published with
+            SlaveControlRouter::Broadcast().
+
+    When this is true, commands which are broadcast should not also be sent
+    on the channel.
+    */
+    bool ReceivesBroadcasts() const noexcept;
+
+private:
+    friend class SlaveControlRouter;
+    SlaveControlChannel(
+        SlaveControlRouter& router,
+        SlaveControlRouter::Peer& peer) noexcept;
+
+    SlaveControlRouter* m_router;
+    SlaveControlRouter::Peer* m_peer;
+};
+
+
+}} // namespace
+#endif // header guard
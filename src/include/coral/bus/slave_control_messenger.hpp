@@ -26,6 +26,7 @@ stuff in this header.
 #include <coral/config.h>
 
 #include <coral/bus/slave_setup.hpp>
+#include <coral/master/step_statistics.hpp>
 #include <coral/net/reactor.hpp>
 #include <coral/model.hpp>
 #include <coral/net.hpp>
@@ -49,6 +50,8 @@ enum SlaveState
 };
 
 
+class SlaveControlRouter;
+
 // Internal types, intentionally left undefined and undocumented.
 class PendingSlaveControlConnectionPrivate;
 struct SlaveControlConnectionPrivate;
@@ -268,8 +271,11 @@ public:
                                 A negative value means no time limit.
     \param [in] onComplete      Completion handler
 
-    \throws std::invalid_argument if `timeout` is less than 1 ms or
-        if `onComplete` is empty.
+    \throws std::invalid_argument if `timeout` is less than 1 ms,
+        if `onComplete` is empty, if `settings` contains an aggregated
+        connection and SupportsAggregation() returns `false`, or if it
+        contains a non-identity transformation and SupportsTransforms()
+        returns `false`.
 
     \pre  `State() == SLAVE_READY`
     \post `State() == SLAVE_BUSY`.
@@ -408,6 +414,11 @@ public:
 
     All error conditions are fatal unless otherwise specified.
 
+    If the slave's channel receives broadcasts (see
+    SlaveControlChannel::ReceivesBroadcasts()), this function does not send
+    the command itself.  The caller must then have published it with
+    SlaveControlRouter::Broadcast() before calling this function.
+
     \param [in] stepID          The ID of the time step to be performed
     \param [in] currentT        The current time point
     \param [in] deltaT          The step size
@@ -456,6 +467,9 @@ public:
       - `coral::error::generic_error::failed`: The operation failed (e.g. due to
             an error in the slave).
 
+    As with Step(), this function does not send the command itself if the
+    slave's channel receives broadcasts.
+
     \param [in] timeout         Max. allowed time for the operation to complete.
                                 A negative value means no time limit.
     \param [in] onComplete      Completion handler
@@ -484,6 +498,45 @@ public:
     \post `State() == SLAVE_NOT_CONNECTED`
     */
     virtual void Terminate() = 0;
+
+    /**
+    \brief  Returns the timings reported by the slave for its most recent
+            time step.
+
+    The `doStep` and `publish` fields are updated when a Step() operation
+    completes successfully, and `dataWait` is updated when the subsequent
+    AcceptStep() operation completes successfully.  Fields which the slave
+    has not reported are zero.
+    */
+    virtual coral::master::SlaveStepTimings LastStepTimings() const noexcept = 0;
+
+    /**
+    \brief  Returns whether the slave supports aggregated connections.
+
+    Slaves from earlier versions silently ignore the aggregation part of a
+    variable setting, so SetVariables() must not be called with such
+    settings unless this returns `true`.
+    */
+    virtual bool SupportsAggregation() const noexcept = 0;
+
+    /**
+    \brief  Returns whether the slave supports linear transformations of
+            connections.
+
+    Slaves from earlier versions silently ignore the transformation part of
+    a variable setting, so SetVariables() must not be called with settings
+    that have non-identity transformations unless this returns `true`.
+    */
+    virtual bool SupportsTransforms() const noexcept = 0;
+
+    /**
+    \brief  Returns whether the slave supports delta publication.
+
+    Slaves from earlier versions ignore SlaveSetup::deltaPublication and
+    don't understand the "step complete" messages of the slaves that use
+    it, so they must not take part in an execution where it is enabled.
+    */
+    virtual bool SupportsDeltaPublication() const noexcept = 0;
 };
 
 
@@ -542,8 +595,9 @@ Possible error conditions are:
 Note that the completion handler is never called if ConnectToSlave() throws
 an exception.
 
-\param [in] reactor         The reactor used to listen for a reply from the
-                            slave.  This will later be used by the
+\param [in] router          The router through which the connection is made,
+                            and whose reactor is used to listen for a reply
+                            from the slave.  This will later be used by the
                             ISlaveControlMessenger object to perform further
                             communication with it, so it is important that
                             it outlives this object.
@@ -559,7 +613,7 @@ an exception.
 \throws std::invalid_argument if any of the arguments are invalid.
 */
 PendingSlaveControlConnection ConnectToSlave(
-    coral::net::Reactor& reactor,
+    SlaveControlRouter& router,
     const coral::net::SlaveLocator& slaveLocator,
     int maxAttempts,
     std::chrono::milliseconds timeout,
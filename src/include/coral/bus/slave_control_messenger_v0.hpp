@@ -14,12 +14,13 @@
 #include <memory>
 
 #include <coral/config.h>
+#include <coral/bus/slave_control_channel.hpp>
 #include <coral/bus/slave_control_messenger.hpp>
 #include <coral/bus/slave_setup.hpp>
 #include <coral/model.hpp>
 #include <coral/net.hpp>
 #include <coral/net/reactor.hpp>
-#include <coral/net/zmqx.hpp>
+#include <coral/timeline.hpp>
 
 #include <boost/variant.hpp>
 
@@ -43,7 +44,7 @@ class SlaveControlMessengerV0 : public ISlaveControlMessenger
 public:
     SlaveControlMessengerV0(
         coral::net::Reactor& reactor,
-        coral::net::zmqx::ReqSocket socket,
+        SlaveControlChannel channel,
         coral::model::SlaveID slaveID,
         const std::string& slaveName,
         const SlaveSetup& setup,
@@ -87,6 +88,14 @@ public:
 
     void Terminate() override;
 
+    coral::master::SlaveStepTimings LastStepTimings() const noexcept override;
+
+    bool SupportsAggregation() const noexcept override;
+
+    bool SupportsTransforms() const noexcept override;
+
+    bool SupportsDeltaPublication() const noexcept override;
+
 private:
     typedef boost::variant<VoidHandler, GetDescriptionHandler> AnyHandler;
 
@@ -112,7 +121,7 @@ private:
     void UnregisterTimeout();
 
     // Event handlers
-    void OnReply();
+    void OnReply(std::vector<zmq::message_t>& msg);
     void OnReplyTimeout();
 
     // Reply parsing/handling
@@ -149,7 +158,7 @@ private:
     void CheckInvariant() const;
 
     coral::net::Reactor& m_reactor;
-    coral::net::zmqx::ReqSocket m_socket;
+    SlaveControlChannel m_channel;
 
     // State information
     SlaveState m_state;
@@ -157,6 +166,14 @@ private:
     int m_currentCommand;
     AnyHandler m_onComplete;
     int m_replyTimeoutTimerId;
+    bool m_supportsAggregation;
+    bool m_supportsTransforms;
+    bool m_supportsDeltaPublication;
+
+    // Timeline tracing and step statistics
+    coral::model::SlaveID m_slaveID;
+    coral::timeline::Time m_commandSendTime;
+    coral::master::SlaveStepTimings m_lastStepTimings;
 };
 
 
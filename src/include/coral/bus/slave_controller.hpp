@@ -17,9 +17,9 @@
 #include <vector>
 
 #include <coral/config.h>
+#include <coral/bus/slave_control_channel.hpp>
 #include <coral/bus/slave_control_messenger.hpp>
 #include <coral/bus/slave_setup.hpp>
-#include <coral/net/reactor.hpp>
 #include <coral/model.hpp>
 #include <coral/net.hpp>
 
@@ -59,8 +59,9 @@ public:
     yet), the connection may be retried automatically.  The maximum number of
     connection attempts is given by `maxConnectionAttempts`.
 
-    \param [in] reactor
-        The reactor used for the messaging/event loop.
+    \param [in] router
+        The router through which the slave is controlled.  Its reactor is
+        used for the messaging/event loop.
     \param [in] slaveLocator
         Information about how to connect to the slave.
     \param [in] slaveID
@@ -82,7 +83,7 @@ public:
         invalid, if `onComplete` is empty, or if `maxConnectionAttempts < 1`.
     */
     SlaveController(
-        coral::net::Reactor& reactor,
+        SlaveControlRouter& router,
         const coral::net::SlaveLocator& slaveLocator,
         coral::model::SlaveID slaveID,
         const std::string& slaveName,
@@ -246,6 +247,42 @@ public:
     */
     void Terminate();
 
+    /**
+    \brief  Returns the timings reported by the slave for its most recent
+            time step.
+
+    \see ISlaveControlMessenger::LastStepTimings()
+    */
+    coral::master::SlaveStepTimings LastStepTimings() const noexcept;
+
+    /**
+    \brief  Returns whether the slave supports aggregated connections.
+
+    This is `false` until the connection has been established.
+
+    \see ISlaveControlMessenger::SupportsAggregation()
+    */
+    bool SupportsAggregation() const noexcept;
+
+    /**
+    \brief  Returns whether the slave supports linear transformations of
+            connections.
+
+    This is `false` until the connection has been established.
+
+    \see ISlaveControlMessenger::SupportsTransforms()
+    */
+    bool SupportsTransforms() const noexcept;
+
+    /**
+    \brief  Returns whether the slave supports delta publication.
+
+    This is `false` until the connection has been established.
+
+    \see ISlaveControlMessenger::SupportsDeltaPublication()
+    */
+    bool SupportsDeltaPublication() const noexcept;
+
 private:
     // Make this class non-movable, since we leak pointers to 'this' in lambda
     // functions passed to SlaveControlMessenger.
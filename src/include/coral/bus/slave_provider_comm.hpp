@@ -16,6 +16,7 @@
 #include <memory>
 #include <string>
 #include <system_error>
+#include <vector>
 
 #include <coral/config.h>
 #include <coral/model.hpp>
@@ -30,8 +31,23 @@ namespace bus
 {
 
 
+/// A number of slaves of the same type, for batch instantiation requests.
+struct SlaveBatch
+{
+    /// The slave type identifier.
+    std::string slaveTypeUUID;
+
+    /// The number of slaves.
+    int count;
+};
+
+
 /**
 \brief  A class for communicating with a single slave provider.
+
+Several requests may be in progress at the same time.  They are sent
+immediately, without waiting for replies to earlier requests, but the slave
+provider handles them one at a time, in the order they were sent.
 */
 class SlaveProviderClient
 {
@@ -83,6 +99,32 @@ public:
         GetSlaveTypesHandler onComplete,
         std::chrono::milliseconds timeout);
 
+    /**
+    \brief  Requests descriptions of some or all of the slave types provided.
+
+    Unlike GetSlaveTypes(), this makes a new request every time, and it
+    allows leaving out the variable descriptions, which make up the bulk of
+    the data for most slave types.  The request is not understood by slave
+    providers from Coral 0.10 and earlier.
+
+    \param [in] slaveTypeUUIDs
+        The slave types to describe, or an empty list to describe all of them.
+        UUIDs of unknown slave types are ignored.
+    \param [in] includeVariables
+        Whether the descriptions should include variables.
+    \param [in] onComplete
+        Function which is called when the result is ready, or with an error
+        code in case of failure.
+    \param [in] timeout
+        Maximum time allowed for the request to complete.
+        A negative value means that there is no time limit.
+    */
+    void GetSlaveTypeDescriptions(
+        const std::vector<std::string>& slaveTypeUUIDs,
+        bool includeVariables,
+        GetSlaveTypesHandler onComplete,
+        std::chrono::milliseconds timeout);
+
     /// Completion handler type for InstantiateSlave().
     typedef std::function<void(
             const std::error_code& ec,
@@ -101,7 +143,9 @@ public:
         risky, because it means that the entire slave provider will freeze
         if the slave hangs during startup).
     \param [in] requestTimeout
-        Additional time allowed for the whole request to complete.
+        Additional time allowed for the whole request to complete.  This
+        should include the time the request may spend waiting for other
+        requests to the same slave provider to complete.
         A negative value means that there is no time limit.
     \param [in] onComplete
         Function which is called with the slave address when the slave has
@@ -113,6 +157,43 @@ public:
         std::chrono::milliseconds requestTimeout,
         InstantiateSlaveHandler onComplete);
 
+    /// Completion handler type for InstantiateSlaves().
+    typedef std::function<void(
+            const std::error_code& ec,
+            const coral::net::SlaveLocator* slaveLocators,
+            std::size_t slaveLocatorCount,
+            const std::string& errorMessage)>
+        InstantiateSlavesHandler;
+
+    /**
+    \brief  Requests the instantiation of several slaves in one operation.
+
+    The slave provider starts all the slaves concurrently.  The operation
+    fails as a whole if any of them could not be instantiated.
+
+    The first time this is called, the client asks the slave provider which
+    protocol version it supports.  Slave providers from before this request
+    was added get one INSTANTIATE_SLAVE request per slave instead.
+
+    \param [in] slaveBatches
+        The numbers and types of slaves to instantiate.
+    \param [in] instantiationTimeout
+        The max allowed time for each slave to start up.
+        A negative value means that there is no time limit.
+    \param [in] requestTimeout
+        Additional time allowed for the whole request to complete.
+        A negative value means that there is no time limit.
+    \param [in] onComplete
+        Function which is called with the slave locators when all slaves
+        have been instantiated, or with an error code and message in case of
+        failure.  The locators are in the same order as `slaveBatches`.
+    */
+    void InstantiateSlaves(
+        const std::vector<SlaveBatch>& slaveBatches,
+        std::chrono::milliseconds instantiationTimeout,
+        std::chrono::milliseconds requestTimeout,
+        InstantiateSlavesHandler onComplete);
+
 private:
     class Private;
     std::unique_ptr<Private> m_private;
@@ -137,6 +218,16 @@ public:
         const std::string& slaveTypeUUID,
         std::chrono::milliseconds timeout) = 0;
 
+    /**
+    \brief  Instantiates several slaves.
+
+    Returns the slave locators in the same order as `slaveBatches`.
+    If any of the slaves could not be instantiated, an exception is thrown.
+    */
+    virtual std::vector<coral::net::SlaveLocator> InstantiateSlaves(
+        const std::vector<SlaveBatch>& slaveBatches,
+        std::chrono::milliseconds timeout) = 0;
+
     virtual ~SlaveProviderOps() noexcept { }
 };
 
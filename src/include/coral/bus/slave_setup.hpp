@@ -42,6 +42,44 @@ struct SlaveSetup
             that a subscription has failed to take effect.
     */
     std::chrono::milliseconds variableRecvTimeout;
+
+    /**
+    \brief  Whether slaves should only publish output values which have
+            changed since the previous time step.
+    */
+    bool deltaPublication;
+
+    /**
+    \brief  The offset between the master's and the slave's timeline trace
+            clocks, as estimated during the connection handshake.
+
+    This is filled in automatically by MakeSlaveControlMessenger().
+    */
+    std::chrono::nanoseconds traceClockOffset;
+
+    /**
+    \brief  Whether the slave supports aggregated connections, as reported
+            during the connection handshake.
+
+    This is filled in automatically by MakeSlaveControlMessenger().
+    */
+    bool supportsAggregation;
+
+    /**
+    \brief  Whether the slave supports linear transformations of connections,
+            as reported during the connection handshake.
+
+    This is filled in automatically by MakeSlaveControlMessenger().
+    */
+    bool supportsTransforms;
+
+    /**
+    \brief  Whether the slave supports delta publication, as reported during
+            the connection handshake.
+
+    This is filled in automatically by MakeSlaveControlMessenger().
+    */
+    bool supportsDeltaPublication;
 };
 
 
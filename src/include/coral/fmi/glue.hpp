@@ -10,6 +10,7 @@
 #ifndef CORAL_FMI_GLUE_HPP
 #define CORAL_FMI_GLUE_HPP
 
+#include <cstddef>
 #include <fmilib.h>
 #include <coral/model.hpp>
 
@@ -63,5 +64,24 @@ coral::model::VariableDescription ToVariable(
     coral::model::VariableID id);
 
 
+/// The number of distinct return values of VariableGroupIndex().
+const std::size_t VARIABLE_GROUP_COUNT = 5 * 4;
+
+
+/**
+\brief  Returns a unique index in the range [0, VARIABLE_GROUP_COUNT) for a
+        combination of causality and data type.
+
+This is used to look up tables of variables grouped by causality and data
+type.
+
+\throws std::logic_error
+    If `causality` or `dataType` is not a valid enum value.
+*/
+std::size_t VariableGroupIndex(
+    coral::model::Causality causality,
+    coral::model::DataType dataType);
+
+
 }}      // namespace
 #endif  // header guard
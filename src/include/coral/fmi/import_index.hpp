@@ -0,0 +1,99 @@
+/**
+\file
+\brief  Defines the coral::fmi::ImportIndex class.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_FMI_IMPORT_INDEX_HPP
+#define CORAL_FMI_IMPORT_INDEX_HPP
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <coral/model.hpp>
+
+
+namespace coral
+{
+namespace fmi
+{
+
+
+/**
+\brief  A persistent index of the slave type descriptions of FMU files.
+
+Importing an %FMU means unpacking it and parsing its model description,
+which takes a while.  A program which only needs the slave type
+descriptions, such as a slave provider, can use an index to skip this for
+FMUs which haven't changed since the last time it ran.
+
+An %FMU file is assumed to be unchanged if it has the same path, size and
+modification time as when it was added to the index.
+
+The index is not synchronised, neither between threads nor between
+processes.  If several processes write to the same index file, the last one
+wins, but the file is never left in a half-written state.
+*/
+class ImportIndex
+{
+public:
+    /**
+    \brief  Loads an index from a file.
+
+    If the file does not exist, or if it can't be read for some reason, the
+    index starts out empty.  (The latter is logged as a warning.)
+    */
+    explicit ImportIndex(const boost::filesystem::path& indexFile);
+
+    /**
+    \brief  Returns the description of an %FMU, or null if it is not in the
+            index or it has changed since it was added.
+
+    The returned pointer is valid until the next call to Insert().
+    */
+    const coral::model::SlaveTypeDescription* Find(
+        const boost::filesystem::path& fmuPath) const;
+
+    /**
+    \brief  Adds an %FMU to the index, replacing any existing entry for the
+            same path.
+
+    The size and modification time of the file are read when this function
+    is called, so it should be called with the description that was
+    obtained from the file in its current state.
+    */
+    void Insert(
+        const boost::filesystem::path& fmuPath,
+        const coral::model::SlaveTypeDescription& description);
+
+    /**
+    \brief  Writes the index to the file it was loaded from.
+
+    Entries for FMUs which no longer exist or have changed are left out.
+    */
+    void Save() const;
+
+private:
+    struct Entry
+    {
+        std::uintmax_t size;
+        std::time_t modificationTime;
+        coral::model::SlaveTypeDescription description;
+    };
+
+    static bool IsCurrent(const boost::filesystem::path& fmuPath, const Entry& entry);
+
+    boost::filesystem::path m_indexFile;
+    std::map<boost::filesystem::path, Entry> m_entries;
+};
+
+
+}} // namespace
+#endif // header guard
@@ -11,13 +11,17 @@
 #define CORAL_NET_REACTOR_HPP
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 
 #include <zmq.hpp>
 #include <coral/config.h>
+#include <coral/net/timer_wheel.hpp>
 
 
 namespace coral
@@ -34,9 +38,20 @@ it dispatches to the registered handler function(s) for that socket.
 If multiple sockets have incoming messages, or there are multiple handlers for
 one socket, the functions are called in the order they were added.
 
+Adding and removing sockets takes constant time, and each iteration of the
+messaging loop only visits the sockets which actually have incoming messages.
+When ZeroMQ is built with the draft `zmq_poller` API (and the
+`CORAL_USE_ZMQ_POLLER` build option is enabled), the sockets are registered
+with an epoll/kqueue based poller while Run() executes.  Otherwise, the
+reactor falls back to `zmq::poll()` on a poll item array which is updated in
+place as sockets are added and removed.
+
 It also supports timed events, where a handler function is called a certain
 number of times (or indefinitely) with a fixed time interval.  Timers are only
 active when the messaging loop is running, i.e. between Run() and Stop().
+They are kept in a TimerWheel, so adding, removing and restarting a timer
+takes constant time, and they are measured with a steady clock, so they are
+not affected by changes to the system time.
 */
 class Reactor
 {
@@ -47,12 +62,16 @@ public:
     typedef int NativeSocket;
 #endif
 
-    typedef std::chrono::system_clock::time_point TimePoint;
+    typedef std::chrono::steady_clock::time_point TimePoint;
     typedef std::function<void(Reactor&, zmq::socket_t&)> SocketHandler;
     typedef std::function<void(Reactor&, NativeSocket)> NativeSocketHandler;
     typedef std::function<void(Reactor&, int)> TimerHandler;
 
     Reactor();
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
 
     /// Adds a handler for the given socket.
     void AddSocket(zmq::socket_t& socket, SocketHandler handler);
@@ -146,17 +165,14 @@ public:
     void Stop();
 
 private:
-    struct Timer
+    struct Timer : TimerWheel::Node
     {
         Timer(
             int id,
-            TimePoint nextEventTime,
             std::chrono::milliseconds interval,
             int remaining,
             std::unique_ptr<TimerHandler> handler);
 
-        CORAL_DEFINE_DEFAULT_MOVE(Timer, id, nextEventTime, interval, remaining, handler)
-
         int id;
         TimePoint nextEventTime;
         std::chrono::milliseconds interval;
@@ -164,25 +180,55 @@ private:
         std::unique_ptr<TimerHandler> handler;
     };
 
-    void RestartTimerIntervals(
-        std::vector<Timer>::iterator begin,
-        std::vector<Timer>::iterator end);
+    void RestartTimerInterval(Timer& timer, TimePoint now) noexcept;
     std::chrono::milliseconds TimeToNextEvent() const;
-    void PerformNextEvent();
+    void PerformEvent(Timer& timer);
+
+    // All handlers for one socket.  Each handler is tagged with a sequence
+    // number, so that handlers for different sockets can be called in the
+    // order they were added.  Entries are heap allocated so that their
+    // addresses can be given to the poller.
+    struct SocketEntry
+    {
+        zmq::socket_t* socket = nullptr;
+        NativeSocket nativeSocket = NativeSocket();
+        bool removed = false;
+        // Position in the poll item array, used when zmq_poller is unavailable.
+        std::size_t pollIndex = 0;
+        std::vector<std::pair<std::uint64_t, std::unique_ptr<SocketHandler>>> handlers;
+        std::vector<std::pair<std::uint64_t, std::unique_ptr<NativeSocketHandler>>> nativeHandlers;
+    };
+
+    // The handler at position `index` in `entry`'s handler list.
+    struct ReadyHandler
+    {
+        std::uint64_t sequence;
+        SocketEntry* entry;
+        std::size_t index;
+    };
+
+    // Wraps whichever polling mechanism is in use; defined in net_reactor.cpp.
+    class Poller;
 
-    // Rebuilds the list of poll items.
-    void Rebuild();
+    void RemoveSocketEntry(std::unique_ptr<SocketEntry> entry) noexcept;
+    void DispatchReadySockets();
 
-    typedef std::pair<zmq::socket_t*, std::unique_ptr<SocketHandler>> SocketHandlerPair;
-    typedef std::pair<NativeSocket, std::unique_ptr<NativeSocketHandler>> NativeSocketHandlerPair;
-    std::vector<SocketHandlerPair> m_sockets;
-    std::vector<NativeSocketHandlerPair> m_nativeSockets;
-    std::vector<zmq::pollitem_t> m_pollItems;
+    std::unordered_map<zmq::socket_t*, std::unique_ptr<SocketEntry>> m_sockets;
+    std::unordered_map<NativeSocket, std::unique_ptr<SocketEntry>> m_nativeSockets;
+    // Removed entries are kept alive until the current dispatch round is over,
+    // since the poller may still have returned pointers to them.
+    std::vector<std::unique_ptr<SocketEntry>> m_removedSockets;
+    // Only exists while Run() is executing.
+    std::unique_ptr<Poller> m_poller;
+    std::uint64_t m_nextHandlerSequence;
+    std::vector<SocketEntry*> m_readySockets;
+    std::vector<ReadyHandler> m_readyHandlers;
 
     int m_nextTimerID;
-    std::vector<Timer> m_timers;
+    // Timers are heap allocated, since the wheel links them by address.
+    std::unordered_map<int, std::unique_ptr<Timer>> m_timers;
+    TimerWheel m_timerWheel;
 
-    bool m_needsRebuild;
     bool m_running;
 };
 
@@ -43,6 +43,13 @@ namespace reqrep
 This class represents the client side of the generic request-reply protocol.
 An instance of this class may only connect to one server at a time.
 
+Requests are pipelined:  A new request may be sent while others are still
+waiting for replies.  Each request is tagged with a request ID which the
+server returns along with the reply, so replies are matched with their
+requests regardless of the order in which they arrive, and each request
+has its own timeout.  The server handles requests in the order they are
+received.
+
 \see Server
     For the server-side class and more information about the protocol.
 */
@@ -133,7 +140,7 @@ public:
         A callback that will be called when the server responds or the request
         times out.  This function is guaranteed to be called unless Request()
         throws an exception or the Client is destroyed before a reply can be
-        received.
+        received.  Other requests may be sent while this one is in progress.
 
     \throws std::runtime_error
         If the timeout is reached before the message could even be sent
@@ -198,29 +205,41 @@ public:
         MaxProtocolReplyHandler onComplete);
 
 private:
-    void SendRequest(
+    // A request which is waiting for a reply.  Exactly one of the handlers
+    // is set.
+    struct PendingRequest
+    {
+        std::uint16_t protocolVersion;
+        ReplyHandler onComplete;
+        MaxProtocolReplyHandler onMaxProtocolComplete;
+        int timeoutTimerID;
+    };
+
+    // Sends a request and returns its ID.
+    std::uint32_t SendRequest(
         const std::string& protocolIdentifier, std::uint16_t protocolVersion,
         const char* requestHeader, size_t requestHeaderSize,
         const char* requestBody, size_t requestBodySize,
         std::chrono::milliseconds timeout);
 
-    void ReceiveReply();
-
-    void CompleteWithError(const std::error_code& ec);
+    void AddPendingRequest(
+        std::uint32_t requestID,
+        PendingRequest request,
+        std::chrono::milliseconds timeout);
 
-    void SetTimer(std::chrono::milliseconds timeout);
+    void ReceiveReply();
 
-    void CancelTimer();
+    // Removes the request from the list of pending ones and cancels its
+    // timer, then calls its handler with an error code.
+    void CompleteWithError(std::uint32_t requestID, const std::error_code& ec);
 
     coral::net::Reactor& m_reactor;
     std::string m_protocolIdentifier;
     coral::net::Endpoint m_serverEndpoint;
     coral::net::zmqx::ReqSocket m_socket;
 
-    int m_timeoutTimerID;
-    std::uint16_t m_requestProtocolVersion;
-    ReplyHandler m_onComplete;
-    MaxProtocolReplyHandler m_onMaxProtocolComplete;
+    std::uint32_t m_nextRequestID;
+    std::unordered_map<std::uint32_t, PendingRequest> m_pendingRequests;
 };
 
 
@@ -38,7 +38,10 @@ namespace service
         automatically detected on a network.
 
 An object of this class will start broadcasting information about its service
-immediately upon construction.  This happens in a background thread.  It is a
+immediately upon construction.  This happens in a background thread.  The
+service is also announced immediately whenever a probe sent with
+Listener::Probe() or Tracker::Probe() is received, provided that the beacon
+was able to bind to `port` on `networkInterface`.  It is a
 good idea to always call Stop() before the object is destroyed, so that errors
 are handled properly.  (See ~Beacon() for more information.)
 
@@ -191,6 +194,18 @@ public:
     /// Move assignment operator
     Listener& operator=(Listener&&) noexcept;
 
+    /**
+    \brief  Asks services to announce themselves immediately.
+
+    This broadcasts a probe message which makes every Beacon in the same
+    partition whose service type is `serviceType` send its announcement
+    right away, rather than at the end of its current period.  If
+    `serviceType` is empty, all services in the partition will respond.
+
+    \throws std::runtime_error on network error.
+    */
+    void Probe(const std::string& serviceType);
+
 private:
     class Impl;
     std::unique_ptr<Impl> m_impl;
@@ -327,6 +342,17 @@ public:
         PayloadChangedHandler onPayloadChange,
         DisappearedHandler onDisappearance);
 
+    /**
+    \brief  Asks services to announce themselves immediately.
+
+    This is useful after adding a tracked service type, to discover the
+    services which are already running without waiting for their next
+    beacon.  See Listener::Probe() for details.
+
+    \throws std::runtime_error on network error.
+    */
+    void Probe(const std::string& serviceType);
+
 private:
     class Impl;
     std::unique_ptr<Impl> m_impl;
@@ -0,0 +1,131 @@
+/**
+\file
+\brief  Contains the coral::net::TimerWheel class.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_NET_TIMER_WHEEL_HPP
+#define CORAL_NET_TIMER_WHEEL_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace coral
+{
+namespace net
+{
+
+
+/**
+\brief  A hierarchical timing wheel with millisecond resolution.
+
+This is the data structure behind the timers in Reactor.  It keeps track of
+a set of nodes, each of which has an expiry time, and hands them back once
+that time has passed.  Scheduling, rescheduling and cancelling a node are
+constant-time operations.  Finding the next expired node takes time
+proportional to the number of nodes which have to be moved down from higher
+levels, and is independent of how much time has passed.
+
+The wheel has four levels of 256 slots each, where a slot on level `L` covers
+256^L milliseconds.  Nodes which expire more than 2^32 ms (about 49 days)
+ahead are kept on an overflow list until they come within range.
+
+Expiry times are rounded up to the next millisecond, so a node never expires
+early.  All times are measured with `std::chrono::steady_clock`, so the wheel
+is unaffected by adjustments of the system clock.
+
+Nodes are intrusive: the wheel only stores pointers, and it is the caller's
+responsibility to cancel a node before it is destroyed.
+*/
+class TimerWheel
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /// Base class for objects that can be scheduled in a TimerWheel.
+    class Node
+    {
+    public:
+        Node() noexcept;
+
+        // Nodes are linked by address, so they can't be copied or moved.
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+
+        /// Whether the node is currently scheduled in a wheel.
+        bool IsScheduled() const noexcept { return m_list >= 0; }
+
+    private:
+        friend class TimerWheel;
+        Node* m_prev;
+        Node* m_next;
+        std::uint64_t m_expiry;
+        int m_list;
+    };
+
+    /// Creates an empty wheel whose time starts at `start`.
+    explicit TimerWheel(Clock::time_point start = Clock::now());
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+    \brief  Schedules `node` to expire at `expiry`.
+
+    If the node is already scheduled, it is rescheduled.  If `expiry` has
+    already passed, the node is returned by the next call to PopExpired().
+    */
+    void Schedule(Node& node, Clock::time_point expiry) noexcept;
+
+    /// Unschedules `node`.  Does nothing if it isn't scheduled.
+    void Cancel(Node& node) noexcept;
+
+    /**
+    \brief  Returns a node whose expiry time is at or before `now`, or null
+            if there is none.
+
+    The returned node is no longer scheduled.  Nodes which expire in the same
+    millisecond are returned in unspecified order.
+    */
+    Node* PopExpired(Clock::time_point now) noexcept;
+
+    /**
+    \brief  Returns a point in time before which no node will expire.
+
+    This is the exact expiry time of the next node if it is less than 256 ms
+    away, and otherwise the time at which the wheel must next be advanced.
+    Returns `Clock::time_point::max()` if the wheel is empty.
+    */
+    Clock::time_point NextWakeUp() const noexcept;
+
+    /// Returns the number of scheduled nodes.
+    std::size_t Size() const noexcept { return m_size; }
+
+private:
+    static const int levelBits = 8;
+    static const int slotsPerLevel = 1 << levelBits;
+    static const int levelCount = 4;
+    static const int overflowList = levelCount * slotsPerLevel;
+    static const int dueList = overflowList + 1;
+
+    std::uint64_t NextWakeUpTicks() const noexcept;
+    std::uint64_t ToTicks(Clock::time_point t, bool roundUp) const noexcept;
+    void Link(Node& node) noexcept;
+    void Unlink(Node& node) noexcept;
+    void Relink(int list) noexcept;
+
+    Clock::time_point m_start;
+    std::uint64_t m_current;
+    std::size_t m_size;
+    std::array<Node*, dueList + 1> m_lists;
+};
+
+
+}}      // namespace
+#endif  // header guard
@@ -63,7 +63,9 @@ public:
         The name or IP address of the network interface to broadcast and listen
         on.  The special value "*" means "all interfaces".
     \param [in] port
-        The port to broadcast and listen on.
+        The port to broadcast and listen on.  If this is zero and the socket
+        is bound (i.e., `onlySend` is not set), the OS chooses a free port,
+        which can be obtained with Port() afterwards.
     \param [in] flags
         A bitwise OR of one or more Flags values, or zero to use defaults.
 
@@ -123,6 +125,9 @@ public:
     /// The native socket handle.
     NativeSocket NativeHandle() const noexcept;
 
+    /// The port which the socket broadcasts and listens on.
+    ip::Port Port() const noexcept;
+
 private:
     class Private;
     std::unique_ptr<Private> m_private;
@@ -230,7 +230,7 @@ public:
     RepSocket();
 
     CORAL_DEFINE_DEFAULT_MOVE(RepSocket,
-        m_socket, m_boundEndpoint, m_clientEnvelope)
+        m_socket, m_boundEndpoint, m_clientEnvelope, m_lastClientEnvelope)
 
     ~RepSocket() noexcept;
 
@@ -285,6 +285,18 @@ public:
     */
     void Send(std::vector<zmq::message_t>& msg);
 
+    /**
+    \brief  Sends a message to the client which the last reply was sent to.
+
+    This is for protocols where a client may send requests through other
+    channels than this socket, but expects the replies to arrive here.
+    It does not affect the state of the request-reply sequence.
+
+    This function may only be called if the socket is connected or bound,
+    and a reply has been sent with Send() at least once.
+    */
+    void SendToLastClient(std::vector<zmq::message_t>& msg);
+
     /**
     \brief  Ignores the last received request.
 
@@ -310,6 +322,7 @@ private:
     std::unique_ptr<zmq::socket_t> m_socket;
     coral::net::Endpoint m_boundEndpoint;
     std::vector<zmq::message_t> m_clientEnvelope;
+    std::vector<zmq::message_t> m_lastClientEnvelope;
 };
 
 
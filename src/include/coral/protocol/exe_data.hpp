@@ -12,6 +12,7 @@
 
 #include <vector>
 #include <zmq.hpp>
+#include <coral/bus/value_store.hpp>
 #include <coral/model.hpp>
 
 
@@ -28,6 +29,12 @@ namespace exe_data
 {
 const size_t HEADER_SIZE = 6;
 
+/**
+\brief  The variable ID in the header of a "step complete" message, which
+        is never used for an actual variable.
+*/
+const coral::model::VariableID STEP_COMPLETE_VARIABLE_ID = 0xFFFFFFFF;
+
 struct Message
 {
     coral::model::Variable variable;
@@ -39,6 +46,56 @@ Message ParseMessage(const std::vector<zmq::message_t>& rawMsg);
 
 void CreateMessage(const Message& message, std::vector<zmq::message_t>& rawOut);
 
+/**
+\brief  Parses the header of a message, i.e., returns the variable whose value
+        it contains, without parsing the value.
+*/
+coral::model::Variable ParseVariable(const std::vector<zmq::message_t>& rawMsg);
+
+/**
+\brief  Parses the body of a message and stores its value in a ValueStore,
+        without going through a ScalarValue.
+
+If `slot` does not refer to a slot in `store` for the data type of the value
+(e.g. because it is value-initialised), a new slot is added to `store`, and
+`slot` is updated to refer to it.
+
+\returns The ID of the time step to which the value belongs.
+*/
+coral::model::StepID ParseValue(
+    const std::vector<zmq::message_t>& rawMsg,
+    coral::bus::ValueStore& store,
+    coral::bus::ValueSlot& slot);
+
+/// Creates a message which contains the value in a ValueStore slot.
+void CreateMessage(
+    const coral::model::Variable& variable,
+    coral::model::StepID timestepID,
+    const coral::bus::ValueStore& store,
+    coral::bus::ValueSlot slot,
+    std::vector<zmq::message_t>& rawOut);
+
+/**
+\brief  Creates a message which says that a slave has published all the
+        values it is going to publish for a time step.
+
+The message header is that of the variable with ID STEP_COMPLETE_VARIABLE_ID,
+so it can be subscribed to with Subscribe().
+*/
+void CreateStepCompleteMessage(
+    coral::model::SlaveID slaveID,
+    coral::model::StepID timestepID,
+    std::vector<zmq::message_t>& rawOut);
+
+/**
+\brief  Parses the body of a "step complete" message, i.e., one for which
+        ParseVariable() returns a variable with ID STEP_COMPLETE_VARIABLE_ID.
+
+\returns The ID of the time step which has been completed.
+*/
+coral::model::StepID ParseStepCompleteMessage(
+    const std::vector<zmq::message_t>& rawMsg);
+
 void Subscribe(zmq::socket_t& socket, const coral::model::Variable& variable);
 
 void Unsubscribe(zmq::socket_t& socket, const coral::model::Variable& variable);
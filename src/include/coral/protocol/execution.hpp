@@ -38,6 +38,15 @@ namespace execution
 {
 
 
+/**
+\brief  The topic on which the master publishes commands which are broadcast
+        to all slaves.
+
+See `SetupData::broadcast_topic` in execution.proto.
+*/
+const char BROADCAST_COMMAND_TOPIC[] = "*";
+
+
 /**
 \brief  Fills `message` with a body-less HELLO message that requests the
         given protocol version.
@@ -17,6 +17,7 @@
 #   pragma warning(push, 0)
 #endif
 #include <domain.pb.h>
+#include <execution.pb.h>
 #include <model.pb.h>
 #include <net.pb.h>
 #ifdef _MSC_VER
@@ -62,6 +63,15 @@ void ConvertToProto(
 /// Converts a protocol buffer to a Variable.
 coral::model::Variable FromProto(const coralproto::model::Variable& source);
 
+/**
+\brief  Converts an Aggregation to a protocol buffer enum.
+\pre `source != coral::model::NO_AGGREGATION`
+*/
+coralproto::execution::Aggregation ToProto(coral::model::Aggregation source);
+
+/// Converts a protocol buffer enum to an Aggregation.
+coral::model::Aggregation FromProto(coralproto::execution::Aggregation source);
+
 void ConvertToProto(
     const coral::net::SlaveLocator& source,
     coralproto::net::SlaveLocator& target);
@@ -0,0 +1,168 @@
+/**
+\file
+\brief  Low-overhead recording of timestamped spans, for diagnosing where
+        time is spent during a simulation.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_TIMELINE_HPP
+#define CORAL_TIMELINE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+
+namespace coral
+{
+/**
+\brief  Per-process timeline tracing.
+
+Timeline tracing is disabled by default.  When enabled with `Enable()`, spans
+recorded with `Record()` or `Span` are stored in an in-memory buffer which is
+written to a file in Chrome's trace event format (which can be viewed with
+`chrome://tracing` or Perfetto) when the process exits.
+
+Recording a span is lock free and allocation free (except for once every
+65536 spans), so tracing may be left on for entire simulation runs.  When
+tracing is disabled, recording a span costs one atomic load.
+
+Timestamps are taken from a monotonic clock.  Since each process has its own
+clock, a process may be assigned a clock offset with `SetClockOffset()`, which
+is added to all timestamps on export.  The master uses this to align the
+timelines of all slaves to its own clock.  The traces from several processes
+may thus be combined by concatenating their `traceEvents` arrays.
+*/
+namespace timeline
+{
+
+
+/// A point in time, in nanoseconds, on this process' trace clock.
+typedef std::int64_t Time;
+
+
+/// The value of the `arg` parameter of `Record()` when there is no argument.
+const std::int64_t noArg = -1;
+
+
+/// Returns the current time on the trace clock.
+Time Now() noexcept;
+
+
+/**
+\brief  Enables timeline tracing.
+
+The recorded spans will be written to `outputFile` when the process exits
+normally (i.e., when `std::exit()` is called or `main()` returns).
+
+\throws std::logic_error if tracing has already been enabled.
+*/
+void Enable(const std::string& outputFile);
+
+
+/**
+\brief  Disables timeline tracing and discards all spans recorded so far.
+
+No file is written when the process exits, unless tracing is enabled again.
+This must not be called while other threads are recording spans.
+*/
+void Disable() noexcept;
+
+
+namespace detail
+{
+    extern std::atomic<bool> enabled;
+}
+
+
+/// Returns whether tracing has been enabled.
+inline bool IsEnabled() noexcept
+{
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+
+/**
+\brief  Sets a human-readable name for this process, to be used when the
+        timeline is displayed.
+*/
+void SetProcessName(const std::string& name);
+
+
+/**
+\brief  Sets the offset which must be added to this process' trace clock to
+        get the corresponding time on the master's trace clock.
+*/
+void SetClockOffset(Time offset) noexcept;
+
+
+/**
+\brief  Records a span.
+
+This function does nothing if tracing is not enabled.
+
+\param [in] name
+    The name of the span.  This must point to a string with static storage
+    duration, since only the pointer is stored.
+\param [in] begin
+    The start time of the span.
+\param [in] end
+    The end time of the span.
+\param [in] arg
+    An optional argument which is displayed along with the span, typically
+    a step or slave ID.
+*/
+void Record(const char* name, Time begin, Time end, std::int64_t arg = noArg)
+    noexcept;
+
+
+/**
+\brief  Records a span which starts on construction and ends on destruction
+        (or on `End()`, whichever comes first).
+
+If tracing is not enabled when the object is constructed, it does nothing.
+*/
+class Span
+{
+public:
+    /// Starts the span.  `name` must have static storage duration.
+    explicit Span(const char* name, std::int64_t arg = noArg) noexcept
+        : m_name(IsEnabled() ? name : nullptr),
+          m_arg(arg),
+          m_begin(m_name ? Now() : 0)
+    { }
+
+    ~Span() noexcept { End(); }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    /// Ends the span early.
+    void End() noexcept
+    {
+        if (m_name) {
+            Record(m_name, m_begin, Now(), m_arg);
+            m_name = nullptr;
+        }
+    }
+
+private:
+    const char* m_name;
+    std::int64_t m_arg;
+    Time m_begin;
+};
+
+
+/**
+\brief  Writes all spans recorded so far to `out`, as a JSON object in Chrome's
+        trace event format.
+*/
+void WriteChromeTrace(std::ostream& out);
+
+
+}} // namespace
+#endif // header guard
@@ -10,11 +10,13 @@
 #ifndef CORAL_UTIL_CONSOLE_HPP
 #define CORAL_UTIL_CONSOLE_HPP
 
+#include <memory>
 #include <ostream>
 #include <string>
 #include <vector>
 #include <boost/optional.hpp>
 #include <boost/program_options.hpp>
+#include <coral/metrics.hpp>
 
 namespace coral
 {
@@ -96,12 +98,58 @@ void AddLoggingOptions(boost::program_options::options_description& options);
 
 This will at least call `coral::log::AddSink()` once, to add logging to the
 standard error stream, and it may also call it an additional time to add
-logging to a file.
+logging to a file.  Per-category levels are set with
+`coral::log::SetCategoryLevel()`.
 */
 void UseLoggingArguments(
     const boost::program_options::variables_map& arguments,
     const std::string& logFilePrefix);
 
 
+/**
+\brief  Enables timeline tracing (see coral::timeline) if the `CORAL_TRACE_DIR`
+        environment variable is set.
+
+The trace is written to a file in the directory specified by `CORAL_TRACE_DIR`,
+named after `traceFilePrefix`, the process ID and the current time.  Since the
+environment is inherited by child processes, setting the variable for a slave
+provider enables tracing in all slaves it starts.
+*/
+void UseTracingEnvironment(const std::string& traceFilePrefix);
+
+
+/// Adds options that control the export of metrics (see coral::metrics).
+void AddMetricsOptions(boost::program_options::options_description& options);
+
+
+/**
+rief  Parses arguments that control metrics export (added with
+        `AddMetricsOptions()`) and starts exporting if requested.
+
+eturns
+    The object which performs the export, which should be kept alive for as
+    long as metrics should be exported, or null if export was not requested.
+*/
+std::unique_ptr<coral::metrics::Exporter> UseMetricsArguments(
+    const boost::program_options::variables_map& arguments);
+
+
+/**
+rief  Starts exporting metrics to a file if the `CORAL_METRICS_DIR`
+        environment variable is set.
+
+The file is written to the directory specified by `CORAL_METRICS_DIR`, and is
+named after `metricsFilePrefix` and the process ID.  Like
+`UseTracingEnvironment()`, this is mainly intended for slaves, which are
+started by a slave provider and therefore can't be given extra arguments.
+
+eturns
+    The object which performs the export, or null if the environment
+    variable is not set.
+*/
+std::unique_ptr<coral::metrics::Exporter> UseMetricsEnvironment(
+    const std::string& metricsFilePrefix);
+
+
 }} // namespace
 #endif // header guard
@@ -0,0 +1,69 @@
+/**
+\file
+\brief  Bucketing functions for logarithmically spaced histograms.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_UTIL_HISTOGRAM_HPP
+#define CORAL_UTIL_HISTOGRAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace coral
+{
+namespace util
+{
+
+
+/**
+\brief  The number of buckets needed to hold all non-negative 64-bit values
+        in a histogram bucketed with LogBucketIndex().
+*/
+const int logBucketCount = 256;
+
+
+/**
+\brief  Returns the index of the bucket which a value falls in.
+
+Values below 4 get a bucket each.  Above that, each interval [2^e, 2^(e+1))
+is split into four equally wide buckets, in the manner of HDR histograms.
+Quantiles computed from such a histogram are thus accurate to within about
+20%.
+
+\pre `value >= 0`
+*/
+int LogBucketIndex(std::int64_t value) noexcept;
+
+
+/// Returns the largest value which falls in the bucket with the given index.
+std::int64_t LogBucketMax(int index) noexcept;
+
+
+/**
+\brief  Returns an approximation of the given quantile of the values in a
+        histogram bucketed with LogBucketIndex().
+
+This is the upper bound of the first bucket at which the cumulative count
+reaches the rank of the quantile.
+
+\param [in] buckets     The bucket counts.
+\param [in] bucketCount The number of buckets.
+\param [in] count       The sum of the bucket counts.
+\param [in] q           A number in the range [0, 1].
+
+\returns The quantile, or zero if `count` is zero.
+*/
+std::int64_t LogBucketQuantile(
+    const std::uint64_t* buckets,
+    std::size_t bucketCount,
+    std::uint64_t count,
+    double q) noexcept;
+
+
+}} // namespace
+#endif // header guard
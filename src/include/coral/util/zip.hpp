@@ -14,6 +14,7 @@
 #include <cstdint>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/optional.hpp>
@@ -178,12 +179,41 @@ public:
     */
     bool IsDirEntry(EntryIndex index) const;
 
+    /**
+    \brief  Returns the uncompressed size of an archive entry.
+
+    \param [in] index
+        An archive entry index in the range `[0,EntryCount())`.
+    \throws coral::util::zip::Exception
+        If there was an error accessing the archive.
+    \pre
+        `IsOpen() == true`
+    */
+    std::uint64_t EntrySize(EntryIndex index) const;
+
+    /**
+    \brief  Returns the CRC-32 checksum of the contents of an archive entry.
+
+    This is read from the archive's central directory, so it is cheap to
+    obtain, even for large files.
+
+    \param [in] index
+        An archive entry index in the range `[0,EntryCount())`.
+    \throws coral::util::zip::Exception
+        If there was an error accessing the archive.
+    \pre
+        `IsOpen() == true`
+    */
+    std::uint32_t EntryCRC(EntryIndex index) const;
+
     /**
     \brief  Extracts the entire contents of the archive.
 
     This will extract all entries in the archive to the given target directory,
     recreating the subdirectory structure in the archive.
 
+    This is equivalent to `ExtractAll(targetDir, 1)`.
+
     \param [in] targetDir
         The directory to which the files should be extracted.
     \throws coral::util::zip::Exception
@@ -196,6 +226,65 @@ public:
     void ExtractAll(
         const boost::filesystem::path& targetDir) const;
 
+    /**
+    \brief  Extracts the entire contents of the archive, using several threads.
+
+    This is like `ExtractAll(const boost::filesystem::path&)`, except that the
+    files are distributed among `threadCount` threads, largest first.  Since a
+    libzip handle may not be shared between threads, each additional thread
+    opens the archive file anew, so this only works for archives which were
+    opened with Open() (or the corresponding constructor) and whose file
+    still exists.
+
+    If an error occurs, the remaining files are skipped, and the first
+    exception is rethrown once all threads have finished.
+
+    \param [in] targetDir
+        The directory to which the files should be extracted.
+    \param [in] threadCount
+        The maximum number of threads to use, including the calling thread.
+        If zero, a number is chosen based on the number of processors and
+        the total size of the files, so that small archives are extracted
+        by the calling thread only.
+    \throws coral::util::zip::Exception
+        If there was an error accessing the archive.
+    \throws std::ios_base::failure
+        On I/O error.
+    \pre
+        `IsOpen() == true`
+    */
+    void ExtractAll(
+        const boost::filesystem::path& targetDir,
+        unsigned threadCount) const;
+
+    /**
+    \brief  Extracts the files whose names begin with certain prefixes.
+
+    This is like `ExtractAll(const boost::filesystem::path&, unsigned)`,
+    except that only the file entries whose full names begin with one of
+    the strings in `prefixes` are extracted.  To extract a directory and
+    everything in it, use its name followed by a forward slash (/), e.g.
+    `"images/"`.
+
+    \param [in] prefixes
+        Entry name prefixes.  The matching is case sensitive.
+    \param [in] targetDir
+        The directory to which the files should be extracted.
+    \param [in] threadCount
+        The maximum number of threads to use, with zero meaning that the
+        number is chosen automatically.
+    \throws coral::util::zip::Exception
+        If there was an error accessing the archive.
+    \throws std::ios_base::failure
+        On I/O error.
+    \pre
+        `IsOpen() == true`
+    */
+    void ExtractMatching(
+        const std::vector<std::string>& prefixes,
+        const boost::filesystem::path& targetDir,
+        unsigned threadCount) const;
+
     /**
     \brief  Extracts a single file from the archive, placing it in a specific
             target directory.
@@ -224,6 +313,7 @@ public:
 
 private:
     ::zip* m_archive;
+    boost::filesystem::path m_path;
 };
 
 
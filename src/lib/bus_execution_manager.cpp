@@ -7,6 +7,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/bus/execution_manager.hpp>
 
 #include <coral/bus/execution_manager_private.hpp>
+#include <coral/error.hpp>
 
 
 namespace coral
@@ -89,4 +90,13 @@ void ExecutionManager::Terminate()
 }
 
 
+coral::master::SlaveStepTimings ExecutionManager::LastStepTimings(
+    coral::model::SlaveID slave) const
+{
+    const auto it = m_private->slaves.find(slave);
+    CORAL_INPUT_CHECK(it != m_private->slaves.end());
+    return it->second.slave->LastStepTimings();
+}
+
+
 }} // namespace
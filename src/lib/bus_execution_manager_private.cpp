@@ -29,6 +29,7 @@ ExecutionManagerPrivate::ExecutionManagerPrivate(
         const std::string& executionName,
         const coral::master::ExecutionOptions& options)
     : reactor(reactor_),
+      controlRouter(reactor_),
       slaveSetup(
         options.startTime,
         options.maxTime,
@@ -36,12 +37,29 @@ ExecutionManagerPrivate::ExecutionManagerPrivate(
         options.slaveVariableRecvTimeout),
       lastSlaveID(0),
       slaves(),
+      stepLatency(coral::metrics::GetHistogram(
+        "coral_step_latency_seconds",
+        "Time from a time step is started until all slaves have completed it",
+        coral::metrics::Labels(), 1e-9)),
       m_state(), // created below
       m_operationCount(0),
       m_allSlaveOpsCompleteHandler(),
       m_currentStepID(-1),
-      m_resendVarsNeeded(false)
+      m_resendVarsNeeded(false),
+      m_stepCount(coral::metrics::GetCounter(
+        "coral_steps_total",
+        "Number of time steps completed")),
+      m_simTime(coral::metrics::GetGauge(
+        "coral_simulation_time_seconds",
+        "Current simulation time")),
+      m_realTimeFactor(coral::metrics::GetGauge(
+        "coral_real_time_factor",
+        "Simulation time advanced per unit of wall-clock time, smoothed")),
+      m_lastAdvanceTime(),
+      m_smoothedRealTimeFactor(-1.0)
 {
+    if (options.broadcastStepCommands) controlRouter.EnableBroadcast();
+    slaveSetup.deltaPublication = options.deltaPublication;
     SwapState(std::make_unique<ReadyExecutionState>());
 }
 
@@ -96,7 +114,7 @@ void ExecutionManagerPrivate::Step(
         if (resendTimeout < std::chrono::milliseconds(0)) {
             coral::master::ExecutionOptions defaults;
             resendTimeout = 2*defaults.slaveVariableRecvTimeout;
-            CORAL_LOG_DEBUG(boost::format(
+            CORAL_LOG_CAT_DEBUG(coral::log::bus, boost::format(
                 "Slave-to-slave variable receive timeout is negative "
                 "(aka. infinite), and we cannot use that to detect when "
                 "slaves are all reconnected to each other. Using default "
@@ -187,6 +205,22 @@ void ExecutionManagerPrivate::AdvanceSimTime(coral::model::TimeDuration delta)
 {
     assert(delta >= 0.0);
     slaveSetup.startTime += delta;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (m_lastAdvanceTime != std::chrono::steady_clock::time_point()) {
+        const auto wallTime =
+            std::chrono::duration<double>(now - m_lastAdvanceTime).count();
+        if (wallTime > 0.0) {
+            const auto rtf = delta / wallTime;
+            m_smoothedRealTimeFactor = m_smoothedRealTimeFactor < 0.0
+                ? rtf
+                : 0.9 * m_smoothedRealTimeFactor + 0.1 * rtf;
+            m_realTimeFactor.Set(m_smoothedRealTimeFactor);
+        }
+    }
+    m_lastAdvanceTime = now;
+    m_stepCount.Increment();
+    m_simTime.Set(slaveSetup.startTime);
 }
 
 
@@ -225,7 +259,7 @@ std::unique_ptr<ExecutionState> ExecutionManagerPrivate::SwapState(
     std::unique_ptr<ExecutionState> next)
 {
     AbortSlaveOpWaiting();
-    CORAL_LOG_TRACE(boost::format("ExecutionManager state change: %s -> %s")
+    CORAL_LOG_CAT_TRACE(coral::log::bus, boost::format("ExecutionManager state change: %s -> %s")
         % (m_state ? typeid(*m_state).name() : "none")
         % (next    ? typeid(*next).name()    : "none"));
     std::swap(m_state, next);
@@ -254,6 +288,11 @@ ExecutionManagerPrivate::Slave::Slave(
     : slave(std::move(slave_))
     , locator(std::move(locator_))
     , description(description_)
+    , stepLatency(&coral::metrics::GetHistogram(
+        "coral_slave_step_latency_seconds",
+        "Time from a STEP command is sent to a slave until it has replied",
+        coral::metrics::Labels{{"slave", description_.Name()}},
+        1e-9))
 { }
 
 
@@ -14,13 +14,24 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <coral/bus/execution_manager_private.hpp>
 #include <coral/bus/slave_control_messenger.hpp>
 #include <coral/bus/slave_controller.hpp>
 #include <coral/log.hpp>
+#include <coral/protocol/execution.hpp>
+#include <coral/timeline.hpp>
 #include <coral/util.hpp>
 
+#ifdef _MSC_VER
+#   pragma warning(push, 0)
+#endif
+#include <execution.pb.h>
+#ifdef _MSC_VER
+#   pragma warning(pop)
+#endif
+
 
 namespace coral
 {
@@ -93,6 +104,51 @@ namespace
         throw std::runtime_error(sst.str());
     }
 
+    // Returns the description of `output`, which is to be connected to the
+    // variable described by `varDesc`, which belongs to the slave `slaveDesc`.
+    const coral::model::VariableDescription& OutputDescription(
+        const ExecutionManagerPrivate& self,
+        const coral::model::SlaveDescription& slaveDesc,
+        const coral::model::VariableDescription& varDesc,
+        const coral::model::Variable& output)
+    {
+        const auto oit = self.slaves.find(output.Slave());
+        if (oit == self.slaves.end()) {
+            throw std::runtime_error(
+                "Failed to connect " + slaveDesc.Name() + '.' + varDesc.Name()
+                + " due to an invalid slave ID");
+        }
+        try {
+            return oit->second.description.TypeDescription().Variable(output.ID());
+        } catch (const std::out_of_range&) {
+            throw std::runtime_error(
+                "Failed to connect " + slaveDesc.Name() + '.' + varDesc.Name()
+                + " due to an invalid variable ID");
+        }
+    }
+
+    // Verifies that `output` exists and can be connected to the variable
+    // described by `varDesc`, which belongs to the slave `slaveDesc`.
+    void VerifyConnection(
+        const ExecutionManagerPrivate& self,
+        const coral::model::SlaveDescription& slaveDesc,
+        const coral::model::VariableDescription& varDesc,
+        const coral::model::Variable& output)
+    {
+        const auto& otherVarDesc = OutputDescription(self, slaveDesc, varDesc, output);
+        VerifyDataTypeMatch(
+            varDesc.DataType(),
+            otherVarDesc.DataType(),
+            slaveDesc.Name(),
+            varDesc.Name(),
+            "connect");
+        VerifyCausalityMatch(
+            varDesc.Causality(),
+            otherVarDesc.Causality(),
+            slaveDesc.Name(),
+            varDesc.Name());
+    }
+
     void VerifyVariableSetting(
         const ExecutionManagerPrivate& self,
         coral::model::SlaveID slaveID,
@@ -113,34 +169,50 @@ namespace
                 varDesc.Name(),
                 "set value of");
         }
-        if (setting.IsConnectionChange() && !setting.ConnectedOutput().Empty()) {
-            const auto oit = self.slaves.find(setting.ConnectedOutput().Slave());
-            if (oit == self.slaves.end()) {
+        if (!setting.IsConnectionChange()) return;
+        if (setting.Aggregation() == coral::model::NO_AGGREGATION) {
+            if (!setting.ConnectedOutput().Empty()) {
+                VerifyConnection(self, slaveDesc, varDesc, setting.ConnectedOutput());
+            }
+        } else {
+            if (!sit->second.slave->SupportsAggregation()) {
                 throw std::runtime_error(
                     "Failed to connect " + slaveDesc.Name() + '.' + varDesc.Name()
-                    + " due to an invalid slave ID");
+                    + " to an aggregate because the slave does not support"
+                    " aggregation (it may be from an earlier version of Coral)");
             }
-            const auto& otherDesc = oit->second.description;
-            const auto& otherType = otherDesc.TypeDescription();
-            const coral::model::VariableDescription* otherVarDesc = nullptr;
-            try {
-                otherVarDesc = &otherType.Variable(setting.ConnectedOutput().ID());
-            } catch (const std::out_of_range&) {
+            if (varDesc.DataType() != coral::model::REAL_DATATYPE) {
                 throw std::runtime_error(
                     "Failed to connect " + slaveDesc.Name() + '.' + varDesc.Name()
-                    + " due to an invalid variable ID");
+                    + " because only real variables can be connected to an aggregate");
+            }
+            for (const auto& output : setting.AggregatedOutputs()) {
+                const auto& outputDesc =
+                    OutputDescription(self, slaveDesc, varDesc, output);
+                if (outputDesc.DataType() != coral::model::REAL_DATATYPE) {
+                    throw std::runtime_error(
+                        "Failed to connect " + slaveDesc.Name() + '.' + varDesc.Name()
+                        + " to an aggregate which includes "
+                        + self.slaves.at(output.Slave()).description.Name()
+                        + '.' + outputDesc.Name()
+                        + ", because only real variables can be aggregated");
+                }
+                VerifyConnection(self, slaveDesc, varDesc, output);
+            }
+        }
+        if (!setting.Transform().IsIdentity()) {
+            if (!sit->second.slave->SupportsTransforms()) {
+                throw std::runtime_error(
+                    "Failed to connect " + slaveDesc.Name() + '.' + varDesc.Name()
+                    + " with a linear transformation because the slave does not"
+                    " support transformations (it may be from an earlier version"
+                    " of Coral)");
+            }
+            if (varDesc.DataType() != coral::model::REAL_DATATYPE) {
+                throw std::runtime_error(
+                    "Failed to connect " + slaveDesc.Name() + '.' + varDesc.Name()
+                    + " because only real variables can have a linear transformation");
             }
-            VerifyDataTypeMatch(
-                varDesc.DataType(),
-                otherVarDesc->DataType(),
-                slaveDesc.Name(),
-                varDesc.Name(),
-                "connect");
-            VerifyCausalityMatch(
-                varDesc.Causality(),
-                otherVarDesc->Causality(),
-                slaveDesc.Name(),
-                varDesc.Name());
         }
     }
 
@@ -298,10 +370,23 @@ namespace
         // This is the handler for the connection operation. Note that we pass
         // onDescriptionReceived into it and use it if the connection succeeds.
         SlaveController::ConnectHandler onConnected =
-            [&self, commTimeout, onComplete, id, onDescriptionReceived]
+            [&self, commTimeout, onComplete, id, realName, onDescriptionReceived]
             (const std::error_code& ec)
         {
-            if (!ec) {
+            if (!ec && self.slaveSetup.deltaPublication
+                    && !self.slaves.at(id).slave->SupportsDeltaPublication()) {
+                // The slave would wait forever for the values which the
+                // other slaves leave out because they haven't changed.
+                coral::log::Log(coral::log::error, boost::format(
+                    "Slave '%s' does not support delta publication, which is "
+                    "enabled for this execution (it may be from an earlier "
+                    "version of Coral)")
+                    % realName);
+                self.slaves.at(id).slave->Terminate();
+                onComplete(
+                    std::make_error_code(std::errc::not_supported),
+                    coral::model::INVALID_SLAVE_ID);
+            } else if (!ec) {
                 self.slaves.at(id).slave->GetDescription(
                     commTimeout,
                     std::move(onDescriptionReceived));
@@ -313,7 +398,7 @@ namespace
 
         // Initiate the connection and add the slave to the slave list
         auto slaveController = std::make_unique<coral::bus::SlaveController>(
-            self.reactor,
+            self.controlRouter,
             slave.locator,
             id,
             realName,
@@ -583,16 +668,19 @@ void PrimingExecutionState::Try(ExecutionManagerPrivate& self, int attemptsLeft)
 
                 if (opTally->ongoing == 0) {
                     if (opTally->otherFailures > 0) {
-                        CORAL_LOG_TRACE("RESEND_VARS failed");
+                        CORAL_LOG_CAT_TRACE(coral::log::bus, "RESEND_VARS failed");
                         Fail(self, make_error_code(coral::error::generic_error::operation_failed));
                     } else if (opTally->timeouts > 0 && attemptsLeft == 1) {
-                        CORAL_LOG_TRACE("RESEND_VARS operation timed out, no attempts left");
+                        CORAL_LOG_CAT_TRACE(coral::log::bus,
+                            "RESEND_VARS operation timed out, no attempts left");
                         Fail(self, make_error_code(coral::error::sim_error::data_timeout));
                     } else if (opTally->timeouts > 0) {
-                        CORAL_LOG_TRACE("RESEND_VARS operation timed out, retrying");
+                        CORAL_LOG_CAT_TRACE(coral::log::bus,
+                            "RESEND_VARS operation timed out, retrying");
                         Try(self, attemptsLeft - 1);
                     } else {
-                        CORAL_LOG_TRACE("All RESEND_VARS operations succeeded");
+                        CORAL_LOG_CAT_TRACE(coral::log::bus,
+                            "All RESEND_VARS operations succeeded");
                         Succeed(self);
                     }
                 }
@@ -638,23 +726,42 @@ SteppingExecutionState::SteppingExecutionState(
 void SteppingExecutionState::StateEntered(ExecutionManagerPrivate& self)
 {
     const auto stepID = self.NextStepID();
+    const auto stepStartTime = coral::timeline::Now();
+    if (self.controlRouter.HasBroadcastReceivers()) {
+        coralproto::execution::StepData data;
+        data.set_step_id(stepID);
+        data.set_timepoint(self.CurrentSimTime());
+        data.set_stepsize(m_stepSize);
+        std::vector<zmq::message_t> msg;
+        coral::protocol::execution::CreateMessage(
+            msg, coralproto::execution::MSG_STEP, data);
+        self.controlRouter.Broadcast(msg);
+    }
     for (auto it = begin(self.slaves); it != end(self.slaves); ++it) {
         const auto slaveID = it->first;
+        const auto slaveStepLatency = it->second.stepLatency;
         it->second.slave->Step(
             stepID,
             self.CurrentSimTime(),
             m_stepSize,
             m_timeout,
-            [&self, slaveID, this] (const std::error_code& ec) {
+            [&self, slaveID, slaveStepLatency, stepStartTime, this]
+            (const std::error_code& ec) {
                 const auto onExit = coral::util::OnScopeExit([&self]() {
                     self.SlaveOpComplete();
                 });
+                slaveStepLatency->Record(coral::timeline::Now() - stepStartTime);
                 if (m_onSlaveStepComplete) m_onSlaveStepComplete(ec, slaveID);
             });
         self.SlaveOpStarted();
     }
-    self.WhenAllSlaveOpsComplete([&self, this] (const std::error_code& ec) {
+    self.WhenAllSlaveOpsComplete(
+        [&self, stepID, stepStartTime, this] (const std::error_code& ec)
+    {
         assert(!ec);
+        const auto stepEndTime = coral::timeline::Now();
+        coral::timeline::Record("Step", stepStartTime, stepEndTime, stepID);
+        self.stepLatency.Record(stepEndTime - stepStartTime);
         bool stepFailed = false;
         bool fatalError = false;
         for (auto it = begin(self.slaves); it != end(self.slaves); ++it) {
@@ -731,6 +838,13 @@ AcceptingExecutionState::AcceptingExecutionState(
 
 void AcceptingExecutionState::StateEntered(ExecutionManagerPrivate& self)
 {
+    const auto acceptStartTime = coral::timeline::Now();
+    if (self.controlRouter.HasBroadcastReceivers()) {
+        std::vector<zmq::message_t> msg;
+        coral::protocol::execution::CreateMessage(
+            msg, coralproto::execution::MSG_ACCEPT_STEP);
+        self.controlRouter.Broadcast(msg);
+    }
     for (auto it = begin(self.slaves); it != end(self.slaves); ++it) {
         const auto slaveID = it->first;
         it->second.slave->AcceptStep(
@@ -745,8 +859,12 @@ void AcceptingExecutionState::StateEntered(ExecutionManagerPrivate& self)
             });
         self.SlaveOpStarted();
     }
-    self.WhenAllSlaveOpsComplete([&self, this] (const std::error_code& ec) {
+    self.WhenAllSlaveOpsComplete(
+        [&self, acceptStartTime, this] (const std::error_code& ec)
+    {
         assert(!ec);
+        coral::timeline::Record(
+            "AcceptStep", acceptStartTime, coral::timeline::Now());
         bool error = false;
         for (auto it = begin(self.slaves); it != end(self.slaves); ++it) {
             if (it->second.slave->State() != SLAVE_READY) {
@@ -7,6 +7,8 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/bus/slave_agent.hpp>
 
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <limits>
 #include <utility>
 
@@ -17,15 +19,22 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/protocol/execution.hpp>
 #include <coral/protocol/glue.hpp>
 #include <coral/slave/exception.hpp>
+#include <coral/timeline.hpp>
 #include <coral/util.hpp>
 
 
 namespace
 {
+    std::uint64_t NanosecondsSince(std::chrono::steady_clock::time_point t)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t).count();
+    }
+
     uint16_t NormalMessageType(const std::vector<zmq::message_t>& msg)
     {
         const auto mt = coral::protocol::execution::NonErrorMessageType(msg);
-        CORAL_LOG_TRACE(boost::format("Received %s")
+        CORAL_LOG_CAT_TRACE(coral::log::bus, boost::format("Received %s")
             % coralproto::execution::MessageType_Name(
                 static_cast<coralproto::execution::MessageType>(mt)));
         if (mt == coralproto::execution::MSG_TERMINATE) throw coral::bus::Shutdown();
@@ -37,6 +46,17 @@ namespace
         throw coral::error::ProtocolViolationException("Invalid reply from master");
     }
 
+    // Returns the name of a request's message type, for use as a timeline
+    // span name, or null if the message is malformed.
+    const char* RequestName(const std::vector<zmq::message_t>& msg)
+    {
+        if (msg.empty() || msg.front().size() < 2) return nullptr;
+        const auto mt = static_cast<coralproto::execution::MessageType>(
+            coral::protocol::execution::ParseMessageType(msg.front()));
+        if (!coralproto::execution::MessageType_IsValid(mt)) return nullptr;
+        return coralproto::execution::MessageType_Name(mt).c_str();
+    }
+
     void EnforceMessageType(
         const std::vector<zmq::message_t>& msg,
         coralproto::execution::MessageType expectedType)
@@ -65,43 +85,60 @@ SlaveAgent::SlaveAgent(
       m_masterInactivityTimeout(reactor, masterInactivityTimeout),
       m_variableRecvTimeout(std::chrono::seconds(1)),
       m_id(coral::model::INVALID_SLAVE_ID),
-      m_currentStepID(coral::model::INVALID_STEP_ID)
+      m_currentStepID(coral::model::INVALID_STEP_ID),
+      m_deltaPublication(false),
+      m_reactor(reactor),
+      m_broadcastActive(false)
 {
     m_control.Bind(controlEndpoint);
-    CORAL_LOG_TRACE("Slave bound to control endpoint: " + BoundControlEndpoint().URL());
+    CORAL_LOG_CAT_TRACE(coral::log::bus,
+        "Slave bound to control endpoint: " + BoundControlEndpoint().URL());
 
     m_publisher.Bind(dataPubEndpoint);
-    CORAL_LOG_TRACE("Slave bound to data publisher endpoint: " + BoundDataPubEndpoint().URL());
+    CORAL_LOG_CAT_TRACE(coral::log::bus,
+        "Slave bound to data publisher endpoint: " + BoundDataPubEndpoint().URL());
+
+    std::vector<coral::model::VariableID> realOutputs;
+    std::vector<coral::model::VariableID> integerOutputs;
+    std::vector<coral::model::VariableID> booleanOutputs;
+    std::vector<coral::model::VariableID> stringOutputs;
+    const auto typeDescription = m_slaveInstance.TypeDescription();
+    for (const auto& varInfo : typeDescription.Variables()) {
+        if (varInfo.Causality() != coral::model::OUTPUT_CAUSALITY) continue;
+        switch (varInfo.DataType()) {
+            case coral::model::REAL_DATATYPE:
+                realOutputs.push_back(varInfo.ID());
+                break;
+            case coral::model::INTEGER_DATATYPE:
+                integerOutputs.push_back(varInfo.ID());
+                break;
+            case coral::model::BOOLEAN_DATATYPE:
+                booleanOutputs.push_back(varInfo.ID());
+                break;
+            case coral::model::STRING_DATATYPE:
+                stringOutputs.push_back(varInfo.ID());
+                break;
+            default:
+                assert (!"Variable has unknown data type");
+        }
+    }
+    m_realOutputs = m_slaveInstance.PrepareVariables(
+        coral::model::REAL_DATATYPE, realOutputs.data(), realOutputs.size());
+    m_integerOutputs = m_slaveInstance.PrepareVariables(
+        coral::model::INTEGER_DATATYPE, integerOutputs.data(), integerOutputs.size());
+    m_booleanOutputs = m_slaveInstance.PrepareVariables(
+        coral::model::BOOLEAN_DATATYPE, booleanOutputs.data(), booleanOutputs.size());
+    m_stringOutputs = m_slaveInstance.PrepareVariables(
+        coral::model::STRING_DATATYPE, stringOutputs.data(), stringOutputs.size());
+    m_outputValues.Resize(coral::model::REAL_DATATYPE, realOutputs.size());
+    m_outputValues.Resize(coral::model::INTEGER_DATATYPE, integerOutputs.size());
+    m_outputValues.Resize(coral::model::BOOLEAN_DATATYPE, booleanOutputs.size());
+    m_outputValues.Resize(coral::model::STRING_DATATYPE, stringOutputs.size());
 
     reactor.AddSocket(
         m_control.Socket(),
         [this](coral::net::Reactor& r, zmq::socket_t& s) {
-            assert(&s == &m_control.Socket());
-            m_masterInactivityTimeout.Reset();
-            std::vector<zmq::message_t> msg;
-            try {
-                m_control.Receive(msg);
-                RequestReply(msg);
-            } catch (const coral::bus::Shutdown&) {
-                r.Stop();
-                return;
-            } catch (const zmq::error_t&) {
-                throw; // Not much we can do about this...
-            } catch (const std::runtime_error& e) {
-                coral::protocol::execution::CreateFatalErrorMessage(
-                    msg,
-                    coralproto::execution::ErrorInfo::UNSPECIFIED_ERROR,
-                    e.what());
-                m_control.Send(msg);
-                throw;
-            }
-#ifdef CORAL_LOG_TRACE_ENABLED
-            const auto replyType = static_cast<coralproto::execution::MessageType>(
-                coral::protocol::execution::ParseMessageType(msg.front()));
-#endif
-            m_control.Send(msg);
-            CORAL_LOG_TRACE(boost::format("Sent %s")
-                % coralproto::execution::MessageType_Name(replyType));
+            HandleCommand(r, s);
         });
 }
 
@@ -124,29 +161,145 @@ void SlaveAgent::RequestReply(std::vector<zmq::message_t>& msg)
 }
 
 
+void SlaveAgent::HandleCommand(coral::net::Reactor& reactor, zmq::socket_t& socket)
+{
+    const bool broadcast = m_broadcast && &socket == m_broadcast.get();
+    assert(broadcast || &socket == &m_control.Socket());
+    std::vector<zmq::message_t> msg;
+    if (broadcast && !ReceiveBroadcast(msg)) return;
+
+    // Broadcast commands are acknowledged to the master which sent the last
+    // command on the control socket, i.e., the one that set us up.
+    const auto sendReply = [this, broadcast] (std::vector<zmq::message_t>& m) {
+        if (broadcast) m_control.SendToLastClient(m);
+        else m_control.Send(m);
+    };
+    m_masterInactivityTimeout.Reset();
+    try {
+        if (!broadcast) m_control.Receive(msg);
+        coral::timeline::Span requestSpan(
+            coral::timeline::IsEnabled() ? RequestName(msg) : nullptr);
+        RequestReply(msg);
+    } catch (const coral::bus::Shutdown&) {
+        reactor.Stop();
+        return;
+    } catch (const zmq::error_t&) {
+        throw; // Not much we can do about this...
+    } catch (const std::runtime_error& e) {
+        coral::protocol::execution::CreateFatalErrorMessage(
+            msg,
+            coralproto::execution::ErrorInfo::UNSPECIFIED_ERROR,
+            e.what());
+        sendReply(msg);
+        throw;
+    }
+#ifdef CORAL_LOG_TRACE_ENABLED
+    const auto replyType = static_cast<coralproto::execution::MessageType>(
+        coral::protocol::execution::ParseMessageType(msg.front()));
+#endif
+    sendReply(msg);
+    CORAL_LOG_CAT_TRACE(coral::log::bus, boost::format("Sent %s")
+        % coralproto::execution::MessageType_Name(replyType));
+}
+
+
+bool SlaveAgent::ReceiveBroadcast(std::vector<zmq::message_t>& msg)
+{
+    coral::net::zmqx::Receive(*m_broadcast, msg);
+    if (msg.size() == 1) {
+        // The master publishes our topic once, immediately before the first
+        // command we should act on.  Anything before that may be a command
+        // which we have already received on the control socket, or one that
+        // we have only received part of.
+        if (coral::net::zmqx::ToString(msg.front()) == m_broadcastTopic) {
+            CORAL_LOG_CAT_TRACE(coral::log::bus, "Broadcast channel activated");
+            m_broadcastActive = true;
+        }
+        return false;
+    }
+    if (!m_broadcastActive) return false;
+    msg.erase(msg.begin());
+    if (msg.front().size() < 2) InvalidReplyFromMaster();
+    const auto mt = coral::protocol::execution::ParseMessageType(msg.front());
+    if (mt != coralproto::execution::MSG_STEP
+            && mt != coralproto::execution::MSG_ACCEPT_STEP) {
+        throw coral::error::ProtocolViolationException(
+            "Invalid command on broadcast channel");
+    }
+    return true;
+}
+
+
+std::string SlaveAgent::BindBroadcastSocket(const std::string& topic)
+{
+    assert(!m_broadcast);
+    auto socket = std::make_unique<zmq::socket_t>(
+        coral::net::zmqx::GlobalContext(), ZMQ_SUB);
+    // For TCP, we use an ephemeral port on the same interface as the control
+    // socket.  Other transports only have names, so we derive one.
+    const auto control = BoundControlEndpoint();
+    std::string url;
+    if (control.Transport() == "tcp") {
+        auto ep = coral::net::ip::Endpoint{control.Address()};
+        ep.SetPort_(coral::net::ip::Port{"*"});
+        url = ep.ToEndpoint("tcp").URL();
+    } else {
+        url = control.URL() + ".broadcast";
+    }
+    socket->bind(url.c_str());
+    const auto& commandTopic = coral::protocol::execution::BROADCAST_COMMAND_TOPIC;
+    socket->setsockopt(ZMQ_SUBSCRIBE, commandTopic, std::strlen(commandTopic));
+    socket->setsockopt(ZMQ_SUBSCRIBE, topic.data(), topic.size());
+
+    m_broadcast = std::move(socket);
+    m_broadcastTopic = topic;
+    m_reactor.AddSocket(
+        *m_broadcast,
+        [this](coral::net::Reactor& r, zmq::socket_t& s) {
+            HandleCommand(r, s);
+        });
+    const auto endpoint = coral::net::zmqx::LastEndpoint(*m_broadcast);
+    CORAL_LOG_CAT_TRACE(coral::log::bus,
+        "Slave bound to broadcast endpoint: " + endpoint);
+    return endpoint;
+}
+
+
 void SlaveAgent::NotConnectedHandler(std::vector<zmq::message_t>& msg)
 {
-    CORAL_LOG_TRACE("NOT CONNECTED state: incoming message");
+    CORAL_LOG_CAT_TRACE(coral::log::bus, "NOT CONNECTED state: incoming message");
     if (coral::protocol::execution::ParseHelloMessage(msg) != 0) {
         throw std::runtime_error("Master required unsupported protocol");
     }
-    CORAL_LOG_TRACE("Received HELLO");
-    coral::protocol::execution::CreateHelloMessage(msg, 0);
+    CORAL_LOG_CAT_TRACE(coral::log::bus, "Received HELLO");
+    if (msg.size() > 1) {
+        // The master wants our trace clock, so it can align our timeline
+        // with its own.  We also tell it which optional connection
+        // features we support.
+        coralproto::execution::HelloData helloData;
+        helloData.set_trace_clock_ns(coral::timeline::Now());
+        helloData.set_supports_aggregation(true);
+        helloData.set_supports_transforms(true);
+        helloData.set_supports_delta_publication(true);
+        coral::protocol::execution::CreateHelloMessage(msg, 0, helloData);
+    } else {
+        coral::protocol::execution::CreateHelloMessage(msg, 0);
+    }
     m_stateHandler = &SlaveAgent::ConnectedHandler;
 }
 
 
 void SlaveAgent::ConnectedHandler(std::vector<zmq::message_t>& msg)
 {
-    CORAL_LOG_TRACE("CONNECTED state: incoming message");
+    CORAL_LOG_CAT_TRACE(coral::log::bus, "CONNECTED state: incoming message");
     EnforceMessageType(msg, coralproto::execution::MSG_SETUP);
     if (msg.size() != 2) InvalidReplyFromMaster();
 
     coralproto::execution::SetupData data;
     coral::protobuf::ParseFromFrame(msg[1], data);
-    CORAL_LOG_DEBUG(boost::format("Slave name (ID): %s (%d)")
+    CORAL_LOG_CAT_DEBUG(coral::log::bus, boost::format("Slave name (ID): %s (%d)")
         % data.slave_name() % data.slave_id());
-    CORAL_LOG_DEBUG(boost::format("Simulation time frame: %g to %g")
+    CORAL_LOG_CAT_DEBUG(coral::log::bus, boost::format("Simulation time frame: %g to %g")
         % data.start_time()
         % (data.has_stop_time() ? data.stop_time() : std::numeric_limits<double>::infinity()));
     m_id = data.slave_id();
@@ -162,15 +315,28 @@ void SlaveAgent::ConnectedHandler(std::vector<zmq::message_t>& msg)
         m_variableRecvTimeout =
             std::chrono::milliseconds(data.variable_recv_timeout_ms());
     }
+    if (data.has_trace_clock_offset_ns()) {
+        coral::timeline::SetClockOffset(data.trace_clock_offset_ns());
+    }
+    coral::timeline::SetProcessName(data.slave_name());
+    m_deltaPublication = data.delta_publication();
 
-    coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_READY);
+    if (data.has_broadcast_topic() && !data.broadcast_topic().empty()) {
+        coralproto::execution::SetupReplyData replyData;
+        replyData.set_broadcast_endpoint(
+            BindBroadcastSocket(data.broadcast_topic()));
+        coral::protocol::execution::CreateMessage(
+            msg, coralproto::execution::MSG_READY, replyData);
+    } else {
+        coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_READY);
+    }
     m_stateHandler = &SlaveAgent::ReadyHandler;
 }
 
 
 void SlaveAgent::ReadyHandler(std::vector<zmq::message_t>& msg)
 {
-    CORAL_LOG_TRACE("READY state: incoming message");
+    CORAL_LOG_CAT_TRACE(coral::log::bus, "READY state: incoming message");
     switch (NormalMessageType(msg)) {
         case coralproto::execution::MSG_STEP: {
             if (msg.size() != 2) {
@@ -180,7 +346,8 @@ void SlaveAgent::ReadyHandler(std::vector<zmq::message_t>& msg)
             coralproto::execution::StepData stepData;
             coral::protobuf::ParseFromFrame(msg[1], stepData);
             if (Step(stepData)) {
-                coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_STEP_OK);
+                coral::protocol::execution::CreateMessage(
+                    msg, coralproto::execution::MSG_STEP_OK, m_stepTimings);
                 m_stateHandler = &SlaveAgent::PublishedHandler;
             } else {
                 coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_STEP_FAILED);
@@ -207,20 +374,24 @@ void SlaveAgent::ReadyHandler(std::vector<zmq::message_t>& msg)
 
 void SlaveAgent::PublishedHandler(std::vector<zmq::message_t>& msg)
 {
-    CORAL_LOG_TRACE("STEP OK state: incoming message");
+    CORAL_LOG_CAT_TRACE(coral::log::bus, "STEP OK state: incoming message");
     EnforceMessageType(msg, coralproto::execution::MSG_ACCEPT_STEP);
     // TODO: Use a different timeout here?
+    const auto updateStart = std::chrono::steady_clock::now();
     if (!m_connections.Update(m_slaveInstance, m_currentStepID, m_variableRecvTimeout)) {
         throw std::runtime_error("Timeout waiting for variable values from other slaves");
     }
-    coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_READY);
+    m_stepTimings.Clear();
+    m_stepTimings.set_data_wait_ns(NanosecondsSince(updateStart));
+    coral::protocol::execution::CreateMessage(
+        msg, coralproto::execution::MSG_READY, m_stepTimings);
     m_stateHandler = &SlaveAgent::ReadyHandler;
 }
 
 
 void SlaveAgent::StepFailedHandler(std::vector<zmq::message_t>& msg)
 {
-    CORAL_LOG_TRACE("STEP FAILED state: incoming message");
+    CORAL_LOG_CAT_TRACE(coral::log::bus, "STEP FAILED state: incoming message");
     EnforceMessageType(msg, coralproto::execution::MSG_TERMINATE);
     // We never get here, because EnforceMessageType() always throws either
     // Shutdown or ProtocolViolationException.
@@ -278,7 +449,7 @@ void SlaveAgent::HandleSetVars(std::vector<zmq::message_t>& msg)
         throw coral::error::ProtocolViolationException(
             "Wrong number of frames in SET_VARS message");
     }
-    CORAL_LOG_DEBUG("Setting/connecting variables");
+    CORAL_LOG_CAT_DEBUG(coral::log::bus, "Setting/connecting variables");
     coralproto::execution::SetVarsData data;
     coral::protobuf::ParseFromFrame(msg[1], data);
 
@@ -291,18 +462,41 @@ void SlaveAgent::HandleSetVars(std::vector<zmq::message_t>& msg)
                     SetVariable(m_slaveInstance, varSetting.variable_id()),
                     val)) {
                 allGood = false;
-                CORAL_LOG_DEBUG(
+                CORAL_LOG_CAT_DEBUG(coral::log::bus,
                     boost::format("Failed to set value of variable with ID %d")
                     % varSetting.variable_id());
             }
         }
-        if (varSetting.has_connected_output()) {
+        const auto transform = coral::model::LinearTransform(
+            varSetting.transform_gain(),
+            varSetting.transform_offset());
+        if (varSetting.has_aggregation()) {
+            const auto dataType = m_slaveInstance.TypeDescription()
+                .Variable(varSetting.variable_id()).DataType();
+            if (dataType != coral::model::REAL_DATATYPE) {
+                coral::protocol::execution::CreateErrorMessage(
+                    msg,
+                    coralproto::execution::ErrorInfo::INVALID_REQUEST,
+                    "Only real variables can be connected to an aggregate");
+                return;
+            }
+            std::vector<coral::model::Variable> outputs;
+            for (const auto& output : varSetting.aggregated_output()) {
+                outputs.push_back(coral::protocol::FromProto(output));
+            }
+            m_connections.Couple(
+                outputs,
+                varSetting.variable_id(),
+                coral::protocol::FromProto(varSetting.aggregation()),
+                transform);
+        } else if (varSetting.has_connected_output()) {
             m_connections.Couple(
                 coral::protocol::FromProto(varSetting.connected_output()),
-                varSetting.variable_id());
+                varSetting.variable_id(),
+                transform);
         }
     }
-    CORAL_LOG_TRACE("Done setting/connecting variables");
+    CORAL_LOG_CAT_TRACE(coral::log::bus, "Done setting/connecting variables");
     if (allGood) {
         coral::protocol::execution::CreateMessage(
             msg,
@@ -322,7 +516,7 @@ void SlaveAgent::HandleSetPeers(std::vector<zmq::message_t>& msg)
         throw coral::error::ProtocolViolationException(
             "Wrong number of frames in SET_PEERS message");
     }
-    CORAL_LOG_DEBUG("Reconnecting to peers");
+    CORAL_LOG_CAT_DEBUG(coral::log::bus, "Reconnecting to peers");
     coralproto::execution::SetPeersData data;
     coral::protobuf::ParseFromFrame(msg[1], data);
     std::vector<coral::net::Endpoint> m_endpoints;
@@ -330,24 +524,26 @@ void SlaveAgent::HandleSetPeers(std::vector<zmq::message_t>& msg)
         m_endpoints.emplace_back(peer);
     }
     m_connections.Connect(m_endpoints.data(), m_endpoints.size());
-    CORAL_LOG_TRACE("Done reconnecting to peers");
+    CORAL_LOG_CAT_TRACE(coral::log::bus, "Done reconnecting to peers");
     coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_READY);
 }
 
 
 void SlaveAgent::HandleResendVars(std::vector<zmq::message_t>& msg)
 {
-    // Publish all own variable values
+    // Publish all own variable values.  Some of the recipients may be new
+    // subscribers, so even unchanged values must be sent.
+    m_publisher.ForgetPublishedValues();
     PublishAll();
 
     // Wait for all values from others
-    CORAL_LOG_TRACE(
+    CORAL_LOG_CAT_TRACE(coral::log::net,
         boost::format("Waiting for variable values (timeout = %d ms)")
         % m_variableRecvTimeout.count());
     if (m_connections.Update(m_slaveInstance, m_currentStepID, m_variableRecvTimeout)) {
         coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_READY);
     } else {
-        CORAL_LOG_TRACE("RESEND_VARS timed out");
+        CORAL_LOG_CAT_TRACE(coral::log::net, "RESEND_VARS timed out");
         coral::protocol::execution::CreateErrorMessage(
             msg,
             coralproto::execution::ErrorInfo::TIMED_OUT,
@@ -357,55 +553,74 @@ void SlaveAgent::HandleResendVars(std::vector<zmq::message_t>& msg)
 }
 
 
-namespace
-{
-    coral::model::ScalarValue GetVariable(
-        const coral::slave::Instance& slave,
-        const coral::model::VariableDescription& variable)
-    {
-        switch (variable.DataType()) {
-            case coral::model::REAL_DATATYPE:
-                return slave.GetRealVariable(variable.ID());
-            case coral::model::INTEGER_DATATYPE:
-                return slave.GetIntegerVariable(variable.ID());
-            case coral::model::BOOLEAN_DATATYPE:
-                return slave.GetBooleanVariable(variable.ID());
-            case coral::model::STRING_DATATYPE:
-                return slave.GetStringVariable(variable.ID());
-            default:
-                assert (!"Variable has unknown data type");
-                return coral::model::ScalarValue();
-        }
-    }
-}
-
-
 bool SlaveAgent::Step(const coralproto::execution::StepData& stepInfo)
 {
     if (m_currentStepID == coral::model::INVALID_STEP_ID) {
         m_slaveInstance.StartSimulation();
     }
     m_currentStepID = stepInfo.step_id();
+    m_stepTimings.Clear();
+
+    coral::timeline::Span doStepSpan("DoStep", m_currentStepID);
+    const auto doStepStart = std::chrono::steady_clock::now();
     if (!m_slaveInstance.DoStep(stepInfo.timepoint(), stepInfo.stepsize())) {
         return false;
     }
+    m_stepTimings.set_do_step_ns(NanosecondsSince(doStepStart));
+    doStepSpan.End();
+
+    const auto publishStart = std::chrono::steady_clock::now();
     PublishAll();
+    m_stepTimings.set_publish_ns(NanosecondsSince(publishStart));
     return true;
 }
 
 
 void SlaveAgent::PublishAll()
 {
-    CORAL_LOG_TRACE("Publishing output variable values");
-    const auto typeDescription = m_slaveInstance.TypeDescription();
-    for (const auto& varInfo : typeDescription.Variables()) {
-        if (varInfo.Causality() != coral::model::OUTPUT_CAUSALITY) continue;
-        m_publisher.Publish(
-            m_currentStepID,
-            m_id,
-            varInfo.ID(),
-            GetVariable(m_slaveInstance, varInfo));
+    CORAL_LOG_CAT_TRACE(coral::log::net, "Publishing output variable values");
+    coral::timeline::Span span("PublishAll", m_currentStepID);
+    m_slaveInstance.GetRealVariables(*m_realOutputs, m_outputValues.Reals());
+    m_slaveInstance.GetIntegerVariables(*m_integerOutputs, m_outputValues.Integers());
+    m_slaveInstance.GetBooleanVariables(*m_booleanOutputs, m_outputValues.Booleans());
+    m_slaveInstance.GetStringVariables(*m_stringOutputs, m_outputValues.Strings());
+
+    if (m_deltaPublication) {
+        m_publisher.PublishChanges(m_currentStepID, m_id,
+            coral::model::REAL_DATATYPE,
+            m_realOutputs->Variables().data(),
+            m_outputValues);
+        m_publisher.PublishChanges(m_currentStepID, m_id,
+            coral::model::INTEGER_DATATYPE,
+            m_integerOutputs->Variables().data(),
+            m_outputValues);
+        m_publisher.PublishChanges(m_currentStepID, m_id,
+            coral::model::BOOLEAN_DATATYPE,
+            m_booleanOutputs->Variables().data(),
+            m_outputValues);
+        m_publisher.PublishChanges(m_currentStepID, m_id,
+            coral::model::STRING_DATATYPE,
+            m_stringOutputs->Variables().data(),
+            m_outputValues);
+        m_publisher.PublishStepComplete(m_currentStepID, m_id);
+        return;
     }
+    m_publisher.Publish(m_currentStepID, m_id,
+        coral::model::REAL_DATATYPE,
+        m_realOutputs->Variables().data(),
+        m_outputValues);
+    m_publisher.Publish(m_currentStepID, m_id,
+        coral::model::INTEGER_DATATYPE,
+        m_integerOutputs->Variables().data(),
+        m_outputValues);
+    m_publisher.Publish(m_currentStepID, m_id,
+        coral::model::BOOLEAN_DATATYPE,
+        m_booleanOutputs->Variables().data(),
+        m_outputValues);
+    m_publisher.Publish(m_currentStepID, m_id,
+        coral::model::STRING_DATATYPE,
+        m_stringOutputs->Variables().data(),
+        m_outputValues);
 }
 
 
@@ -463,6 +678,58 @@ void SlaveAgent::Timeout::SetTimeout(std::chrono::milliseconds timeout)
 // class SlaveAgent::Connections
 // =============================================================================
 
+namespace
+{
+    // Copies `source[indices[i]]` to `target[i]` for all `i`.
+    template<typename T>
+    void Gather(const std::vector<std::size_t>& indices, const T* source, T* target)
+    {
+        const auto n = indices.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            target[i] = source[indices[i]];
+        }
+    }
+
+
+    // Combines groups of values from `source` into `target`, as described
+    // for SlaveAgent::Connections::Aggregates, using the binary function
+    // `combine`.  For means, the sums are scaled afterwards.
+    template<typename Combine>
+    void Aggregate(
+        const std::vector<std::size_t>& targets,
+        const std::vector<std::size_t>& offsets,
+        const std::vector<std::size_t>& sources,
+        const double* source,
+        double* target,
+        Combine combine)
+    {
+        const auto n = targets.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto end = offsets[i+1];
+            auto value = source[sources[offsets[i]]];
+            for (auto j = offsets[i] + 1; j < end; ++j) {
+                value = combine(value, source[sources[j]]);
+            }
+            target[targets[i]] = value;
+        }
+    }
+
+
+    // Sets `values[i] = gains[i]*values[i] + offsets[i]` for all `i`.  This
+    // is a plain loop over contiguous arrays so the compiler can vectorise it.
+    void Transform(
+        std::size_t count,
+        const double* gains,
+        const double* offsets,
+        double* values)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            values[i] = gains[i] * values[i] + offsets[i];
+        }
+    }
+}
+
+
 void SlaveAgent::Connections::Connect(
     const coral::net::Endpoint* endpoints,
     std::size_t endpointsSize)
@@ -473,13 +740,36 @@ void SlaveAgent::Connections::Connect(
 
 void SlaveAgent::Connections::Couple(
     coral::model::Variable remoteOutput,
-    coral::model::VariableID localInput)
+    coral::model::VariableID localInput,
+    const coral::model::LinearTransform& transform)
 {
     Decouple(localInput);
     if (!remoteOutput.Empty()) {
         m_subscriber.Subscribe(remoteOutput);
         m_connections.insert(ConnectionBimap::value_type(remoteOutput, localInput));
+        if (!transform.IsIdentity()) m_transforms[localInput] = transform;
     }
+    m_inputsGrouped = false;
+}
+
+
+void SlaveAgent::Connections::Couple(
+    const std::vector<coral::model::Variable>& remoteOutputs,
+    coral::model::VariableID localInput,
+    coral::model::Aggregation aggregation,
+    const coral::model::LinearTransform& transform)
+{
+    assert(aggregation != coral::model::NO_AGGREGATION);
+    Decouple(localInput);
+    for (const auto& remoteOutput : remoteOutputs) {
+        m_subscriber.Subscribe(remoteOutput);
+        m_connections.insert(ConnectionBimap::value_type(remoteOutput, localInput));
+    }
+    if (!remoteOutputs.empty()) {
+        m_aggregations[localInput] = aggregation;
+        if (!transform.IsIdentity()) m_transforms[localInput] = transform;
+    }
+    m_inputsGrouped = false;
 }
 
 
@@ -488,27 +778,163 @@ bool SlaveAgent::Connections::Update(
     coral::model::StepID stepID,
     std::chrono::milliseconds timeout)
 {
+    coral::timeline::Span waitSpan("WaitForData", stepID);
     if (!m_subscriber.Update(stepID, timeout)) return false;
-    for (const auto& conn : m_connections.left) {
-        boost::apply_visitor(
-            SetVariable(slaveInstance, conn.second),
-            m_subscriber.Value(conn.first));
+    waitSpan.End();
+    if (!m_inputsGrouped || m_slotRevision != m_subscriber.SlotRevision()) {
+        GroupInputs(slaveInstance);
+    }
+
+    const auto& received = m_subscriber.Values();
+    Gather(m_realInputs.sources, received.Reals(), m_inputValues.Reals());
+    Gather(m_integerInputs.sources, received.Integers(), m_inputValues.Integers());
+    Gather(m_booleanInputs.sources, received.Booleans(), m_inputValues.Booleans());
+    Gather(m_stringInputs.sources, received.Strings(), m_inputValues.Strings());
+    const auto plus = [] (double a, double b) { return a + b; };
+    Aggregate(m_sums.targets, m_sums.offsets, m_sums.sources,
+        received.Reals(), m_inputValues.Reals(), plus);
+    Aggregate(m_minima.targets, m_minima.offsets, m_minima.sources,
+        received.Reals(), m_inputValues.Reals(),
+        [] (double a, double b) { return b < a ? b : a; });
+    Aggregate(m_maxima.targets, m_maxima.offsets, m_maxima.sources,
+        received.Reals(), m_inputValues.Reals(),
+        [] (double a, double b) { return a < b ? b : a; });
+    Aggregate(m_means.targets, m_means.offsets, m_means.sources,
+        received.Reals(), m_inputValues.Reals(), plus);
+    for (std::size_t i = 0; i < m_means.targets.size(); ++i) {
+        m_inputValues.Reals()[m_means.targets[i]] /=
+            static_cast<double>(m_means.offsets[i+1] - m_means.offsets[i]);
+    }
+    if (m_transformReals) {
+        Transform(
+            m_realInputs.variables.size(),
+            m_realGains.data(),
+            m_realOffsets.data(),
+            m_inputValues.Reals());
     }
+
+    slaveInstance.SetRealVariables(*m_realInputs.group, m_inputValues.Reals());
+    slaveInstance.SetIntegerVariables(*m_integerInputs.group, m_inputValues.Integers());
+    slaveInstance.SetBooleanVariables(*m_booleanInputs.group, m_inputValues.Booleans());
+    slaveInstance.SetStringVariables(*m_stringInputs.group, m_inputValues.Strings());
     return true;
 }
 
 
 void SlaveAgent::Connections::Decouple(coral::model::VariableID localInput)
 {
-    const auto conn = m_connections.right.find(localInput);
-    if (conn == m_connections.right.end()) return;
-    const auto remoteOutput = conn->second;
-    m_connections.right.erase(conn);
-    if (m_connections.left.count(remoteOutput) == 0) {
-        m_subscriber.Unsubscribe(remoteOutput);
+    const auto conns = m_connections.right.equal_range(localInput);
+    if (conns.first == conns.second) return;
+    std::vector<coral::model::Variable> remoteOutputs;
+    for (auto it = conns.first; it != conns.second; ++it) {
+        remoteOutputs.push_back(it->second);
+    }
+    m_connections.right.erase(conns.first, conns.second);
+    m_transforms.erase(localInput);
+    m_aggregations.erase(localInput);
+    m_inputsGrouped = false;
+    for (const auto& remoteOutput : remoteOutputs) {
+        if (m_connections.left.count(remoteOutput) == 0) {
+            m_subscriber.Unsubscribe(remoteOutput);
+        }
     }
     assert(m_connections.right.count(localInput) == 0);
 }
 
 
+void SlaveAgent::Connections::GroupInputs(
+    const coral::slave::Instance& slaveInstance)
+{
+    for (auto inputs : {
+            &m_realInputs, &m_integerInputs, &m_booleanInputs, &m_stringInputs}) {
+        inputs->variables.clear();
+        inputs->sources.clear();
+    }
+    for (const auto& conn : m_connections.left) {
+        if (m_aggregations.count(conn.second)) continue;
+        const auto slot = m_subscriber.Slot(conn.first);
+        Inputs* inputs = nullptr;
+        switch (slot.dataType) {
+            case coral::model::REAL_DATATYPE:       inputs = &m_realInputs;     break;
+            case coral::model::INTEGER_DATATYPE:    inputs = &m_integerInputs;  break;
+            case coral::model::BOOLEAN_DATATYPE:    inputs = &m_booleanInputs;  break;
+            case coral::model::STRING_DATATYPE:     inputs = &m_stringInputs;   break;
+            default: assert (!"Invalid value slot"); continue;
+        }
+        inputs->variables.push_back(conn.second);
+        inputs->sources.push_back(slot.index);
+    }
+
+    // The aggregated inputs come after the other real inputs.
+    for (auto aggregates : {&m_sums, &m_minima, &m_maxima, &m_means}) {
+        aggregates->targets.clear();
+        aggregates->offsets.assign(1, 0);
+        aggregates->sources.clear();
+    }
+    for (const auto& aggregation : m_aggregations) {
+        Aggregates* aggregates = nullptr;
+        switch (aggregation.second) {
+            case coral::model::SUM_AGGREGATION:     aggregates = &m_sums;   break;
+            case coral::model::MIN_AGGREGATION:     aggregates = &m_minima; break;
+            case coral::model::MAX_AGGREGATION:     aggregates = &m_maxima; break;
+            case coral::model::MEAN_AGGREGATION:    aggregates = &m_means;  break;
+            default: assert (!"Invalid aggregation"); continue;
+        }
+        const auto sourceCount = aggregates->sources.size();
+        const auto conns = m_connections.right.equal_range(aggregation.first);
+        for (auto it = conns.first; it != conns.second; ++it) {
+            const auto slot = m_subscriber.Slot(it->second);
+            if (slot.dataType == coral::model::REAL_DATATYPE) {
+                aggregates->sources.push_back(slot.index);
+            } else {
+                // The master only accepts real outputs in aggregates, so
+                // this is a bug somewhere.  Fail rather than compute the
+                // aggregate from some of the sources only.
+                throw std::runtime_error(boost::str(boost::format(
+                    "Received a non-real value for variable %d:%d, which is "
+                    "part of the aggregate for variable %d")
+                    % it->second.Slave() % it->second.ID() % aggregation.first));
+            }
+        }
+        if (aggregates->sources.size() == sourceCount) continue;
+        aggregates->targets.push_back(m_realInputs.variables.size());
+        aggregates->offsets.push_back(aggregates->sources.size());
+        m_realInputs.variables.push_back(aggregation.first);
+    }
+
+    m_realGains.clear();
+    m_realOffsets.clear();
+    m_transformReals = false;
+    for (const auto input : m_realInputs.variables) {
+        const auto t = m_transforms.find(input);
+        if (t == m_transforms.end()) {
+            m_realGains.push_back(1.0);
+            m_realOffsets.push_back(0.0);
+        } else {
+            m_realGains.push_back(t->second.Gain());
+            m_realOffsets.push_back(t->second.Offset());
+            m_transformReals = true;
+        }
+    }
+    m_realInputs.group = slaveInstance.PrepareVariables(
+        coral::model::REAL_DATATYPE,
+        m_realInputs.variables.data(), m_realInputs.variables.size());
+    m_integerInputs.group = slaveInstance.PrepareVariables(
+        coral::model::INTEGER_DATATYPE,
+        m_integerInputs.variables.data(), m_integerInputs.variables.size());
+    m_booleanInputs.group = slaveInstance.PrepareVariables(
+        coral::model::BOOLEAN_DATATYPE,
+        m_booleanInputs.variables.data(), m_booleanInputs.variables.size());
+    m_stringInputs.group = slaveInstance.PrepareVariables(
+        coral::model::STRING_DATATYPE,
+        m_stringInputs.variables.data(), m_stringInputs.variables.size());
+    m_inputValues.Resize(coral::model::REAL_DATATYPE, m_realInputs.variables.size());
+    m_inputValues.Resize(coral::model::INTEGER_DATATYPE, m_integerInputs.variables.size());
+    m_inputValues.Resize(coral::model::BOOLEAN_DATATYPE, m_booleanInputs.variables.size());
+    m_inputValues.Resize(coral::model::STRING_DATATYPE, m_stringInputs.variables.size());
+    m_slotRevision = m_subscriber.SlotRevision();
+    m_inputsGrouped = true;
+}
+
+
 }} // namespace
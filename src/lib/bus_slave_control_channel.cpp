@@ -0,0 +1,406 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/bus/slave_control_channel.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+#include <coral/error.hpp>
+#include <coral/log.hpp>
+#include <coral/net/zmqx.hpp>
+#include <coral/protocol/execution.hpp>
+
+
+namespace coral
+{
+namespace bus
+{
+
+namespace
+{
+    const int CONTROL_SOCKET_LINGER_MSEC = 1000;
+
+    // Removes the empty delimiter frame which precedes the body of every
+    // request and reply.  Returns false if the message is malformed.
+    bool StripDelimiter(std::vector<zmq::message_t>& msg)
+    {
+        if (msg.size() < 2 || msg.front().size() > 0) return false;
+        msg.erase(msg.begin());
+        return true;
+    }
+
+    // Slaves typically bind their subscriber socket to all interfaces, in
+    // which case we connect to the host we already use for control messages.
+    std::string MakeBroadcastEndpoint(
+        const std::string& controlEndpointURL,
+        const std::string& broadcastEndpointURL)
+    {
+        const auto ep = coral::net::Endpoint{broadcastEndpointURL};
+        if (ep.Transport() != "tcp") return broadcastEndpointURL;
+        auto inEp = coral::net::ip::Endpoint{ep.Address()};
+        if (inEp.Address().IsAnyAddress()) {
+            const auto controlEndpoint = coral::net::Endpoint{controlEndpointURL};
+            inEp.SetAddress(
+                coral::net::ip::Endpoint{controlEndpoint.Address()}.Address());
+        }
+        return inEp.ToEndpoint("tcp").URL();
+    }
+}
+
+
+// =============================================================================
+// SlaveControlRouter
+// =============================================================================
+
+
+SlaveControlRouter::SlaveControlRouter(coral::net::Reactor& reactor)
+    : m_reactor(reactor)
+    , m_nextPeerID(0)
+#ifdef ZMQ_CONNECT_RID
+    , m_socket(coral::net::zmqx::GlobalContext(), ZMQ_ROUTER)
+#endif
+    , m_broadcastReceiverCount(0)
+{
+#ifdef ZMQ_CONNECT_RID
+    m_socket.setsockopt(ZMQ_LINGER, CONTROL_SOCKET_LINGER_MSEC);
+    m_reactor.AddSocket(
+        m_socket,
+        [this] (coral::net::Reactor&, zmq::socket_t& s) { ReceiveReplies(s); });
+#endif
+}
+
+
+SlaveControlRouter::~SlaveControlRouter() noexcept
+{
+    assert(m_peers.empty());
+#ifdef ZMQ_CONNECT_RID
+    m_reactor.RemoveSocket(m_socket);
+#endif
+    if (m_broadcastSocket) m_reactor.RemoveSocket(*m_broadcastSocket);
+}
+
+
+coral::net::Reactor& SlaveControlRouter::Reactor() noexcept
+{
+    return m_reactor;
+}
+
+
+SlaveControlChannel SlaveControlRouter::Connect(
+    const coral::net::Endpoint& endpoint)
+{
+    // Routing IDs which start with a zero byte are reserved by ZeroMQ.
+    auto peerID = "s" + std::to_string(m_nextPeerID++);
+    Peer peer;
+    peer.id = peerID;
+    peer.endpoint = endpoint.URL();
+#ifdef ZMQ_CONNECT_RID
+    m_socket.setsockopt(ZMQ_CONNECT_RID, peerID.data(), peerID.size());
+    m_socket.connect(peer.endpoint);
+#else
+    peer.socket = std::make_unique<zmq::socket_t>(
+        coral::net::zmqx::GlobalContext(),
+        ZMQ_DEALER);
+    peer.socket->setsockopt(ZMQ_LINGER, CONTROL_SOCKET_LINGER_MSEC);
+    peer.socket->connect(peer.endpoint);
+    m_reactor.AddSocket(
+        *peer.socket,
+        [this, peerID] (coral::net::Reactor&, zmq::socket_t& s) {
+            std::vector<zmq::message_t> msg;
+            coral::net::zmqx::Receive(s, msg);
+            Dispatch(peerID, msg);
+        });
+#endif
+    auto& stored = m_peers.emplace(peerID, std::move(peer)).first->second;
+    return SlaveControlChannel(*this, stored);
+}
+
+
+void SlaveControlRouter::EnableBroadcast()
+{
+    if (m_broadcastSocket) return;
+    auto socket = std::make_unique<zmq::socket_t>(
+        coral::net::zmqx::GlobalContext(),
+        ZMQ_XPUB);
+    socket->setsockopt(ZMQ_LINGER, 0);
+    m_reactor.AddSocket(
+        *socket,
+        [this] (coral::net::Reactor&, zmq::socket_t& s) { ReceiveSubscriptions(s); });
+    m_broadcastSocket = std::move(socket);
+}
+
+
+bool SlaveControlRouter::BroadcastEnabled() const noexcept
+{
+    return !!m_broadcastSocket;
+}
+
+
+bool SlaveControlRouter::HasBroadcastReceivers() const noexcept
+{
+    return m_broadcastReceiverCount > 0 || !m_pendingBroadcastReceivers.empty();
+}
+
+
+void SlaveControlRouter::Broadcast(std::vector<zmq::message_t>& msg)
+{
+    CORAL_PRECONDITION_CHECK(m_broadcastSocket);
+    CORAL_INPUT_CHECK(!msg.empty());
+    // The switch-over message goes through the same pipe as the commands,
+    // so the slave knows that everything after it is meant for it.
+    for (const auto peer : m_pendingBroadcastReceivers) {
+        const auto topic = BroadcastTopic(*peer);
+        m_broadcastSocket->send(topic.data(), topic.size());
+        peer->receivesBroadcasts = true;
+        ++m_broadcastReceiverCount;
+    }
+    m_pendingBroadcastReceivers.clear();
+    const auto& commandTopic = coral::protocol::execution::BROADCAST_COMMAND_TOPIC;
+    m_broadcastSocket->send(commandTopic, std::strlen(commandTopic), ZMQ_SNDMORE);
+    coral::net::zmqx::Send(*m_broadcastSocket, msg);
+}
+
+
+void SlaveControlRouter::Send(Peer& peer, std::vector<zmq::message_t>& msg)
+{
+    CORAL_INPUT_CHECK(!msg.empty());
+#ifdef ZMQ_CONNECT_RID
+    // Without ZMQ_ROUTER_MANDATORY, a message to a peer whose connection has
+    // been lost is silently dropped.  This is what we want, as the lack of a
+    // reply is handled by the same timeout as with one socket per slave.
+    m_socket.send(peer.id.data(), peer.id.size(), ZMQ_SNDMORE);
+    m_socket.send("", 0, ZMQ_SNDMORE);
+    coral::net::zmqx::Send(m_socket, msg);
+#else
+    peer.socket->send("", 0, ZMQ_SNDMORE);
+    coral::net::zmqx::Send(*peer.socket, msg);
+#endif
+}
+
+
+void SlaveControlRouter::SetReplyHandler(Peer& peer, ReplyHandler handler)
+{
+    // The old handler may be the one that is currently running, in which
+    // case Dispatch() keeps it alive until it returns.
+    peer.onReply = handler
+        ? std::make_shared<ReplyHandler>(std::move(handler))
+        : nullptr;
+}
+
+
+std::string SlaveControlRouter::BroadcastTopic(const Peer& peer) const
+{
+    // The terminator ensures that no topic is a prefix of another.
+    return m_broadcastSocket ? peer.id + '.' : std::string();
+}
+
+
+void SlaveControlRouter::ConnectBroadcast(Peer& peer, const std::string& endpoint)
+{
+    CORAL_PRECONDITION_CHECK(m_broadcastSocket);
+    CORAL_PRECONDITION_CHECK(peer.broadcastEndpoint.empty());
+    auto url = MakeBroadcastEndpoint(peer.endpoint, endpoint);
+    m_broadcastSocket->connect(url);
+    peer.broadcastEndpoint = std::move(url);
+}
+
+
+void SlaveControlRouter::Disconnect(Peer& peer) noexcept
+{
+    try {
+#ifdef ZMQ_CONNECT_RID
+        m_socket.disconnect(peer.endpoint.c_str());
+#else
+        m_reactor.RemoveSocket(*peer.socket);
+#endif
+        if (!peer.broadcastEndpoint.empty()) {
+            m_broadcastSocket->disconnect(peer.broadcastEndpoint.c_str());
+        }
+    } catch (const zmq::error_t& e) {
+        CORAL_LOG_CAT_DEBUG(coral::log::bus, boost::format(
+            "SlaveControlRouter %x: Failed to disconnect from %s: %s")
+            % this % peer.endpoint % e.what());
+    }
+    if (peer.receivesBroadcasts) {
+        --m_broadcastReceiverCount;
+    } else if (peer.broadcastSubscribed) {
+        m_pendingBroadcastReceivers.erase(std::remove(
+            m_pendingBroadcastReceivers.begin(),
+            m_pendingBroadcastReceivers.end(),
+            &peer));
+    }
+    m_peers.erase(m_peers.find(peer.id));
+}
+
+
+void SlaveControlRouter::ReceiveReplies(zmq::socket_t& socket)
+{
+    // Drain all replies which have arrived, so a single poll event can
+    // complete a whole round of STEP or ACCEPT_STEP commands.
+    zmq::message_t peerIDFrame;
+    std::vector<zmq::message_t> msg;
+    while (socket.recv(&peerIDFrame, ZMQ_DONTWAIT)) {
+        if (!peerIDFrame.more()) continue;
+        coral::net::zmqx::Receive(socket, msg);
+        Dispatch(
+            std::string(static_cast<const char*>(peerIDFrame.data()), peerIDFrame.size()),
+            msg);
+    }
+}
+
+
+void SlaveControlRouter::ReceiveSubscriptions(zmq::socket_t& socket)
+{
+    // Each message is a single frame, where the first byte is 1 for a
+    // subscription and 0 for an unsubscription, and the rest is the topic.
+    // We only care about the first subscription to each slave's own topic.
+    // A lost subscription means a lost connection, which shows up as a
+    // reply timeout.
+    zmq::message_t frame;
+    while (socket.recv(&frame, ZMQ_DONTWAIT)) {
+        const auto data = static_cast<const char*>(frame.data());
+        if (frame.size() < 3 || data[0] != 1 || data[frame.size()-1] != '.') {
+            continue;
+        }
+        const auto it = m_peers.find(std::string(data + 1, frame.size() - 2));
+        if (it == m_peers.end() || it->second.broadcastSubscribed) continue;
+        CORAL_LOG_CAT_TRACE(coral::log::bus, boost::format(
+            "SlaveControlRouter %x: %s subscribed to broadcasts")
+            % this % it->second.endpoint);
+        it->second.broadcastSubscribed = true;
+        m_pendingBroadcastReceivers.push_back(&it->second);
+    }
+}
+
+
+void SlaveControlRouter::Dispatch(
+    const std::string& peerID,
+    std::vector<zmq::message_t>& msg)
+{
+    const auto it = m_peers.find(peerID);
+    if (it == m_peers.end() || !it->second.onReply) {
+        // A late reply on a channel which has since been closed.
+        CORAL_LOG_CAT_TRACE(coral::log::bus, boost::format(
+            "SlaveControlRouter %x: Discarding reply for unknown peer")
+            % this);
+        return;
+    }
+    if (!StripDelimiter(msg)) {
+        CORAL_LOG_CAT_DEBUG(coral::log::bus, boost::format(
+            "SlaveControlRouter %x: Discarding malformed reply from %s")
+            % this % it->second.endpoint);
+        return;
+    }
+    // Hold on to the handler, as it may close the channel or replace itself.
+    const auto onReply = it->second.onReply;
+    (*onReply)(msg);
+}
+
+
+// =============================================================================
+// SlaveControlChannel
+// =============================================================================
+
+
+SlaveControlChannel::SlaveControlChannel() noexcept
+    : m_router(nullptr)
+    , m_peer(nullptr)
+{
+}
+
+
+SlaveControlChannel::SlaveControlChannel(
+    SlaveControlRouter& router,
+    SlaveControlRouter::Peer& peer) noexcept
+    : m_router(&router)
+    , m_peer(&peer)
+{
+}
+
+
+SlaveControlChannel::SlaveControlChannel(SlaveControlChannel&& other) noexcept
+    : m_router(other.m_router)
+    , m_peer(other.m_peer)
+{
+    other.m_router = nullptr;
+    other.m_peer = nullptr;
+}
+
+
+SlaveControlChannel& SlaveControlChannel::operator=(
+    SlaveControlChannel&& other) noexcept
+{
+    if (&other != this) {
+        Close();
+        m_router = other.m_router;
+        m_peer = other.m_peer;
+        other.m_router = nullptr;
+        other.m_peer = nullptr;
+    }
+    return *this;
+}
+
+
+SlaveControlChannel::~SlaveControlChannel() noexcept
+{
+    Close();
+}
+
+
+void SlaveControlChannel::Send(std::vector<zmq::message_t>& msg)
+{
+    CORAL_PRECONDITION_CHECK(m_router);
+    m_router->Send(*m_peer, msg);
+}
+
+
+void SlaveControlChannel::SetReplyHandler(ReplyHandler handler)
+{
+    CORAL_PRECONDITION_CHECK(m_router);
+    m_router->SetReplyHandler(*m_peer, std::move(handler));
+}
+
+
+void SlaveControlChannel::Close() noexcept
+{
+    if (m_router) {
+        m_router->Disconnect(*m_peer);
+        m_router = nullptr;
+        m_peer = nullptr;
+    }
+}
+
+
+SlaveControlChannel::operator bool() const noexcept
+{
+    return m_router != nullptr;
+}
+
+
+std::string SlaveControlChannel::BroadcastTopic() const
+{
+    CORAL_PRECONDITION_CHECK(m_router);
+    return m_router->BroadcastTopic(*m_peer);
+}
+
+
+void SlaveControlChannel::ConnectBroadcast(const std::string& endpoint)
+{
+    CORAL_PRECONDITION_CHECK(m_router);
+    m_router->ConnectBroadcast(*m_peer, endpoint);
+}
+
+
+bool SlaveControlChannel::ReceivesBroadcasts() const noexcept
+{
+    return m_peer && m_peer->receivesBroadcasts;
+}
+
+
+}} // namespace
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <zmq.hpp>
+
+#include <coral/bus/slave_control_channel.hpp>
+#include <coral/net/reactor.hpp>
+#include <coral/net/zmqx.hpp>
+
+
+using namespace coral::bus;
+using namespace coral::net;
+
+
+namespace
+{
+    std::vector<zmq::message_t> Message(const std::string& s)
+    {
+        std::vector<zmq::message_t> msg;
+        msg.push_back(zmqx::ToFrame(s));
+        return msg;
+    }
+
+    // Makes `server` reply to each request with `name` followed by the
+    // request body.
+    void Serve(Reactor& reactor, zmqx::RepSocket& server, const std::string& name)
+    {
+        reactor.AddSocket(
+            server.Socket(),
+            [&server, name] (Reactor&, zmq::socket_t&) {
+                std::vector<zmq::message_t> msg;
+                server.Receive(msg);
+                auto reply = Message(name + zmqx::ToString(msg.front()));
+                server.Send(reply);
+            });
+    }
+}
+
+
+TEST(coral_bus, SlaveControlChannel)
+{
+    Reactor reactor;
+    zmqx::RepSocket server1, server2;
+    server1.Bind(Endpoint{"inproc://coral_bus_SlaveControlChannel_1"});
+    server2.Bind(Endpoint{"inproc://coral_bus_SlaveControlChannel_2"});
+    Serve(reactor, server1, "one:");
+    Serve(reactor, server2, "two:");
+
+    SlaveControlRouter router(reactor);
+    EXPECT_EQ(&reactor, &router.Reactor());
+    auto channel1 = router.Connect(server1.BoundEndpoint());
+    auto channel2 = router.Connect(server2.BoundEndpoint());
+    EXPECT_TRUE(!!channel1);
+    EXPECT_TRUE(!!channel2);
+
+    // Each reply should reach the channel that sent the request, and the
+    // handler should be able to close its own channel.
+    std::vector<std::string> replies1, replies2;
+    channel1.SetReplyHandler([&] (std::vector<zmq::message_t>& msg) {
+        replies1.push_back(zmqx::ToString(msg.front()));
+        if (replies1.size() < 3) {
+            auto request = Message(std::to_string(replies1.size()));
+            channel1.Send(request);
+        } else {
+            channel1.Close();
+            if (replies2.size() == 1) reactor.Stop();
+        }
+    });
+    channel2.SetReplyHandler([&] (std::vector<zmq::message_t>& msg) {
+        replies2.push_back(zmqx::ToString(msg.front()));
+        if (replies1.size() == 3) reactor.Stop();
+    });
+
+    auto request1 = Message("0");
+    channel1.Send(request1);
+    EXPECT_TRUE(request1.empty());
+    auto request2 = Message("x");
+    channel2.Send(request2);
+    reactor.AddTimer(std::chrono::seconds(5), 1, [] (Reactor& r, int) {
+        r.Stop();
+        ADD_FAILURE() << "Timed out waiting for replies";
+    });
+    reactor.Run();
+
+    ASSERT_EQ(3U, replies1.size());
+    EXPECT_EQ("one:0", replies1[0]);
+    EXPECT_EQ("one:1", replies1[1]);
+    EXPECT_EQ("one:2", replies1[2]);
+    ASSERT_EQ(1U, replies2.size());
+    EXPECT_EQ("two:x", replies2[0]);
+    EXPECT_FALSE(!!channel1);
+
+    // Moving a channel transfers ownership of the connection.
+    auto moved = std::move(channel2);
+    EXPECT_FALSE(!!channel2);
+    EXPECT_TRUE(!!moved);
+    moved.Close();
+    EXPECT_FALSE(!!moved);
+    reactor.RemoveSocket(server1.Socket());
+    reactor.RemoveSocket(server2.Socket());
+}
+
+
+TEST(coral_bus, SlaveControlRouter_Broadcast)
+{
+    Reactor reactor;
+    zmqx::RepSocket server;
+    server.Bind(Endpoint{"inproc://coral_bus_SlaveControlRouter_Broadcast"});
+    zmq::socket_t subscriber(zmqx::GlobalContext(), ZMQ_SUB);
+    subscriber.bind("inproc://coral_bus_SlaveControlRouter_Broadcast_sub");
+    subscriber.setsockopt(ZMQ_SUBSCRIBE, "*", 1);
+
+    SlaveControlRouter router(reactor);
+    EXPECT_FALSE(router.BroadcastEnabled());
+    auto disabled = router.Connect(server.BoundEndpoint());
+    EXPECT_TRUE(disabled.BroadcastTopic().empty());
+    disabled.Close();
+
+    router.EnableBroadcast();
+    EXPECT_TRUE(router.BroadcastEnabled());
+    EXPECT_FALSE(router.HasBroadcastReceivers());
+    auto channel = router.Connect(server.BoundEndpoint());
+    const auto topic = channel.BroadcastTopic();
+    ASSERT_FALSE(topic.empty());
+    subscriber.setsockopt(ZMQ_SUBSCRIBE, topic.data(), topic.size());
+    channel.ConnectBroadcast("inproc://coral_bus_SlaveControlRouter_Broadcast_sub");
+
+    // The slave becomes a receiver once the router has seen its
+    // subscription, and is activated by the first broadcast.
+    std::vector<std::vector<std::string>> received;
+    reactor.AddSocket(subscriber, [&] (Reactor& r, zmq::socket_t& s) {
+        std::vector<zmq::message_t> msg;
+        zmqx::Receive(s, msg);
+        received.emplace_back();
+        for (const auto& f : msg) received.back().push_back(zmqx::ToString(f));
+        if (received.size() == 2) r.Stop();
+    });
+    reactor.AddTimer(std::chrono::milliseconds(1), -1, [&] (Reactor&, int id) {
+        if (!router.HasBroadcastReceivers()) return;
+        reactor.RemoveTimer(id);
+        EXPECT_FALSE(channel.ReceivesBroadcasts());
+        auto msg = Message("step");
+        router.Broadcast(msg);
+        EXPECT_TRUE(msg.empty());
+        EXPECT_TRUE(channel.ReceivesBroadcasts());
+    });
+    reactor.AddTimer(std::chrono::seconds(5), 1, [] (Reactor& r, int) {
+        r.Stop();
+        ADD_FAILURE() << "Timed out waiting for broadcast";
+    });
+    reactor.Run();
+
+    ASSERT_EQ(2U, received.size());
+    EXPECT_EQ(std::vector<std::string>{topic}, received[0]);
+    EXPECT_EQ((std::vector<std::string>{"*", "step"}), received[1]);
+
+    channel.Close();
+    EXPECT_FALSE(router.HasBroadcastReceivers());
+    reactor.RemoveSocket(subscriber);
+}
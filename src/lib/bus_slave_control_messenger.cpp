@@ -9,11 +9,13 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <cassert>
 #include <utility>
 
+#include <coral/bus/slave_control_channel.hpp>
 #include <coral/bus/slave_control_messenger_v0.hpp>
 #include <coral/error.hpp>
 #include <coral/log.hpp>
-#include <coral/net/zmqx.hpp>
+#include <coral/protobuf.hpp>
 #include <coral/protocol/execution.hpp>
+#include <coral/timeline.hpp>
 
 
 namespace coral
@@ -31,7 +33,7 @@ class PendingSlaveControlConnectionPrivate
 {
 public:
     PendingSlaveControlConnectionPrivate(
-        coral::net::Reactor& reactor,
+        SlaveControlRouter& router,
         const coral::net::SlaveLocator& slaveLocator,
         int maxAttempts,
         std::chrono::milliseconds timeout,
@@ -48,8 +50,8 @@ public:
 
     bool Active() const noexcept;
 
-    // Aborts an ongoing connection attempt by simply resetting the socket
-    // and cancelling the timeout timer and socket listener.  The completion
+    // Aborts an ongoing connection attempt by simply closing the channel
+    // and cancelling the timeout timer.  The completion
     // handler does NOT get called.
     void Destroy() noexcept;
 
@@ -60,42 +62,48 @@ public:
 
 private:
     void TryConnect(int remainingAttempts);
-    void HandleHelloReply();
+    void HandleHelloReply(std::vector<zmq::message_t>& msg);
     void HandleTimeout();
     void OnComplete(const std::error_code& ec, SlaveControlConnection scc);
     void CancelTimeoutTimer() noexcept;
 
-    coral::net::Reactor& m_reactor;
+    SlaveControlRouter& m_router;
     const coral::net::SlaveLocator m_slaveLocator;
     const std::chrono::milliseconds m_timeout;
 
     ConnectToSlaveHandler m_onComplete;
     int m_timeoutTimer;
-    coral::net::zmqx::ReqSocket m_socket;
+    SlaveControlChannel m_channel;
+    coral::timeline::Time m_helloSendTime;
 };
 
 
 struct SlaveControlConnectionPrivate
 {
     coral::net::Reactor* reactor;
-    coral::net::zmqx::ReqSocket socket;
+    SlaveControlChannel channel;
     std::chrono::milliseconds timeout;
     int protocol;
+    std::chrono::nanoseconds traceClockOffset;
+    bool supportsAggregation;
+    bool supportsTransforms;
+    bool supportsDeltaPublication;
 };
 
 
 PendingSlaveControlConnectionPrivate::PendingSlaveControlConnectionPrivate(
-    coral::net::Reactor& reactor,
+    SlaveControlRouter& router,
     const coral::net::SlaveLocator& slaveLocator,
     int maxAttempts,
     std::chrono::milliseconds timeout,
     ConnectToSlaveHandler onComplete)
-    : m_reactor(reactor),
+    : m_router(router),
       m_slaveLocator(slaveLocator),
       m_timeout(timeout),
       m_onComplete(std::move(onComplete)),
       m_timeoutTimer(NO_TIMER),
-      m_socket()
+      m_channel(),
+      m_helloSendTime(0)
 {
     TryConnect(maxAttempts);
     assert(m_timeoutTimer != NO_TIMER);
@@ -112,8 +120,7 @@ void PendingSlaveControlConnectionPrivate::Destroy() noexcept
 {
     if (Active()) {
         CancelTimeoutTimer();
-        m_reactor.RemoveSocket(m_socket.Socket());
-        m_socket = coral::net::zmqx::ReqSocket{};
+        m_channel.Close();
         m_onComplete = nullptr;
     }
 }
@@ -123,8 +130,7 @@ void PendingSlaveControlConnectionPrivate::Close()
 {
     if (Active()) {
         CancelTimeoutTimer();
-        m_reactor.RemoveSocket(m_socket.Socket());
-        m_socket.Close();
+        m_channel.Close();
         OnComplete(std::make_error_code(std::errc::operation_canceled), SlaveControlConnection());
     }
 }
@@ -133,16 +139,24 @@ void PendingSlaveControlConnectionPrivate::Close()
 void PendingSlaveControlConnectionPrivate::TryConnect(int remainingAttempts)
 {
     // Connect and send HELLO
-    m_socket = coral::net::zmqx::ReqSocket{}; // reset to a fresh socket
-    m_socket.Connect(m_slaveLocator.ControlEndpoint());
-    CORAL_LOG_TRACE(boost::format("PendingSlaveControlConnectionPrivate  %x: "
+    // Close the previous channel, if any, before opening a new one, since
+    // closing it disconnects from the endpoint.
+    m_channel.Close();
+    m_channel = m_router.Connect(m_slaveLocator.ControlEndpoint());
+    CORAL_LOG_CAT_TRACE(coral::log::bus, boost::format("PendingSlaveControlConnectionPrivate  %x: "
             "Connecting to endpoint %s")
         % this % m_slaveLocator.ControlEndpoint().URL());
 
+    // The HELLO body carries our trace clock, so we can estimate the offset
+    // between our clock and the slave's from its reply.  (Slaves which don't
+    // know about this simply ignore the body.)
+    coralproto::execution::HelloData helloData;
+    m_helloSendTime = coral::timeline::Now();
+    helloData.set_trace_clock_ns(m_helloSendTime);
     std::vector<zmq::message_t> msg;
-    coral::protocol::execution::CreateHelloMessage(msg, 0);
-    m_socket.Send(msg);
-    CORAL_LOG_TRACE(
+    coral::protocol::execution::CreateHelloMessage(msg, 0, helloData);
+    m_channel.Send(msg);
+    CORAL_LOG_CAT_TRACE(coral::log::bus,
         boost::format("PendingSlaveControlConnectionPrivate  %x: Sent HELLO")
         % this);
 
@@ -153,17 +167,17 @@ void PendingSlaveControlConnectionPrivate::TryConnect(int remainingAttempts)
     auto timeout = m_timeout;
     if (timeout < std::chrono::milliseconds(0) && remainingAttempts > 1) {
         timeout = std::chrono::seconds(1);
-        CORAL_LOG_DEBUG(boost::format(
+        CORAL_LOG_CAT_DEBUG(coral::log::bus, boost::format(
             "PendingSlaveControlConnectionPrivate %x: Using default timeout "
             "(%d ms) for initial connection attempts.")
             % this % timeout.count());
     }
     if (timeout >= std::chrono::milliseconds(0)) {
-        m_timeoutTimer = m_reactor.AddTimer(timeout, 1,
+        m_timeoutTimer = m_router.Reactor().AddTimer(timeout, 1,
             [remainingAttempts, this](coral::net::Reactor& r, int id)
             {
                 m_timeoutTimer = NO_TIMER;
-                r.RemoveSocket(m_socket.Socket());
+                m_channel.Close();
                 if (remainingAttempts > 1) {
                     TryConnect(remainingAttempts-1);
                 } else {
@@ -171,22 +185,21 @@ void PendingSlaveControlConnectionPrivate::TryConnect(int remainingAttempts)
                 }
             });
     }
-    m_reactor.AddSocket(
-        m_socket.Socket(),
-        [this] (coral::net::Reactor& r, zmq::socket_t& s) {
+    m_channel.SetReplyHandler(
+        [this] (std::vector<zmq::message_t>& reply) {
             CancelTimeoutTimer();
-            r.RemoveSocket(s);
-            HandleHelloReply();
+            m_channel.SetReplyHandler(nullptr);
+            HandleHelloReply(reply);
         });
 }
 
 
-void PendingSlaveControlConnectionPrivate::HandleHelloReply()
+void PendingSlaveControlConnectionPrivate::HandleHelloReply(
+    std::vector<zmq::message_t>& msg)
 {
-    std::vector<zmq::message_t> msg;
-    m_socket.Receive(msg);
+    const auto receiveTime = coral::timeline::Now();
     const auto reply = coral::protocol::execution::ParseMessageType(msg.front());
-    CORAL_LOG_TRACE(
+    CORAL_LOG_CAT_TRACE(coral::log::bus,
         boost::format("PendingSlaveControlConnectionPrivate  %x: Received %s")
         % this
         % coralproto::execution::MessageType_Name(
@@ -194,13 +207,31 @@ void PendingSlaveControlConnectionPrivate::HandleHelloReply()
 
     if (reply == coralproto::execution::MSG_HELLO) {
         auto p = std::make_unique<SlaveControlConnectionPrivate>();
-        p->reactor = &m_reactor;
-        p->socket = std::move(m_socket);
+        p->reactor = &m_router.Reactor();
+        p->channel = std::move(m_channel);
         p->timeout = m_timeout;
         p->protocol = coral::protocol::execution::ParseHelloMessage(msg);
+        p->traceClockOffset = std::chrono::nanoseconds(0);
+        p->supportsAggregation = false;
+        p->supportsTransforms = false;
+        p->supportsDeltaPublication = false;
+        if (msg.size() > 1) {
+            // Assume that the slave read its clock halfway between our
+            // sending the HELLO and receiving its reply.
+            coralproto::execution::HelloData helloData;
+            coral::protobuf::ParseFromFrame(msg[1], helloData);
+            if (helloData.has_trace_clock_ns()) {
+                p->traceClockOffset = std::chrono::nanoseconds(
+                    m_helloSendTime + (receiveTime - m_helloSendTime) / 2
+                    - helloData.trace_clock_ns());
+            }
+            p->supportsAggregation = helloData.supports_aggregation();
+            p->supportsTransforms = helloData.supports_transforms();
+            p->supportsDeltaPublication = helloData.supports_delta_publication();
+        }
         OnComplete(std::error_code(), SlaveControlConnection(std::move(p)));
     } else {
-        m_socket.Close();
+        m_channel.Close();
         std::error_code ec;
         if (reply == coralproto::execution::MSG_DENIED) {
             ec = make_error_code(std::errc::permission_denied);
@@ -232,7 +263,7 @@ void PendingSlaveControlConnectionPrivate::OnComplete(
 void PendingSlaveControlConnectionPrivate::CancelTimeoutTimer() noexcept
 {
     if (m_timeoutTimer == NO_TIMER) return;
-    try { m_reactor.RemoveTimer(m_timeoutTimer); }
+    try { m_router.Reactor().RemoveTimer(m_timeoutTimer); }
     catch (...) { assert(!"PendingSlaveControlConnection: Tried to cancel a nonexisting timer"); }
     m_timeoutTimer = NO_TIMER;
 }
@@ -320,7 +351,7 @@ SlaveControlConnectionPrivate& SlaveControlConnection::Private()
 // === Free functions ===
 
 PendingSlaveControlConnection ConnectToSlave(
-    coral::net::Reactor& reactor,
+    SlaveControlRouter& router,
     const coral::net::SlaveLocator& slaveLocator,
     int maxAttempts,
     std::chrono::milliseconds timeout,
@@ -331,7 +362,7 @@ PendingSlaveControlConnection ConnectToSlave(
 
     return PendingSlaveControlConnection(
         std::make_shared<PendingSlaveControlConnectionPrivate>(
-            reactor,
+            router,
             slaveLocator,
             maxAttempts,
             timeout,
@@ -350,12 +381,18 @@ std::unique_ptr<ISlaveControlMessenger> MakeSlaveControlMessenger(
     CORAL_INPUT_CHECK(slaveID != coral::model::INVALID_SLAVE_ID);
     CORAL_INPUT_CHECK(onComplete);
     if (connection.Private().protocol == 0) {
+        auto fullSetup = setup;
+        fullSetup.traceClockOffset = connection.Private().traceClockOffset;
+        fullSetup.supportsAggregation = connection.Private().supportsAggregation;
+        fullSetup.supportsTransforms = connection.Private().supportsTransforms;
+        fullSetup.supportsDeltaPublication =
+            connection.Private().supportsDeltaPublication;
         return std::make_unique<coral::bus::SlaveControlMessengerV0>(
             *connection.Private().reactor,
-            std::move(connection.Private().socket),
+            std::move(connection.Private().channel),
             slaveID,
             slaveName,
-            setup,
+            fullSetup,
             connection.Private().timeout,
             std::move(onComplete));
     } else {
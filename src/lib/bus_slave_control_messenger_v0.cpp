@@ -75,25 +75,30 @@ namespace
 
 SlaveControlMessengerV0::SlaveControlMessengerV0(
     coral::net::Reactor& reactor,
-    coral::net::zmqx::ReqSocket socket,
+    SlaveControlChannel channel,
     coral::model::SlaveID slaveID,
     const std::string& slaveName,
     const SlaveSetup& setup,
     std::chrono::milliseconds timeout,
     MakeSlaveControlMessengerHandler onComplete)
     : m_reactor(reactor),
-      m_socket(std::move(socket)),
+      m_channel(std::move(channel)),
       m_state(SLAVE_CONNECTED),
       m_attachedToReactor(false),
       m_currentCommand(NO_COMMAND_ACTIVE),
       m_onComplete(),
-      m_replyTimeoutTimerId(NO_TIMER_ACTIVE)
-{
-    CORAL_LOG_TRACE(boost::format("SlaveControlMessengerV0 %x: connected to \"%s\" (ID = %d)")
+      m_replyTimeoutTimerId(NO_TIMER_ACTIVE),
+      m_supportsAggregation(setup.supportsAggregation),
+      m_supportsTransforms(setup.supportsTransforms),
+      m_supportsDeltaPublication(setup.supportsDeltaPublication),
+      m_slaveID(slaveID),
+      m_commandSendTime(0)
+{
+    CORAL_LOG_CAT_TRACE(coral::log::bus,
+        boost::format("SlaveControlMessengerV0 %x: connected to \"%s\" (ID = %d)")
         % this % slaveName % slaveID);
-    reactor.AddSocket(m_socket.Socket(), [=](coral::net::Reactor& r, zmq::socket_t& s) {
-        assert (&s == &m_socket.Socket());
-        OnReply();
+    m_channel.SetReplyHandler([=](std::vector<zmq::message_t>& msg) {
+        OnReply(msg);
     });
     m_attachedToReactor = true;
     Setup(slaveID, slaveName, setup, timeout, std::move(onComplete));
@@ -107,7 +112,7 @@ SlaveControlMessengerV0::~SlaveControlMessengerV0() noexcept
 {
     CheckInvariant();
     if (m_attachedToReactor) {
-        m_reactor.RemoveSocket(m_socket.Socket());
+        m_channel.Close();
     }
     if (m_replyTimeoutTimerId != NO_TIMER_ACTIVE) {
         UnregisterTimeout();
@@ -172,7 +177,20 @@ void SlaveControlMessengerV0::SetVariables(
             coral::protocol::ConvertToProto(it->Value(), *v->mutable_value());
         }
         if (it->IsConnectionChange()) {
-            coral::protocol::ConvertToProto(it->ConnectedOutput(), *v->mutable_connected_output());
+            if (it->Aggregation() == coral::model::NO_AGGREGATION) {
+                coral::protocol::ConvertToProto(it->ConnectedOutput(), *v->mutable_connected_output());
+            } else {
+                CORAL_INPUT_CHECK(m_supportsAggregation);
+                v->set_aggregation(coral::protocol::ToProto(it->Aggregation()));
+                for (const auto& output : it->AggregatedOutputs()) {
+                    coral::protocol::ConvertToProto(output, *v->add_aggregated_output());
+                }
+            }
+            if (!it->Transform().IsIdentity()) {
+                CORAL_INPUT_CHECK(m_supportsTransforms);
+                v->set_transform_gain(it->Transform().Gain());
+                v->set_transform_offset(it->Transform().Offset());
+            }
         }
     }
     SendCommand(coralproto::execution::MSG_SET_VARS, &data, timeout, std::move(onComplete));
@@ -225,7 +243,12 @@ void SlaveControlMessengerV0::Step(
     data.set_timepoint(currentT);
     data.set_stepsize(deltaT);
 
-    SendCommand(coralproto::execution::MSG_STEP, &data, timeout, std::move(onComplete));
+    if (m_channel.ReceivesBroadcasts()) {
+        m_commandSendTime = coral::timeline::Now();
+        PostSendCommand(coralproto::execution::MSG_STEP, timeout, std::move(onComplete));
+    } else {
+        SendCommand(coralproto::execution::MSG_STEP, &data, timeout, std::move(onComplete));
+    }
     assert(State() == SLAVE_BUSY);
 }
 
@@ -238,7 +261,12 @@ void SlaveControlMessengerV0::AcceptStep(
     CORAL_INPUT_CHECK(onComplete);
     CheckInvariant();
 
-    SendCommand(coralproto::execution::MSG_ACCEPT_STEP, nullptr, timeout, std::move(onComplete));
+    if (m_channel.ReceivesBroadcasts()) {
+        m_commandSendTime = coral::timeline::Now();
+        PostSendCommand(coralproto::execution::MSG_ACCEPT_STEP, timeout, std::move(onComplete));
+    } else {
+        SendCommand(coralproto::execution::MSG_ACCEPT_STEP, nullptr, timeout, std::move(onComplete));
+    }
     assert(State() == SLAVE_BUSY);
 }
 
@@ -248,17 +276,43 @@ void SlaveControlMessengerV0::Terminate()
     CORAL_PRECONDITION_CHECK(m_state != SLAVE_NOT_CONNECTED);
     CheckInvariant();
 
-    CORAL_LOG_TRACE(
+    CORAL_LOG_CAT_TRACE(coral::log::bus,
         boost::format("SlaveControlMessengerV0 %x: Sending MSG_TERMINATE")
         % this);
     std::vector<zmq::message_t> msg;
     coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_TERMINATE);
-    m_socket.Send(msg);
-    CORAL_LOG_TRACE(boost::format("SlaveControlMessengerV0 %x: Send complete") % this);
+    m_channel.Send(msg);
+    CORAL_LOG_CAT_TRACE(coral::log::bus,
+        boost::format("SlaveControlMessengerV0 %x: Send complete") % this);
     Close();
 }
 
 
+coral::master::SlaveStepTimings SlaveControlMessengerV0::LastStepTimings()
+    const noexcept
+{
+    return m_lastStepTimings;
+}
+
+
+bool SlaveControlMessengerV0::SupportsAggregation() const noexcept
+{
+    return m_supportsAggregation;
+}
+
+
+bool SlaveControlMessengerV0::SupportsTransforms() const noexcept
+{
+    return m_supportsTransforms;
+}
+
+
+bool SlaveControlMessengerV0::SupportsDeltaPublication() const noexcept
+{
+    return m_supportsDeltaPublication;
+}
+
+
 void SlaveControlMessengerV0::Setup(
     coral::model::SlaveID slaveID,
     const std::string& slaveName,
@@ -281,6 +335,10 @@ void SlaveControlMessengerV0::Setup(
         setup.variableRecvTimeout >= std::chrono::milliseconds(0)
             ? boost::numeric_cast<google::protobuf::int32>(setup.variableRecvTimeout.count())
             : -1);
+    data.set_trace_clock_offset_ns(setup.traceClockOffset.count());
+    const auto broadcastTopic = m_channel.BroadcastTopic();
+    if (!broadcastTopic.empty()) data.set_broadcast_topic(broadcastTopic);
+    if (setup.deltaPublication) data.set_delta_publication(true);
     SendCommand(coralproto::execution::MSG_SETUP, &data, timeout, std::move(onComplete));
     assert(State() == SLAVE_BUSY);
 }
@@ -292,8 +350,7 @@ void SlaveControlMessengerV0::Reset()
     assert(m_currentCommand == NO_COMMAND_ACTIVE);
     assert(boost::apply_visitor(IsEmpty(), m_onComplete));
     assert(m_replyTimeoutTimerId == NO_TIMER_ACTIVE);
-    m_reactor.RemoveSocket(m_socket.Socket());
-    m_socket.Close();
+    m_channel.Close();
     m_state = SLAVE_NOT_CONNECTED;
     m_attachedToReactor = false;
 }
@@ -307,12 +364,14 @@ void SlaveControlMessengerV0::SendCommand(
 {
     std::vector<zmq::message_t> msg;
     const auto msgType = static_cast<coralproto::execution::MessageType>(command);
-    CORAL_LOG_TRACE(boost::format("SlaveControlMessengerV0 %x: Sending %s")
+    CORAL_LOG_CAT_TRACE(coral::log::bus, boost::format("SlaveControlMessengerV0 %x: Sending %s")
         % this % coralproto::execution::MessageType_Name(msgType));
     if (data) coral::protocol::execution::CreateMessage(msg, msgType, *data);
     else      coral::protocol::execution::CreateMessage(msg, msgType);
-    m_socket.Send(msg);
-    CORAL_LOG_TRACE(boost::format("SlaveControlMessengerV0 %x: Send complete") % this);
+    m_commandSendTime = coral::timeline::Now();
+    m_channel.Send(msg);
+    CORAL_LOG_CAT_TRACE(coral::log::bus,
+        boost::format("SlaveControlMessengerV0 %x: Send complete") % this);
     PostSendCommand(command, timeout, std::move(onComplete));
 }
 
@@ -350,7 +409,7 @@ void SlaveControlMessengerV0::UnregisterTimeout()
 }
 
 
-void SlaveControlMessengerV0::OnReply()
+void SlaveControlMessengerV0::OnReply(std::vector<zmq::message_t>& msg)
 {
     CheckInvariant();
     if (State() != SLAVE_BUSY) {
@@ -375,9 +434,15 @@ void SlaveControlMessengerV0::OnReply()
     UnregisterTimeout();
 
     // Delegate different replies to different functions.
-    std::vector<zmq::message_t> msg;
-    m_socket.Receive(msg);
-    CORAL_LOG_TRACE(boost::format("SlaveControlMessengerV0 %x: Received %s")
+    // The span covers the entire round trip, from the master's point of view.
+    // MessageType_Name() returns a reference to a static string.
+    coral::timeline::Record(
+        coralproto::execution::MessageType_Name(
+            static_cast<coralproto::execution::MessageType>(currentCommand)).c_str(),
+        m_commandSendTime,
+        coral::timeline::Now(),
+        m_slaveID);
+    CORAL_LOG_CAT_TRACE(coral::log::bus, boost::format("SlaveControlMessengerV0 %x: Received %s")
         % this
         % coralproto::execution::MessageType_Name(
             static_cast<coralproto::execution::MessageType>(
@@ -444,6 +509,24 @@ void SlaveControlMessengerV0::SetupReplyReceived(
     VoidHandler onComplete)
 {
     assert (m_state == SLAVE_BUSY);
+    if (msg.size() > 1
+        && coral::protocol::execution::ParseMessageType(msg.front())
+            == coralproto::execution::MSG_READY)
+    {
+        coralproto::execution::SetupReplyData data;
+        coral::protobuf::ParseFromFrame(msg[1], data);
+        if (data.has_broadcast_endpoint()) {
+            // If this fails, the slave simply never receives broadcasts,
+            // and we keep sending it commands directly.
+            try {
+                m_channel.ConnectBroadcast(data.broadcast_endpoint());
+            } catch (const zmq::error_t& e) {
+                CORAL_LOG_CAT_DEBUG(coral::log::bus, boost::format(
+                    "SlaveControlMessengerV0 %x: Cannot connect to broadcast endpoint %s: %s")
+                    % this % data.broadcast_endpoint() % e.what());
+            }
+        }
+    }
     HandleExpectedReadyReply(msg, std::move(onComplete));
 }
 
@@ -519,6 +602,15 @@ void SlaveControlMessengerV0::StepReplyReceived(
     assert (m_state = SLAVE_BUSY);
     const auto msgType = coral::protocol::execution::ParseMessageType(msg.front());
     if (msgType == coralproto::execution::MSG_STEP_OK) {
+        m_lastStepTimings = coral::master::SlaveStepTimings{};
+        if (msg.size() > 1) {
+            coralproto::execution::StepTimings timings;
+            coral::protobuf::ParseFromFrame(msg[1], timings);
+            m_lastStepTimings.doStep =
+                std::chrono::nanoseconds(timings.do_step_ns());
+            m_lastStepTimings.publish =
+                std::chrono::nanoseconds(timings.publish_ns());
+        }
         m_state = SLAVE_STEP_OK;
         onComplete(std::error_code());
     } else if (msgType == coralproto::execution::MSG_STEP_FAILED) {
@@ -535,6 +627,15 @@ void SlaveControlMessengerV0::AcceptStepReplyReceived(
     VoidHandler onComplete)
 {
     assert(m_state == SLAVE_BUSY);
+    if (msg.size() > 1
+        && coral::protocol::execution::ParseMessageType(msg.front())
+            == coralproto::execution::MSG_READY)
+    {
+        coralproto::execution::StepTimings timings;
+        coral::protobuf::ParseFromFrame(msg[1], timings);
+        m_lastStepTimings.dataWait =
+            std::chrono::nanoseconds(timings.data_wait_ns());
+    }
     HandleExpectedReadyReply(msg, std::move(onComplete));
 }
 
@@ -18,7 +18,7 @@ namespace bus
 
 
 SlaveController::SlaveController(
-    coral::net::Reactor& reactor,
+    SlaveControlRouter& router,
     const coral::net::SlaveLocator& slaveLocator,
     coral::model::SlaveID slaveID,
     const std::string& slaveName,
@@ -29,7 +29,7 @@ SlaveController::SlaveController(
 {
     CORAL_INPUT_CHECK(slaveID != coral::model::INVALID_SLAVE_ID);
     m_pendingConnection = ConnectToSlave(
-        reactor,
+        router,
         slaveLocator,
         maxConnectionAttempts,
         timeout,
@@ -160,4 +160,29 @@ void SlaveController::Terminate()
 }
 
 
+coral::master::SlaveStepTimings SlaveController::LastStepTimings() const noexcept
+{
+    if (m_messenger) return m_messenger->LastStepTimings();
+    else return coral::master::SlaveStepTimings{};
+}
+
+
+bool SlaveController::SupportsAggregation() const noexcept
+{
+    return m_messenger && m_messenger->SupportsAggregation();
+}
+
+
+bool SlaveController::SupportsTransforms() const noexcept
+{
+    return m_messenger && m_messenger->SupportsTransforms();
+}
+
+
+bool SlaveController::SupportsDeltaPublication() const noexcept
+{
+    return m_messenger && m_messenger->SupportsDeltaPublication();
+}
+
+
 }} // namespace
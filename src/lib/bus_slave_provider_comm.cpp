@@ -6,6 +6,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <coral/bus/slave_provider_comm.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <utility>
 #include <vector>
@@ -34,8 +35,11 @@ namespace
 {
     const char* PROTOCOL_IDENTIFIER = "DSSPI";
     const std::uint16_t PROTOCOL_VERSION = 0;
+    // Version 1 adds INSTANTIATE_SLAVES; the other requests are unchanged.
+    const std::uint16_t BATCH_PROTOCOL_VERSION = 1;
     const std::string GET_SLAVE_TYPES_REQUEST = "GET_SLAVE_TYPES";
     const std::string INSTANTIATE_SLAVE_REQUEST = "INSTANTIATE_SLAVE";
+    const std::string INSTANTIATE_SLAVES_REQUEST = "INSTANTIATE_SLAVES";
     const std::string OK_REPLY = "OK";
     const std::string ERROR_REPLY = "ERROR";
 
@@ -75,6 +79,23 @@ namespace
             return ep;
         }
     }
+
+    google::protobuf::int32 TimeoutToProto(std::chrono::milliseconds timeout)
+    {
+        return timeout >= std::chrono::milliseconds(0)
+            ? boost::numeric_cast<google::protobuf::int32>(timeout.count())
+            : -1;
+    }
+
+    std::chrono::milliseconds TotalTimeout(
+        std::chrono::milliseconds instantiationTimeout,
+        std::chrono::milliseconds requestTimeout)
+    {
+        return instantiationTimeout < std::chrono::milliseconds(0)
+                || requestTimeout < std::chrono::milliseconds(0)
+            ? std::chrono::milliseconds(-1)
+            : instantiationTimeout + requestTimeout;
+    }
 }
 
 
@@ -111,8 +132,34 @@ public:
                 timeout,
                 std::bind(
                     &Private::OnGetSlaveTypesReply, this,
-                    std::move(onComplete), _1, _2, _3, _4, _5));
+                    true, std::move(onComplete), _1, _2, _3, _4, _5));
+        }
+    }
+
+    void GetSlaveTypeDescriptions(
+        const std::vector<std::string>& slaveTypeUUIDs,
+        bool includeVariables,
+        GetSlaveTypesHandler onComplete,
+        std::chrono::milliseconds timeout)
+    {
+        CORAL_INPUT_CHECK(onComplete != nullptr);
+
+        coralproto::domain::GetSlaveTypesData args;
+        for (const auto& uuid : slaveTypeUUIDs) {
+            args.add_slave_type_uuid(uuid);
         }
+        args.set_omit_variables(!includeVariables);
+        const auto body = args.SerializeAsString();
+        assert(!body.empty());
+
+        m_client.Request(
+            PROTOCOL_VERSION,
+            GET_SLAVE_TYPES_REQUEST.data(), GET_SLAVE_TYPES_REQUEST.size(),
+            body.data(), body.size(),
+            timeout,
+            std::bind(
+                &Private::OnGetSlaveTypesReply, this,
+                false, std::move(onComplete), _1, _2, _3, _4, _5));
     }
 
     void InstantiateSlave(
@@ -125,32 +172,158 @@ public:
 
         coralproto::domain::InstantiateSlaveData args;
         args.set_slave_type_uuid(slaveTypeUUID);
-        args.set_timeout_ms(instantiationTimeout >= std::chrono::milliseconds(0)
-            ? boost::numeric_cast<google::protobuf::int32>(instantiationTimeout.count())
-            : -1);
+        args.set_timeout_ms(TimeoutToProto(instantiationTimeout));
         const auto body = args.SerializeAsString();
         assert(!body.empty());
 
-        const auto totalTimeout =
-            instantiationTimeout < std::chrono::milliseconds(0)
-                || requestTimeout < std::chrono::milliseconds(0)
-            ? std::chrono::milliseconds(-1)
-            : instantiationTimeout + requestTimeout;
-
         m_client.Request(
             PROTOCOL_VERSION,
             INSTANTIATE_SLAVE_REQUEST.data(),
             INSTANTIATE_SLAVE_REQUEST.size(),
             body.data(),
             body.size(),
-            totalTimeout,
+            TotalTimeout(instantiationTimeout, requestTimeout),
             std::bind(
                 &Private::OnInstantiateSlaveReply, this,
                 std::move(onComplete), _1, _2, _3, _4, _5));
     }
 
+    void InstantiateSlaves(
+        const std::vector<SlaveBatch>& slaveBatches,
+        std::chrono::milliseconds instantiationTimeout,
+        std::chrono::milliseconds requestTimeout,
+        InstantiateSlavesHandler onComplete)
+    {
+        CORAL_INPUT_CHECK(onComplete != nullptr);
+        for (const auto& batch : slaveBatches) {
+            CORAL_INPUT_CHECK(batch.count >= 0);
+        }
+
+        // Slave providers from earlier versions silently ignore requests
+        // they don't understand, so we ask which protocol version the
+        // provider supports (once) before using INSTANTIATE_SLAVES.
+        if (!m_maxProtocolVersionKnown) {
+            m_client.RequestMaxProtocol(
+                requestTimeout,
+                [=, onComplete = std::move(onComplete)]
+                    (const std::error_code& ec, std::uint16_t version)
+                {
+                    if (ec) {
+                        onComplete(ec, nullptr, 0, std::string{});
+                        return;
+                    }
+                    m_maxProtocolVersion = version;
+                    m_maxProtocolVersionKnown = true;
+                    InstantiateSlaves(
+                        slaveBatches,
+                        instantiationTimeout,
+                        requestTimeout,
+                        std::move(onComplete));
+                });
+            return;
+        }
+        if (m_maxProtocolVersion < BATCH_PROTOCOL_VERSION) {
+            InstantiateSlavesSeparately(
+                slaveBatches,
+                instantiationTimeout,
+                requestTimeout,
+                std::move(onComplete));
+            return;
+        }
+
+        coralproto::domain::InstantiateSlavesData args;
+        std::size_t slaveCount = 0;
+        for (const auto& batch : slaveBatches) {
+            auto pbBatch = args.add_slave_batch();
+            pbBatch->set_slave_type_uuid(batch.slaveTypeUUID);
+            pbBatch->set_count(batch.count);
+            slaveCount += batch.count;
+        }
+        args.set_timeout_ms(TimeoutToProto(instantiationTimeout));
+        const auto body = args.SerializeAsString();
+        assert(!body.empty());
+
+        m_client.Request(
+            BATCH_PROTOCOL_VERSION,
+            INSTANTIATE_SLAVES_REQUEST.data(),
+            INSTANTIATE_SLAVES_REQUEST.size(),
+            body.data(),
+            body.size(),
+            TotalTimeout(instantiationTimeout, requestTimeout),
+            std::bind(
+                &Private::OnInstantiateSlavesReply, this,
+                slaveCount, std::move(onComplete), _1, _2, _3, _4, _5));
+    }
+
 private:
+    // Instantiates the slaves with one INSTANTIATE_SLAVE request each, for
+    // slave providers which don't support INSTANTIATE_SLAVES.  The provider
+    // serves the requests one at a time.  If one of them fails, the slaves
+    // which were started anyway will shut down by themselves when no master
+    // connects to them.
+    void InstantiateSlavesSeparately(
+        const std::vector<SlaveBatch>& slaveBatches,
+        std::chrono::milliseconds instantiationTimeout,
+        std::chrono::milliseconds requestTimeout,
+        InstantiateSlavesHandler onComplete)
+    {
+        struct State
+        {
+            std::vector<coral::net::SlaveLocator> slaveLocators;
+            std::size_t remaining = 0;
+            std::error_code error;
+            std::string errorMessage;
+            InstantiateSlavesHandler onComplete;
+        };
+        auto state = std::make_shared<State>();
+        for (const auto& batch : slaveBatches) {
+            state->remaining += batch.count;
+        }
+        if (state->remaining == 0) {
+            onComplete(std::error_code{}, nullptr, 0, std::string{});
+            return;
+        }
+        state->slaveLocators.resize(state->remaining);
+        state->onComplete = std::move(onComplete);
+
+        std::size_t index = 0;
+        for (const auto& batch : slaveBatches) {
+            for (int i = 0; i < batch.count; ++i, ++index) {
+                InstantiateSlave(
+                    batch.slaveTypeUUID,
+                    instantiationTimeout,
+                    requestTimeout,
+                    [state, index] (
+                        const std::error_code& ec,
+                        const coral::net::SlaveLocator& slaveLocator,
+                        const std::string& errorMessage)
+                    {
+                        if (ec) {
+                            if (!state->error) {
+                                state->error = ec;
+                                state->errorMessage = errorMessage;
+                            }
+                        } else {
+                            state->slaveLocators[index] = slaveLocator;
+                        }
+                        if (--state->remaining > 0) return;
+                        if (state->error) {
+                            state->onComplete(
+                                state->error, nullptr, 0, state->errorMessage);
+                        } else {
+                            state->onComplete(
+                                std::error_code{},
+                                state->slaveLocators.data(),
+                                state->slaveLocators.size(),
+                                std::string{});
+                        }
+                    });
+            }
+        }
+    }
+
     void OnGetSlaveTypesReply(
+        bool cacheResult,
         GetSlaveTypesHandler completionHandler,
         const std::error_code& ec,
         const char* replyHeader, size_t replyHeaderSize,
@@ -164,12 +337,20 @@ private:
         if (reply == OK_REPLY) {
             coralproto::domain::SlaveTypeList slaveTypeList;
             if (slaveTypeList.ParseFromArray(replyBody, boost::numeric_cast<int>(replyBodySize))) {
-                m_slaveTypes = FromProto(slaveTypeList);
-                m_slaveTypesCached = true; // TODO: Add "expiry date"?
-                completionHandler(
-                    std::error_code{},
-                    m_slaveTypes.data(),
-                    m_slaveTypes.size());
+                auto slaveTypes = FromProto(slaveTypeList);
+                if (cacheResult) {
+                    m_slaveTypes = std::move(slaveTypes);
+                    m_slaveTypesCached = true; // TODO: Add "expiry date"?
+                    completionHandler(
+                        std::error_code{},
+                        m_slaveTypes.data(),
+                        m_slaveTypes.size());
+                } else {
+                    completionHandler(
+                        std::error_code{},
+                        slaveTypes.data(),
+                        slaveTypes.size());
+                }
             } else {
                 completionHandler(
                     make_error_code(std::errc::bad_message),
@@ -227,10 +408,56 @@ private:
             std::string{});
     }
 
+    void OnInstantiateSlavesReply(
+        std::size_t slaveCount,
+        InstantiateSlavesHandler completionHandler,
+        const std::error_code& ec,
+        const char* replyHeader, size_t replyHeaderSize,
+        const char* replyBody, size_t replyBodySize)
+    {
+        if (ec) {
+            completionHandler(ec, nullptr, 0, std::string{});
+            return;
+        }
+        const auto reply = std::string{replyHeader, replyHeaderSize};
+        if (reply == OK_REPLY) {
+            coralproto::domain::InstantiateSlavesReply replyData;
+            if (replyData.ParseFromArray(replyBody, boost::numeric_cast<int>(replyBodySize))
+                && replyData.slave_locator_size() == static_cast<int>(slaveCount))
+            {
+                std::vector<coral::net::SlaveLocator> slaveLocators;
+                for (const auto& sl : replyData.slave_locator()) {
+                    slaveLocators.emplace_back(
+                        MakeSlaveEndpoint(m_address, sl.control_endpoint()),
+                        MakeSlaveEndpoint(m_address, sl.data_pub_endpoint()));
+                }
+                completionHandler(
+                    std::error_code{},
+                    slaveLocators.data(),
+                    slaveLocators.size(),
+                    std::string{});
+                return;
+            } // else fall through to the end of the function
+        } else if (reply == ERROR_REPLY) {
+            completionHandler(
+                make_error_code(coral::error::generic_error::operation_failed),
+                nullptr, 0,
+                std::string{replyBody, replyBodySize});
+            return;
+        }
+        // If we get here, it means we have received bad data.
+        completionHandler(
+            make_error_code(std::errc::bad_message),
+            nullptr, 0,
+            std::string{});
+    }
+
     const std::string m_address;
     coral::net::reqrep::Client m_client;
     bool m_slaveTypesCached = false;
     std::vector<coral::model::SlaveTypeDescription> m_slaveTypes;
+    bool m_maxProtocolVersionKnown = false;
+    std::uint16_t m_maxProtocolVersion = PROTOCOL_VERSION;
 };
 
 
@@ -270,6 +497,20 @@ void SlaveProviderClient::GetSlaveTypes(
 }
 
 
+void SlaveProviderClient::GetSlaveTypeDescriptions(
+    const std::vector<std::string>& slaveTypeUUIDs,
+    bool includeVariables,
+    GetSlaveTypesHandler onComplete,
+    std::chrono::milliseconds timeout)
+{
+    m_private->GetSlaveTypeDescriptions(
+        slaveTypeUUIDs,
+        includeVariables,
+        std::move(onComplete),
+        timeout);
+}
+
+
 void SlaveProviderClient::InstantiateSlave(
     const std::string& slaveTypeUUID,
     std::chrono::milliseconds instantiationTimeout,
@@ -284,6 +525,20 @@ void SlaveProviderClient::InstantiateSlave(
 }
 
 
+void SlaveProviderClient::InstantiateSlaves(
+    const std::vector<SlaveBatch>& slaveBatches,
+    std::chrono::milliseconds instantiationTimeout,
+    std::chrono::milliseconds requestTimeout,
+    InstantiateSlavesHandler onComplete)
+{
+    m_private->InstantiateSlaves(
+        slaveBatches,
+        instantiationTimeout,
+        requestTimeout,
+        std::move(onComplete));
+}
+
+
 // =============================================================================
 // SlaveProviderServerHandler
 // =============================================================================
@@ -342,7 +597,8 @@ public:
         const char*& replyBody, size_t& replyBodySize)
     {
         assert(protocolIdentifier == PROTOCOL_IDENTIFIER);
-        assert(protocolVersion == PROTOCOL_VERSION);
+        assert(protocolVersion == PROTOCOL_VERSION
+            || protocolVersion == BATCH_PROTOCOL_VERSION);
         const auto request = std::string{requestHeader, requestHeaderSize};
         if (request == GET_SLAVE_TYPES_REQUEST) {
             return HandleGetSlaveTypesRequest(
@@ -354,8 +610,15 @@ public:
                 requestBody, requestBodySize,
                 replyHeader, replyHeaderSize,
                 replyBody, replyBodySize);
+        } else if (request == INSTANTIATE_SLAVES_REQUEST
+                && protocolVersion >= BATCH_PROTOCOL_VERSION) {
+            return HandleInstantiateSlavesRequest(
+                requestBody, requestBodySize,
+                replyHeader, replyHeaderSize,
+                replyBody, replyBodySize);
         } else {
-            CORAL_LOG_TRACE("SlaveProviderServerHandler: Ignoring request due to invalid request header");
+            CORAL_LOG_CAT_TRACE(coral::log::bus,
+                "SlaveProviderServerHandler: Ignoring request due to invalid request header");
             return false;
         }
     }
@@ -366,15 +629,29 @@ private:
         const char*& replyHeader, size_t& replyHeaderSize,
         const char*& replyBody, size_t& replyBodySize)
     {
-        if (requestBody != nullptr) {
-            CORAL_LOG_TRACE("SlaveProviderServerHandler: Ignoring request due to unexpected request body");
+        // The request body is optional, and lets the client select which
+        // slave types to describe, and whether to include their variables.
+        coralproto::domain::GetSlaveTypesData args;
+        if (requestBody != nullptr &&
+                !args.ParseFromArray(requestBody, boost::numeric_cast<int>(requestBodySize))) {
+            CORAL_LOG_CAT_TRACE(coral::log::bus,
+                "SlaveProviderServerHandler: Ignoring request due to malformed request body");
             return false;
         }
+        const auto& selected = args.slave_type_uuid();
         coralproto::domain::SlaveTypeList slaveTypeList;
         const int n = m_slaveProvider->GetSlaveTypeCount();
         for (int i = 0; i < n; ++i) {
-            *(slaveTypeList.add_slave_type()->mutable_description()) =
-                coral::protocol::ToProto(m_slaveProvider->GetSlaveType(i));
+            const auto slaveType = m_slaveProvider->GetSlaveType(i);
+            if (!selected.empty() &&
+                    std::find(selected.begin(), selected.end(), slaveType.UUID())
+                        == selected.end()) {
+                continue;
+            }
+            auto pbDescription =
+                slaveTypeList.add_slave_type()->mutable_description();
+            *pbDescription = coral::protocol::ToProto(slaveType);
+            if (args.omit_variables()) pbDescription->clear_variable();
         }
         m_replyBodyBuffer = slaveTypeList.SerializeAsString();
 
@@ -391,12 +668,14 @@ private:
         const char*& replyBody, size_t& replyBodySize)
     {
         if (requestBody == nullptr) {
-            CORAL_LOG_TRACE("SlaveProviderServerHandler: Ignoring request due to missing request body");
+            CORAL_LOG_CAT_TRACE(coral::log::bus,
+                "SlaveProviderServerHandler: Ignoring request due to missing request body");
             return false;
         }
         coralproto::domain::InstantiateSlaveData args;
         if (!args.ParseFromArray(requestBody, boost::numeric_cast<int>(requestBodySize))) {
-            CORAL_LOG_TRACE("SlaveProviderServerHandler: Ignoring request due to malformed request body");
+            CORAL_LOG_CAT_TRACE(coral::log::bus,
+                "SlaveProviderServerHandler: Ignoring request due to malformed request body");
             return false;
         }
         try {
@@ -424,6 +703,52 @@ private:
         return true;
     }
 
+    bool HandleInstantiateSlavesRequest(
+        const char* requestBody, size_t requestBodySize,
+        const char*& replyHeader, size_t& replyHeaderSize,
+        const char*& replyBody, size_t& replyBodySize)
+    {
+        if (requestBody == nullptr) {
+            CORAL_LOG_CAT_TRACE(coral::log::bus,
+                "SlaveProviderServerHandler: Ignoring request due to missing request body");
+            return false;
+        }
+        coralproto::domain::InstantiateSlavesData args;
+        if (!args.ParseFromArray(requestBody, boost::numeric_cast<int>(requestBodySize))) {
+            CORAL_LOG_CAT_TRACE(coral::log::bus,
+                "SlaveProviderServerHandler: Ignoring request due to malformed request body");
+            return false;
+        }
+        try {
+            std::vector<SlaveBatch> slaveBatches;
+            for (const auto& b : args.slave_batch()) {
+                if (b.count() < 0) throw std::runtime_error("Invalid slave count");
+                slaveBatches.push_back(SlaveBatch{b.slave_type_uuid(), b.count()});
+            }
+            const auto slaveLocators = m_slaveProvider->InstantiateSlaves(
+                slaveBatches,
+                std::chrono::milliseconds(args.timeout_ms()));
+            replyHeader = OK_REPLY.data();
+            replyHeaderSize = OK_REPLY.size();
+            coralproto::domain::InstantiateSlavesReply data;
+            for (const auto& slaveLocator : slaveLocators) {
+                auto pbLocator = data.add_slave_locator();
+                pbLocator->set_control_endpoint(slaveLocator.ControlEndpoint().URL());
+                pbLocator->set_data_pub_endpoint(slaveLocator.DataPubEndpoint().URL());
+            }
+            m_replyBodyBuffer = data.SerializeAsString();
+        } catch (const std::runtime_error& e) {
+             replyHeader = ERROR_REPLY.data();
+             replyHeaderSize = ERROR_REPLY.size();
+             m_replyBodyBuffer = e.what();
+        }
+        assert(replyHeader != nullptr);
+        assert(replyHeaderSize > 0);
+        replyBody = m_replyBodyBuffer.data();
+        replyBodySize = m_replyBodyBuffer.size();
+        return true;
+    }
+
     std::shared_ptr<SlaveProviderOps> m_slaveProvider;
     std::string m_replyBodyBuffer;
 };
@@ -483,10 +808,10 @@ void MakeSlaveProviderServer(
     coral::net::reqrep::Server& server,
     std::shared_ptr<SlaveProviderOps> slaveProvider)
 {
-    server.AddProtocolHandler(
-        PROTOCOL_IDENTIFIER,
-        PROTOCOL_VERSION,
-        std::make_shared<SlaveProviderServerHandler>(slaveProvider));
+    const auto handler =
+        std::make_shared<SlaveProviderServerHandler>(slaveProvider);
+    server.AddProtocolHandler(PROTOCOL_IDENTIFIER, PROTOCOL_VERSION, handler);
+    server.AddProtocolHandler(PROTOCOL_IDENTIFIER, BATCH_PROTOCOL_VERSION, handler);
 }
 
 
@@ -18,7 +18,12 @@ namespace bus
 
 SlaveSetup::SlaveSetup()
     : startTime(std::numeric_limits<coral::model::TimePoint>::signaling_NaN()),
-      stopTime(std::numeric_limits<coral::model::TimePoint>::signaling_NaN())
+      stopTime(std::numeric_limits<coral::model::TimePoint>::signaling_NaN()),
+      deltaPublication(false),
+      traceClockOffset(0),
+      supportsAggregation(false),
+      supportsTransforms(false),
+      supportsDeltaPublication(false)
 {
 }
 
@@ -31,7 +36,12 @@ SlaveSetup::SlaveSetup(
     : startTime(startTime_),
       stopTime(stopTime_),
       executionName(executionName_),
-      variableRecvTimeout(variableRecvTimeout_)
+      variableRecvTimeout(variableRecvTimeout_),
+      deltaPublication(false),
+      traceClockOffset(0),
+      supportsAggregation(false),
+      supportsTransforms(false),
+      supportsDeltaPublication(false)
 {
     assert(startTime <= stopTime);
 }
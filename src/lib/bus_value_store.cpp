@@ -0,0 +1,162 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/bus/value_store.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+
+namespace coral
+{
+namespace bus
+{
+
+
+ValueStore::ValueStore() noexcept
+    : m_booleanCount(0)
+    , m_booleanCapacity(0)
+{
+}
+
+
+ValueStore::ValueStore(ValueStore&& other) noexcept
+    : m_reals(std::move(other.m_reals))
+    , m_integers(std::move(other.m_integers))
+    , m_booleans(std::move(other.m_booleans))
+    , m_booleanCount(other.m_booleanCount)
+    , m_booleanCapacity(other.m_booleanCapacity)
+    , m_strings(std::move(other.m_strings))
+{
+    other.m_booleanCount = 0;
+    other.m_booleanCapacity = 0;
+}
+
+
+ValueStore& ValueStore::operator=(ValueStore&& other) noexcept
+{
+    m_reals = std::move(other.m_reals);
+    m_integers = std::move(other.m_integers);
+    m_booleans = std::move(other.m_booleans);
+    m_booleanCount = other.m_booleanCount;
+    m_booleanCapacity = other.m_booleanCapacity;
+    m_strings = std::move(other.m_strings);
+    other.m_booleanCount = 0;
+    other.m_booleanCapacity = 0;
+    return *this;
+}
+
+
+ValueSlot ValueStore::Add(coral::model::DataType dataType)
+{
+    const auto index = Size(dataType);
+    Resize(dataType, index + 1);
+    return ValueSlot{dataType, index};
+}
+
+
+void ValueStore::Resize(coral::model::DataType dataType, std::size_t size)
+{
+    switch (dataType) {
+        case coral::model::REAL_DATATYPE:
+            m_reals.resize(size);
+            break;
+        case coral::model::INTEGER_DATATYPE:
+            m_integers.resize(size);
+            break;
+        case coral::model::BOOLEAN_DATATYPE:
+            if (size > m_booleanCapacity) {
+                const auto capacity = std::max(size, 2 * m_booleanCapacity);
+                auto booleans = std::make_unique<bool[]>(capacity);
+                std::copy(m_booleans.get(), m_booleans.get() + m_booleanCount, booleans.get());
+                m_booleans = std::move(booleans);
+                m_booleanCapacity = capacity;
+            } else if (size > m_booleanCount) {
+                std::fill(m_booleans.get() + m_booleanCount, m_booleans.get() + size, false);
+            }
+            m_booleanCount = size;
+            break;
+        case coral::model::STRING_DATATYPE:
+            m_strings.resize(size);
+            break;
+        default:
+            throw std::invalid_argument("Invalid data type");
+    }
+}
+
+
+std::size_t ValueStore::Size(coral::model::DataType dataType) const noexcept
+{
+    switch (dataType) {
+        case coral::model::REAL_DATATYPE:       return m_reals.size();
+        case coral::model::INTEGER_DATATYPE:    return m_integers.size();
+        case coral::model::BOOLEAN_DATATYPE:    return m_booleanCount;
+        case coral::model::STRING_DATATYPE:     return m_strings.size();
+        default:                                return 0;
+    }
+}
+
+
+void ValueStore::Clear() noexcept
+{
+    m_reals.clear();
+    m_integers.clear();
+    m_booleanCount = 0;
+    m_strings.clear();
+}
+
+
+coral::model::ScalarValue ValueStore::Get(ValueSlot slot) const
+{
+    CheckSlot(slot);
+    switch (slot.dataType) {
+        case coral::model::REAL_DATATYPE:       return m_reals[slot.index];
+        case coral::model::INTEGER_DATATYPE:    return m_integers[slot.index];
+        case coral::model::BOOLEAN_DATATYPE:    return m_booleans[slot.index];
+        case coral::model::STRING_DATATYPE:     return m_strings[slot.index];
+        default:
+            assert (!"CheckSlot() should have caught this");
+            return coral::model::ScalarValue();
+    }
+}
+
+
+void ValueStore::Set(ValueSlot slot, const coral::model::ScalarValue& value)
+{
+    CheckSlot(slot);
+    if (coral::model::DataTypeOf(value) != slot.dataType) {
+        throw std::invalid_argument("Value has wrong data type for slot");
+    }
+    switch (slot.dataType) {
+        case coral::model::REAL_DATATYPE:
+            m_reals[slot.index] = boost::get<double>(value);
+            break;
+        case coral::model::INTEGER_DATATYPE:
+            m_integers[slot.index] = boost::get<int>(value);
+            break;
+        case coral::model::BOOLEAN_DATATYPE:
+            m_booleans[slot.index] = boost::get<bool>(value);
+            break;
+        case coral::model::STRING_DATATYPE:
+            m_strings[slot.index] = boost::get<std::string>(value);
+            break;
+        default:
+            assert (!"CheckSlot() should have caught this");
+    }
+}
+
+
+void ValueStore::CheckSlot(ValueSlot slot) const
+{
+    if (slot.index >= Size(slot.dataType)) {
+        throw std::out_of_range("Invalid value slot");
+    }
+}
+
+
+}} // namespace
@@ -0,0 +1,66 @@
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include <coral/bus/value_store.hpp>
+
+
+using namespace coral::bus;
+
+
+TEST(coral_bus, ValueStore)
+{
+    ValueStore store;
+    EXPECT_EQ(0U, store.Size(coral::model::REAL_DATATYPE));
+
+    const auto r0 = store.Add(coral::model::REAL_DATATYPE);
+    const auto r1 = store.Add(coral::model::REAL_DATATYPE);
+    const auto i0 = store.Add(coral::model::INTEGER_DATATYPE);
+    const auto b0 = store.Add(coral::model::BOOLEAN_DATATYPE);
+    const auto s0 = store.Add(coral::model::STRING_DATATYPE);
+    EXPECT_EQ(coral::model::REAL_DATATYPE, r1.dataType);
+    EXPECT_EQ(0U, r0.index);
+    EXPECT_EQ(1U, r1.index);
+    EXPECT_EQ(0U, i0.index);
+    EXPECT_EQ(2U, store.Size(coral::model::REAL_DATATYPE));
+    EXPECT_EQ(1U, store.Size(coral::model::BOOLEAN_DATATYPE));
+
+    // New slots are zero-initialised
+    EXPECT_EQ(0.0, store.Reals()[1]);
+    EXPECT_EQ(0, store.Integers()[0]);
+    EXPECT_FALSE(store.Booleans()[0]);
+    EXPECT_TRUE(store.Strings()[0].empty());
+
+    // The arrays and the ScalarValue interface refer to the same values
+    store.Reals()[1] = 2.5;
+    store.Booleans()[0] = true;
+    EXPECT_EQ(2.5, boost::get<double>(store.Get(r1)));
+    EXPECT_TRUE(boost::get<bool>(store.Get(b0)));
+    store.Set(i0, 42);
+    store.Set(s0, std::string("foo"));
+    EXPECT_EQ(42, store.Integers()[0]);
+    EXPECT_EQ("foo", store.Strings()[0]);
+    EXPECT_THROW(store.Set(i0, 1.0), std::invalid_argument);
+    EXPECT_THROW(store.Get(ValueSlot{coral::model::INTEGER_DATATYPE, 1}), std::out_of_range);
+    EXPECT_THROW(store.Get(ValueSlot{}), std::out_of_range);
+
+    // Resizing keeps existing values, and growing the boolean array
+    // repeatedly works like the others.
+    for (int i = 0; i < 100; ++i) store.Add(coral::model::BOOLEAN_DATATYPE);
+    EXPECT_EQ(101U, store.Size(coral::model::BOOLEAN_DATATYPE));
+    EXPECT_TRUE(store.Booleans()[0]);
+    EXPECT_FALSE(store.Booleans()[100]);
+    store.Resize(coral::model::BOOLEAN_DATATYPE, 1);
+    store.Resize(coral::model::BOOLEAN_DATATYPE, 2);
+    EXPECT_TRUE(store.Booleans()[0]);
+    EXPECT_FALSE(store.Booleans()[1]);
+
+    auto moved = std::move(store);
+    EXPECT_EQ(2.5, moved.Reals()[1]);
+    EXPECT_EQ(2U, moved.Size(coral::model::BOOLEAN_DATATYPE));
+    moved.Clear();
+    EXPECT_EQ(0U, moved.Size(coral::model::REAL_DATATYPE));
+    EXPECT_EQ(0U, moved.Size(coral::model::BOOLEAN_DATATYPE));
+}
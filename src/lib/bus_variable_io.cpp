@@ -6,11 +6,13 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <coral/bus/variable_io.hpp>
 
+#include <algorithm>
 #include <utility>
 #include <zmq.hpp>
 
 #include <coral/error.hpp>
 #include <coral/log.hpp>
+#include <coral/metrics.hpp>
 #include <coral/net/zmqx.hpp>
 #include <coral/protocol/exe_data.hpp>
 
@@ -29,6 +31,79 @@ namespace
                 state ? "Not connected" : "Already connected");
         }
     }
+
+    std::size_t TotalSize(const std::vector<zmq::message_t>& msg)
+    {
+        std::size_t size = 0;
+        for (const auto& part : msg) size += part.size();
+        return size;
+    }
+
+    struct VariableMetrics
+    {
+        coral::metrics::Counter& publishedMessages = coral::metrics::GetCounter(
+            "coral_data_published_messages_total",
+            "Number of variable value messages published");
+        coral::metrics::Counter& publishedBytes = coral::metrics::GetCounter(
+            "coral_data_published_bytes_total",
+            "Size of variable value messages published");
+        coral::metrics::Counter& receivedMessages = coral::metrics::GetCounter(
+            "coral_data_received_messages_total",
+            "Number of variable value messages received");
+        coral::metrics::Counter& receivedBytes = coral::metrics::GetCounter(
+            "coral_data_received_bytes_total",
+            "Size of variable value messages received");
+        coral::metrics::Counter& unchangedValues = coral::metrics::GetCounter(
+            "coral_data_unchanged_values_total",
+            "Number of variable values left out of publication because they had not changed");
+        coral::metrics::Gauge& queuedValues = coral::metrics::GetGauge(
+            "coral_data_queued_values",
+            "Number of received variable values waiting to be used");
+    };
+
+    // Stores the indices of the elements in `values` which differ from the
+    // ones in `published` (or of all elements, if `all` is true) in
+    // `changed`, and updates `published`.
+    //
+    // The comparison is a separate pass which only stores a flag per
+    // element in `mask`, so that it has no branches and can be vectorised
+    // for the arithmetic types.  The indices are collected from the mask
+    // afterwards.
+    template<typename T>
+    void FindChanges(
+        const T* values,
+        T* published,
+        std::size_t count,
+        bool all,
+        std::vector<unsigned char>& mask,
+        std::vector<std::size_t>& changed)
+    {
+        changed.clear();
+        if (all) {
+            for (std::size_t i = 0; i < count; ++i) changed.push_back(i);
+        } else {
+            mask.resize(count);
+            const auto m = mask.data();
+            for (std::size_t i = 0; i < count; ++i) {
+                m[i] = values[i] != published[i];
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                if (m[i]) changed.push_back(i);
+            }
+        }
+        for (const auto i : changed) published[i] = values[i];
+    }
+
+    bool SameSlot(coral::bus::ValueSlot a, coral::bus::ValueSlot b)
+    {
+        return a.dataType == b.dataType && a.index == b.index;
+    }
+
+    VariableMetrics& Metrics()
+    {
+        static VariableMetrics metrics;
+        return metrics;
+    }
 }
 
 
@@ -77,7 +152,104 @@ void VariablePublisher::Publish(
     };
     std::vector<zmq::message_t> d;
     coral::protocol::exe_data::CreateMessage(m, d);
+    const auto size = TotalSize(d);
     coral::net::zmqx::Send(*m_socket, d);
+    Metrics().publishedMessages.Increment();
+    Metrics().publishedBytes.Increment(size);
+}
+
+
+void VariablePublisher::Publish(
+    coral::model::StepID stepID,
+    coral::model::SlaveID slaveID,
+    coral::model::DataType dataType,
+    const coral::model::VariableID* variables,
+    const ValueStore& values)
+{
+    EnforceConnected(m_socket, true);
+    std::vector<zmq::message_t> d;
+    const auto count = values.Size(dataType);
+    for (std::size_t i = 0; i < count; ++i) {
+        coral::protocol::exe_data::CreateMessage(
+            coral::model::Variable(slaveID, variables[i]),
+            stepID,
+            values,
+            ValueSlot{dataType, i},
+            d);
+        const auto size = TotalSize(d);
+        coral::net::zmqx::Send(*m_socket, d);
+        Metrics().publishedMessages.Increment();
+        Metrics().publishedBytes.Increment(size);
+    }
+}
+
+
+void VariablePublisher::PublishChanges(
+    coral::model::StepID stepID,
+    coral::model::SlaveID slaveID,
+    coral::model::DataType dataType,
+    const coral::model::VariableID* variables,
+    const ValueStore& values)
+{
+    EnforceConnected(m_socket, true);
+    const auto count = values.Size(dataType);
+    const bool all = m_published.Size(dataType) != count;
+    if (all) m_published.Resize(dataType, count);
+    switch (dataType) {
+        case coral::model::REAL_DATATYPE:
+            FindChanges(values.Reals(), m_published.Reals(),
+                count, all, m_changeMask, m_changed);
+            break;
+        case coral::model::INTEGER_DATATYPE:
+            FindChanges(values.Integers(), m_published.Integers(),
+                count, all, m_changeMask, m_changed);
+            break;
+        case coral::model::BOOLEAN_DATATYPE:
+            FindChanges(values.Booleans(), m_published.Booleans(),
+                count, all, m_changeMask, m_changed);
+            break;
+        case coral::model::STRING_DATATYPE:
+            FindChanges(values.Strings(), m_published.Strings(),
+                count, all, m_changeMask, m_changed);
+            break;
+        default:
+            throw std::invalid_argument("Invalid data type");
+    }
+
+    std::vector<zmq::message_t> d;
+    for (const auto i : m_changed) {
+        coral::protocol::exe_data::CreateMessage(
+            coral::model::Variable(slaveID, variables[i]),
+            stepID,
+            values,
+            ValueSlot{dataType, i},
+            d);
+        const auto size = TotalSize(d);
+        coral::net::zmqx::Send(*m_socket, d);
+        Metrics().publishedMessages.Increment();
+        Metrics().publishedBytes.Increment(size);
+    }
+    Metrics().unchangedValues.Increment(count - m_changed.size());
+}
+
+
+void VariablePublisher::PublishStepComplete(
+    coral::model::StepID stepID,
+    coral::model::SlaveID slaveID)
+{
+    EnforceConnected(m_socket, true);
+    std::vector<zmq::message_t> d;
+    coral::protocol::exe_data::CreateStepCompleteMessage(slaveID, stepID, d);
+    const auto size = TotalSize(d);
+    coral::net::zmqx::Send(*m_socket, d);
+    Metrics().publishedMessages.Increment();
+    Metrics().publishedBytes.Increment(size);
+}
+
+
+void VariablePublisher::ForgetPublishedValues() noexcept
+{
+    m_published.Clear();
 }
 
 
@@ -88,6 +260,7 @@ void VariablePublisher::Publish(
 
 VariableSubscriber::VariableSubscriber()
     : m_currentStepID(coral::model::INVALID_STEP_ID)
+    , m_slotRevision(0)
 { }
 
 
@@ -106,6 +279,10 @@ void VariableSubscriber::Connect(
         for (const auto& variable : m_values) {
             coral::protocol::exe_data::Subscribe(*m_socket, variable.first);
         }
+        for (const auto& publisher : m_publishers) {
+            coral::protocol::exe_data::Subscribe(*m_socket, coral::model::Variable(
+                publisher.first, coral::protocol::exe_data::STEP_COMPLETE_VARIABLE_ID));
+        }
     } catch (...) {
         m_socket.reset();
         throw;
@@ -117,7 +294,19 @@ void VariableSubscriber::Subscribe(const coral::model::Variable& variable)
 {
     EnforceConnected(m_socket, true);
     coral::protocol::exe_data::Subscribe(*m_socket, variable);
-    m_values.insert(std::make_pair(variable, ValueQueue()));
+    const auto inserted = m_values.insert(std::make_pair(
+        variable,
+        Entry{ValueSlot{}, false, coral::model::INVALID_STEP_ID, ValueQueue()}));
+    if (!inserted.second) return;
+
+    // Also listen for "step complete" messages from the slave.
+    const auto publisher = m_publishers.insert(std::make_pair(
+        variable.Slave(),
+        Publisher{0, coral::model::INVALID_STEP_ID})).first;
+    if (publisher->second.subscriptionCount++ == 0) {
+        coral::protocol::exe_data::Subscribe(*m_socket, coral::model::Variable(
+            variable.Slave(), coral::protocol::exe_data::STEP_COMPLETE_VARIABLE_ID));
+    }
 }
 
 
@@ -126,6 +315,13 @@ void VariableSubscriber::Unsubscribe(const coral::model::Variable& variable)
     EnforceConnected(m_socket, true);
     if (m_values.erase(variable)) {
         coral::protocol::exe_data::Unsubscribe(*m_socket, variable);
+        const auto publisher = m_publishers.find(variable.Slave());
+        assert(publisher != m_publishers.end());
+        if (--publisher->second.subscriptionCount == 0) {
+            m_publishers.erase(publisher);
+            coral::protocol::exe_data::Unsubscribe(*m_socket, coral::model::Variable(
+                variable.Slave(), coral::protocol::exe_data::STEP_COMPLETE_VARIABLE_ID));
+        }
     }
 }
 
@@ -137,46 +333,142 @@ bool VariableSubscriber::Update(
     CORAL_PRECONDITION_CHECK(stepID >= m_currentStepID);
     m_currentStepID = stepID;
 
+    std::size_t storeSize = 0;
+    for (const auto dataType : {
+            coral::model::REAL_DATATYPE, coral::model::INTEGER_DATATYPE,
+            coral::model::BOOLEAN_DATATYPE, coral::model::STRING_DATATYPE}) {
+        storeSize += m_store.Size(dataType);
+    }
+    if (storeSize > 2 * m_values.size() + 16) CompactStore();
+
     std::vector<zmq::message_t> rawMsg;
-    for (auto& entry : m_values) {
-        auto& valQueue = entry.second;
-        // Pop off old data
-        while (!valQueue.empty() && valQueue.front().first < m_currentStepID) {
-            valQueue.pop();
+    for (auto& e : m_values) {
+        auto& entry = e.second;
+        // Drop old data, and use queued data if we have any
+        if (entry.hasValue && entry.stepID < m_currentStepID) {
+            entry.hasValue = false;
+        }
+        while (!entry.hasValue && !entry.laterValues.empty()) {
+            const auto& queued = entry.laterValues.front();
+            if (queued.first >= m_currentStepID) {
+                const auto dataType = coral::model::DataTypeOf(queued.second);
+                if (entry.slot.dataType != dataType
+                        || entry.slot.index >= m_store.Size(dataType)) {
+                    entry.slot = m_store.Add(dataType);
+                    ++m_slotRevision;
+                }
+                m_store.Set(entry.slot, queued.second);
+                entry.stepID = queued.first;
+                entry.hasValue = true;
+            }
+            entry.laterValues.pop();
         }
         // If necessary, wait for new data
-        while (valQueue.empty()) {
+        const auto& publisher = m_publishers.at(e.first.Slave());
+        while (!entry.hasValue) {
+            // If the slave has published all its values for this step
+            // without this one, it is unchanged.
+            if (publisher.completedStepID >= m_currentStepID
+                    && entry.slot.index < m_store.Size(entry.slot.dataType)) {
+                entry.stepID = m_currentStepID;
+                entry.hasValue = true;
+                break;
+            }
             if (!coral::net::zmqx::WaitForIncoming(*m_socket, timeout)) {
-                CORAL_LOG_DEBUG(
+                CORAL_LOG_CAT_DEBUG(coral::log::net,
                     boost::format("Timeout waiting for variable %d from slave %d")
-                    % entry.first.ID() % entry.first.Slave());
+                    % e.first.ID() % e.first.Slave());
                 return false;
             }
             coral::net::zmqx::Receive(*m_socket, rawMsg);
-            const auto msg = coral::protocol::exe_data::ParseMessage(rawMsg);
-            // Queue the variable value iff it is from the current (or a newer)
-            // timestep and it is one we're listening for. (Wrt. the latter,
-            // unsubscriptions may take time to come into effect.)
-            if (msg.timestepID >= m_currentStepID) {
-                auto it = m_values.find(msg.variable);
-                if (it != m_values.end()) {
-                    it->second.emplace(msg.timestepID, msg.value);
+            Metrics().receivedMessages.Increment();
+            Metrics().receivedBytes.Increment(TotalSize(rawMsg));
+            // Use the variable value iff it is one we're listening for
+            // (unsubscriptions may take time to come into effect) and it is
+            // from the current (or a newer) timestep.  Values are stored
+            // directly in m_store, unless there is already a current value,
+            // in which case the new one is queued.
+            const auto variable = coral::protocol::exe_data::ParseVariable(rawMsg);
+            if (variable.ID() == coral::protocol::exe_data::STEP_COMPLETE_VARIABLE_ID) {
+                const auto p = m_publishers.find(variable.Slave());
+                if (p != m_publishers.end()) {
+                    p->second.completedStepID = std::max(
+                        p->second.completedStepID,
+                        coral::protocol::exe_data::ParseStepCompleteMessage(rawMsg));
+                }
+                continue;
+            }
+            auto it = m_values.find(variable);
+            if (it == m_values.end()) continue;
+            auto& target = it->second;
+            if (target.hasValue) {
+                const auto msg = coral::protocol::exe_data::ParseMessage(rawMsg);
+                if (msg.timestepID >= m_currentStepID) {
+                    target.laterValues.emplace(msg.timestepID, msg.value);
+                }
+            } else {
+                const auto oldSlot = target.slot;
+                const auto valueStepID =
+                    coral::protocol::exe_data::ParseValue(rawMsg, m_store, target.slot);
+                if (!SameSlot(target.slot, oldSlot)) ++m_slotRevision;
+                if (valueStepID >= m_currentStepID) {
+                    target.stepID = valueStepID;
+                    target.hasValue = true;
                 }
             }
         }
     }
+
+    std::size_t queued = 0;
+    for (const auto& entry : m_values) {
+        queued += entry.second.laterValues.size() + (entry.second.hasValue ? 1 : 0);
+    }
+    Metrics().queuedValues.Set(static_cast<double>(queued));
     return true;
 }
 
 
-const coral::model::ScalarValue& VariableSubscriber::Value(
+coral::model::ScalarValue VariableSubscriber::Value(
    const coral::model::Variable& variable) const
 {
-    const auto& valQueue = m_values.at(variable);
-    if (valQueue.empty()) {
+    return m_store.Get(Slot(variable));
+}
+
+
+ValueSlot VariableSubscriber::Slot(const coral::model::Variable& variable) const
+{
+    const auto& entry = m_values.at(variable);
+    if (!entry.hasValue) {
         throw std::logic_error("Variable not updated yet");
     }
-    return valQueue.front().second;
+    return entry.slot;
+}
+
+
+const ValueStore& VariableSubscriber::Values() const
+{
+    return m_store;
+}
+
+
+std::uint64_t VariableSubscriber::SlotRevision() const
+{
+    return m_slotRevision;
+}
+
+
+void VariableSubscriber::CompactStore()
+{
+    ValueStore store;
+    for (auto& e : m_values) {
+        auto& entry = e.second;
+        if (entry.slot.index >= m_store.Size(entry.slot.dataType)) continue;
+        const auto slot = store.Add(entry.slot.dataType);
+        store.Set(slot, m_store.Get(entry.slot));
+        entry.slot = slot;
+    }
+    m_store = std::move(store);
+    ++m_slotRevision;
 }
 
 }} // header guard
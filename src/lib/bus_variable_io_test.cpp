@@ -100,6 +100,142 @@ TEST(coral_bus, VariablePublishSubscribe)
 }
 
 
+TEST(coral_bus, VariablePublishSubscribe_ValueStore)
+{
+    const coral::model::SlaveID slaveID = 1;
+    const coral::model::VariableID realIDs[] = { 10, 11 };
+    const coral::model::VariableID stringIDs[] = { 20 };
+    const auto realX = coral::model::Variable(slaveID, realIDs[0]);
+    const auto realY = coral::model::Variable(slaveID, realIDs[1]);
+    const auto stringZ = coral::model::Variable(slaveID, stringIDs[0]);
+
+    auto pub = coral::bus::VariablePublisher();
+    pub.Bind(coral::net::Endpoint{"tcp://*:*"});
+    auto inetEndpoint = coral::net::ip::Endpoint{pub.BoundEndpoint().Address()};
+    inetEndpoint.SetAddress(coral::net::ip::Address{"localhost"});
+    const auto endpoint = inetEndpoint.ToEndpoint("tcp");
+
+    auto sub = coral::bus::VariableSubscriber();
+    sub.Connect(&endpoint, 1);
+    sub.Subscribe(realX);
+    sub.Subscribe(realY);
+    sub.Subscribe(stringZ);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    coral::bus::ValueStore out;
+    out.Resize(coral::model::REAL_DATATYPE, 2);
+    out.Resize(coral::model::STRING_DATATYPE, 1);
+    out.Reals()[0] = 1.0;
+    out.Reals()[1] = 2.0;
+    out.Strings()[0] = "foo";
+
+    coral::model::StepID t = 0;
+    pub.Publish(t, slaveID, coral::model::REAL_DATATYPE, realIDs, out);
+    pub.Publish(t, slaveID, coral::model::STRING_DATATYPE, stringIDs, out);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    const auto slotX = sub.Slot(realX);
+    const auto slotY = sub.Slot(realY);
+    const auto slotZ = sub.Slot(stringZ);
+    EXPECT_EQ(coral::model::REAL_DATATYPE, slotX.dataType);
+    EXPECT_EQ(coral::model::STRING_DATATYPE, slotZ.dataType);
+    EXPECT_EQ(1.0, sub.Values().Reals()[slotX.index]);
+    EXPECT_EQ(2.0, sub.Values().Reals()[slotY.index]);
+    EXPECT_EQ("foo", sub.Values().Strings()[slotZ.index]);
+    EXPECT_EQ(2.0, boost::get<double>(sub.Value(realY)));
+
+    // The slots stay put as long as the types don't change.
+    const auto revision = sub.SlotRevision();
+    ++t;
+    out.Reals()[0] = 3.0;
+    pub.Publish(t, slaveID, coral::model::REAL_DATATYPE, realIDs, out);
+    pub.Publish(t, slaveID, coral::model::STRING_DATATYPE, stringIDs, out);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(revision, sub.SlotRevision());
+    EXPECT_EQ(3.0, sub.Values().Reals()[slotX.index]);
+
+    // ...and move when they do.
+    ++t;
+    pub.Publish(t, slaveID, realIDs[0], 7);
+    coral::bus::ValueStore yOnly;
+    yOnly.Add(coral::model::REAL_DATATYPE);
+    pub.Publish(t, slaveID, coral::model::REAL_DATATYPE, realIDs + 1, yOnly);
+    pub.Publish(t, slaveID, coral::model::STRING_DATATYPE, stringIDs, out);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_NE(revision, sub.SlotRevision());
+    EXPECT_EQ(coral::model::INTEGER_DATATYPE, sub.Slot(realX).dataType);
+    EXPECT_EQ(7, sub.Values().Integers()[sub.Slot(realX).index]);
+}
+
+
+TEST(coral_bus, VariablePublishSubscribe_Delta)
+{
+    const coral::model::SlaveID slaveID = 1;
+    const coral::model::VariableID realIDs[] = { 10, 11 };
+    const auto realX = coral::model::Variable(slaveID, realIDs[0]);
+    const auto realY = coral::model::Variable(slaveID, realIDs[1]);
+
+    auto pub = coral::bus::VariablePublisher();
+    pub.Bind(coral::net::Endpoint{"tcp://*:*"});
+    auto inetEndpoint = coral::net::ip::Endpoint{pub.BoundEndpoint().Address()};
+    inetEndpoint.SetAddress(coral::net::ip::Address{"localhost"});
+    const auto endpoint = inetEndpoint.ToEndpoint("tcp");
+
+    auto sub = coral::bus::VariableSubscriber();
+    sub.Connect(&endpoint, 1);
+    sub.Subscribe(realX);
+    sub.Subscribe(realY);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    coral::bus::ValueStore out;
+    out.Resize(coral::model::REAL_DATATYPE, 2);
+    out.Reals()[0] = 1.0;
+    out.Reals()[1] = 2.0;
+
+    // The first time, all values are published.
+    coral::model::StepID t = 0;
+    pub.PublishChanges(t, slaveID, coral::model::REAL_DATATYPE, realIDs, out);
+    pub.PublishStepComplete(t, slaveID);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(1.0, boost::get<double>(sub.Value(realX)));
+    EXPECT_EQ(2.0, boost::get<double>(sub.Value(realY)));
+
+    // Afterwards, only the changed ones are, and the subscriber keeps the
+    // previous values of the others.
+    ++t;
+    out.Reals()[1] = 3.0;
+    pub.PublishChanges(t, slaveID, coral::model::REAL_DATATYPE, realIDs, out);
+    EXPECT_FALSE(sub.Update(t, std::chrono::milliseconds(1)));
+    pub.PublishStepComplete(t, slaveID);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(1.0, boost::get<double>(sub.Value(realX)));
+    EXPECT_EQ(3.0, boost::get<double>(sub.Value(realY)));
+
+    // Nothing changed.
+    ++t;
+    pub.PublishChanges(t, slaveID, coral::model::REAL_DATATYPE, realIDs, out);
+    pub.PublishStepComplete(t, slaveID);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(1.0, boost::get<double>(sub.Value(realX)));
+    EXPECT_EQ(3.0, boost::get<double>(sub.Value(realY)));
+
+    // A new subscriber doesn't have any previous values, so it has to wait
+    // until the publisher forgets what it has published.
+    auto sub2 = coral::bus::VariableSubscriber();
+    sub2.Connect(&endpoint, 1);
+    sub2.Subscribe(realX);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ++t;
+    pub.PublishChanges(t, slaveID, coral::model::REAL_DATATYPE, realIDs, out);
+    pub.PublishStepComplete(t, slaveID);
+    EXPECT_FALSE(sub2.Update(t, std::chrono::milliseconds(100)));
+    pub.ForgetPublishedValues();
+    pub.PublishChanges(t, slaveID, coral::model::REAL_DATATYPE, realIDs, out);
+    pub.PublishStepComplete(t, slaveID);
+    ASSERT_TRUE(sub2.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(1.0, boost::get<double>(sub2.Value(realX)));
+}
+
+
 TEST(coral_bus, VariablePublishSubscribePerformance)
 {
     const int VAR_COUNT = 5000;
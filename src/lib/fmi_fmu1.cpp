@@ -14,6 +14,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <mutex>
 #include <stdexcept>
 #include <unordered_map>
+#include <utility>
 
 #include <boost/numeric/conversion/cast.hpp>
 #include <fmilib.h>
@@ -66,6 +67,13 @@ FMU1::FMU1(
         variables.push_back(
             ToVariable(var, boost::numeric_cast<coral::model::VariableID>(i)));
     }
+    m_valueReferenceTables.resize(VARIABLE_GROUP_COUNT);
+    for (const auto& v : variables) {
+        auto& table = m_valueReferenceTables[
+            VariableGroupIndex(v.Causality(), v.DataType())];
+        table.variables.push_back(v.ID());
+        table.valueReferences.push_back(m_valueReferences[v.ID()]);
+    }
     m_description = std::make_unique<coral::model::SlaveTypeDescription>(
         std::string(fmi1_import_get_model_name(m_handle)),
         std::string(fmi1_import_get_GUID(m_handle)),
@@ -133,6 +141,7 @@ std::shared_ptr<SlaveInstance1> FMU1::InstantiateSlave1()
     if (isSingleton && !m_instances.empty()) {
         throw std::runtime_error("FMU can only be instantiated once");
     }
+    m_importer->CompleteUnpacking(*this);
     auto instance =
         std::shared_ptr<SlaveInstance1>(new SlaveInstance1(shared_from_this()));
     m_instances.push_back(instance);
@@ -153,6 +162,14 @@ fmi1_value_reference_t FMU1::FMIValueReference(coral::model::VariableID variable
 }
 
 
+const FMU1::ValueReferenceTable& FMU1::ValueReferences(
+    coral::model::Causality causality,
+    coral::model::DataType dataType) const
+{
+    return m_valueReferenceTables[VariableGroupIndex(causality, dataType)];
+}
+
+
 fmi1_import_t* FMU1::FmilibHandle() const
 {
     return m_handle;
@@ -167,7 +184,7 @@ namespace
 {
     void StepFinishedPlaceholder(fmi1_component_t, fmi1_status_t)
     {
-        CORAL_LOG_DEBUG("FMU instance completed asynchronous step, "
+        CORAL_LOG_CAT_DEBUG(coral::log::fmi, "FMU instance completed asynchronous step, "
             "but this feature is currently not supported");
     }
 
@@ -509,6 +526,247 @@ bool SlaveInstance1::SetStringVariable(coral::model::VariableID varID, const std
 }
 
 
+namespace
+{
+    std::runtime_error MakeBulkGetOrSetException(
+        const std::string& getOrSet,
+        std::size_t count,
+        const std::string& instanceName)
+    {
+        return std::runtime_error(
+            "Failed to " + getOrSet + " values of " + std::to_string(count)
+            + " variables (" + LastLogRecord(instanceName).message + ")");
+    }
+}
+
+
+namespace
+{
+    // A variable group which also holds the FMI value references of the
+    // variables, and the instance which prepared it.
+    class VariableGroup1 : public coral::slave::VariableGroup
+    {
+    public:
+        VariableGroup1(
+            const SlaveInstance1* instance_,
+            coral::model::DataType dataType,
+            const coral::model::VariableID* variables,
+            std::size_t count,
+            std::vector<fmi1_value_reference_t> valueReferences_)
+            : coral::slave::VariableGroup(dataType, variables, count)
+            , instance(instance_)
+            , valueReferences(std::move(valueReferences_))
+        { }
+
+        const SlaveInstance1* instance;
+        std::vector<fmi1_value_reference_t> valueReferences;
+    };
+}
+
+
+std::unique_ptr<coral::slave::VariableGroup> SlaveInstance1::PrepareVariables(
+    coral::model::DataType dataType,
+    const coral::model::VariableID* variables,
+    std::size_t count) const
+{
+    std::vector<fmi1_value_reference_t> valueReferences;
+    valueReferences.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (m_fmu->Description().Variable(variables[i]).DataType() != dataType) {
+            throw std::logic_error(
+                "Variable " + std::to_string(variables[i])
+                + " does not have the requested data type");
+        }
+        valueReferences.push_back(m_fmu->FMIValueReference(variables[i]));
+    }
+    return std::make_unique<VariableGroup1>(
+        this, dataType, variables, count, std::move(valueReferences));
+}
+
+
+const std::vector<fmi1_value_reference_t>& SlaveInstance1::ValueReferences(
+    const coral::slave::VariableGroup& variables,
+    coral::model::DataType dataType) const
+{
+    const auto group = dynamic_cast<const VariableGroup1*>(&variables);
+    if (!group || group->instance != this) {
+        throw std::invalid_argument(
+            "Variable group was not prepared by this slave instance");
+    }
+    if (group->DataType() != dataType) {
+        throw std::logic_error("Variable group has wrong data type");
+    }
+    return group->valueReferences;
+}
+
+
+void SlaveInstance1::GetRealVariables(
+    const coral::slave::VariableGroup& variables,
+    double* values) const
+{
+    assert(m_setupComplete);
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::REAL_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return;
+    const auto status = fmi1_import_get_real(
+        m_handle, valueReferences.data(), count, values);
+    if (status != fmi1_status_ok && status != fmi1_status_warning) {
+        throw MakeBulkGetOrSetException("get", count, m_instanceName);
+    }
+}
+
+
+void SlaveInstance1::GetIntegerVariables(
+    const coral::slave::VariableGroup& variables,
+    int* values) const
+{
+    assert(m_setupComplete);
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::INTEGER_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return;
+    const auto status = fmi1_import_get_integer(
+        m_handle, valueReferences.data(), count, values);
+    if (status != fmi1_status_ok && status != fmi1_status_warning) {
+        throw MakeBulkGetOrSetException("get", count, m_instanceName);
+    }
+}
+
+
+void SlaveInstance1::GetBooleanVariables(
+    const coral::slave::VariableGroup& variables,
+    bool* values) const
+{
+    assert(m_setupComplete);
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::BOOLEAN_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return;
+    m_booleanBuffer.resize(count);
+    const auto status = fmi1_import_get_boolean(
+        m_handle, valueReferences.data(), count, m_booleanBuffer.data());
+    if (status != fmi1_status_ok && status != fmi1_status_warning) {
+        throw MakeBulkGetOrSetException("get", count, m_instanceName);
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        values[i] = m_booleanBuffer[i] != 0;
+    }
+}
+
+
+void SlaveInstance1::GetStringVariables(
+    const coral::slave::VariableGroup& variables,
+    std::string* values) const
+{
+    assert(m_setupComplete);
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::STRING_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return;
+    m_stringBuffer.assign(count, nullptr);
+    const auto status = fmi1_import_get_string(
+        m_handle, valueReferences.data(), count, m_stringBuffer.data());
+    if (status != fmi1_status_ok && status != fmi1_status_warning) {
+        throw MakeBulkGetOrSetException("get", count, m_instanceName);
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        values[i] = m_stringBuffer[i]
+            ? std::string(m_stringBuffer[i])
+            : std::string();
+    }
+}
+
+
+bool SlaveInstance1::SetRealVariables(
+    const coral::slave::VariableGroup& variables,
+    const double* values)
+{
+    assert(m_setupComplete);
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::REAL_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return true;
+    const auto status = fmi1_import_set_real(
+        m_handle, valueReferences.data(), count, values);
+    if (status == fmi1_status_ok || status == fmi1_status_warning) {
+        return true;
+    } else if (status == fmi1_status_discard) {
+        return false;
+    } else {
+        throw MakeBulkGetOrSetException("set", count, m_instanceName);
+    }
+}
+
+
+bool SlaveInstance1::SetIntegerVariables(
+    const coral::slave::VariableGroup& variables,
+    const int* values)
+{
+    assert(m_setupComplete);
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::INTEGER_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return true;
+    const auto status = fmi1_import_set_integer(
+        m_handle, valueReferences.data(), count, values);
+    if (status == fmi1_status_ok || status == fmi1_status_warning) {
+        return true;
+    } else if (status == fmi1_status_discard) {
+        return false;
+    } else {
+        throw MakeBulkGetOrSetException("set", count, m_instanceName);
+    }
+}
+
+
+bool SlaveInstance1::SetBooleanVariables(
+    const coral::slave::VariableGroup& variables,
+    const bool* values)
+{
+    assert(m_setupComplete);
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::BOOLEAN_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return true;
+    m_booleanBuffer.assign(values, values + count);
+    const auto status = fmi1_import_set_boolean(
+        m_handle, valueReferences.data(), count, m_booleanBuffer.data());
+    if (status == fmi1_status_ok || status == fmi1_status_warning) {
+        return true;
+    } else if (status == fmi1_status_discard) {
+        return false;
+    } else {
+        throw MakeBulkGetOrSetException("set", count, m_instanceName);
+    }
+}
+
+
+bool SlaveInstance1::SetStringVariables(
+    const coral::slave::VariableGroup& variables,
+    const std::string* values)
+{
+    assert(m_setupComplete);
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::STRING_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return true;
+    m_stringBuffer.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        m_stringBuffer[i] = values[i].c_str();
+    }
+    const auto status = fmi1_import_set_string(
+        m_handle, valueReferences.data(), count, m_stringBuffer.data());
+    if (status == fmi1_status_ok || status == fmi1_status_warning) {
+        return true;
+    } else if (status == fmi1_status_discard) {
+        return false;
+    } else {
+        throw MakeBulkGetOrSetException("set", count, m_instanceName);
+    }
+}
+
+
 std::shared_ptr<coral::fmi::FMU> SlaveInstance1::FMU() const
 {
     return FMU1();
@@ -12,8 +12,11 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <cstdlib>
 #include <cstring>
 #include <mutex>
+#include <new>
 #include <stdexcept>
+#include <string>
 #include <unordered_map>
+#include <utility>
 
 #include <boost/numeric/conversion/cast.hpp>
 #include <fmilib.h>
@@ -24,7 +27,10 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/util.hpp>
 
 #ifdef _WIN32
-#include <coral/fmi/windows.hpp>
+#   include <Windows.h>
+#   include <coral/fmi/windows.hpp>
+#else
+#   include <dlfcn.h>
 #endif
 
 
@@ -33,6 +39,176 @@ namespace coral
 namespace fmi
 {
 
+// =============================================================================
+// FMI2Library
+// =============================================================================
+
+namespace
+{
+    void StepFinishedPlaceholder(fmi2_component_environment_t, fmi2_status_t);
+
+    void LogMessage(
+        fmi2_component_environment_t,
+        fmi2_string_t instanceName,
+        fmi2_status_t status,
+        fmi2_string_t category,
+        fmi2_string_t message,
+        ...);
+}
+
+
+// The shared library of an FMI 2.0 FMU, and the functions in it that we use.
+//
+// FMI Library ties each FMI component to an fmi2_import_t object, which means
+// that the model description has to be parsed anew for every instance.  To
+// avoid that, we load the library and look up the functions ourselves, and
+// call them directly with each instance's component.
+class FMI2Library
+{
+public:
+    FMI2Library(fmi2_import_t* fmu, const boost::filesystem::path& fmuDir);
+    ~FMI2Library() noexcept;
+
+    FMI2Library(const FMI2Library&) = delete;
+    FMI2Library& operator=(const FMI2Library&) = delete;
+
+    // The URI of the FMU's resources directory.
+    const std::string& ResourceURI() const { return m_resourceURI; }
+
+    // Callbacks that must remain valid as long as any component exists.
+    const fmi2_callback_functions_t* Callbacks() const { return &m_callbacks; }
+
+    fmi2_component_t (*instantiate)(
+        fmi2_string_t, fmi2_type_t, fmi2_string_t, fmi2_string_t,
+        const fmi2_callback_functions_t*, fmi2_boolean_t, fmi2_boolean_t);
+    void (*freeInstance)(fmi2_component_t);
+    fmi2_status_t (*setupExperiment)(
+        fmi2_component_t, fmi2_boolean_t, fmi2_real_t, fmi2_real_t,
+        fmi2_boolean_t, fmi2_real_t);
+    fmi2_status_t (*enterInitializationMode)(fmi2_component_t);
+    fmi2_status_t (*exitInitializationMode)(fmi2_component_t);
+    fmi2_status_t (*terminate)(fmi2_component_t);
+    fmi2_status_t (*doStep)(
+        fmi2_component_t, fmi2_real_t, fmi2_real_t, fmi2_boolean_t);
+    fmi2_status_t (*getReal)(
+        fmi2_component_t, const fmi2_value_reference_t*, std::size_t, fmi2_real_t*);
+    fmi2_status_t (*getInteger)(
+        fmi2_component_t, const fmi2_value_reference_t*, std::size_t, fmi2_integer_t*);
+    fmi2_status_t (*getBoolean)(
+        fmi2_component_t, const fmi2_value_reference_t*, std::size_t, fmi2_boolean_t*);
+    fmi2_status_t (*getString)(
+        fmi2_component_t, const fmi2_value_reference_t*, std::size_t, fmi2_string_t*);
+    fmi2_status_t (*setReal)(
+        fmi2_component_t, const fmi2_value_reference_t*, std::size_t, const fmi2_real_t*);
+    fmi2_status_t (*setInteger)(
+        fmi2_component_t, const fmi2_value_reference_t*, std::size_t, const fmi2_integer_t*);
+    fmi2_status_t (*setBoolean)(
+        fmi2_component_t, const fmi2_value_reference_t*, std::size_t, const fmi2_boolean_t*);
+    fmi2_status_t (*setString)(
+        fmi2_component_t, const fmi2_value_reference_t*, std::size_t, const fmi2_string_t*);
+
+private:
+    template<typename F>
+    void Load(F& function, const char* name);
+
+#ifdef _WIN32
+    HMODULE m_handle;
+#else
+    void* m_handle;
+#endif
+    std::string m_resourceURI;
+    fmi2_callback_functions_t m_callbacks;
+};
+
+
+FMI2Library::FMI2Library(fmi2_import_t* fmu, const boost::filesystem::path& fmuDir)
+{
+    const auto modelIdentifier = fmi2_import_get_model_identifier_CS(fmu);
+    if (modelIdentifier == nullptr) {
+        throw std::runtime_error("FMU has no co-simulation model identifier");
+    }
+    const auto cb = jm_get_default_callbacks();
+    const auto dllPathZ = fmi_import_get_dll_path(
+        fmuDir.string().c_str(), modelIdentifier, cb);
+    const auto resourceURIZ = fmi_import_create_URL_from_abs_path(
+        cb, (fmuDir / "resources").string().c_str());
+    const auto freeStrings = coral::util::OnScopeExit([&]() {
+        cb->free(dllPathZ);
+        cb->free(resourceURIZ);
+    });
+    if (dllPathZ == nullptr || resourceURIZ == nullptr) {
+        throw std::bad_alloc();
+    }
+    const auto dllPath = boost::filesystem::path(dllPathZ);
+    m_resourceURI = resourceURIZ;
+
+#ifdef _WIN32
+    m_handle = LoadLibraryW(dllPath.wstring().c_str());
+#else
+    m_handle = dlopen(dllPath.string().c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+    if (m_handle == nullptr) {
+        throw std::runtime_error("Failed to load FMU library: " + dllPath.string());
+    }
+    try {
+        Load(instantiate, "fmi2Instantiate");
+        Load(freeInstance, "fmi2FreeInstance");
+        Load(setupExperiment, "fmi2SetupExperiment");
+        Load(enterInitializationMode, "fmi2EnterInitializationMode");
+        Load(exitInitializationMode, "fmi2ExitInitializationMode");
+        Load(terminate, "fmi2Terminate");
+        Load(doStep, "fmi2DoStep");
+        Load(getReal, "fmi2GetReal");
+        Load(getInteger, "fmi2GetInteger");
+        Load(getBoolean, "fmi2GetBoolean");
+        Load(getString, "fmi2GetString");
+        Load(setReal, "fmi2SetReal");
+        Load(setInteger, "fmi2SetInteger");
+        Load(setBoolean, "fmi2SetBoolean");
+        Load(setString, "fmi2SetString");
+    } catch (...) {
+#ifdef _WIN32
+        FreeLibrary(m_handle);
+#else
+        dlclose(m_handle);
+#endif
+        throw;
+    }
+
+    m_callbacks.allocateMemory       = std::calloc;
+    m_callbacks.freeMemory           = std::free;
+    m_callbacks.logger               = LogMessage;
+    m_callbacks.stepFinished         = StepFinishedPlaceholder;
+    m_callbacks.componentEnvironment = nullptr;
+}
+
+
+FMI2Library::~FMI2Library() noexcept
+{
+#ifdef _WIN32
+    FreeLibrary(m_handle);
+#else
+    dlclose(m_handle);
+#endif
+}
+
+
+template<typename F>
+void FMI2Library::Load(F& function, const char* name)
+{
+#ifdef _WIN32
+    const auto address = GetProcAddress(m_handle, name);
+#else
+    const auto address = dlsym(m_handle, name);
+#endif
+    if (address == nullptr) {
+        throw std::runtime_error(
+            std::string("FMU library does not contain function: ") + name);
+    }
+    function = reinterpret_cast<F>(address);
+}
+
+
 // =============================================================================
 // FMU2
 // =============================================================================
@@ -65,6 +241,13 @@ FMU2::FMU2(
         variables.push_back(
             ToVariable(var, boost::numeric_cast<coral::model::VariableID>(i)));
     }
+    m_valueReferenceTables.resize(VARIABLE_GROUP_COUNT);
+    for (const auto& v : variables) {
+        auto& table = m_valueReferenceTables[
+            VariableGroupIndex(v.Causality(), v.DataType())];
+        table.variables.push_back(v.ID());
+        table.valueReferences.push_back(m_valueReferences[v.ID()]);
+    }
     m_description = std::make_unique<coral::model::SlaveTypeDescription>(
         std::string(fmi2_import_get_model_name(m_handle)),
         std::string(fmi2_import_get_GUID(m_handle)),
@@ -131,10 +314,15 @@ std::shared_ptr<SlaveInstance2> FMU2::InstantiateSlave2()
         m_handle,
         fmi2_cs_canBeInstantiatedOnlyOncePerProcess);
     if (isSingleton && !m_instances.empty()) {
-        throw std::runtime_error("FMU can only be instantiated once");
+        throw std::runtime_error(
+            "FMU can only be instantiated once per process");
+    }
+    m_importer->CompleteUnpacking(*this);
+    if (!m_library) {
+        m_library = std::make_shared<FMI2Library>(m_handle, m_dir);
     }
-    auto instance =
-        std::shared_ptr<SlaveInstance2>(new SlaveInstance2(shared_from_this()));
+    auto instance = std::shared_ptr<SlaveInstance2>(
+        new SlaveInstance2(shared_from_this(), m_library));
     m_instances.push_back(instance);
     return instance;
 }
@@ -153,6 +341,14 @@ fmi2_value_reference_t FMU2::FMIValueReference(coral::model::VariableID variable
 }
 
 
+const FMU2::ValueReferenceTable& FMU2::ValueReferences(
+    coral::model::Causality causality,
+    coral::model::DataType dataType) const
+{
+    return m_valueReferenceTables[VariableGroupIndex(causality, dataType)];
+}
+
+
 fmi2_import_t* FMU2::FmilibHandle() const
 {
     return m_handle;
@@ -167,7 +363,7 @@ namespace
 {
     void StepFinishedPlaceholder(fmi2_component_environment_t, fmi2_status_t)
     {
-        CORAL_LOG_DEBUG("FMU instance completed asynchronous step, "
+        CORAL_LOG_CAT_DEBUG(coral::log::fmi, "FMU instance completed asynchronous step, "
             "but this feature is currently not supported");
     }
 
@@ -258,26 +454,12 @@ namespace
 }
 
 
-SlaveInstance2::SlaveInstance2(std::shared_ptr<coral::fmi::FMU2> fmu)
+SlaveInstance2::SlaveInstance2(
+    std::shared_ptr<coral::fmi::FMU2> fmu,
+    std::shared_ptr<const FMI2Library> library)
     : m_fmu{fmu}
-    , m_handle{fmi2_import_parse_xml(fmu->Importer()->FmilibHandle(), fmu->Directory().string().c_str(), nullptr)}
+    , m_library{library}
 {
-    if (m_handle == nullptr) {
-        throw std::runtime_error(fmu->Importer()->LastErrorMessage());
-    }
-
-    fmi2_callback_functions_t callbacks;
-    callbacks.allocateMemory       = std::calloc;
-    callbacks.freeMemory           = std::free;
-    callbacks.logger               = LogMessage;
-    callbacks.stepFinished         = StepFinishedPlaceholder;
-    callbacks.componentEnvironment = nullptr;
-
-    if (fmi2_import_create_dllfmu(m_handle, fmi2_fmu_kind_cs, &callbacks) != jm_status_success) {
-        const auto msg = fmu->Importer()->LastErrorMessage();
-        fmi2_import_free(m_handle);
-        throw std::runtime_error(msg);
-    }
 }
 
 
@@ -285,12 +467,10 @@ SlaveInstance2::~SlaveInstance2() noexcept
 {
     if (m_setupComplete) {
         if (m_simStarted) {
-            fmi2_import_terminate(m_handle);
+            m_library->terminate(m_component);
         }
-        fmi2_import_free_instance(m_handle);
+        m_library->freeInstance(m_component);
     }
-    fmi2_import_destroy_dllfmu(m_handle);
-    fmi2_import_free(m_handle);
 }
 
 
@@ -309,20 +489,25 @@ void SlaveInstance2::Setup(
     double relativeTolerance)
 {
     assert(!m_setupComplete);
-    const auto rci = fmi2_import_instantiate(
-        m_handle,
+    m_component = m_library->instantiate(
         slaveName.c_str(),
         fmi2_cosimulation,
-        nullptr,
-        fmi2_false);
-    if (rci != jm_status_success) {
+        m_fmu->Description().UUID().c_str(),
+        m_library->ResourceURI().c_str(),
+        m_library->Callbacks(),
+        fmi2_false,
+        fmi2_true);
+    if (m_component == nullptr) {
         throw std::runtime_error(
             "FMI error: Slave instantiation failed ("
             + LastLogRecord(slaveName).message + ')');
     }
+    // From here on, the destructor must free the component.
+    m_setupComplete = true;
+    m_instanceName = slaveName;
 
-    const auto rcs = fmi2_import_setup_experiment(
-        m_handle,
+    const auto rcs = m_library->setupExperiment(
+        m_component,
         adaptiveStepSize ? fmi2_true : fmi2_false,
         relativeTolerance,
         startTime,
@@ -334,15 +519,12 @@ void SlaveInstance2::Setup(
             + LastLogRecord(slaveName).message + ')');
     }
 
-    const auto rce = fmi2_import_enter_initialization_mode(m_handle);
+    const auto rce = m_library->enterInitializationMode(m_component);
     if (rce != fmi2_status_ok && rce != fmi2_status_warning) {
         throw std::runtime_error(
             "FMI error: Slave failed to enter initialization mode ("
             + LastLogRecord(slaveName).message + ')');
     }
-
-    m_setupComplete = true;
-    m_instanceName = slaveName;
 }
 
 
@@ -350,7 +532,7 @@ void SlaveInstance2::StartSimulation()
 {
     assert(m_setupComplete);
     assert(!m_simStarted);
-    const auto rc = fmi2_import_exit_initialization_mode(m_handle);
+    const auto rc = m_library->exitInitializationMode(m_component);
     if (rc != fmi2_status_ok && rc != fmi2_status_warning) {
         throw std::runtime_error(
             "FMI error: Slave failed to exit initialization mode ("
@@ -363,7 +545,7 @@ void SlaveInstance2::StartSimulation()
 void SlaveInstance2::EndSimulation()
 {
     assert(m_simStarted);
-    const auto rc = fmi2_import_terminate(m_handle);
+    const auto rc = m_library->terminate(m_component);
     m_simStarted = false;
     if (rc != fmi2_status_ok && rc != fmi2_status_warning) {
         throw std::runtime_error(
@@ -378,7 +560,7 @@ bool SlaveInstance2::DoStep(
     coral::model::TimeDuration deltaT)
 {
     assert(m_simStarted);
-    const auto rc = fmi2_import_do_step(m_handle, currentT, deltaT, fmi2_true);
+    const auto rc = m_library->doStep(m_component, currentT, deltaT, fmi2_true);
     if (rc == fmi2_status_ok || rc == fmi2_status_warning) {
         return true;
     } else if (rc == fmi2_status_discard) {
@@ -416,7 +598,7 @@ double SlaveInstance2::GetRealVariable(coral::model::VariableID varID) const
 {
     const auto valRef = m_fmu->FMIValueReference(varID);
     fmi2_real_t value = 0.0;
-    const auto status = fmi2_import_get_real(m_handle, &valRef, 1, &value);
+    const auto status = m_library->getReal(m_component, &valRef, 1, &value);
     if (status != fmi2_status_ok && status != fmi2_status_warning) {
         throw MakeGetOrSetException("get", varID, *FMU2(), m_instanceName);
     }
@@ -428,7 +610,7 @@ int SlaveInstance2::GetIntegerVariable(coral::model::VariableID varID) const
 {
     const auto valRef = m_fmu->FMIValueReference(varID);
     fmi2_integer_t value = 0;
-    const auto status = fmi2_import_get_integer(m_handle, &valRef, 1, &value);
+    const auto status = m_library->getInteger(m_component, &valRef, 1, &value);
     if (status != fmi2_status_ok && status != fmi2_status_warning) {
         throw MakeGetOrSetException("get", varID, *FMU2(), m_instanceName);
     }
@@ -440,7 +622,7 @@ bool SlaveInstance2::GetBooleanVariable(coral::model::VariableID varID) const
 {
     const auto valRef = m_fmu->FMIValueReference(varID);
     fmi2_boolean_t value = 0;
-    const auto status = fmi2_import_get_boolean(m_handle, &valRef, 1, &value);
+    const auto status = m_library->getBoolean(m_component, &valRef, 1, &value);
     if (status != fmi2_status_ok && status != fmi2_status_warning) {
         throw MakeGetOrSetException("get", varID, *FMU2(), m_instanceName);
     }
@@ -452,7 +634,7 @@ std::string SlaveInstance2::GetStringVariable(coral::model::VariableID varID) co
 {
     const auto valRef = m_fmu->FMIValueReference(varID);
     fmi2_string_t value = nullptr;
-    const auto status = fmi2_import_get_string(m_handle, &valRef, 1, &value);
+    const auto status = m_library->getString(m_component, &valRef, 1, &value);
     if (status != fmi2_status_ok && status != fmi2_status_warning) {
         throw MakeGetOrSetException("get", varID, *FMU2(), m_instanceName);
     }
@@ -463,7 +645,7 @@ std::string SlaveInstance2::GetStringVariable(coral::model::VariableID varID) co
 bool SlaveInstance2::SetRealVariable(coral::model::VariableID varID, double value)
 {
     const auto valRef = m_fmu->FMIValueReference(varID);
-    const auto status = fmi2_import_set_real(m_handle, &valRef, 1, &value);
+    const auto status = m_library->setReal(m_component, &valRef, 1, &value);
     if (status == fmi2_status_ok || status == fmi2_status_warning) {
         return true;
     } else if (status == fmi2_status_discard) {
@@ -477,7 +659,7 @@ bool SlaveInstance2::SetRealVariable(coral::model::VariableID varID, double valu
 bool SlaveInstance2::SetIntegerVariable(coral::model::VariableID varID, int value)
 {
     const auto valRef = m_fmu->FMIValueReference(varID);
-    const auto status = fmi2_import_set_integer(m_handle, &valRef, 1, &value);
+    const auto status = m_library->setInteger(m_component, &valRef, 1, &value);
     if (status == fmi2_status_ok || status == fmi2_status_warning) {
         return true;
     } else if (status == fmi2_status_discard) {
@@ -492,7 +674,7 @@ bool SlaveInstance2::SetBooleanVariable(coral::model::VariableID varID, bool val
 {
     fmi2_boolean_t fmiValue = value;
     const auto valRef = m_fmu->FMIValueReference(varID);
-    const auto status = fmi2_import_set_boolean(m_handle, &valRef, 1, &fmiValue);
+    const auto status = m_library->setBoolean(m_component, &valRef, 1, &fmiValue);
     if (status == fmi2_status_ok || status == fmi2_status_warning) {
         return true;
     } else if (status == fmi2_status_discard) {
@@ -507,7 +689,7 @@ bool SlaveInstance2::SetStringVariable(coral::model::VariableID varID, const std
 {
     const auto fmiValue = value.c_str();
     const auto valRef = m_fmu->FMIValueReference(varID);
-    const auto status = fmi2_import_set_string(m_handle, &valRef, 1, &fmiValue);
+    const auto status = m_library->setString(m_component, &valRef, 1, &fmiValue);
     if (status == fmi2_status_ok || status == fmi2_status_warning) {
         return true;
     } else if (status == fmi2_status_discard) {
@@ -518,6 +700,239 @@ bool SlaveInstance2::SetStringVariable(coral::model::VariableID varID, const std
 }
 
 
+namespace
+{
+    std::runtime_error MakeBulkGetOrSetException(
+        const std::string& getOrSet,
+        std::size_t count,
+        const std::string& instanceName)
+    {
+        return std::runtime_error(
+            "Failed to " + getOrSet + " values of " + std::to_string(count)
+            + " variables (" + LastLogRecord(instanceName).message + ")");
+    }
+}
+
+
+namespace
+{
+    // A variable group which also holds the FMI value references of the
+    // variables, and the instance which prepared it.
+    class VariableGroup2 : public coral::slave::VariableGroup
+    {
+    public:
+        VariableGroup2(
+            const SlaveInstance2* instance_,
+            coral::model::DataType dataType,
+            const coral::model::VariableID* variables,
+            std::size_t count,
+            std::vector<fmi2_value_reference_t> valueReferences_)
+            : coral::slave::VariableGroup(dataType, variables, count)
+            , instance(instance_)
+            , valueReferences(std::move(valueReferences_))
+        { }
+
+        const SlaveInstance2* instance;
+        std::vector<fmi2_value_reference_t> valueReferences;
+    };
+}
+
+
+std::unique_ptr<coral::slave::VariableGroup> SlaveInstance2::PrepareVariables(
+    coral::model::DataType dataType,
+    const coral::model::VariableID* variables,
+    std::size_t count) const
+{
+    std::vector<fmi2_value_reference_t> valueReferences;
+    valueReferences.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (m_fmu->Description().Variable(variables[i]).DataType() != dataType) {
+            throw std::logic_error(
+                "Variable " + std::to_string(variables[i])
+                + " does not have the requested data type");
+        }
+        valueReferences.push_back(m_fmu->FMIValueReference(variables[i]));
+    }
+    return std::make_unique<VariableGroup2>(
+        this, dataType, variables, count, std::move(valueReferences));
+}
+
+
+const std::vector<fmi2_value_reference_t>& SlaveInstance2::ValueReferences(
+    const coral::slave::VariableGroup& variables,
+    coral::model::DataType dataType) const
+{
+    const auto group = dynamic_cast<const VariableGroup2*>(&variables);
+    if (!group || group->instance != this) {
+        throw std::invalid_argument(
+            "Variable group was not prepared by this slave instance");
+    }
+    if (group->DataType() != dataType) {
+        throw std::logic_error("Variable group has wrong data type");
+    }
+    return group->valueReferences;
+}
+
+
+void SlaveInstance2::GetRealVariables(
+    const coral::slave::VariableGroup& variables,
+    double* values) const
+{
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::REAL_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return;
+    const auto status = m_library->getReal(
+        m_component, valueReferences.data(), count, values);
+    if (status != fmi2_status_ok && status != fmi2_status_warning) {
+        throw MakeBulkGetOrSetException("get", count, m_instanceName);
+    }
+}
+
+
+void SlaveInstance2::GetIntegerVariables(
+    const coral::slave::VariableGroup& variables,
+    int* values) const
+{
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::INTEGER_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return;
+    const auto status = m_library->getInteger(
+        m_component, valueReferences.data(), count, values);
+    if (status != fmi2_status_ok && status != fmi2_status_warning) {
+        throw MakeBulkGetOrSetException("get", count, m_instanceName);
+    }
+}
+
+
+void SlaveInstance2::GetBooleanVariables(
+    const coral::slave::VariableGroup& variables,
+    bool* values) const
+{
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::BOOLEAN_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return;
+    m_booleanBuffer.resize(count);
+    const auto status = m_library->getBoolean(
+        m_component, valueReferences.data(), count, m_booleanBuffer.data());
+    if (status != fmi2_status_ok && status != fmi2_status_warning) {
+        throw MakeBulkGetOrSetException("get", count, m_instanceName);
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        values[i] = m_booleanBuffer[i] != fmi2_false;
+    }
+}
+
+
+void SlaveInstance2::GetStringVariables(
+    const coral::slave::VariableGroup& variables,
+    std::string* values) const
+{
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::STRING_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return;
+    m_stringBuffer.assign(count, nullptr);
+    const auto status = m_library->getString(
+        m_component, valueReferences.data(), count, m_stringBuffer.data());
+    if (status != fmi2_status_ok && status != fmi2_status_warning) {
+        throw MakeBulkGetOrSetException("get", count, m_instanceName);
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        values[i] = m_stringBuffer[i]
+            ? std::string(m_stringBuffer[i])
+            : std::string();
+    }
+}
+
+
+bool SlaveInstance2::SetRealVariables(
+    const coral::slave::VariableGroup& variables,
+    const double* values)
+{
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::REAL_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return true;
+    const auto status = m_library->setReal(
+        m_component, valueReferences.data(), count, values);
+    if (status == fmi2_status_ok || status == fmi2_status_warning) {
+        return true;
+    } else if (status == fmi2_status_discard) {
+        return false;
+    } else {
+        throw MakeBulkGetOrSetException("set", count, m_instanceName);
+    }
+}
+
+
+bool SlaveInstance2::SetIntegerVariables(
+    const coral::slave::VariableGroup& variables,
+    const int* values)
+{
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::INTEGER_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return true;
+    const auto status = m_library->setInteger(
+        m_component, valueReferences.data(), count, values);
+    if (status == fmi2_status_ok || status == fmi2_status_warning) {
+        return true;
+    } else if (status == fmi2_status_discard) {
+        return false;
+    } else {
+        throw MakeBulkGetOrSetException("set", count, m_instanceName);
+    }
+}
+
+
+bool SlaveInstance2::SetBooleanVariables(
+    const coral::slave::VariableGroup& variables,
+    const bool* values)
+{
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::BOOLEAN_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return true;
+    m_booleanBuffer.assign(values, values + count);
+    const auto status = m_library->setBoolean(
+        m_component, valueReferences.data(), count, m_booleanBuffer.data());
+    if (status == fmi2_status_ok || status == fmi2_status_warning) {
+        return true;
+    } else if (status == fmi2_status_discard) {
+        return false;
+    } else {
+        throw MakeBulkGetOrSetException("set", count, m_instanceName);
+    }
+}
+
+
+bool SlaveInstance2::SetStringVariables(
+    const coral::slave::VariableGroup& variables,
+    const std::string* values)
+{
+    const auto& valueReferences =
+        ValueReferences(variables, coral::model::STRING_DATATYPE);
+    const auto count = valueReferences.size();
+    if (count == 0) return true;
+    m_stringBuffer.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        m_stringBuffer[i] = values[i].c_str();
+    }
+    const auto status = m_library->setString(
+        m_component, valueReferences.data(), count, m_stringBuffer.data());
+    if (status == fmi2_status_ok || status == fmi2_status_warning) {
+        return true;
+    } else if (status == fmi2_status_discard) {
+        return false;
+    } else {
+        throw MakeBulkGetOrSetException("set", count, m_instanceName);
+    }
+}
+
+
 std::shared_ptr<coral::fmi::FMU> SlaveInstance2::FMU() const
 {
     return FMU2();
@@ -530,9 +945,9 @@ std::shared_ptr<coral::fmi::FMU2> SlaveInstance2::FMU2() const
 }
 
 
-fmi2_import_t* SlaveInstance2::FmilibHandle() const
+fmi2_component_t SlaveInstance2::Component() const
 {
-    return m_handle;
+    return m_component;
 }
 
 
@@ -1,9 +1,14 @@
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 #include <boost/filesystem.hpp>
 #include <gtest/gtest.h>
 
 #include <coral/fmi/importer.hpp>
 #include <coral/fmi/fmu2.hpp>
 #include <coral/util.hpp>
+#include <coral/util/filesystem.hpp>
 
 
 #define STRINGIFY_IMPL(x) #x
@@ -51,3 +56,220 @@ TEST(coral_fmi, Fmu2)
     EXPECT_TRUE(foundValve);
     EXPECT_TRUE(foundMinlevel);
 }
+
+
+TEST(coral_fmi, Fmu2_MultipleInstances)
+{
+    auto importer = coral::fmi::Importer::Create();
+    auto fmu = importer->Import(
+        boost::filesystem::path(fmuDir) / "fmi2_cs" / "WaterTank_Control.fmu");
+    coral::model::VariableID minlevel = 0;
+    bool foundMinlevel = false;
+    for (const auto& v : fmu->Description().Variables()) {
+        if (v.Name() == "minlevel") {
+            minlevel = v.ID();
+            foundMinlevel = true;
+        }
+    }
+    ASSERT_TRUE(foundMinlevel);
+
+    // The instances share the FMU's library, but each has its own state.
+    auto instance1 = fmu->InstantiateSlave();
+    auto instance2 = fmu->InstantiateSlave();
+    instance1->Setup("testSlave1", "testExecution", 0.0, 1.0, false, 0.0);
+    instance2->Setup("testSlave2", "testExecution", 0.0, 1.0, false, 0.0);
+    EXPECT_TRUE(instance1->SetRealVariable(minlevel, 2.0));
+    EXPECT_EQ(2.0, instance1->GetRealVariable(minlevel));
+    EXPECT_EQ(1.0, instance2->GetRealVariable(minlevel));
+
+    // Instances can be destroyed and created independently.
+    instance1.reset();
+    EXPECT_EQ(1.0, instance2->GetRealVariable(minlevel));
+    auto instance3 = fmu->InstantiateSlave();
+    instance3->Setup("testSlave3", "testExecution", 0.0, 1.0, false, 0.0);
+    EXPECT_EQ(1.0, instance3->GetRealVariable(minlevel));
+}
+
+
+TEST(coral_fmi, Fmu2_ValueReferences)
+{
+    auto importer = coral::fmi::Importer::Create();
+    const auto fmu = std::static_pointer_cast<coral::fmi::FMU2>(importer->Import(
+        boost::filesystem::path(fmuDir) / "fmi2_cs" / "WaterTank_Control.fmu"));
+    const auto& d = fmu->Description();
+
+    // Each variable is in the table for its causality and data type, and
+    // the tables are ordered by variable ID.
+    std::size_t tabulated = 0;
+    for (const auto c : {
+            coral::model::PARAMETER_CAUSALITY,
+            coral::model::CALCULATED_PARAMETER_CAUSALITY,
+            coral::model::INPUT_CAUSALITY,
+            coral::model::OUTPUT_CAUSALITY,
+            coral::model::LOCAL_CAUSALITY}) {
+        for (const auto dt : {
+                coral::model::REAL_DATATYPE,
+                coral::model::INTEGER_DATATYPE,
+                coral::model::BOOLEAN_DATATYPE,
+                coral::model::STRING_DATATYPE}) {
+            const auto& table = fmu->ValueReferences(c, dt);
+            ASSERT_EQ(table.variables.size(), table.valueReferences.size());
+            for (std::size_t i = 0; i < table.variables.size(); ++i) {
+                const auto& v = d.Variable(table.variables[i]);
+                EXPECT_EQ(c, v.Causality());
+                EXPECT_EQ(dt, v.DataType());
+                EXPECT_EQ(fmu->FMIValueReference(v.ID()), table.valueReferences[i]);
+                if (i > 0) EXPECT_LT(table.variables[i-1], table.variables[i]);
+            }
+            tabulated += table.variables.size();
+        }
+    }
+    std::size_t variableCount = 0;
+    for (const auto& v : d.Variables()) { (void) v; ++variableCount; }
+    EXPECT_EQ(variableCount, tabulated);
+
+    // Getting and setting values in bulk is equivalent to doing it one
+    // variable at a time.
+    const auto& params = fmu->ValueReferences(
+        coral::model::PARAMETER_CAUSALITY, coral::model::REAL_DATATYPE);
+    ASSERT_FALSE(params.variables.empty());
+    auto instance = fmu->InstantiateSlave2();
+    instance->Setup("testSlave", "testExecution", 0.0, 1.0, false, 0.0);
+    const auto n = params.variables.size();
+    const auto group = instance->PrepareVariables(
+        coral::model::REAL_DATATYPE, params.variables.data(), n);
+    ASSERT_EQ(n, group->Size());
+    std::vector<double> values(n);
+    instance->GetRealVariables(*group, values.data());
+    for (std::size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(instance->GetRealVariable(params.variables[i]), values[i]);
+        values[i] += 1.0;
+    }
+    EXPECT_TRUE(instance->SetRealVariables(*group, values.data()));
+    for (std::size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(values[i], instance->GetRealVariable(params.variables[i]));
+    }
+
+    // The data types are checked, both when preparing and when using a group.
+    std::vector<int> ints(n);
+    EXPECT_THROW(instance->GetIntegerVariables(*group, ints.data()), std::logic_error);
+    EXPECT_THROW(
+        instance->PrepareVariables(
+            coral::model::INTEGER_DATATYPE, params.variables.data(), n),
+        std::logic_error);
+
+    // A group prepared by one instance can't be used with another.
+    auto otherInstance = fmu->InstantiateSlave2();
+    otherInstance->Setup("otherSlave", "testExecution", 0.0, 1.0, false, 0.0);
+    EXPECT_THROW(
+        otherInstance->GetRealVariables(*group, values.data()),
+        std::invalid_argument);
+}
+
+
+TEST(coral_fmi, Fmu2_SelectiveUnpacking)
+{
+    namespace fs = boost::filesystem;
+    coral::util::TempDir cacheDir;
+    const auto fmuPath =
+        fs::path(fmuDir) / "fmi2_cs" / "WaterTank_Control.fmu";
+
+    // Only the model description and this platform's binaries are unpacked.
+    fs::path unpackDir;
+    {
+        auto importer = coral::fmi::Importer::Create(
+            cacheDir.Path(), coral::fmi::UnpackMode::selective);
+        auto fmu = std::static_pointer_cast<coral::fmi::FMU2>(
+            importer->Import(fmuPath));
+        unpackDir = fmu->Directory();
+        EXPECT_TRUE(fs::exists(unpackDir / "modelDescription.xml"));
+        EXPECT_FALSE(fs::exists(unpackDir / "documentation"));
+        EXPECT_FALSE(fs::exists(unpackDir / "sources"));
+        std::size_t platformCount = 0;
+        for (auto it = fs::directory_iterator(unpackDir / "binaries");
+             it != fs::directory_iterator();
+             ++it)
+        {
+            ++platformCount;
+        }
+        EXPECT_EQ(1u, platformCount);
+
+        auto instance = fmu->InstantiateSlave();
+        instance->Setup("testSlave", "testExecution", 0.0, 1.0, false, 0.0);
+    }
+
+    // A full import of the same FMU unpacks the rest.
+    auto importer = coral::fmi::Importer::Create(cacheDir.Path());
+    auto fmu = std::static_pointer_cast<coral::fmi::FMU2>(
+        importer->Import(fmuPath));
+    EXPECT_EQ(unpackDir, fmu->Directory());
+    auto instance = fmu->InstantiateSlave();
+    instance->Setup("testSlave", "testExecution", 0.0, 1.0, false, 0.0);
+}
+
+
+TEST(coral_fmi, Importer_SharedCache)
+{
+    namespace fs = boost::filesystem;
+    coral::util::TempDir cacheDir;
+    const auto fmuPath =
+        fs::path(fmuDir) / "fmi2_cs" / "WaterTank_Control.fmu";
+
+    // Importers which run concurrently share the unpacked FMU.
+    std::vector<fs::path> dirs(4);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < dirs.size(); ++i) {
+        threads.emplace_back([&, i] () {
+            auto importer = coral::fmi::Importer::Create(cacheDir.Path());
+            dirs[i] = std::static_pointer_cast<coral::fmi::FMU2>(
+                importer->Import(fmuPath))->Directory();
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (const auto& d : dirs) EXPECT_EQ(dirs.front(), d);
+    EXPECT_TRUE(fs::exists(dirs.front() / "modelDescription.xml"));
+
+    // An FMU which is in use is not removed from the cache by anyone.
+    auto importer1 = coral::fmi::Importer::Create(cacheDir.Path());
+    auto importer2 = coral::fmi::Importer::Create(cacheDir.Path());
+    auto fmu = importer1->Import(fmuPath);
+    importer2->CleanCache();
+    importer1->CleanCache();
+    EXPECT_TRUE(fs::exists(dirs.front()));
+
+    // Evicting it removes its lock file too, but not the FMU directory.
+    const auto lockFile = dirs.front().parent_path().parent_path()
+        / "lock" / dirs.front().filename();
+    EXPECT_TRUE(fs::exists(lockFile));
+    fmu.reset();
+    importer2->CleanCache();
+    EXPECT_FALSE(fs::exists(dirs.front()));
+    EXPECT_FALSE(fs::exists(lockFile));
+    EXPECT_TRUE(fs::exists(dirs.front().parent_path()));
+
+    // A size limit which is smaller than any FMU still keeps the one in use.
+    importer1->SetCacheSizeLimit(1);
+    fmu = importer1->Import(fmuPath);
+    EXPECT_TRUE(fs::exists(dirs.front()));
+    EXPECT_NO_THROW(fmu->InstantiateSlave());
+}
+
+
+TEST(coral_fmi, Importer_ImportUnpacked)
+{
+    coral::util::TempDir cacheDir;
+    auto importer = coral::fmi::Importer::Create(
+        cacheDir.Path(), coral::fmi::UnpackMode::selective);
+    auto fmu = importer->Import(
+        boost::filesystem::path(fmuDir) / "fmi2_cs" / "WaterTank_Control.fmu");
+    importer->CompleteUnpacking(*fmu);
+
+    // Another importer can use the unpacked FMU directly, as a slave
+    // started by coralslaveprovider does.
+    auto otherImporter = coral::fmi::Importer::Create();
+    auto otherFmu = otherImporter->ImportUnpacked(fmu->Directory());
+    EXPECT_EQ(fmu->Directory(), otherFmu->Directory());
+    EXPECT_EQ(fmu->Description().UUID(), otherFmu->Description().UUID());
+    auto instance = otherFmu->InstantiateSlave();
+    instance->Setup("testSlave", "testExecution", 0.0, 1.0, false, 0.0);
+}
@@ -147,4 +147,29 @@ coral::model::VariableDescription ToVariable(
 }
 
 
+std::size_t VariableGroupIndex(
+    coral::model::Causality causality,
+    coral::model::DataType dataType)
+{
+    std::size_t causalityIndex = 0;
+    switch (causality) {
+        case coral::model::PARAMETER_CAUSALITY:             causalityIndex = 0; break;
+        case coral::model::CALCULATED_PARAMETER_CAUSALITY:  causalityIndex = 1; break;
+        case coral::model::INPUT_CAUSALITY:                 causalityIndex = 2; break;
+        case coral::model::OUTPUT_CAUSALITY:                causalityIndex = 3; break;
+        case coral::model::LOCAL_CAUSALITY:                 causalityIndex = 4; break;
+        default: throw std::logic_error("Invalid variable causality");
+    }
+    std::size_t dataTypeIndex = 0;
+    switch (dataType) {
+        case coral::model::REAL_DATATYPE:       dataTypeIndex = 0; break;
+        case coral::model::INTEGER_DATATYPE:    dataTypeIndex = 1; break;
+        case coral::model::BOOLEAN_DATATYPE:    dataTypeIndex = 2; break;
+        case coral::model::STRING_DATATYPE:     dataTypeIndex = 3; break;
+        default: throw std::logic_error("Invalid variable data type");
+    }
+    return causalityIndex * 4 + dataTypeIndex;
+}
+
+
 }} // namespace
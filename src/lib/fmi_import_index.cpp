@@ -0,0 +1,145 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/fmi/import_index.hpp>
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/filesystem.hpp>
+
+#include <coral/log.hpp>
+#include <coral/protocol/glue.hpp>
+#include <coral/util.hpp>
+
+#ifdef _MSC_VER
+#   pragma warning(push, 0)
+#endif
+#include <fmi.pb.h>
+#ifdef _MSC_VER
+#   pragma warning(pop)
+#endif
+
+
+namespace coral
+{
+namespace fmi
+{
+
+namespace
+{
+    // Must be incremented whenever the contents of the descriptions stored
+    // in the index change, e.g. if variable IDs are assigned differently.
+    const std::uint32_t INDEX_FORMAT_VERSION = 1;
+}
+
+
+ImportIndex::ImportIndex(const boost::filesystem::path& indexFile)
+    : m_indexFile(indexFile)
+{
+    std::ifstream in(indexFile.string(), std::ios::binary);
+    if (!in) return;
+
+    coralproto::fmi::ImportIndex index;
+    if (!index.ParseFromIstream(&in)) {
+        coral::log::Log(coral::log::warning, boost::format(
+            "Ignoring corrupt FMU index file: %s") % indexFile.string());
+        return;
+    }
+    if (index.version() != INDEX_FORMAT_VERSION) {
+        CORAL_LOG_DEBUG(boost::format("Ignoring FMU index with version %d: %s")
+            % index.version() % indexFile.string());
+        return;
+    }
+    for (const auto& e : index.entry()) {
+        try {
+            Entry entry = {
+                static_cast<std::uintmax_t>(e.size()),
+                static_cast<std::time_t>(e.modification_time()),
+                coral::protocol::FromProto(e.description())
+            };
+            m_entries.insert(std::make_pair(
+                boost::filesystem::path(e.path()),
+                std::move(entry)));
+        } catch (const std::exception& ex) {
+            CORAL_LOG_DEBUG(boost::format("Skipping invalid FMU index entry for %s: %s")
+                % e.path() % ex.what());
+        }
+    }
+    CORAL_LOG_DEBUG(boost::format("Loaded FMU index with %d entries: %s")
+        % m_entries.size() % indexFile.string());
+}
+
+
+const coral::model::SlaveTypeDescription* ImportIndex::Find(
+    const boost::filesystem::path& fmuPath) const
+{
+    const auto it = m_entries.find(fmuPath);
+    if (it == m_entries.end() || !IsCurrent(fmuPath, it->second)) {
+        return nullptr;
+    }
+    return &it->second.description;
+}
+
+
+void ImportIndex::Insert(
+    const boost::filesystem::path& fmuPath,
+    const coral::model::SlaveTypeDescription& description)
+{
+    Entry entry = {
+        boost::filesystem::file_size(fmuPath),
+        boost::filesystem::last_write_time(fmuPath),
+        description
+    };
+    m_entries[fmuPath] = std::move(entry);
+}
+
+
+void ImportIndex::Save() const
+{
+    coralproto::fmi::ImportIndex index;
+    index.set_version(INDEX_FORMAT_VERSION);
+    for (const auto& e : m_entries) {
+        if (!IsCurrent(e.first, e.second)) continue;
+        auto entry = index.add_entry();
+        entry->set_path(e.first.string());
+        entry->set_size(e.second.size);
+        entry->set_modification_time(e.second.modificationTime);
+        *entry->mutable_description() =
+            coral::protocol::ToProto(e.second.description);
+    }
+
+    // Write to a uniquely named temporary file first, so that the index is
+    // never left half-written, even if several processes save it at once.
+    boost::filesystem::create_directories(m_indexFile.parent_path());
+    const auto tempPath =
+        m_indexFile.string() + "." + coral::util::RandomUUID() + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out || !index.SerializeToOstream(&out)) {
+            boost::system::error_code ignored;
+            boost::filesystem::remove(tempPath, ignored);
+            throw std::runtime_error("Failed to write FMU index file: " + tempPath);
+        }
+    }
+    boost::filesystem::rename(tempPath, m_indexFile);
+}
+
+
+bool ImportIndex::IsCurrent(
+    const boost::filesystem::path& fmuPath,
+    const Entry& entry)
+{
+    boost::system::error_code ec;
+    const auto size = boost::filesystem::file_size(fmuPath, ec);
+    if (ec || size != entry.size) return false;
+    const auto modificationTime = boost::filesystem::last_write_time(fmuPath, ec);
+    return !ec && modificationTime == entry.modificationTime;
+}
+
+
+}} // namespace
@@ -0,0 +1,88 @@
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include <coral/fmi/import_index.hpp>
+#include <coral/util/filesystem.hpp>
+
+
+namespace
+{
+    void WriteFile(const boost::filesystem::path& path, const std::string& contents)
+    {
+        std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+        out << contents;
+    }
+
+    coral::model::SlaveTypeDescription MakeDescription(const std::string& name)
+    {
+        std::vector<coral::model::VariableDescription> variables;
+        variables.emplace_back(
+            0, "x", coral::model::REAL_DATATYPE,
+            coral::model::OUTPUT_CAUSALITY, coral::model::CONTINUOUS_VARIABILITY);
+        return coral::model::SlaveTypeDescription(
+            name, name + "-uuid", "description", "author", "1.0", variables);
+    }
+}
+
+
+TEST(coral_fmi, ImportIndex)
+{
+    const auto tmp = coral::util::TempDir();
+    const auto indexFile = tmp.Path() / "index" / "fmus.idx";
+    const auto fmu1 = tmp.Path() / "one.fmu";
+    const auto fmu2 = tmp.Path() / "two.fmu";
+    const auto fmu3 = tmp.Path() / "three.fmu";
+    WriteFile(fmu1, "1");
+    WriteFile(fmu2, "22");
+    WriteFile(fmu3, "333");
+
+    {
+        coral::fmi::ImportIndex index(indexFile);
+        EXPECT_EQ(nullptr, index.Find(fmu1));
+        index.Insert(fmu1, MakeDescription("one"));
+        index.Insert(fmu2, MakeDescription("two"));
+        index.Insert(fmu3, MakeDescription("three"));
+        const auto d = index.Find(fmu1);
+        ASSERT_NE(nullptr, d);
+        EXPECT_EQ("one", d->Name());
+        index.Save();
+    }
+    EXPECT_TRUE(boost::filesystem::exists(indexFile));
+
+    // Changing the size or the modification time of a file invalidates its
+    // entry, and so does removing it.
+    WriteFile(fmu2, "twotwo");
+    boost::filesystem::last_write_time(
+        fmu3,
+        boost::filesystem::last_write_time(fmu3) + 10);
+    boost::filesystem::remove(fmu1);
+    {
+        coral::fmi::ImportIndex index(indexFile);
+        EXPECT_EQ(nullptr, index.Find(fmu1));
+        EXPECT_EQ(nullptr, index.Find(fmu2));
+        EXPECT_EQ(nullptr, index.Find(fmu3));
+
+        WriteFile(fmu1, "1");
+        index.Insert(fmu1, MakeDescription("uno"));
+        index.Save();
+    }
+    {
+        coral::fmi::ImportIndex index(indexFile);
+        const auto d = index.Find(fmu1);
+        ASSERT_NE(nullptr, d);
+        EXPECT_EQ("uno", d->Name());
+        EXPECT_EQ("uno-uuid", d->UUID());
+        ASSERT_EQ(1, std::distance(d->Variables().begin(), d->Variables().end()));
+        EXPECT_EQ("x", d->Variables().begin()->Name());
+        EXPECT_EQ(nullptr, index.Find(fmu2));
+    }
+
+    // A corrupt index file is ignored.
+    WriteFile(indexFile, "garbage");
+    coral::fmi::ImportIndex index(indexFile);
+    EXPECT_EQ(nullptr, index.Find(fmu1));
+}
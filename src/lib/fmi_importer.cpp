@@ -6,11 +6,18 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <coral/fmi/importer.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <limits>
 #include <new>
 #include <sstream>
+#include <vector>
 
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/filesystem.hpp>
@@ -34,15 +41,17 @@ namespace fmi
 
 
 std::shared_ptr<Importer> Importer::Create(
-    const boost::filesystem::path& cachePath)
+    const boost::filesystem::path& cachePath,
+    UnpackMode unpackMode)
 {
-    return std::shared_ptr<Importer>(new Importer(cachePath));
+    return std::shared_ptr<Importer>(new Importer(cachePath, unpackMode));
 }
 
 
-std::shared_ptr<Importer> Importer::Create()
+std::shared_ptr<Importer> Importer::Create(UnpackMode unpackMode)
 {
-    return std::shared_ptr<Importer>(new Importer(coral::util::TempDir()));
+    return std::shared_ptr<Importer>(
+        new Importer(coral::util::TempDir(), unpackMode));
 }
 
 
@@ -103,18 +112,23 @@ namespace
 }
 
 
-Importer::Importer(const boost::filesystem::path& cachePath)
+Importer::Importer(
+    const boost::filesystem::path& cachePath,
+    UnpackMode unpackMode)
     : m_callbacks{MakeCallbacks()}
     , m_handle{fmi_import_allocate_context(m_callbacks.get()), &fmi_import_free_context}
     , m_fmuDir{cachePath / "fmu"}
+    , m_lockDir{cachePath / "lock"}
     , m_workDir{cachePath / "tmp"}
+    , m_unpackMode{unpackMode}
+    , m_cacheSizeLimit{std::numeric_limits<std::uint64_t>::max()}
 {
     if (m_handle == nullptr) throw std::bad_alloc();
 }
 
 
-Importer::Importer(coral::util::TempDir tempDir)
-    : Importer{tempDir.Path()}
+Importer::Importer(coral::util::TempDir tempDir, UnpackMode unpackMode)
+    : Importer{tempDir.Path(), unpackMode}
 {
     m_tempCacheDir = std::make_unique<coral::util::TempDir>(std::move(tempDir));
 }
@@ -128,13 +142,58 @@ namespace
         std::string guid;
     };
 
+    // Returns the start tag of the root element of an XML file, rewritten
+    // as an empty-element tag, without reading the rest of the file.
+    std::string ReadRootStartTag(
+        const boost::filesystem::path& xmlFile,
+        const std::string& rootName)
+    {
+        std::ifstream file(xmlFile.string(), std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Failed to open file: " + xmlFile.string());
+        }
+        std::string text;
+        auto tagStart = std::string::npos;
+        std::size_t pos = 0;
+        char quote = 0;
+        char buffer[4096];
+        while (file.read(buffer, sizeof(buffer)), file.gcount() > 0) {
+            text.append(buffer, static_cast<std::size_t>(file.gcount()));
+            if (tagStart == std::string::npos) {
+                tagStart = text.find('<' + rootName);
+                if (tagStart == std::string::npos) continue;
+                pos = tagStart;
+            }
+            // Attribute values may contain '>'.
+            for (; pos < text.size(); ++pos) {
+                const char c = text[pos];
+                if (quote) {
+                    if (c == quote) quote = 0;
+                } else if (c == '"' || c == '\'') {
+                    quote = c;
+                } else if (c == '>') {
+                    auto tag = text.substr(tagStart, pos - tagStart);
+                    if (tag.back() == '/') tag.pop_back();
+                    return tag + "/>";
+                }
+            }
+        }
+        throw std::runtime_error(
+            "Invalid " + xmlFile.filename().string() + "; "
+            + rootName + " element not found");
+    }
+
     // Reads the 'fmiVersion' and 'guid' attributes from the XML file.
+    // Only the root element's start tag is parsed, since FMI Library will
+    // parse the whole file later anyway.
     MinimalModelDescription PeekModelDescription(
         const boost::filesystem::path& fmuUnpackDir)
     {
         const auto xmlFile = fmuUnpackDir / "modelDescription.xml";
+        std::istringstream rootTag(
+            ReadRootStartTag(xmlFile, "fmiModelDescription"));
         boost::property_tree::ptree xml;
-        boost::property_tree::read_xml(xmlFile.string(), xml);
+        boost::property_tree::read_xml(rootTag, xml);
 
         MinimalModelDescription md;
 
@@ -167,33 +226,201 @@ namespace
         return md;
     }
 
-    // Replaces all characters which are not printable ASCII characters or
-    // not valid for use in a path with their percent-encoded equivalents.
-    // References:
-    //     https://en.wikipedia.org/wiki/Percent-encoding
-    //     https://msdn.microsoft.com/en-us/library/aa365247.aspx
-    std::string SanitisePath(const std::string& str)
+    // The name of the subdirectory of an FMU's 'binaries' directory which
+    // holds the binaries for the platform we're running on.
+    const char* BinariesPlatform()
     {
-        CORAL_INPUT_CHECK(!str.empty());
-        std::ostringstream sanitised;
-        sanitised.fill('0');
-        sanitised << std::hex;
-        for (const char c : str) {
-            if (c < 0x20 || c > 0x7E
-#ifdef _WIN32
-                || c == '<'  || c == '>' || c == ':' || c == '"' || c == '/'
-                || c == '\\' || c == '|' || c == '?' || c == '*'
+#if defined(_WIN64)
+        return "win64";
+#elif defined(_WIN32)
+        return "win32";
+#elif defined(__APPLE__)
+        return sizeof(void*) == 8 ? "darwin64" : "darwin32";
+#else
+        return sizeof(void*) == 8 ? "linux64" : "linux32";
 #endif
-            ) {
-                sanitised
-                    << '%'
-                    << std::setw(2)
-                    << static_cast<int>(static_cast<unsigned char>(c));
-            } else {
-                sanitised << c;
+    }
+
+    // A file which is placed in the unpack directory of a selectively
+    // imported FMU, to distinguish it from a fully unpacked one.
+    const char* const SELECTIVE_UNPACK_MARKER = ".coral_selective";
+
+    // Leftovers in the temporary directory which are older than this are
+    // assumed to be from an interrupted unpacking, and may be removed.
+    const auto STALE_TEMP_FILE_AGE = std::chrono::hours(24);
+
+    // The prefixes of the archive entries which are unpacked up front in
+    // selective mode.
+    std::vector<std::string> SelectivePrefixes()
+    {
+        return std::vector<std::string>{
+            "modelDescription.xml",
+            std::string("binaries/") + BinariesPlatform() + '/'
+        };
+    }
+
+    // Computes a key which identifies the contents of an FMU, for use as the
+    // name of its directory in the cache.  Rather than reading the entire
+    // file, this is a 64-bit FNV-1a hash of the name, size and CRC-32 of each
+    // entry, as listed in the archive's central directory.
+    std::string ContentKey(const coral::util::zip::Archive& zip)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        const auto add = [&hash] (const void* data, std::size_t size) {
+            const auto bytes = static_cast<const unsigned char*>(data);
+            for (std::size_t i = 0; i < size; ++i) {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+        };
+        const auto entryCount = zip.EntryCount();
+        for (coral::util::zip::EntryIndex i = 0; i < entryCount; ++i) {
+            const auto name = zip.EntryName(i);
+            const std::uint64_t size = zip.EntrySize(i);
+            const std::uint32_t crc = zip.EntryCRC(i);
+            add(name.c_str(), name.size() + 1);
+            add(&size, sizeof(size));
+            add(&crc, sizeof(crc));
+        }
+        std::ostringstream key;
+        key << std::hex << std::setw(16) << std::setfill('0') << hash;
+        return key.str();
+    }
+
+    // Moves the files and directories in `source` which don't already exist
+    // in `target` into it, recursing into directories which exist in both.
+    // Each move is a rename, so nobody sees partially written files.
+    void MoveMissing(
+        const boost::filesystem::path& source,
+        const boost::filesystem::path& target)
+    {
+        const auto children = std::vector<boost::filesystem::path>(
+            boost::filesystem::directory_iterator(source),
+            boost::filesystem::directory_iterator());
+        for (const auto& child : children) {
+            const auto targetChild = target / child.filename();
+            if (!boost::filesystem::exists(targetChild)) {
+                boost::system::error_code ec;
+                boost::filesystem::rename(child, targetChild, ec);
+                // Another importer may have beaten us to it, which is fine.
+                if (ec && !boost::filesystem::exists(targetChild)) {
+                    throw boost::filesystem::filesystem_error(
+                        "Failed to move unpacked FMU contents into place",
+                        child,
+                        targetChild,
+                        ec);
+                }
+            } else if (boost::filesystem::is_directory(child) &&
+                boost::filesystem::is_directory(targetChild))
+            {
+                MoveMissing(child, targetChild);
             }
         }
-        return sanitised.str();
+    }
+
+    // Creates a uniquely named directory under `workDir`.
+    boost::filesystem::path MakeWorkDir(const boost::filesystem::path& workDir)
+    {
+        const auto dir = workDir / coral::util::RandomUUID();
+        boost::filesystem::create_directories(dir);
+        return dir;
+    }
+
+    // Extracts the archive entries whose names begin with `prefixes` and
+    // adds those which are missing from `unpackDir` to it.
+    void UnpackMissing(
+        const coral::util::zip::Archive& zip,
+        const std::vector<std::string>& prefixes,
+        const boost::filesystem::path& unpackDir,
+        const boost::filesystem::path& workDir)
+    {
+        const auto tempDir = MakeWorkDir(workDir);
+        const auto removeTempDir = coral::util::OnScopeExit([&](){
+            boost::system::error_code ignored;
+            boost::filesystem::remove_all(tempDir, ignored);
+        });
+        zip.ExtractMatching(prefixes, tempDir, 0);
+        MoveMissing(tempDir, unpackDir);
+    }
+
+    // Unpacks an FMU to a temporary directory and then renames it to
+    // `unpackDir`, so the unpack directory never exists in an incomplete
+    // state.
+    void Unpack(
+        const coral::util::zip::Archive& zip,
+        UnpackMode unpackMode,
+        const boost::filesystem::path& unpackDir,
+        const boost::filesystem::path& workDir)
+    {
+        const auto tempDir = MakeWorkDir(workDir);
+        const auto removeTempDir = coral::util::OnScopeExit([&](){
+            boost::system::error_code ignored;
+            boost::filesystem::remove_all(tempDir, ignored);
+        });
+        if (unpackMode == UnpackMode::full) {
+            zip.ExtractAll(tempDir, 0);
+        } else {
+            const auto marker = tempDir / SELECTIVE_UNPACK_MARKER;
+            if (!std::ofstream(marker.string())) {
+                throw std::runtime_error("Failed to create file: " + marker.string());
+            }
+            zip.ExtractMatching(SelectivePrefixes(), tempDir, 0);
+        }
+        boost::filesystem::create_directories(unpackDir.parent_path());
+        boost::filesystem::rename(tempDir, unpackDir);
+    }
+
+    // Acquires a shared lock on the cache entry in `unpackDir`, first
+    // unpacking the FMU into it if necessary.  `unpacked` is set to whether
+    // we did.
+    //
+    // The lock file is removed when the entry is evicted from the cache, so
+    // a lock which turns out to be on a removed file is acquired anew.
+    std::unique_ptr<coral::util::FileLock> AcquireCacheEntry(
+        const coral::util::zip::Archive& zip,
+        UnpackMode unpackMode,
+        const boost::filesystem::path& unpackDir,
+        const boost::filesystem::path& lockFile,
+        const boost::filesystem::path& workDir,
+        bool& unpacked)
+    {
+        using coral::util::FileLock;
+        using coral::util::FileLockMode;
+        unpacked = false;
+        boost::filesystem::create_directories(lockFile.parent_path());
+        for (;;) {
+            auto lock = std::make_unique<FileLock>(lockFile, FileLockMode::shared);
+            if (!lock->IsCurrent()) continue;
+            if (boost::filesystem::exists(unpackDir)) {
+                // The modification time of the lock file is the time of
+                // last use, for the purpose of cache eviction.
+                boost::system::error_code ignored;
+                boost::filesystem::last_write_time(lockFile, std::time(nullptr), ignored);
+                return lock;
+            }
+            lock.reset();
+
+            // Only one importer unpacks the FMU, while the others wait here.
+            FileLock exclusiveLock(lockFile, FileLockMode::exclusive);
+            if (exclusiveLock.IsCurrent() && !boost::filesystem::exists(unpackDir)) {
+                Unpack(zip, unpackMode, unpackDir, workDir);
+                unpacked = true;
+            }
+        }
+    }
+
+    std::uint64_t DirectorySize(const boost::filesystem::path& dir)
+    {
+        std::uint64_t size = 0;
+        for (auto it = boost::filesystem::recursive_directory_iterator(dir);
+             it != boost::filesystem::recursive_directory_iterator();
+             ++it)
+        {
+            if (boost::filesystem::is_regular_file(it->status())) {
+                size += boost::filesystem::file_size(it->path());
+            }
+        }
+        return size;
     }
 }
 
@@ -205,21 +432,38 @@ std::shared_ptr<FMU> Importer::Import(const boost::filesystem::path& fmuPath)
     if (pit != end(m_pathCache)) return pit->second.lock();
 
     const auto zip = coral::util::zip::Archive(fmuPath);
-    const auto tempMdDir = m_workDir / coral::util::RandomUUID();
-    boost::filesystem::create_directories(tempMdDir);
-    const auto removeTempMdDir = coral::util::OnScopeExit([&](){
-        boost::system::error_code ignored;
-        boost::filesystem::remove_all(tempMdDir, ignored);
-    });
-
-    const auto modelDescriptionIndex = zip.FindEntry("modelDescription.xml");
-    if (modelDescriptionIndex == coral::util::zip::INVALID_ENTRY_INDEX) {
+    if (zip.FindEntry("modelDescription.xml") == coral::util::zip::INVALID_ENTRY_INDEX) {
         throw std::runtime_error(
             fmuPath.string() + " does not contain modelDescription.xml");
     }
-    zip.ExtractFileTo(modelDescriptionIndex, tempMdDir);
+    const auto key = ContentKey(zip);
+    const auto fmuUnpackDir = m_fmuDir / key;
+    bool unpacked = false;
+    auto cacheLock = AcquireCacheEntry(
+        zip, m_unpackMode, fmuUnpackDir, m_lockDir / key, m_workDir, unpacked);
+    if (unpacked && m_cacheSizeLimit < std::numeric_limits<std::uint64_t>::max()) {
+        CleanCache(m_cacheSizeLimit);
+    }
+
+    // An FMU which was unpacked selectively may need more of its contents
+    // now.  These are added alongside the existing contents, which may be in
+    // use by other importers.
+    const auto selectiveMarker = fmuUnpackDir / SELECTIVE_UNPACK_MARKER;
+    if (boost::filesystem::exists(selectiveMarker)) {
+        if (m_unpackMode == UnpackMode::full) {
+            UnpackMissing(
+                zip, std::vector<std::string>{std::string()}, fmuUnpackDir, m_workDir);
+            boost::system::error_code ignored;
+            boost::filesystem::remove(selectiveMarker, ignored);
+        } else {
+            if (!boost::filesystem::exists(fmuUnpackDir / "binaries" / BinariesPlatform())) {
+                UnpackMissing(zip, SelectivePrefixes(), fmuUnpackDir, m_workDir);
+            }
+            m_deferredUnpacks[fmuUnpackDir] = fmuPath;
+        }
+    }
 
-    const auto minModelDesc = PeekModelDescription(tempMdDir);
+    const auto minModelDesc = PeekModelDescription(fmuUnpackDir);
     if (minModelDesc.fmiVersion == FMIVersion::unknown) {
         throw std::runtime_error(
             "Unsupported FMI version for FMU '" + fmuPath.string() + "'");
@@ -227,26 +471,12 @@ std::shared_ptr<FMU> Importer::Import(const boost::filesystem::path& fmuPath)
     auto git = m_guidCache.find(minModelDesc.guid);
     if (git != end(m_guidCache)) return git->second.lock();
 
-    const auto fmuUnpackDir = m_fmuDir / SanitisePath(minModelDesc.guid);
-    if (!boost::filesystem::exists(fmuUnpackDir) ||
-        !boost::filesystem::exists(fmuUnpackDir / "modelDescription.xml") ||
-        boost::filesystem::last_write_time(fmuPath) > boost::filesystem::last_write_time(fmuUnpackDir / "modelDescription.xml"))
-    {
-        boost::filesystem::create_directories(fmuUnpackDir);
-        try {
-            zip.ExtractAll(fmuUnpackDir);
-        } catch (...) {
-            boost::system::error_code ignoreErrors;
-            boost::filesystem::remove_all(fmuUnpackDir, ignoreErrors);
-            throw;
-        }
-    }
-
     auto fmu = minModelDesc.fmiVersion == FMIVersion::v1_0
         ? std::shared_ptr<FMU>(new FMU1(shared_from_this(), fmuUnpackDir))
         : std::shared_ptr<FMU>(new FMU2(shared_from_this(), fmuUnpackDir));
     m_pathCache[fmuPath] = fmu;
     m_guidCache[minModelDesc.guid] = fmu;
+    m_cacheLocks[fmuUnpackDir] = CacheEntryLock{fmu, std::move(cacheLock)};
     return fmu;
 }
 
@@ -272,27 +502,111 @@ std::shared_ptr<FMU> Importer::ImportUnpacked(
 }
 
 
-void Importer::CleanCache()
+void Importer::CompleteUnpacking(const FMU& fmu)
+{
+    const auto& fmuDir = fmu.Directory();
+    const auto it = m_deferredUnpacks.find(fmuDir);
+    if (it == m_deferredUnpacks.end()) return;
+
+    if (!boost::filesystem::exists(fmuDir / "resources")) {
+        CORAL_LOG_DEBUG(boost::format("Unpacking resources of %s")
+            % it->second.string());
+        const auto zip = coral::util::zip::Archive(it->second);
+        if (ContentKey(zip) != fmuDir.filename().string()) {
+            throw std::runtime_error(
+                "FMU file has changed since it was imported: "
+                + it->second.string());
+        }
+        UnpackMissing(
+            zip, std::vector<std::string>{"resources/"}, fmuDir, m_workDir);
+    }
+    m_deferredUnpacks.erase(it);
+}
+
+
+void Importer::CleanCache(std::uint64_t maxSize)
 {
-    // Remove unused FMUs
+    PrunePtrCaches();
+    boost::system::error_code ec;
     if (boost::filesystem::exists(m_fmuDir)) {
-        boost::system::error_code ignoredError;
+        struct Entry
+        {
+            boost::filesystem::path dir;
+            std::time_t lastUsed;
+            std::uint64_t size;
+        };
+        std::vector<Entry> entries;
+        std::uint64_t totalSize = 0;
         for (auto it = boost::filesystem::directory_iterator(m_fmuDir);
              it != boost::filesystem::directory_iterator();
              ++it)
         {
-            if (m_guidCache.count(it->path().filename().string()) == 0) {
-                boost::filesystem::remove_all(*it, ignoredError);
+            if (!boost::filesystem::is_directory(it->status())) continue;
+            auto lastUsed = boost::filesystem::last_write_time(
+                m_lockDir / it->path().filename(), ec);
+            if (ec) lastUsed = boost::filesystem::last_write_time(it->path(), ec);
+            try {
+                const auto size = DirectorySize(it->path());
+                entries.push_back(Entry{it->path(), ec ? 0 : lastUsed, size});
+                totalSize += size;
+            } catch (const boost::filesystem::filesystem_error&) {
+                // Probably removed by someone else while we were looking.
             }
         }
-        if (boost::filesystem::is_empty(m_fmuDir)) {
-            boost::filesystem::remove(m_fmuDir, ignoredError);
+        std::sort(
+            entries.begin(),
+            entries.end(),
+            [] (const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+
+        boost::filesystem::create_directories(m_lockDir);
+        for (const auto& entry : entries) {
+            if (totalSize <= maxSize) break;
+            // Entries which are in use, by us or anyone else, are locked.
+            const auto lockFile = m_lockDir / entry.dir.filename();
+            coral::util::FileLock lock(
+                lockFile, coral::util::FileLockMode::exclusive, false);
+            if (!lock.Locked() || !lock.IsCurrent()) continue;
+            // Move the directory out of the way before removing it, so
+            // nobody sees it half-removed.
+            boost::filesystem::create_directories(m_workDir);
+            const auto trash = m_workDir / coral::util::RandomUUID();
+            boost::filesystem::rename(entry.dir, trash, ec);
+            if (ec) continue;
+            CORAL_LOG_DEBUG(boost::format("Removing %s from FMU cache")
+                % entry.dir.filename().string());
+            boost::filesystem::remove_all(trash, ec);
+            totalSize -= entry.size;
+            // The lock file is removed while we still hold the lock.  Anyone
+            // waiting for it will find that it is no longer current.  The
+            // FMU directory itself is left in place, even if it is now
+            // empty, since other importers may be unpacking into it.
+            boost::filesystem::remove(lockFile, ec);
         }
     }
 
-    // Delete the temp-files directory
-    boost::system::error_code ec;
-    boost::filesystem::remove_all(m_workDir, ec);
+    // Remove leftovers from unpacking which was interrupted.  Other importers
+    // may be unpacking FMUs right now, so only old ones are removed.
+    if (boost::filesystem::exists(m_workDir)) {
+        const auto staleTime = std::chrono::system_clock::to_time_t(
+            std::chrono::system_clock::now() - STALE_TEMP_FILE_AGE);
+        for (auto it = boost::filesystem::directory_iterator(m_workDir);
+             it != boost::filesystem::directory_iterator();
+             ++it)
+        {
+            const auto modified = boost::filesystem::last_write_time(it->path(), ec);
+            if (!ec && modified < staleTime) {
+                boost::filesystem::remove_all(it->path(), ec);
+            }
+        }
+    }
+}
+
+
+void Importer::SetCacheSizeLimit(std::uint64_t maxSize)
+{
+    m_cacheSizeLimit = maxSize > 0
+        ? maxSize
+        : std::numeric_limits<std::uint64_t>::max();
 }
 
 
@@ -318,6 +632,14 @@ void Importer::PrunePtrCaches()
         if (it->second.expired()) m_guidCache.erase(it++);
         else ++it;
     }
+    for (auto it = begin(m_cacheLocks); it != end(m_cacheLocks);) {
+        if (it->second.fmu.expired()) {
+            m_deferredUnpacks.erase(it->first);
+            m_cacheLocks.erase(it++);
+        } else {
+            ++it;
+        }
+    }
 }
 
 
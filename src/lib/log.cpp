@@ -6,12 +6,15 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <coral/log.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <mutex>
 #include <vector>
 
 #include <boost/algorithm/string.hpp>
 
+#include <coral/error.hpp>
+
 
 namespace coral
 {
@@ -31,6 +34,22 @@ Level ParseLevel(std::string str)
 }
 
 
+Category ParseCategory(std::string str)
+{
+    boost::trim(str);
+    if (boost::iequals(str, "general"))      return general;
+    else if (boost::iequals(str, "net"))     return net;
+    else if (boost::iequals(str, "bus"))     return bus;
+    else if (boost::iequals(str, "fmi"))     return fmi;
+    else throw std::runtime_error("Invalid log category: " + str);
+}
+
+
+// Must match the initial state of g_sinks and g_categoryLevels below.
+std::atomic<int> detail::effectiveLevels[detail::categoryCount] =
+    {{error}, {error}, {error}, {error}};
+
+
 namespace
 {
     struct Sink
@@ -41,6 +60,21 @@ namespace
     std::mutex g_mutex;
     std::vector<Sink> g_sinks{{error, CLogPtr()}};
     bool g_sinksAdded = false;
+    Level g_categoryLevels[detail::categoryCount] = {trace, trace, trace, trace};
+
+    // Recomputes detail::effectiveLevels.  g_mutex must be locked.
+    void UpdateEffectiveLevels()
+    {
+        auto minSinkLevel = error;
+        for (const auto& sink : g_sinks) {
+            minSinkLevel = std::min(minSinkLevel, sink.level);
+        }
+        for (int c = 0; c < detail::categoryCount; ++c) {
+            detail::effectiveLevels[c].store(
+                std::max(minSinkLevel, g_categoryLevels[c]),
+                std::memory_order_relaxed);
+        }
+    }
 
     // Returns a space-padded, human-readable string for each log level.
     const char* LevelNamePadded(Level level)
@@ -58,6 +92,7 @@ namespace
 
 
 #define CORAL_IMPLEMENT_LOG \
+    if (!IsEnabled(level)) return; \
     std::lock_guard<std::mutex> lock(g_mutex); \
     for (const auto& sink : g_sinks) { \
         if (level >= sink.level) { \
@@ -68,6 +103,7 @@ namespace
     }
 
 #define CORAL_IMPLEMENT_LOG_LOC \
+    if (!IsEnabled(level, category)) return; \
     std::lock_guard<std::mutex> lock(g_mutex); \
     for (const auto& sink : g_sinks) { \
         if (level >= sink.level) { \
@@ -97,19 +133,19 @@ void Log(Level level, const boost::format& message) noexcept
 }
 
 
-void detail::LogLoc(Level level, const char* file, int line, const char* message) noexcept
+void detail::LogLoc(Level level, Category category, const char* file, int line, const char* message) noexcept
 {
     CORAL_IMPLEMENT_LOG_LOC
 }
 
 
-void detail::LogLoc(Level level, const char* file, int line, const std::string& message) noexcept
+void detail::LogLoc(Level level, Category category, const char* file, int line, const std::string& message) noexcept
 {
     CORAL_IMPLEMENT_LOG_LOC
 }
 
 
-void detail::LogLoc(Level level, const char* file, int line, const boost::format& message) noexcept
+void detail::LogLoc(Level level, Category category, const char* file, int line, const boost::format& message) noexcept
 {
     CORAL_IMPLEMENT_LOG_LOC
 }
@@ -125,6 +161,31 @@ void AddSink(std::shared_ptr<std::ostream> stream, Level level)
     } else {
         g_sinks.push_back({level, stream});
     }
+    UpdateEffectiveLevels();
+}
+
+
+void RemoveSink(const std::shared_ptr<std::ostream>& stream)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_sinks.erase(
+        std::remove_if(g_sinks.begin(), g_sinks.end(),
+            [&stream] (const Sink& s) { return s.stream == stream; }),
+        g_sinks.end());
+    if (g_sinks.empty()) {
+        g_sinks.push_back({error, CLogPtr()});
+        g_sinksAdded = false;
+    }
+    UpdateEffectiveLevels();
+}
+
+
+void SetCategoryLevel(Category category, Level level)
+{
+    CORAL_INPUT_CHECK(category >= 0 && category < detail::categoryCount);
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_categoryLevels[category] = level;
+    UpdateEffectiveLevels();
 }
 
 
@@ -0,0 +1,71 @@
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <gtest/gtest.h>
+
+#include <coral/log.hpp>
+#include <coral/util.hpp>
+
+
+TEST(coral_log, ParseCategory)
+{
+    EXPECT_EQ(coral::log::general, coral::log::ParseCategory("general"));
+    EXPECT_EQ(coral::log::net, coral::log::ParseCategory(" NET "));
+    EXPECT_EQ(coral::log::bus, coral::log::ParseCategory("Bus"));
+    EXPECT_EQ(coral::log::fmi, coral::log::ParseCategory("fmi"));
+    EXPECT_THROW(coral::log::ParseCategory("foo"), std::runtime_error);
+}
+
+
+TEST(coral_log, CategoryFiltering)
+{
+    auto stream = std::make_shared<std::ostringstream>();
+    coral::log::AddSink(stream, coral::log::info);
+    const auto cleanup = coral::util::OnScopeExit([stream] () {
+        coral::log::SetCategoryLevel(coral::log::net, coral::log::trace);
+        coral::log::RemoveSink(stream);
+    });
+    EXPECT_TRUE(coral::log::IsEnabled(coral::log::info));
+    EXPECT_TRUE(coral::log::IsEnabled(coral::log::info, coral::log::net));
+    EXPECT_FALSE(coral::log::IsEnabled(coral::log::debug, coral::log::bus));
+
+    coral::log::SetCategoryLevel(coral::log::net, coral::log::warning);
+    EXPECT_FALSE(coral::log::IsEnabled(coral::log::info, coral::log::net));
+    EXPECT_TRUE(coral::log::IsEnabled(coral::log::warning, coral::log::net));
+    EXPECT_TRUE(coral::log::IsEnabled(coral::log::info, coral::log::bus));
+
+    // The arguments to a filtered-out log statement are never evaluated.
+    int evaluations = 0;
+    const auto message = [&] () { ++evaluations; return std::string("foo"); };
+    CORAL_LOG_CAT_DEBUG(coral::log::net, message());
+    EXPECT_EQ(0, evaluations);
+}
+
+
+TEST(coral_log, PerCategoryLevels)
+{
+    auto stream = std::make_shared<std::ostringstream>();
+    coral::log::AddSink(stream, coral::log::trace);
+    coral::log::SetCategoryLevel(coral::log::general, coral::log::error);
+    const auto cleanup = coral::util::OnScopeExit([stream] () {
+        coral::log::SetCategoryLevel(coral::log::general, coral::log::trace);
+        coral::log::RemoveSink(stream);
+    });
+    EXPECT_FALSE(coral::log::IsEnabled(coral::log::debug));
+    EXPECT_TRUE(coral::log::IsEnabled(coral::log::trace, coral::log::net));
+
+    // This is what the CORAL_LOG_CAT_xxx macros expand to, when enabled.
+    coral::log::detail::LogLoc(
+        coral::log::trace, coral::log::net, __FILE__, __LINE__, "net message");
+    coral::log::detail::LogLoc(
+        coral::log::debug, coral::log::general, __FILE__, __LINE__, "general message");
+    coral::log::Log(coral::log::info, "plain message");
+    coral::log::Log(coral::log::error, "error message");
+
+    const auto output = stream->str();
+    EXPECT_NE(std::string::npos, output.find("net message"));
+    EXPECT_EQ(std::string::npos, output.find("general message"));
+    EXPECT_EQ(std::string::npos, output.find("plain message"));
+    EXPECT_NE(std::string::npos, output.find("error message"));
+}
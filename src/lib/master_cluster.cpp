@@ -6,8 +6,14 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <coral/master/cluster.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <stdexcept>
 #include <unordered_map>
+#include <utility>
 
 #include <zmq.hpp>
 
@@ -37,26 +43,170 @@ namespace master
 
 namespace
 {
+    // The service type used by slave provider beacons.
+    const auto SLAVEPROVIDER_SERVICE_TYPE =
+        std::string("no.sintef.viproma.coral.slave_provider");
+
+    // The service type used by the beacons which advertise the catalog
+    // versions of slave providers.
+    const auto SLAVEPROVIDER_CATALOG_SERVICE_TYPE =
+        std::string("no.sintef.viproma.coral.slave_provider_catalog");
+
     // The period of silence before a slave provider is considered "lost".
     const auto SLAVEPROVIDER_TIMEOUT = std::chrono::minutes(10);
 
+    // The timeout for the slave type requests which are sent to newly
+    // discovered slave providers.
+    const auto SLAVE_TYPE_QUERY_TIMEOUT = std::chrono::seconds(10);
+
+    // How long to wait for the catalog version of a newly discovered slave
+    // provider before assuming that it doesn't advertise one.  This is a bit
+    // longer than the slave providers' beacon period.
+    const auto CATALOG_VERSION_WAIT = std::chrono::milliseconds(1500);
+
+    // How long WaitForSlaveTypes() waits for more slave providers to appear
+    // when no particular slave types are required.
+    const auto DISCOVERY_SETTLE_TIME = std::chrono::milliseconds(250);
+
+    // How often pending WaitForSlaveTypes() calls check for timeouts.
+    const auto WAIT_CHECK_INTERVAL = std::chrono::milliseconds(20);
+
     // Mapping from slave provider IDs to slave provider client objects.
     typedef std::unordered_map<
             std::string,
             coral::bus::SlaveProviderClient>
         SlaveProviderMap;
 
+    // The slave type catalog, i.e., the slave types offered by each slave
+    // provider.  Slave providers advertise a catalog version with a separate
+    // beacon, and a provider's catalog is only requested when the provider
+    // is discovered or its version changes.  The catalogs don't include
+    // variable descriptions; full descriptions are requested the first time
+    // they are needed, and cached by slave type UUID.  (A slave type's UUID
+    // identifies its contents, so a cached description never goes stale.)
+    //
+    // The class also keeps track of pending WaitForSlaveTypes() calls and
+    // other operations which have to wait for replies from slave providers.
+    class SlaveTypeCatalog
+    {
+    public:
+        explicit SlaveTypeCatalog(coral::net::Reactor& reactor);
+        ~SlaveTypeCatalog() noexcept;
+
+        SlaveTypeCatalog(const SlaveTypeCatalog&) = delete;
+        SlaveTypeCatalog& operator=(const SlaveTypeCatalog&) = delete;
+
+        // Registers a slave provider which has just been discovered, or
+        // whose address has changed, and requests its catalog unless we
+        // already have the current version.  If the slave provider's catalog
+        // version hasn't been received within CATALOG_VERSION_WAIT, we assume
+        // it doesn't advertise one (i.e., it is an older version), and
+        // request full descriptions of all its slave types instead.
+        void ProviderDiscovered(
+            const std::string& slaveProviderID,
+            coral::bus::SlaveProviderClient& client);
+
+        // Forgets about a slave provider.
+        void ProviderLost(const std::string& slaveProviderID);
+
+        // Records the catalog version advertised by a slave provider, which
+        // may or may not have been discovered yet, and requests its catalog
+        // if the version has changed.
+        void CatalogVersionReceived(
+            const std::string& slaveProviderID,
+            std::uint32_t catalogVersion);
+
+        // Forgets the catalog version of a slave provider.
+        void CatalogVersionLost(const std::string& slaveProviderID);
+
+        // Sets `promise` to true when all the named slave types are
+        // available, or to false if `timeout` passes first.
+        void WaitForSlaveTypes(
+            const std::vector<std::string>& slaveTypeNames,
+            std::chrono::milliseconds timeout,
+            std::promise<bool> promise);
+
+        // Fulfils `promise` with the slave types offered by the known slave
+        // providers, once any catalog requests in progress have completed.
+        // If `slaveTypeUUIDs` is nonempty, only those types are included, and
+        // it is an error if any of them are unknown.  If `includeVariables`
+        // is true, any descriptions which aren't cached are requested.
+        void GetSlaveTypes(
+            const std::vector<std::string>& slaveTypeUUIDs,
+            bool includeVariables,
+            std::chrono::milliseconds timeout,
+            std::promise<std::vector<ProviderCluster::SlaveType>> promise);
+
+    private:
+        static const int NO_QUERY = -1;
+
+        struct Provider
+        {
+            Provider() noexcept;
+
+            coral::bus::SlaveProviderClient* client;
+            // The catalog version we have, or have requested, if any.
+            bool hasCatalogVersion;
+            std::uint32_t catalogVersion;
+            bool catalogKnown;
+            int pendingQueryID;
+            // The timer for falling back to full descriptions, if we're
+            // still waiting for the catalog version.
+            int fallbackTimerID;
+            // The slave types, without variable descriptions.
+            std::vector<coral::model::SlaveTypeDescription> slaveTypes;
+        };
+
+        struct Waiter
+        {
+            std::function<bool(std::chrono::steady_clock::time_point)> isReady;
+            std::chrono::steady_clock::time_point deadline;
+            std::function<void(bool)> onDone;
+        };
+
+        // Calls `onDone(true)` once `isReady()` returns true, or
+        // `onDone(false)` at `deadline` if it hasn't by then.
+        void AddWaiter(
+            std::function<bool(std::chrono::steady_clock::time_point)> isReady,
+            std::chrono::steady_clock::time_point deadline,
+            std::function<void(bool)> onDone);
+        void CheckWaiters();
+
+        void UpdateCatalog(const std::string& slaveProviderID);
+        void RequestCatalog(
+            const std::string& slaveProviderID,
+            const std::uint32_t* catalogVersion);
+
+        bool HasPendingQueries() const;
+        bool HasSlaveTypes(
+            const std::vector<std::string>& slaveTypeNames,
+            std::chrono::steady_clock::time_point now) const;
+        std::vector<ProviderCluster::SlaveType> CollectSlaveTypes(
+            const std::vector<std::string>& slaveTypeUUIDs) const;
+        void FetchDescriptions(
+            const std::vector<ProviderCluster::SlaveType>& slaveTypes,
+            std::chrono::milliseconds timeout,
+            std::chrono::steady_clock::time_point deadline,
+            std::function<void(std::exception_ptr)> onComplete);
+
+        coral::net::Reactor& m_reactor;
+        std::unordered_map<std::string, Provider> m_providers;
+        std::unordered_map<std::string, std::uint32_t> m_catalogVersions;
+        std::unordered_map<std::string, coral::model::SlaveTypeDescription> m_descriptions;
+        int m_nextQueryID;
+        std::chrono::steady_clock::time_point m_lastDiscovery;
+
+        std::vector<Waiter> m_waiters;
+        int m_checkTimerID;
+    };
+
     // Forward declarations of internal functions, definitions are
     // further down.
     void SetupSlaveProviderTracking(
         coral::net::service::Tracker& tracker,
         SlaveProviderMap& slaveProviderMap,
+        SlaveTypeCatalog& slaveTypeCatalog,
         coral::net::Reactor& reactor);
-    void HandleGetSlaveTypes(
-        std::chrono::milliseconds timeout,
-        SlaveProviderMap& slaveProviders,
-        std::promise<std::vector<coral::master::ProviderCluster::SlaveType>> promise)
-        noexcept;
     void HandleInstantiateSlave(
         const std::string& slaveProviderID,
         const std::string& slaveTypeUUID,
@@ -65,6 +215,13 @@ namespace
         SlaveProviderMap& slaveProviders,
         std::promise<coral::net::SlaveLocator> promise)
         noexcept;
+    void HandleInstantiateSlaves(
+        const std::vector<coral::master::ProviderCluster::InstantiationRequest>& requests,
+        std::chrono::milliseconds instantiationTimeout,
+        std::chrono::milliseconds commTimeout,
+        SlaveProviderMap& slaveProviders,
+        std::promise<std::vector<coral::net::SlaveLocator>> promise)
+        noexcept;
 
 
 }
@@ -85,6 +242,8 @@ public:
             (coral::net::Reactor& reactor, BgData& bgData, std::promise<void> status)
         {
             try {
+                bgData.slaveTypeCatalog =
+                    std::make_unique<SlaveTypeCatalog>(reactor);
                 bgData.serviceTracker =
                     std::make_unique<coral::net::service::Tracker>(
                         reactor,
@@ -93,7 +252,18 @@ public:
                 SetupSlaveProviderTracking(
                     *bgData.serviceTracker,
                     bgData.slaveProviders,
+                    *bgData.slaveTypeCatalog,
                     reactor);
+                // Ask running slave providers to announce themselves now,
+                // rather than waiting for their next beacon.  If this fails,
+                // we'll still discover them, only later.
+                try {
+                    bgData.serviceTracker->Probe(SLAVEPROVIDER_SERVICE_TYPE);
+                    bgData.serviceTracker->Probe(SLAVEPROVIDER_CATALOG_SERVICE_TYPE);
+                } catch (const std::runtime_error& e) {
+                    coral::log::Log(coral::log::warning, boost::format(
+                        "Failed to probe for slave providers: %s") % e.what());
+                }
                 status.set_value();
             } catch (...) {
                 status.set_exception(std::current_exception());
@@ -108,17 +278,22 @@ public:
 
 
     std::vector<SlaveType> GetSlaveTypes(
+        const std::vector<std::string>& slaveTypeUUIDs,
+        bool includeVariables,
         std::chrono::milliseconds timeout)
     {
+        // Note: It is safe to capture by reference in the lambda because
+        // the present thread is blocked waiting for the operation to complete.
         return m_thread.Execute<std::vector<SlaveType>>(
-            [=] (
+            [&] (
                 coral::net::Reactor&,
                 BgData& bgData,
                 std::promise<std::vector<SlaveType>> result)
             {
-                HandleGetSlaveTypes(
+                bgData.slaveTypeCatalog->GetSlaveTypes(
+                    slaveTypeUUIDs,
+                    includeVariables,
                     timeout,
-                    bgData.slaveProviders,
                     std::move(result));
             }
         ).get();
@@ -148,9 +323,54 @@ public:
         ).get();
     }
 
+    bool WaitForSlaveTypes(
+        const std::vector<std::string>& slaveTypeNames,
+        std::chrono::milliseconds timeout)
+    {
+        // Note: It is safe to capture by reference in the lambda because
+        // the present thread is blocked waiting for the operation to complete.
+        return m_thread.Execute<bool>(
+            [&] (
+                coral::net::Reactor&,
+                BgData& bgData,
+                std::promise<bool> result)
+            {
+                bgData.slaveTypeCatalog->WaitForSlaveTypes(
+                    slaveTypeNames,
+                    timeout,
+                    std::move(result));
+            }
+        ).get();
+    }
+
+    std::vector<coral::net::SlaveLocator> InstantiateSlaves(
+        const std::vector<InstantiationRequest>& requests,
+        std::chrono::milliseconds timeout)
+    {
+        // Note: It is safe to capture by reference in the lambda because
+        // the present thread is blocked waiting for the operation to complete.
+        return m_thread.Execute<std::vector<coral::net::SlaveLocator>>(
+            [&] (
+                coral::net::Reactor&,
+                BgData& bgData,
+                std::promise<std::vector<coral::net::SlaveLocator>> result)
+            {
+                HandleInstantiateSlaves(
+                    requests,
+                    timeout,   // instantiation timeout
+                    2*timeout, // communication timeout
+                    bgData.slaveProviders,
+                    std::move(result));
+            }
+        ).get();
+    }
+
 private:
     struct BgData
     {
+        // Declared first, so it outlives the clients in `slaveProviders`,
+        // which hold completion handlers that refer to it.
+        std::unique_ptr<SlaveTypeCatalog> slaveTypeCatalog;
         SlaveProviderMap slaveProviders;
         // TODO: Replace std::unique_ptr with boost::optional (when we no longer
         //       need to support Boost < 1.56) or std::optional (when all our
@@ -191,7 +411,31 @@ ProviderCluster& ProviderCluster::operator=(ProviderCluster&& other) noexcept
 std::vector<ProviderCluster::SlaveType> ProviderCluster::GetSlaveTypes(
     std::chrono::milliseconds timeout)
 {
-    return m_private->GetSlaveTypes(timeout);
+    return m_private->GetSlaveTypes(std::vector<std::string>{}, true, timeout);
+}
+
+
+std::vector<ProviderCluster::SlaveType> ProviderCluster::GetSlaveTypes(
+    const std::vector<std::string>& slaveTypeUUIDs,
+    std::chrono::milliseconds timeout)
+{
+    CORAL_INPUT_CHECK(!slaveTypeUUIDs.empty());
+    return m_private->GetSlaveTypes(slaveTypeUUIDs, true, timeout);
+}
+
+
+std::vector<ProviderCluster::SlaveType> ProviderCluster::GetSlaveTypeCatalog(
+    std::chrono::milliseconds timeout)
+{
+    return m_private->GetSlaveTypes(std::vector<std::string>{}, false, timeout);
+}
+
+
+bool ProviderCluster::WaitForSlaveTypes(
+    const std::vector<std::string>& slaveTypeNames,
+    std::chrono::milliseconds timeout)
+{
+    return m_private->WaitForSlaveTypes(slaveTypeNames, timeout);
 }
 
 
@@ -207,6 +451,14 @@ coral::net::SlaveLocator ProviderCluster::InstantiateSlave(
 }
 
 
+std::vector<coral::net::SlaveLocator> ProviderCluster::InstantiateSlaves(
+    const std::vector<InstantiationRequest>& requests,
+    std::chrono::milliseconds timeout)
+{
+    return m_private->InstantiateSlaves(requests, timeout);
+}
+
+
 namespace // Internal functions
 {
 
@@ -215,16 +467,18 @@ namespace // Internal functions
 void SetupSlaveProviderTracking(
     coral::net::service::Tracker& tracker,
     SlaveProviderMap& slaveProviderMap,
+    SlaveTypeCatalog& slaveTypeCatalog,
     coral::net::Reactor& reactor)
 {
     const auto slaveProviderMapPtr = &slaveProviderMap;
+    const auto catalogPtr = &slaveTypeCatalog;
     const auto reactorPtr = &reactor;
 
     tracker.AddTrackedServiceType(
-        "no.sintef.viproma.coral.slave_provider",
+        SLAVEPROVIDER_SERVICE_TYPE,
         SLAVEPROVIDER_TIMEOUT,
         // Slave provider discovered:
-        [slaveProviderMapPtr, reactorPtr] (
+        [slaveProviderMapPtr, catalogPtr, reactorPtr] (
             const coral::net::ip::Address& address,
             const std::string& serviceType,
             const std::string& serviceID,
@@ -232,21 +486,23 @@ void SetupSlaveProviderTracking(
             std::size_t payloadSize)
         {
             if (payloadSize != 2) {
-                CORAL_LOG_TRACE("Ignoring slave provider beacon due to missing data");
+                CORAL_LOG_CAT_TRACE(coral::log::net,
+                    "Ignoring slave provider beacon due to missing data");
                 return;
             }
             const auto port = coral::util::DecodeUint16(payload);
-            slaveProviderMapPtr->insert(std::make_pair(
+            const auto it = slaveProviderMapPtr->insert(std::make_pair(
                 serviceID,
                 coral::bus::SlaveProviderClient{
                     *reactorPtr,
-                    coral::net::ip::Endpoint{address, port}}));
-            CORAL_LOG_TRACE(
+                    coral::net::ip::Endpoint{address, port}})).first;
+            CORAL_LOG_CAT_TRACE(coral::log::net,
                 boost::format("Slave provider discovered: %s @ %s:%d")
                 % serviceID % address.ToString() % port);
+            catalogPtr->ProviderDiscovered(serviceID, it->second);
         },
         // Slave provider port changed:
-        [slaveProviderMapPtr, reactorPtr] (
+        [slaveProviderMapPtr, catalogPtr, reactorPtr] (
             const coral::net::ip::Address& address,
             const std::string& serviceType,
             const std::string& serviceID,
@@ -254,128 +510,553 @@ void SetupSlaveProviderTracking(
             std::size_t payloadSize)
         {
             if (payloadSize != 2) {
-                CORAL_LOG_TRACE("Ignoring slave provider beacon due to missing data");
+                CORAL_LOG_CAT_TRACE(coral::log::net,
+                    "Ignoring slave provider beacon due to missing data");
                 return;
             }
             const auto port = coral::util::DecodeUint16(payload);
             slaveProviderMapPtr->erase(serviceID);
-            slaveProviderMapPtr->insert(std::make_pair(
+            const auto it = slaveProviderMapPtr->insert(std::make_pair(
                 serviceID,
                 coral::bus::SlaveProviderClient{
                     *reactorPtr,
-                    coral::net::ip::Endpoint{address, port}}));
-            CORAL_LOG_TRACE(
+                    coral::net::ip::Endpoint{address, port}})).first;
+            CORAL_LOG_CAT_TRACE(coral::log::net,
                 boost::format("Slave provider updated: %s @ %s:%d")
                 % serviceID % address.ToString() % port);
+            catalogPtr->ProviderDiscovered(serviceID, it->second);
         },
         // Slave provider disappeared:
-        [slaveProviderMapPtr] (
+        [slaveProviderMapPtr, catalogPtr] (
             const std::string& serviceType,
             const std::string& serviceID)
         {
             slaveProviderMapPtr->erase(serviceID);
-            CORAL_LOG_TRACE(boost::format("Slave provider disappeared: %s")
+            catalogPtr->ProviderLost(serviceID);
+            CORAL_LOG_CAT_TRACE(coral::log::net, boost::format("Slave provider disappeared: %s")
                 % serviceID);
         });
+
+    // The catalog version is advertised separately, so that the slave
+    // provider beacons remain compatible with older masters.
+    const auto onCatalogVersion = [catalogPtr] (
+        const coral::net::ip::Address&,
+        const std::string&,
+        const std::string& serviceID,
+        const char* payload,
+        std::size_t payloadSize)
+    {
+        if (payloadSize != 4) {
+            CORAL_LOG_CAT_TRACE(coral::log::net,
+                "Ignoring slave provider catalog beacon due to missing data");
+            return;
+        }
+        catalogPtr->CatalogVersionReceived(
+            serviceID,
+            coral::util::DecodeUint32(payload));
+    };
+    tracker.AddTrackedServiceType(
+        SLAVEPROVIDER_CATALOG_SERVICE_TYPE,
+        SLAVEPROVIDER_TIMEOUT,
+        onCatalogVersion, // discovered
+        onCatalogVersion, // changed
+        [catalogPtr] (const std::string&, const std::string& serviceID)
+        {
+            catalogPtr->CatalogVersionLost(serviceID);
+        });
 }
 
-// This struct contains the state of an ongoing GetSlaveTypes request
-// to multiple slave providers.
-struct GetSlaveTypesRequest
+
+std::chrono::steady_clock::time_point Deadline(std::chrono::milliseconds timeout)
 {
-    int remainingReplies = 0;
-    std::vector<coral::master::ProviderCluster::SlaveType> slaveTypes;
-    std::unordered_map<std::string, std::size_t> slaveTypeIndices;
+    return timeout < std::chrono::milliseconds(0)
+        ? std::chrono::steady_clock::time_point::max()
+        : std::chrono::steady_clock::now() + timeout;
+}
 
-    void AddReply(
-        const std::string& slaveProviderID,
-        const std::error_code& ec,
-        const coral::model::SlaveTypeDescription* types,
-        std::size_t typeCount,
-        std::promise<std::vector<coral::master::ProviderCluster::SlaveType>>& promise);
-};
 
+coral::model::SlaveTypeDescription WithoutVariables(
+    const coral::model::SlaveTypeDescription& d)
+{
+    return coral::model::SlaveTypeDescription(
+        d.Name(),
+        d.UUID(),
+        d.Description(),
+        d.Author(),
+        d.Version(),
+        std::vector<coral::model::VariableDescription>());
+}
 
-void HandleGetSlaveTypes(
-    std::chrono::milliseconds timeout,
-    SlaveProviderMap& slaveProviders,
-    std::promise<std::vector<coral::master::ProviderCluster::SlaveType>> promise)
-    noexcept
+
+SlaveTypeCatalog::Provider::Provider() noexcept
+    : client(nullptr)
+    , hasCatalogVersion(false)
+    , catalogVersion(0)
+    , catalogKnown(false)
+    , pendingQueryID(NO_QUERY)
+    , fallbackTimerID(coral::net::Reactor::invalidTimerID)
+{
+}
+
+
+SlaveTypeCatalog::SlaveTypeCatalog(coral::net::Reactor& reactor)
+    : m_reactor(reactor)
+    , m_nextQueryID(0)
+    , m_lastDiscovery(std::chrono::steady_clock::now())
+    , m_checkTimerID(coral::net::Reactor::invalidTimerID)
+{
+}
+
+
+SlaveTypeCatalog::~SlaveTypeCatalog() noexcept
+{
+    for (const auto& p : m_providers) {
+        if (p.second.fallbackTimerID != coral::net::Reactor::invalidTimerID) {
+            m_reactor.RemoveTimer(p.second.fallbackTimerID);
+        }
+    }
+    if (m_checkTimerID != coral::net::Reactor::invalidTimerID) {
+        m_reactor.RemoveTimer(m_checkTimerID);
+    }
+}
+
+
+void SlaveTypeCatalog::ProviderDiscovered(
+    const std::string& slaveProviderID,
+    coral::bus::SlaveProviderClient& client)
+{
+    m_lastDiscovery = std::chrono::steady_clock::now();
+    auto& provider = m_providers[slaveProviderID];
+    provider.client = &client;
+
+    // A request in progress was sent with the previous client object, and
+    // its reply is lost.  And if the slave provider doesn't advertise a
+    // catalog version, a changed address is our only hint that its catalog
+    // may have changed.
+    if (provider.pendingQueryID != NO_QUERY
+            || !m_catalogVersions.count(slaveProviderID)) {
+        provider.hasCatalogVersion = false;
+        provider.catalogKnown = false;
+        provider.pendingQueryID = NO_QUERY;
+        provider.slaveTypes.clear();
+    }
+    UpdateCatalog(slaveProviderID);
+}
+
+
+void SlaveTypeCatalog::ProviderLost(const std::string& slaveProviderID)
+{
+    const auto it = m_providers.find(slaveProviderID);
+    if (it == m_providers.end()) return;
+    if (it->second.fallbackTimerID != coral::net::Reactor::invalidTimerID) {
+        m_reactor.RemoveTimer(it->second.fallbackTimerID);
+    }
+    m_providers.erase(it);
+    CheckWaiters();
+}
+
+
+void SlaveTypeCatalog::CatalogVersionReceived(
+    const std::string& slaveProviderID,
+    std::uint32_t catalogVersion)
 {
-    if (slaveProviders.empty()) {
-        promise.set_value(std::vector<coral::master::ProviderCluster::SlaveType>{});
+    m_catalogVersions[slaveProviderID] = catalogVersion;
+    UpdateCatalog(slaveProviderID);
+}
+
+
+void SlaveTypeCatalog::CatalogVersionLost(const std::string& slaveProviderID)
+{
+    m_catalogVersions.erase(slaveProviderID);
+}
+
+
+void SlaveTypeCatalog::UpdateCatalog(const std::string& slaveProviderID)
+{
+    const auto it = m_providers.find(slaveProviderID);
+    if (it == m_providers.end()) return; // Not discovered yet
+    auto& provider = it->second;
+
+    const auto version = m_catalogVersions.find(slaveProviderID);
+    if (version == m_catalogVersions.end()) {
+        if (!provider.catalogKnown
+                && provider.pendingQueryID == NO_QUERY
+                && provider.fallbackTimerID == coral::net::Reactor::invalidTimerID) {
+            provider.fallbackTimerID = m_reactor.AddTimer(
+                CATALOG_VERSION_WAIT,
+                1,
+                [this, slaveProviderID] (coral::net::Reactor&, int) {
+                    const auto p = m_providers.find(slaveProviderID);
+                    if (p == m_providers.end()) return;
+                    p->second.fallbackTimerID = coral::net::Reactor::invalidTimerID;
+                    CORAL_LOG_CAT_TRACE(coral::log::net, boost::format(
+                        "Slave provider %s doesn't advertise a catalog version")
+                        % slaveProviderID);
+                    RequestCatalog(slaveProviderID, nullptr);
+                });
+        }
+        return;
+    }
+
+    if (provider.fallbackTimerID != coral::net::Reactor::invalidTimerID) {
+        m_reactor.RemoveTimer(provider.fallbackTimerID);
+        provider.fallbackTimerID = coral::net::Reactor::invalidTimerID;
+    }
+    if (provider.hasCatalogVersion
+            && provider.catalogVersion == version->second
+            && (provider.catalogKnown || provider.pendingQueryID != NO_QUERY)) {
+        CORAL_LOG_CAT_TRACE(coral::log::net,
+            boost::format("Slave type catalog of slave provider %s is up to date")
+            % slaveProviderID);
         return;
     }
+    RequestCatalog(slaveProviderID, &version->second);
+}
+
+
+// Requests the catalog of a slave provider.  If `catalogVersion` is null,
+// the slave provider is assumed not to support catalog requests, and full
+// descriptions of all its slave types are requested instead.
+void SlaveTypeCatalog::RequestCatalog(
+    const std::string& slaveProviderID,
+    const std::uint32_t* catalogVersion)
+{
+    auto& provider = m_providers.at(slaveProviderID);
+    provider.hasCatalogVersion = !!catalogVersion;
+    provider.catalogVersion = catalogVersion ? *catalogVersion : 0;
+    provider.catalogKnown = false;
+    provider.slaveTypes.clear();
+    auto& client = *provider.client;
+
+    // If the catalog changes again while a request is in progress, the old
+    // reply is ignored.
+    const auto queryID = m_nextQueryID++;
+    provider.pendingQueryID = queryID;
+    const bool fullDescriptions = !catalogVersion;
+    auto onReply = [this, slaveProviderID, queryID, fullDescriptions] (
+        const std::error_code& ec,
+        const coral::model::SlaveTypeDescription* slaveTypes,
+        std::size_t slaveTypeCount)
+    {
+        const auto it = m_providers.find(slaveProviderID);
+        if (it == m_providers.end() || it->second.pendingQueryID != queryID) {
+            return;
+        }
+        auto& provider = it->second;
+        provider.pendingQueryID = NO_QUERY;
+        if (ec) {
+            coral::log::Log(coral::log::warning, boost::format(
+                "GetSlaveTypes request to slave provider %s failed (%s)")
+                % slaveProviderID
+                % ec.message());
+        } else {
+            for (std::size_t i = 0; i < slaveTypeCount; ++i) {
+                if (fullDescriptions) {
+                    m_descriptions[slaveTypes[i].UUID()] = slaveTypes[i];
+                    provider.slaveTypes.push_back(WithoutVariables(slaveTypes[i]));
+                } else {
+                    provider.slaveTypes.push_back(slaveTypes[i]);
+                }
+            }
+            provider.catalogKnown = true;
+            CORAL_LOG_CAT_TRACE(coral::log::net,
+                boost::format("Slave provider %s offers %d slave types")
+                % slaveProviderID
+                % slaveTypeCount);
+        }
+        CheckWaiters();
+    };
+    try {
+        if (fullDescriptions) {
+            client.GetSlaveTypes(std::move(onReply), SLAVE_TYPE_QUERY_TIMEOUT);
+        } else {
+            client.GetSlaveTypeDescriptions(
+                std::vector<std::string>{},
+                false,
+                std::move(onReply),
+                SLAVE_TYPE_QUERY_TIMEOUT);
+        }
+    } catch (const std::exception& e) {
+        m_providers[slaveProviderID].pendingQueryID = NO_QUERY;
+        coral::log::Log(coral::log::warning, boost::format(
+            "GetSlaveTypes request to slave provider %s failed (%s)")
+            % slaveProviderID
+            % e.what());
+    }
+}
+
+
+void SlaveTypeCatalog::WaitForSlaveTypes(
+    const std::vector<std::string>& slaveTypeNames,
+    std::chrono::milliseconds timeout,
+    std::promise<bool> promise)
+{
+    const auto sharedPromise = std::make_shared<std::promise<bool>>(std::move(promise));
+    AddWaiter(
+        [this, slaveTypeNames] (std::chrono::steady_clock::time_point now) {
+            return HasSlaveTypes(slaveTypeNames, now);
+        },
+        Deadline(timeout),
+        [sharedPromise] (bool ready) { sharedPromise->set_value(ready); });
+}
+
+
+void SlaveTypeCatalog::GetSlaveTypes(
+    const std::vector<std::string>& slaveTypeUUIDs,
+    bool includeVariables,
+    std::chrono::milliseconds timeout,
+    std::promise<std::vector<ProviderCluster::SlaveType>> promise)
+{
     const auto sharedPromise =
         std::make_shared<decltype(promise)>(std::move(promise));
-    try {
-        const auto state = std::make_shared<GetSlaveTypesRequest>();
-        for (auto& slaveProvider : slaveProviders) {
-            ++(state->remainingReplies);
+    const auto deadline = Deadline(timeout);
+
+    // If some catalogs are still on their way, we wait for them, but in case
+    // of a timeout we use the ones we've got.
+    AddWaiter(
+        [this] (std::chrono::steady_clock::time_point) {
+            return !HasPendingQueries();
+        },
+        deadline,
+        [this, sharedPromise, slaveTypeUUIDs, includeVariables, timeout, deadline]
+            (bool)
+        {
             try {
-                const auto slaveProviderID = slaveProvider.first;
-                slaveProvider.second.GetSlaveTypes(
-                    [sharedPromise, state, slaveProviderID] (
-                        const std::error_code& ec,
-                        const coral::model::SlaveTypeDescription* slaveTypes,
-                        std::size_t slaveTypeCount)
+                auto slaveTypes = CollectSlaveTypes(slaveTypeUUIDs);
+                if (!includeVariables) {
+                    sharedPromise->set_value(std::move(slaveTypes));
+                    return;
+                }
+                FetchDescriptions(
+                    slaveTypes,
+                    timeout,
+                    deadline,
+                    [this, sharedPromise, slaveTypes] (std::exception_ptr error) mutable
                     {
-                        state->AddReply(
-                            slaveProviderID,
-                            ec,
-                            slaveTypes,
-                            slaveTypeCount,
-                            *sharedPromise);
-                    },
-                    timeout);
+                        try {
+                            if (error) std::rethrow_exception(error);
+                            for (auto& st : slaveTypes) {
+                                const auto d = m_descriptions.find(st.description.UUID());
+                                if (d == m_descriptions.end()) {
+                                    throw std::runtime_error(
+                                        "Slave provider did not describe slave type: "
+                                        + st.description.Name());
+                                }
+                                st.description = d->second;
+                            }
+                            sharedPromise->set_value(std::move(slaveTypes));
+                        } catch (...) {
+                            sharedPromise->set_exception(std::current_exception());
+                        }
+                    });
             } catch (...) {
-                --(state->remainingReplies);
-                throw;
+                sharedPromise->set_exception(std::current_exception());
             }
+        });
+}
+
+
+void SlaveTypeCatalog::AddWaiter(
+    std::function<bool(std::chrono::steady_clock::time_point)> isReady,
+    std::chrono::steady_clock::time_point deadline,
+    std::function<void(bool)> onDone)
+{
+    Waiter waiter;
+    waiter.isReady = std::move(isReady);
+    waiter.deadline = deadline;
+    waiter.onDone = std::move(onDone);
+    m_waiters.push_back(std::move(waiter));
+    if (m_checkTimerID == coral::net::Reactor::invalidTimerID) {
+        m_checkTimerID = m_reactor.AddTimer(
+            WAIT_CHECK_INTERVAL,
+            -1,
+            [this] (coral::net::Reactor&, int) { CheckWaiters(); });
+    }
+    CheckWaiters();
+}
+
+
+void SlaveTypeCatalog::CheckWaiters()
+{
+    // The completion handlers may start new operations, so we remove the
+    // finished waiters before calling any of them.
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<std::pair<std::function<void(bool)>, bool>> finished;
+    for (auto it = m_waiters.begin(); it != m_waiters.end(); ) {
+        const bool ready = it->isReady(now);
+        if (ready || now >= it->deadline) {
+            finished.emplace_back(std::move(it->onDone), ready);
+            it = m_waiters.erase(it);
+        } else {
+            ++it;
         }
-        CORAL_LOG_TRACE(boost::format("Sent GetSlaveTypes request to %d providers")
-            % state->remainingReplies);
-    } catch (...) {
-        sharedPromise->set_exception(std::current_exception());
     }
+    if (m_waiters.empty() && m_checkTimerID != coral::net::Reactor::invalidTimerID) {
+        m_reactor.RemoveTimer(m_checkTimerID);
+        m_checkTimerID = coral::net::Reactor::invalidTimerID;
+    }
+    for (auto& f : finished) f.first(f.second);
 }
 
 
-void GetSlaveTypesRequest::AddReply(
-    const std::string& slaveProviderID,
-    const std::error_code& ec,
-    const coral::model::SlaveTypeDescription* types,
-    std::size_t typeCount,
-    std::promise<std::vector<coral::master::ProviderCluster::SlaveType>>& promise)
-{
-    --remainingReplies;
-    assert(remainingReplies >= 0);
-    if (!ec) {
-        for (std::size_t i = 0; i < typeCount; ++i) {
-            auto stIt = slaveTypeIndices.find(types[i].UUID());
+bool SlaveTypeCatalog::HasPendingQueries() const
+{
+    return std::any_of(
+        m_providers.begin(),
+        m_providers.end(),
+        [] (const std::pair<const std::string, Provider>& p) {
+            return p.second.pendingQueryID != NO_QUERY
+                || p.second.fallbackTimerID != coral::net::Reactor::invalidTimerID;
+        });
+}
+
+
+bool SlaveTypeCatalog::HasSlaveTypes(
+    const std::vector<std::string>& slaveTypeNames,
+    std::chrono::steady_clock::time_point now) const
+{
+    if (slaveTypeNames.empty()) {
+        // We don't know what to look for, so we wait until at least one slave
+        // provider has told us its slave types, and it seems that no more are
+        // on their way.
+        return !HasPendingQueries()
+            && now >= m_lastDiscovery + DISCOVERY_SETTLE_TIME
+            && std::any_of(
+                m_providers.begin(),
+                m_providers.end(),
+                [] (const std::pair<const std::string, Provider>& p) {
+                    return p.second.catalogKnown;
+                });
+    }
+    for (const auto& name : slaveTypeNames) {
+        const auto found = std::any_of(
+            m_providers.begin(),
+            m_providers.end(),
+            [&] (const std::pair<const std::string, Provider>& p) {
+                return std::any_of(
+                    p.second.slaveTypes.begin(),
+                    p.second.slaveTypes.end(),
+                    [&] (const coral::model::SlaveTypeDescription& st) {
+                        return st.Name() == name;
+                    });
+            });
+        if (!found) return false;
+    }
+    return true;
+}
+
+
+std::vector<ProviderCluster::SlaveType> SlaveTypeCatalog::CollectSlaveTypes(
+    const std::vector<std::string>& slaveTypeUUIDs) const
+{
+    std::vector<ProviderCluster::SlaveType> slaveTypes;
+    std::unordered_map<std::string, std::size_t> slaveTypeIndices;
+    for (const auto& provider : m_providers) {
+        if (!provider.second.catalogKnown) {
+            coral::log::Log(coral::log::warning, boost::format(
+                "Slave types offered by slave provider %s are unknown")
+                % provider.first);
+            continue;
+        }
+        for (const auto& st : provider.second.slaveTypes) {
+            auto stIt = slaveTypeIndices.find(st.UUID());
             if (stIt == slaveTypeIndices.end()) {
                 slaveTypes.emplace_back();
-                slaveTypes.back().description = types[i];
+                slaveTypes.back().description = st;
                 stIt = slaveTypeIndices.insert(
-                    std::make_pair(types[i].UUID(), slaveTypes.size() - 1)).first;
+                    std::make_pair(st.UUID(), slaveTypes.size() - 1)).first;
             }
-            slaveTypes[stIt->second].providers.push_back(
-                slaveProviderID);
+            slaveTypes[stIt->second].providers.push_back(provider.first);
         }
-        CORAL_LOG_TRACE(
-            boost::format("GetSlaveTypes request to slave provider %s returned %d types")
-            % slaveProviderID
-            % typeCount);
-    } else {
-        coral::log::Log(coral::log::warning, boost::format(
-            "GetSlaveTypes request to slave provider %s failed (%s)")
-            % slaveProviderID
-            % ec.message());
     }
-    if (remainingReplies == 0) {
-        // All slave providers have replied, now finalise async call.
-        promise.set_value(std::move(slaveTypes));
+    if (slaveTypeUUIDs.empty()) return slaveTypes;
+
+    std::vector<ProviderCluster::SlaveType> selected;
+    for (const auto& uuid : slaveTypeUUIDs) {
+        const auto stIt = slaveTypeIndices.find(uuid);
+        if (stIt == slaveTypeIndices.end()) {
+            throw std::runtime_error("Unknown slave type: " + uuid);
+        }
+        selected.push_back(slaveTypes[stIt->second]);
+    }
+    return selected;
+}
+
+
+// This struct contains the state of an ongoing request for slave type
+// descriptions, which may involve several slave providers.
+struct FetchDescriptionsRequest
+{
+    std::size_t remainingReplies = 0;
+    std::exception_ptr error;
+};
+
+
+void SlaveTypeCatalog::FetchDescriptions(
+    const std::vector<ProviderCluster::SlaveType>& slaveTypes,
+    std::chrono::milliseconds timeout,
+    std::chrono::steady_clock::time_point deadline,
+    std::function<void(std::exception_ptr)> onComplete)
+{
+    // Group the uncached slave types by the slave provider we'll ask.
+    std::unordered_map<std::string, std::vector<std::string>> uuids;
+    for (const auto& st : slaveTypes) {
+        if (!m_descriptions.count(st.description.UUID())) {
+            uuids[st.providers.front()].push_back(st.description.UUID());
+        }
+    }
+    if (uuids.empty()) {
+        onComplete(nullptr);
+        return;
+    }
+
+    const auto state = std::make_shared<FetchDescriptionsRequest>();
+    for (const auto& request : uuids) {
+        const auto& slaveProviderID = request.first;
+        try {
+            m_providers.at(slaveProviderID).client->GetSlaveTypeDescriptions(
+                request.second,
+                true,
+                [this, state, slaveProviderID] (
+                    const std::error_code& ec,
+                    const coral::model::SlaveTypeDescription* descriptions,
+                    std::size_t descriptionCount)
+                {
+                    if (ec) {
+                        if (!state->error) {
+                            state->error = std::make_exception_ptr(std::runtime_error(
+                                "Failed to get slave type descriptions from slave provider "
+                                + slaveProviderID + " (" + ec.message() + ")"));
+                        }
+                    } else {
+                        for (std::size_t i = 0; i < descriptionCount; ++i) {
+                            m_descriptions[descriptions[i].UUID()] = descriptions[i];
+                        }
+                    }
+                    --state->remainingReplies;
+                    CheckWaiters();
+                },
+                timeout);
+            ++state->remainingReplies;
+        } catch (...) {
+            if (!state->error) state->error = std::current_exception();
+        }
     }
+    CORAL_LOG_CAT_TRACE(coral::log::net,
+        boost::format("Requested slave type descriptions from %d providers")
+        % state->remainingReplies);
+    AddWaiter(
+        [state] (std::chrono::steady_clock::time_point) {
+            return state->remainingReplies == 0;
+        },
+        deadline,
+        [state, onComplete] (bool ready) {
+            if (!ready && !state->error) {
+                state->error = std::make_exception_ptr(std::runtime_error(
+                    "Timeout while waiting for slave type descriptions"));
+            }
+            onComplete(state->error);
+        });
 }
 
 
@@ -419,5 +1100,95 @@ void HandleInstantiateSlave(
 }
 
 
+
+// This struct contains the state of an ongoing InstantiateSlaves request.
+struct InstantiateSlavesRequest
+{
+    std::size_t remainingReplies = 0;
+    std::vector<coral::net::SlaveLocator> locators;
+    std::exception_ptr error;
+    std::promise<std::vector<coral::net::SlaveLocator>> promise;
+
+    void Finish()
+    {
+        if (error) promise.set_exception(error);
+        else promise.set_value(std::move(locators));
+    }
+};
+
+
+void HandleInstantiateSlaves(
+    const std::vector<coral::master::ProviderCluster::InstantiationRequest>& requests,
+    std::chrono::milliseconds instantiationTimeout,
+    std::chrono::milliseconds commTimeout,
+    SlaveProviderMap& slaveProviders,
+    std::promise<std::vector<coral::net::SlaveLocator>> promise)
+    noexcept
+{
+    const auto state = std::make_shared<InstantiateSlavesRequest>();
+    state->promise = std::move(promise);
+    // This function counts as a reply in progress until it returns, since
+    // the completion handlers may be called before InstantiateSlaves() does.
+    state->remainingReplies = 1;
+    try {
+        // Group the requests by slave provider, and keep track of where in
+        // the result list each provider's slaves should go.
+        std::unordered_map<std::string, std::vector<coral::bus::SlaveBatch>> batches;
+        std::unordered_map<std::string, std::vector<std::size_t>> positions;
+        for (const auto& request : requests) {
+            CORAL_INPUT_CHECK(request.count >= 0);
+            if (!slaveProviders.count(request.slaveProviderID)) {
+                throw std::runtime_error(
+                    "Unknown slave provider: " + request.slaveProviderID);
+            }
+            batches[request.slaveProviderID].push_back(
+                coral::bus::SlaveBatch{request.slaveTypeUUID, request.count});
+            auto& pos = positions[request.slaveProviderID];
+            for (int i = 0; i < request.count; ++i) {
+                pos.push_back(state->locators.size());
+                state->locators.emplace_back();
+            }
+        }
+        for (const auto& batch : batches) {
+            const auto& slaveProviderID = batch.first;
+            ++state->remainingReplies;
+            try {
+                slaveProviders.at(slaveProviderID).InstantiateSlaves(
+                    batch.second,
+                    instantiationTimeout,
+                    commTimeout,
+                    [state, slaveProviderID, pos = positions[slaveProviderID]] (
+                        const std::error_code& ec,
+                        const coral::net::SlaveLocator* locators,
+                        std::size_t locatorCount,
+                        const std::string& errorMessage)
+                    {
+                        if (!ec) {
+                            assert(locatorCount == pos.size());
+                            for (std::size_t i = 0; i < locatorCount; ++i) {
+                                state->locators[pos[i]] = locators[i];
+                            }
+                        } else if (!state->error) {
+                            state->error = std::make_exception_ptr(std::runtime_error(
+                                "Failed to instantiate slaves on slave provider "
+                                + slaveProviderID + ": "
+                                + ec.message() + " (" + errorMessage + ")"));
+                        }
+                        if (--state->remainingReplies == 0) state->Finish();
+                    });
+            } catch (...) {
+                --state->remainingReplies;
+                throw;
+            }
+        }
+    } catch (...) {
+        state->error = std::current_exception();
+    }
+    // If no requests are in progress, we're done.  Otherwise, the last
+    // completion handler finishes the operation.
+    if (--state->remainingReplies == 0) state->Finish();
+}
+
+
 } // anonymous namespace
 }} // namespace
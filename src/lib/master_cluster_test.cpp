@@ -0,0 +1,540 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/range/size.hpp>
+#include <gtest/gtest.h>
+
+#include <coral/master/cluster.hpp>
+#include <coral/net/reactor.hpp>
+#include <coral/net/reqrep.hpp>
+#include <coral/net/service.hpp>
+#include <coral/net/udp.hpp>
+#include <coral/net/zmqx.hpp>
+#include <coral/protocol/glue.hpp>
+#include <coral/provider/provider.hpp>
+#include <coral/util.hpp>
+
+#ifdef _MSC_VER
+#   pragma warning(push, 0)
+#endif
+#include <domain.pb.h>
+#ifdef _MSC_VER
+#   pragma warning(pop)
+#endif
+
+
+namespace
+{
+    // A slave type which can't actually be instantiated, since we only
+    // need it to be discoverable.
+    class DummySlaveCreator : public coral::provider::SlaveCreator
+    {
+    public:
+        explicit DummySlaveCreator(const std::string& name)
+            : m_description(
+                name,
+                coral::util::RandomUUID(),
+                "A dummy slave type",
+                "SINTEF Ocean",
+                "1.0",
+                std::vector<coral::model::VariableDescription>())
+        {
+        }
+
+        const coral::model::SlaveTypeDescription& Description() const override
+        {
+            return m_description;
+        }
+
+        bool Instantiate(
+            std::chrono::milliseconds, coral::net::SlaveLocator&) override
+        {
+            return false;
+        }
+
+        std::string InstantiationFailureDescription() const override
+        {
+            return "Dummy slave types can't be instantiated";
+        }
+
+    private:
+        coral::model::SlaveTypeDescription m_description;
+    };
+
+
+    std::vector<std::unique_ptr<coral::provider::SlaveCreator>> DummySlaveTypes(
+        const std::vector<std::string>& slaveTypeNames)
+    {
+        std::vector<std::unique_ptr<coral::provider::SlaveCreator>> creators;
+        for (const auto& name : slaveTypeNames) {
+            creators.push_back(std::make_unique<DummySlaveCreator>(name));
+        }
+        return creators;
+    }
+
+
+    coral::model::SlaveTypeDescription MakeSlaveType(const std::string& name)
+    {
+        return coral::model::SlaveTypeDescription(
+            name,
+            coral::util::RandomUUID(),
+            "A dummy slave type",
+            "SINTEF Ocean",
+            "1.0",
+            std::vector<coral::model::VariableDescription>{
+                coral::model::VariableDescription(
+                    0,
+                    "x",
+                    coral::model::REAL_DATATYPE,
+                    coral::model::OUTPUT_CAUSALITY,
+                    coral::model::CONTINUOUS_VARIABILITY)
+            });
+    }
+
+
+    // A GET_SLAVE_TYPES request received by a FakeSlaveProvider.
+    struct SlaveTypesRequest
+    {
+        bool hasBody = false;
+        std::vector<std::string> slaveTypeUUIDs;
+        bool omitVariables = false;
+    };
+
+
+    // A handler for the slave provider protocol which records the requests
+    // it receives.  If `supportsCatalogs` is false, it behaves like a slave
+    // provider from before catalog versions were introduced, and ignores
+    // GET_SLAVE_TYPES requests with a body.  It only knows version 0 of the
+    // protocol, and answers INSTANTIATE_SLAVE requests with made-up slave
+    // locators.
+    class FakeSlaveProviderHandler : public coral::net::reqrep::ServerProtocolHandler
+    {
+    public:
+        FakeSlaveProviderHandler(
+            const std::vector<coral::model::SlaveTypeDescription>& slaveTypes,
+            bool supportsCatalogs)
+            : m_slaveTypes(slaveTypes)
+            , m_supportsCatalogs(supportsCatalogs)
+        {
+        }
+
+        void SetSlaveTypes(
+            const std::vector<coral::model::SlaveTypeDescription>& slaveTypes)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_slaveTypes = slaveTypes;
+        }
+
+        std::vector<SlaveTypesRequest> Requests() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_requests;
+        }
+
+        int InstantiationCount() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_instantiationCount;
+        }
+
+        bool HandleRequest(
+            const std::string& protocolIdentifier,
+            std::uint16_t protocolVersion,
+            const char* requestHeader, size_t requestHeaderSize,
+            const char* requestBody, size_t requestBodySize,
+            const char*& replyHeader, size_t& replyHeaderSize,
+            const char*& replyBody, size_t& replyBodySize) override
+        {
+            const auto requestType = std::string(requestHeader, requestHeaderSize);
+            if (requestType == "INSTANTIATE_SLAVE") {
+                return HandleInstantiateSlave(
+                    replyHeader, replyHeaderSize, replyBody, replyBodySize);
+            } else if (requestType != "GET_SLAVE_TYPES") {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            SlaveTypesRequest request;
+            if (requestBody != nullptr) {
+                coralproto::domain::GetSlaveTypesData args;
+                EXPECT_TRUE(args.ParseFromArray(
+                    requestBody, static_cast<int>(requestBodySize)));
+                request.hasBody = true;
+                request.slaveTypeUUIDs.assign(
+                    args.slave_type_uuid().begin(),
+                    args.slave_type_uuid().end());
+                request.omitVariables = args.omit_variables();
+            }
+            m_requests.push_back(request);
+            if (request.hasBody && !m_supportsCatalogs) return false;
+
+            coralproto::domain::SlaveTypeList slaveTypeList;
+            for (const auto& st : m_slaveTypes) {
+                if (!request.slaveTypeUUIDs.empty() &&
+                        std::find(
+                            request.slaveTypeUUIDs.begin(),
+                            request.slaveTypeUUIDs.end(),
+                            st.UUID())
+                        == request.slaveTypeUUIDs.end()) {
+                    continue;
+                }
+                auto pbDescription =
+                    slaveTypeList.add_slave_type()->mutable_description();
+                *pbDescription = coral::protocol::ToProto(st);
+                if (request.omitVariables) pbDescription->clear_variable();
+            }
+            m_replyBody = slaveTypeList.SerializeAsString();
+            replyHeader = "OK";
+            replyHeaderSize = 2;
+            replyBody = m_replyBody.data();
+            replyBodySize = m_replyBody.size();
+            return true;
+        }
+
+    private:
+        bool HandleInstantiateSlave(
+            const char*& replyHeader, size_t& replyHeaderSize,
+            const char*& replyBody, size_t& replyBodySize)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const auto port = 10000 + 2 * m_instantiationCount++;
+            coralproto::domain::InstantiateSlaveReply data;
+            data.mutable_slave_locator()->set_control_endpoint(
+                "tcp://127.0.0.1:" + std::to_string(port));
+            data.mutable_slave_locator()->set_data_pub_endpoint(
+                "tcp://127.0.0.1:" + std::to_string(port + 1));
+            m_replyBody = data.SerializeAsString();
+            replyHeader = "OK";
+            replyHeaderSize = 2;
+            replyBody = m_replyBody.data();
+            replyBodySize = m_replyBody.size();
+            return true;
+        }
+
+        mutable std::mutex m_mutex;
+        std::vector<coral::model::SlaveTypeDescription> m_slaveTypes;
+        const bool m_supportsCatalogs;
+        std::vector<SlaveTypesRequest> m_requests;
+        int m_instantiationCount = 0;
+        std::string m_replyBody;
+    };
+
+
+    // A slave provider which runs a FakeSlaveProviderHandler in a background
+    // thread, so we can see which requests the master makes.  If
+    // `advertiseCatalog` is false, it doesn't send a catalog beacon, and
+    // doesn't support catalog requests.
+    class FakeSlaveProvider
+    {
+    public:
+        FakeSlaveProvider(
+            const std::string& slaveProviderID,
+            const std::vector<coral::model::SlaveTypeDescription>& slaveTypes,
+            bool advertiseCatalog,
+            coral::net::ip::Port discoveryPort)
+            : m_slaveProviderID(slaveProviderID)
+            , m_advertiseCatalog(advertiseCatalog)
+            , m_discoveryPort(discoveryPort)
+            , m_handler(std::make_shared<FakeSlaveProviderHandler>(
+                slaveTypes, advertiseCatalog))
+            , m_catalogVersion(1)
+            , m_server(m_reactor, coral::net::Endpoint{"tcp://*:*"})
+            , m_stop(false)
+        {
+            m_server.AddProtocolHandler("DSSPI", 0, m_handler);
+            m_reactor.AddTimer(
+                std::chrono::milliseconds(10),
+                -1,
+                [this] (coral::net::Reactor& r, int) { if (m_stop) r.Stop(); });
+
+            char payload[2];
+            coral::util::EncodeUint16(
+                coral::net::zmqx::EndpointPort(m_server.BoundEndpoint().URL()),
+                payload);
+            m_beacon = std::make_unique<coral::net::service::Beacon>(
+                0,
+                "no.sintef.viproma.coral.slave_provider",
+                m_slaveProviderID,
+                payload,
+                sizeof(payload),
+                BEACON_PERIOD,
+                "*",
+                m_discoveryPort);
+            if (m_advertiseCatalog) StartCatalogBeacon();
+            m_thread = std::thread{[this] () { m_reactor.Run(); }};
+        }
+
+        ~FakeSlaveProvider()
+        {
+            m_stop = true;
+            m_thread.join();
+        }
+
+        // Replaces the slave types, and advertises a new catalog version.
+        void SetSlaveTypes(
+            const std::vector<coral::model::SlaveTypeDescription>& slaveTypes)
+        {
+            m_handler->SetSlaveTypes(slaveTypes);
+            ++m_catalogVersion;
+            if (m_advertiseCatalog) StartCatalogBeacon();
+        }
+
+        std::vector<SlaveTypesRequest> Requests() const
+        {
+            return m_handler->Requests();
+        }
+
+        int InstantiationCount() const
+        {
+            return m_handler->InstantiationCount();
+        }
+
+    private:
+        const std::chrono::milliseconds BEACON_PERIOD{100};
+
+        void StartCatalogBeacon()
+        {
+            if (m_catalogBeacon) m_catalogBeacon->Stop();
+            char payload[4];
+            coral::util::EncodeUint32(m_catalogVersion, payload);
+            m_catalogBeacon = std::make_unique<coral::net::service::Beacon>(
+                0,
+                "no.sintef.viproma.coral.slave_provider_catalog",
+                m_slaveProviderID,
+                payload,
+                sizeof(payload),
+                BEACON_PERIOD,
+                "*",
+                m_discoveryPort);
+        }
+
+        const std::string m_slaveProviderID;
+        const bool m_advertiseCatalog;
+        const coral::net::ip::Port m_discoveryPort;
+        const std::shared_ptr<FakeSlaveProviderHandler> m_handler;
+        std::uint32_t m_catalogVersion;
+
+        coral::net::Reactor m_reactor;
+        coral::net::reqrep::Server m_server;
+        std::unique_ptr<coral::net::service::Beacon> m_beacon;
+        std::unique_ptr<coral::net::service::Beacon> m_catalogBeacon;
+        std::atomic<bool> m_stop;
+        std::thread m_thread;
+    };
+}
+
+
+TEST(coral_master_ProviderCluster, WaitForSlaveTypes)
+{
+    // Let the OS choose a free port, and keep it reserved for the duration
+    // of the test.
+    const auto portReservation = coral::net::udp::BroadcastSocket(
+        coral::net::ip::Address{"*"}, std::uint16_t(0));
+    const auto port = portReservation.Port();
+
+    coral::master::ProviderCluster cluster{"*", port};
+
+    // The slave provider is started after the cluster, so its slave types
+    // only appear once its first beacon has been received.
+    coral::provider::SlaveProvider provider{
+        "provider", DummySlaveTypes({"typeA", "typeB"}), "*", port};
+    const auto stopProvider = coral::util::OnScopeExit([&] () {
+        provider.Stop();
+    });
+
+    const auto t0 = std::chrono::steady_clock::now();
+    EXPECT_TRUE(cluster.WaitForSlaveTypes(
+        {"typeA", "typeB"}, std::chrono::seconds(10)));
+    EXPECT_LT(
+        std::chrono::steady_clock::now() - t0,
+        std::chrono::seconds(10));
+
+    const auto catalog = cluster.GetSlaveTypeCatalog(std::chrono::seconds(1));
+    ASSERT_EQ(2u, catalog.size());
+    for (const auto& st : catalog) {
+        EXPECT_TRUE(st.description.Name() == "typeA" ||
+            st.description.Name() == "typeB");
+        ASSERT_EQ(1u, st.providers.size());
+        EXPECT_EQ("provider", st.providers.front());
+    }
+}
+
+
+TEST(coral_master_ProviderCluster, WaitForSlaveTypes_timeout)
+{
+    const auto portReservation = coral::net::udp::BroadcastSocket(
+        coral::net::ip::Address{"*"}, std::uint16_t(0));
+    const auto port = portReservation.Port();
+
+    coral::provider::SlaveProvider provider{
+        "provider", DummySlaveTypes({"typeA"}), "*", port};
+    const auto stopProvider = coral::util::OnScopeExit([&] () {
+        provider.Stop();
+    });
+    coral::master::ProviderCluster cluster{"*", port};
+
+    const auto timeout = std::chrono::milliseconds(500);
+    const auto t0 = std::chrono::steady_clock::now();
+    EXPECT_FALSE(cluster.WaitForSlaveTypes({"typeA", "typeC"}, timeout));
+    const auto elapsed = std::chrono::steady_clock::now() - t0;
+    EXPECT_GE(elapsed, timeout);
+    EXPECT_LT(elapsed, 10 * timeout);
+
+    // The type which does exist should still have been found.
+    EXPECT_TRUE(cluster.WaitForSlaveTypes({"typeA"}, std::chrono::seconds(10)));
+}
+
+
+TEST(coral_master_ProviderCluster, SlaveTypeCatalogCaching)
+{
+    const auto portReservation = coral::net::udp::BroadcastSocket(
+        coral::net::ip::Address{"*"}, std::uint16_t(0));
+    const auto port = portReservation.Port();
+
+    FakeSlaveProvider provider{
+        "provider",
+        {MakeSlaveType("typeA"), MakeSlaveType("typeB")},
+        true,
+        port};
+    coral::master::ProviderCluster cluster{"*", port};
+    ASSERT_TRUE(cluster.WaitForSlaveTypes(
+        {"typeA", "typeB"}, std::chrono::seconds(10)));
+
+    for (int i = 0; i < 3; ++i) {
+        const auto catalog = cluster.GetSlaveTypeCatalog(std::chrono::seconds(1));
+        ASSERT_EQ(2u, catalog.size());
+        for (const auto& st : catalog) {
+            EXPECT_TRUE(st.description.Variables().empty());
+        }
+    }
+
+    // The catalog should only have been requested once, and without
+    // variable descriptions.
+    const auto requests = provider.Requests();
+    ASSERT_EQ(1u, requests.size());
+    EXPECT_TRUE(requests[0].hasBody);
+    EXPECT_TRUE(requests[0].slaveTypeUUIDs.empty());
+    EXPECT_TRUE(requests[0].omitVariables);
+}
+
+
+TEST(coral_master_ProviderCluster, SlaveTypeDescriptionSubset)
+{
+    const auto portReservation = coral::net::udp::BroadcastSocket(
+        coral::net::ip::Address{"*"}, std::uint16_t(0));
+    const auto port = portReservation.Port();
+
+    const auto typeA = MakeSlaveType("typeA");
+    const auto typeB = MakeSlaveType("typeB");
+    FakeSlaveProvider provider{"provider", {typeA, typeB}, true, port};
+    coral::master::ProviderCluster cluster{"*", port};
+    ASSERT_TRUE(cluster.WaitForSlaveTypes({"typeA"}, std::chrono::seconds(10)));
+
+    // Full descriptions are only requested for the given slave types, and
+    // only the first time.
+    for (int i = 0; i < 2; ++i) {
+        const auto slaveTypes =
+            cluster.GetSlaveTypes({typeA.UUID()}, std::chrono::seconds(1));
+        ASSERT_EQ(1u, slaveTypes.size());
+        EXPECT_EQ(typeA.UUID(), slaveTypes[0].description.UUID());
+        EXPECT_EQ(1, boost::size(slaveTypes[0].description.Variables()));
+    }
+    const auto requests = provider.Requests();
+    ASSERT_EQ(2u, requests.size());
+    EXPECT_TRUE(requests[0].omitVariables);
+    EXPECT_TRUE(requests[1].hasBody);
+    EXPECT_FALSE(requests[1].omitVariables);
+    ASSERT_EQ(1u, requests[1].slaveTypeUUIDs.size());
+    EXPECT_EQ(typeA.UUID(), requests[1].slaveTypeUUIDs[0]);
+
+    EXPECT_THROW(
+        cluster.GetSlaveTypes({"no-such-uuid"}, std::chrono::seconds(1)),
+        std::runtime_error);
+}
+
+
+TEST(coral_master_ProviderCluster, SlaveTypeCatalogVersionChange)
+{
+    const auto portReservation = coral::net::udp::BroadcastSocket(
+        coral::net::ip::Address{"*"}, std::uint16_t(0));
+    const auto port = portReservation.Port();
+
+    const auto typeA = MakeSlaveType("typeA");
+    FakeSlaveProvider provider{"provider", {typeA}, true, port};
+    coral::master::ProviderCluster cluster{"*", port};
+    ASSERT_TRUE(cluster.WaitForSlaveTypes({"typeA"}, std::chrono::seconds(10)));
+    EXPECT_EQ(1u, provider.Requests().size());
+
+    provider.SetSlaveTypes({typeA, MakeSlaveType("typeC")});
+    ASSERT_TRUE(cluster.WaitForSlaveTypes({"typeC"}, std::chrono::seconds(10)));
+    EXPECT_EQ(2u, cluster.GetSlaveTypeCatalog(std::chrono::seconds(1)).size());
+
+    const auto requests = provider.Requests();
+    ASSERT_EQ(2u, requests.size());
+    EXPECT_TRUE(requests[1].hasBody);
+    EXPECT_TRUE(requests[1].slaveTypeUUIDs.empty());
+    EXPECT_TRUE(requests[1].omitVariables);
+}
+
+
+TEST(coral_master_ProviderCluster, SlaveTypeCatalogLegacyProvider)
+{
+    const auto portReservation = coral::net::udp::BroadcastSocket(
+        coral::net::ip::Address{"*"}, std::uint16_t(0));
+    const auto port = portReservation.Port();
+
+    const auto typeA = MakeSlaveType("typeA");
+    FakeSlaveProvider provider{"provider", {typeA}, false, port};
+    coral::master::ProviderCluster cluster{"*", port};
+    ASSERT_TRUE(cluster.WaitForSlaveTypes({"typeA"}, std::chrono::seconds(10)));
+
+    // The full descriptions were received with the catalog, so no more
+    // requests are needed.
+    const auto slaveTypes =
+        cluster.GetSlaveTypes({typeA.UUID()}, std::chrono::seconds(1));
+    ASSERT_EQ(1u, slaveTypes.size());
+    EXPECT_EQ(1, boost::size(slaveTypes[0].description.Variables()));
+
+    const auto requests = provider.Requests();
+    ASSERT_EQ(1u, requests.size());
+    EXPECT_FALSE(requests[0].hasBody);
+}
+
+
+TEST(coral_master_ProviderCluster, InstantiateSlavesLegacyProvider)
+{
+    const auto portReservation = coral::net::udp::BroadcastSocket(
+        coral::net::ip::Address{"*"}, std::uint16_t(0));
+    const auto port = portReservation.Port();
+
+    const auto typeA = MakeSlaveType("typeA");
+    const auto typeB = MakeSlaveType("typeB");
+    FakeSlaveProvider provider{"provider", {typeA, typeB}, false, port};
+    coral::master::ProviderCluster cluster{"*", port};
+    ASSERT_TRUE(cluster.WaitForSlaveTypes(
+        {"typeA", "typeB"}, std::chrono::seconds(10)));
+
+    // The provider doesn't support INSTANTIATE_SLAVES, so each slave is
+    // requested separately.
+    const auto slaveLocators = cluster.InstantiateSlaves(
+        {
+            {"provider", typeA.UUID(), 2},
+            {"provider", typeB.UUID(), 1}
+        },
+        std::chrono::seconds(5));
+    ASSERT_EQ(3u, slaveLocators.size());
+    EXPECT_EQ(3, provider.InstantiationCount());
+    std::vector<std::string> endpoints;
+    for (const auto& sl : slaveLocators) {
+        endpoints.push_back(sl.ControlEndpoint().URL());
+    }
+    std::sort(endpoints.begin(), endpoints.end());
+    EXPECT_EQ("tcp://127.0.0.1:10000", endpoints[0]);
+    EXPECT_EQ("tcp://127.0.0.1:10002", endpoints[1]);
+    EXPECT_EQ("tcp://127.0.0.1:10004", endpoints[2]);
+}
@@ -7,6 +7,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/master/execution.hpp>
 
 #include <exception>
+#include <map>
 #include <stdexcept>
 #include <utility>
 
@@ -233,17 +234,25 @@ public:
     void AcceptStep(std::chrono::milliseconds timeout)
     {
         m_thread.Execute<void>(
-            [timeout] (
+            [timeout, this] (
                 coral::net::Reactor&,
                 ExecMgr& execMgr,
                 std::promise<void> promise)
             {
+                const auto execMgrPtr = execMgr.get();
                 try {
                     execMgr->AcceptStep(
                         timeout,
                         SimpleHandler(
                             std::move(promise),
-                            "Failed to complete time step"));
+                            "Failed to complete time step"),
+                        [execMgrPtr, this]
+                            (const std::error_code& ec, coral::model::SlaveID slaveID)
+                        {
+                            if (ec) return;
+                            m_stepStatistics[slaveID].Add(
+                                execMgrPtr->LastStepTimings(slaveID));
+                        });
                 } catch (...) {
                     promise.set_exception(std::current_exception());
                 }
@@ -252,6 +261,20 @@ public:
     }
 
 
+    std::map<coral::model::SlaveID, SlaveStepStatistics> StepStatistics()
+    {
+        return m_thread.Execute<std::map<coral::model::SlaveID, SlaveStepStatistics>>(
+            [this] (
+                coral::net::Reactor&,
+                ExecMgr&,
+                std::promise<std::map<coral::model::SlaveID, SlaveStepStatistics>> promise)
+            {
+                promise.set_value(m_stepStatistics);
+            }
+        ).get();
+    }
+
+
     void Terminate()
     {
         m_thread.Execute<void>(
@@ -273,6 +296,11 @@ private:
     //       need to support Boost < 1.56) or std::optional (when all our
     //       compilers support it).
     using ExecMgr = std::unique_ptr<coral::bus::ExecutionManager>;
+
+    // Only accessed in the background thread.  Declared before m_thread so
+    // that it outlives it.
+    std::map<coral::model::SlaveID, SlaveStepStatistics> m_stepStatistics;
+
     coral::async::CommThread<ExecMgr> m_thread;
 };
 
@@ -336,6 +364,13 @@ void coral::master::Execution::AcceptStep(std::chrono::milliseconds timeout)
 }
 
 
+std::map<coral::model::SlaveID, coral::master::SlaveStepStatistics>
+    coral::master::Execution::StepStatistics()
+{
+    return m_private->StepStatistics();
+}
+
+
 void coral::master::Execution::Terminate()
 {
     m_private->Terminate();
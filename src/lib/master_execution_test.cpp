@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
@@ -7,12 +8,16 @@
 
 #include <boost/filesystem.hpp>
 #include <gtest/gtest.h>
+#include <zmq.hpp>
 
 #include <coral/fmi/importer.hpp>
 #include <coral/fmi/fmu.hpp>
 #include <coral/master/execution.hpp>
+#include <coral/metrics.hpp>
 #include <coral/model.hpp>
 #include <coral/net.hpp>
+#include <coral/net/zmqx.hpp>
+#include <coral/protocol/execution.hpp>
 #include <coral/slave/instance.hpp>
 #include <coral/slave/runner.hpp>
 #include <coral/util.hpp>
@@ -139,6 +144,144 @@ namespace
             std::chrono::seconds(10));
         return s;
     }
+
+    // Forwards control messages between a master and a slave, and removes
+    // the body of the slave's HELLO reply, so that the slave looks like one
+    // from an earlier version of Coral to the master.
+    class LegacySlaveProxy
+    {
+    public:
+        explicit LegacySlaveProxy(const coral::net::Endpoint& slaveEndpoint)
+            : m_endpoint("inproc", coral::util::RandomUUID())
+            , m_stop(false)
+        {
+            auto& context = coral::net::zmqx::GlobalContext();
+            zmq::socket_t frontend(context, ZMQ_ROUTER);
+            zmq::socket_t backend(context, ZMQ_DEALER);
+            frontend.setsockopt(ZMQ_LINGER, 0);
+            backend.setsockopt(ZMQ_LINGER, 0);
+            frontend.bind(m_endpoint.URL());
+            backend.connect(slaveEndpoint.URL());
+            m_thread = std::thread(
+                &LegacySlaveProxy::Run,
+                this,
+                std::move(frontend),
+                std::move(backend));
+        }
+
+        ~LegacySlaveProxy()
+        {
+            m_stop = true;
+            m_thread.join();
+        }
+
+        const coral::net::Endpoint& Endpoint() const { return m_endpoint; }
+
+    private:
+        void Run(zmq::socket_t frontend, zmq::socket_t backend)
+        {
+            zmq::pollitem_t pollItems[] = {
+                { static_cast<void*>(frontend), 0, ZMQ_POLLIN, 0 },
+                { static_cast<void*>(backend), 0, ZMQ_POLLIN, 0 }
+            };
+            std::string masterID;
+            std::vector<zmq::message_t> msg;
+            while (!m_stop) {
+                zmq::poll(pollItems, 2, 100);
+                if (pollItems[0].revents & ZMQ_POLLIN) {
+                    coral::net::zmqx::Receive(frontend, msg);
+                    masterID = coral::net::zmqx::ToString(msg.front());
+                    msg.erase(msg.begin());
+                    coral::net::zmqx::Send(backend, msg);
+                }
+                if (pollItems[1].revents & ZMQ_POLLIN) {
+                    // The reply is an empty delimiter frame followed by
+                    // the message proper.
+                    coral::net::zmqx::Receive(backend, msg);
+                    if (msg.size() > 2
+                            && coral::protocol::execution::ParseMessageType(msg[1])
+                                == coralproto::execution::MSG_HELLO) {
+                        msg.resize(2);
+                    }
+                    msg.insert(msg.begin(), coral::net::zmqx::ToFrame(masterID));
+                    coral::net::zmqx::Send(frontend, msg);
+                }
+            }
+        }
+
+        coral::net::Endpoint m_endpoint;
+        std::atomic<bool> m_stop;
+        std::thread m_thread;
+    };
+
+    // An execution with one or more slaves of the 'identity' FMU and a
+    // SimpleLogger, which the tests of the different connection types
+    // below have in common.  The slaves are added to the execution in that
+    // order.  Tests must call execution.Terminate() before the object is
+    // destroyed, since the destructor waits for the slave threads to end.
+    class IdentityExecution
+    {
+    public:
+        IdentityExecution(
+            std::size_t identityCount,
+            std::size_t loggerInputCount,
+            const coral::master::ExecutionOptions& options =
+                coral::master::ExecutionOptions())
+            : logger(std::make_shared<SimpleLogger>(loggerInputCount))
+            , execution("coral_test_execution", options)
+        {
+            const auto testDataDir = std::getenv("CORAL_TEST_DATA_DIR");
+            m_importer = coral::fmi::Importer::Create();
+            m_idFMU = m_importer->Import(
+                boost::filesystem::path(testDataDir) / "fmi1_cs" / "identity.fmu");
+            for (const auto& v : m_idFMU->Description().Variables()) {
+                if (v.Name() == "realIn") realInID = v.ID();
+                else if (v.Name() == "realOut") realOutID = v.ID();
+                else if (v.Name() == "integerOut") integerOutID = v.ID();
+            }
+
+            std::vector<coral::master::AddedSlave> added;
+            for (std::size_t i = 0; i < identityCount; ++i) {
+                m_slaves.push_back(SpawnSlave(m_idFMU->InstantiateSlave()));
+                added.emplace_back(
+                    m_slaves.back().locator,
+                    "id" + std::to_string(i + 1));
+            }
+            m_slaves.push_back(SpawnSlave(logger));
+            added.emplace_back(m_slaves.back().locator, "log");
+
+            execution.Reconstitute(added, std::chrono::seconds(1));
+            for (std::size_t i = 0; i < identityCount; ++i) {
+                idSlaveIDs.push_back(added[i].info.ID());
+            }
+            logSlaveID = added.back().info.ID();
+        }
+
+        ~IdentityExecution()
+        {
+            for (auto& s : m_slaves) s.thread.join();
+        }
+
+        // Performs a time step and accepts it.
+        void Step()
+        {
+            execution.Step(1.0, std::chrono::seconds(1));
+            execution.AcceptStep(std::chrono::seconds(1));
+        }
+
+        coral::model::VariableID realInID = 0;
+        coral::model::VariableID realOutID = 0;
+        coral::model::VariableID integerOutID = 0;
+        std::shared_ptr<SimpleLogger> logger;
+        coral::master::Execution execution;
+        std::vector<coral::model::SlaveID> idSlaveIDs;
+        coral::model::SlaveID logSlaveID = coral::model::INVALID_SLAVE_ID;
+
+    private:
+        std::shared_ptr<coral::fmi::Importer> m_importer;
+        std::shared_ptr<coral::fmi::FMU> m_idFMU;
+        std::vector<Slave> m_slaves;
+    };
 }
 
 
@@ -300,3 +443,278 @@ TEST(coral_master, Execution)
 
     execution.Terminate();
 }
+
+
+TEST(coral_master, Execution_LinearTransform)
+{
+    using namespace coral::master;
+    using namespace coral::model;
+    IdentityExecution t(1, 2);
+    const auto idSlaveID = t.idSlaveIDs[0];
+
+    // Connect the same output to both inputs, with and without a transform.
+    auto settings = std::vector<SlaveConfig>{
+        SlaveConfig(
+            idSlaveID,
+            std::vector<VariableSetting>{
+                VariableSetting(t.realInID, 2.0)
+            }),
+        SlaveConfig(
+            t.logSlaveID,
+            std::vector<VariableSetting>{
+                VariableSetting(
+                    0,
+                    Variable(idSlaveID, t.realOutID),
+                    LinearTransform(3.0, 0.5)),
+                VariableSetting(1, Variable(idSlaveID, t.realOutID))
+            })
+    };
+    t.execution.Reconfigure(settings, std::chrono::seconds(1));
+    t.Step();
+    t.Step();
+
+    const auto log = t.logger->Log();
+    ASSERT_TRUE(log.count(1.0) == 1);
+    const auto& values = log.at(1.0);
+    ASSERT_EQ(2U, values.size());
+    EXPECT_EQ(6.5, values[0]);
+    EXPECT_EQ(2.0, values[1]);
+
+    t.execution.Terminate();
+}
+
+
+TEST(coral_master, Execution_Aggregation)
+{
+    using namespace coral::master;
+    using namespace coral::model;
+    IdentityExecution t(2, 2);
+    const auto idSlave1ID = t.idSlaveIDs[0];
+    const auto idSlave2ID = t.idSlaveIDs[1];
+
+    const auto outputs = std::vector<Variable>{
+        Variable(idSlave1ID, t.realOutID),
+        Variable(idSlave2ID, t.realOutID)
+    };
+    auto settings = std::vector<SlaveConfig>{
+        SlaveConfig(
+            idSlave1ID,
+            std::vector<VariableSetting>{
+                VariableSetting(t.realInID, 1.0)
+            }),
+        SlaveConfig(
+            idSlave2ID,
+            std::vector<VariableSetting>{
+                VariableSetting(t.realInID, 4.0)
+            }),
+        SlaveConfig(
+            t.logSlaveID,
+            std::vector<VariableSetting>{
+                VariableSetting(0, outputs, SUM_AGGREGATION),
+                VariableSetting(1, outputs, MEAN_AGGREGATION, LinearTransform(2.0))
+            })
+    };
+    t.execution.Reconfigure(settings, std::chrono::seconds(1));
+    t.Step();
+    t.Step();
+
+    // Replace the mean by the maximum, and connect the other input to a
+    // single output again.
+    auto newSettings = std::vector<SlaveConfig>{
+        SlaveConfig(
+            t.logSlaveID,
+            std::vector<VariableSetting>{
+                VariableSetting(0, Variable(idSlave1ID, t.realOutID)),
+                VariableSetting(1, outputs, MAX_AGGREGATION)
+            })
+    };
+    t.execution.Reconfigure(newSettings, std::chrono::seconds(1));
+    t.Step();
+    t.Step();
+
+    const auto log = t.logger->Log();
+    const auto vec2Equals = [] (const std::vector<double>& v, double e0, double e1) {
+        return v.size() == 2 && v[0] == e0 && v[1] == e1;
+    };
+    ASSERT_TRUE(log.count(1.0) == 1);
+    EXPECT_TRUE(vec2Equals(log.at(1.0), 5.0, 5.0));
+    ASSERT_TRUE(log.count(3.0) == 1);
+    EXPECT_TRUE(vec2Equals(log.at(3.0), 1.0, 4.0));
+
+    // Only real outputs can be aggregated.
+    const auto mixedOutputs = std::vector<Variable>{
+        Variable(idSlave1ID, t.realOutID),
+        Variable(idSlave2ID, t.integerOutID)
+    };
+    auto invalidSettings = std::vector<SlaveConfig>{
+        SlaveConfig(
+            t.logSlaveID,
+            std::vector<VariableSetting>{
+                VariableSetting(0, mixedOutputs, SUM_AGGREGATION)
+            })
+    };
+    EXPECT_THROW(
+        t.execution.Reconfigure(invalidSettings, std::chrono::seconds(1)),
+        std::runtime_error);
+
+    t.execution.Terminate();
+}
+
+
+TEST(coral_master, Execution_LegacySlave)
+{
+    using namespace coral::master;
+    using namespace coral::model;
+    const auto testDataDir = std::getenv("CORAL_TEST_DATA_DIR");
+    auto importer = coral::fmi::Importer::Create();
+    auto idFMU = importer->Import(
+        boost::filesystem::path(testDataDir) / "fmi1_cs" / "identity.fmu");
+    VariableID realOutID = 0;
+    for (const auto& v : idFMU->Description().Variables()) {
+        if (v.Name() == "realOut") realOutID = v.ID();
+    }
+
+    auto idSlave = SpawnSlave(idFMU->InstantiateSlave());
+    auto logSlave = SpawnSlave(std::make_shared<SimpleLogger>(1));
+    LegacySlaveProxy logProxy(logSlave.locator.ControlEndpoint());
+
+    Execution execution("coral_test_execution");
+    auto added = std::vector<AddedSlave>{
+        AddedSlave(idSlave.locator, "id"),
+        AddedSlave(
+            coral::net::SlaveLocator(
+                logProxy.Endpoint(),
+                logSlave.locator.DataPubEndpoint()),
+            "log")
+    };
+    execution.Reconstitute(added, std::chrono::seconds(1));
+    const auto output = Variable(added[0].info.ID(), realOutID);
+    const auto logSlaveID = added[1].info.ID();
+
+    // The slave would ignore aggregations and transformations, so the master
+    // must refuse them.
+    auto settings = std::vector<SlaveConfig>{
+        SlaveConfig(
+            logSlaveID,
+            std::vector<VariableSetting>{
+                VariableSetting(0, std::vector<Variable>{output}, SUM_AGGREGATION)
+            })
+    };
+    EXPECT_THROW(
+        execution.Reconfigure(settings, std::chrono::seconds(1)),
+        std::runtime_error);
+    settings = std::vector<SlaveConfig>{
+        SlaveConfig(
+            logSlaveID,
+            std::vector<VariableSetting>{
+                VariableSetting(0, output, LinearTransform(2.0))
+            })
+    };
+    EXPECT_THROW(
+        execution.Reconfigure(settings, std::chrono::seconds(1)),
+        std::runtime_error);
+
+    // Ordinary connections still work.
+    settings = std::vector<SlaveConfig>{
+        SlaveConfig(
+            logSlaveID,
+            std::vector<VariableSetting>{VariableSetting(0, output)})
+    };
+    EXPECT_NO_THROW(execution.Reconfigure(settings, std::chrono::seconds(1)));
+
+    execution.Terminate();
+    idSlave.thread.join();
+    logSlave.thread.join();
+}
+
+
+TEST(coral_master, Execution_DeltaPublication_LegacySlave)
+{
+    using namespace coral::master;
+    auto logSlave = SpawnSlave(std::make_shared<SimpleLogger>(1));
+    LegacySlaveProxy logProxy(logSlave.locator.ControlEndpoint());
+
+    // The slave would wait for values which are never sent because they
+    // haven't changed, so the master must refuse to add it.
+    ExecutionOptions options;
+    options.deltaPublication = true;
+    Execution execution("coral_test_execution", options);
+    auto added = std::vector<AddedSlave>{
+        AddedSlave(
+            coral::net::SlaveLocator(
+                logProxy.Endpoint(),
+                logSlave.locator.DataPubEndpoint()),
+            "log")
+    };
+    EXPECT_THROW(
+        execution.Reconstitute(added, std::chrono::seconds(1)),
+        std::runtime_error);
+    EXPECT_EQ(std::make_error_code(std::errc::not_supported), added[0].error);
+
+    execution.Terminate();
+    logSlave.thread.join();
+}
+
+
+TEST(coral_master, Execution_DeltaPublication)
+{
+    using namespace coral::master;
+    using namespace coral::model;
+    ExecutionOptions options;
+    options.deltaPublication = true;
+    IdentityExecution t(1, 1, options);
+    const auto idSlaveID = t.idSlaveIDs[0];
+
+    auto settings = std::vector<SlaveConfig>{
+        SlaveConfig(
+            idSlaveID,
+            std::vector<VariableSetting>{
+                VariableSetting(t.realInID, 2.0)
+            }),
+        SlaveConfig(
+            t.logSlaveID,
+            std::vector<VariableSetting>{
+                VariableSetting(0, Variable(idSlaveID, t.realOutID))
+            })
+    };
+    t.execution.Reconfigure(settings, std::chrono::seconds(1));
+
+    // The slaves run in this process, so we can see what they publish in
+    // the global metrics.  When no outputs have changed, each slave only
+    // publishes its "step complete" message.
+    const auto& publishedMessages =
+        coral::metrics::GetCounter("coral_data_published_messages_total", "");
+    const auto& unchangedValues =
+        coral::metrics::GetCounter("coral_data_unchanged_values_total", "");
+    const auto stepWithoutChanges = [&] () {
+        const auto published0 = publishedMessages.Value();
+        const auto unchanged0 = unchangedValues.Value();
+        t.Step();
+        EXPECT_EQ(2u, publishedMessages.Value() - published0);
+        EXPECT_LT(0u, unchangedValues.Value() - unchanged0);
+    };
+
+    // The output stays the same for a few steps, so it is only published
+    // once, and then it changes.
+    t.Step();
+    stepWithoutChanges();
+    auto newSettings = std::vector<SlaveConfig>{
+        SlaveConfig(
+            idSlaveID,
+            std::vector<VariableSetting>{
+                VariableSetting(t.realInID, 4.0)
+            })
+    };
+    t.execution.Reconfigure(newSettings, std::chrono::seconds(1));
+    t.Step();
+    stepWithoutChanges();
+    stepWithoutChanges();
+
+    const auto log = t.logger->Log();
+    ASSERT_TRUE(log.count(2.0) == 1);
+    ASSERT_TRUE(log.count(4.0) == 1);
+    EXPECT_EQ(2.0, log.at(2.0).at(0));
+    EXPECT_EQ(4.0, log.at(4.0).at(0));
+
+    t.execution.Terminate();
+}
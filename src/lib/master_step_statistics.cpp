@@ -0,0 +1,90 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/master/step_statistics.hpp>
+
+#include <algorithm>
+#include <limits>
+
+#include <coral/error.hpp>
+#include <coral/util/histogram.hpp>
+
+
+namespace coral
+{
+namespace master
+{
+
+DurationHistogram::DurationHistogram() noexcept
+    : m_count(0),
+      m_min(std::numeric_limits<std::int64_t>::max()),
+      m_max(0),
+      m_sum(0.0)
+{
+    static_assert(
+        bucketCount == coral::util::logBucketCount,
+        "DurationHistogram must have room for all buckets");
+    m_buckets.fill(0);
+}
+
+
+void DurationHistogram::Add(std::chrono::nanoseconds duration) noexcept
+{
+    const auto value = std::max(duration.count(), std::int64_t(0));
+    ++m_buckets[coral::util::LogBucketIndex(value)];
+    ++m_count;
+    m_min = std::min(m_min, value);
+    m_max = std::max(m_max, value);
+    m_sum += value;
+}
+
+
+std::uint64_t DurationHistogram::Count() const noexcept
+{
+    return m_count;
+}
+
+
+std::chrono::nanoseconds DurationHistogram::Min() const noexcept
+{
+    return std::chrono::nanoseconds(m_count ? m_min : 0);
+}
+
+
+std::chrono::nanoseconds DurationHistogram::Max() const noexcept
+{
+    return std::chrono::nanoseconds(m_max);
+}
+
+
+std::chrono::nanoseconds DurationHistogram::Mean() const noexcept
+{
+    if (m_count == 0) return std::chrono::nanoseconds(0);
+    return std::chrono::nanoseconds(
+        static_cast<std::int64_t>(m_sum / m_count));
+}
+
+
+std::chrono::nanoseconds DurationHistogram::Percentile(double percentile) const
+{
+    CORAL_INPUT_CHECK(percentile >= 0.0 && percentile <= 100.0);
+    if (m_count == 0) return std::chrono::nanoseconds(0);
+
+    const auto quantile = coral::util::LogBucketQuantile(
+        m_buckets.data(), m_buckets.size(), m_count, percentile / 100.0);
+    return std::chrono::nanoseconds(std::min(std::max(quantile, m_min), m_max));
+}
+
+
+void SlaveStepStatistics::Add(const SlaveStepTimings& timings) noexcept
+{
+    doStep.Add(timings.doStep);
+    publish.Add(timings.publish);
+    dataWait.Add(timings.dataWait);
+}
+
+
+}} // namespace
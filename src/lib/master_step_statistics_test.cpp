@@ -0,0 +1,48 @@
+#include <stdexcept>
+#include <gtest/gtest.h>
+#include <coral/master/step_statistics.hpp>
+
+using namespace std::chrono;
+
+
+TEST(coral_master, DurationHistogram)
+{
+    coral::master::DurationHistogram h;
+    EXPECT_EQ(0u, h.Count());
+    EXPECT_EQ(nanoseconds(0), h.Min());
+    EXPECT_EQ(nanoseconds(0), h.Max());
+    EXPECT_EQ(nanoseconds(0), h.Mean());
+    EXPECT_EQ(nanoseconds(0), h.Percentile(50));
+
+    for (int i = 1; i <= 100; ++i) h.Add(milliseconds(i));
+    EXPECT_EQ(100u, h.Count());
+    EXPECT_EQ(milliseconds(1), h.Min());
+    EXPECT_EQ(milliseconds(100), h.Max());
+    EXPECT_EQ(microseconds(50500), h.Mean());
+    EXPECT_NEAR(1e6, static_cast<double>(h.Percentile(0).count()), 0.2e6);
+    EXPECT_EQ(milliseconds(100), h.Percentile(100));
+    // Percentiles are accurate to within about 20%
+    EXPECT_NEAR(50e6, static_cast<double>(h.Percentile(50).count()), 10e6);
+    EXPECT_NEAR(90e6, static_cast<double>(h.Percentile(90).count()), 18e6);
+    EXPECT_GE(h.Percentile(90), h.Percentile(50));
+
+    EXPECT_THROW(h.Percentile(-1), std::invalid_argument);
+    EXPECT_THROW(h.Percentile(101), std::invalid_argument);
+
+    h.Add(nanoseconds(-5));
+    EXPECT_EQ(nanoseconds(0), h.Min());
+}
+
+
+TEST(coral_master, SlaveStepStatistics)
+{
+    coral::master::SlaveStepTimings t;
+    t.doStep = milliseconds(3);
+    t.publish = microseconds(10);
+    coral::master::SlaveStepStatistics s;
+    s.Add(t);
+    EXPECT_EQ(1u, s.doStep.Count());
+    EXPECT_EQ(milliseconds(3), s.doStep.Max());
+    EXPECT_EQ(microseconds(10), s.publish.Max());
+    EXPECT_EQ(nanoseconds(0), s.dataWait.Max());
+}
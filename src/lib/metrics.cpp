@@ -0,0 +1,465 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/metrics.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <coral/error.hpp>
+#include <coral/log.hpp>
+#include <coral/net/zmqx.hpp>
+#include <coral/util.hpp>
+#include <coral/util/histogram.hpp>
+
+
+namespace coral
+{
+namespace metrics
+{
+
+
+// =============================================================================
+// Gauge
+// =============================================================================
+
+
+void Gauge::Add(double delta) noexcept
+{
+    auto value = m_value.load(std::memory_order_relaxed);
+    while (!m_value.compare_exchange_weak(
+        value, value + delta, std::memory_order_relaxed)) { }
+}
+
+
+// =============================================================================
+// Histogram
+// =============================================================================
+
+static_assert(
+    Histogram::bucketCount == coral::util::logBucketCount,
+    "Histogram must have room for all buckets");
+
+
+Histogram::Histogram() noexcept
+    : m_sum(0)
+{
+    for (auto& b : m_buckets) b.store(0, std::memory_order_relaxed);
+}
+
+
+void Histogram::Record(std::int64_t value) noexcept
+{
+    const auto v = std::max(value, std::int64_t(0));
+    m_buckets[coral::util::LogBucketIndex(v)].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(v, std::memory_order_relaxed);
+}
+
+
+Histogram::Snapshot Histogram::Take() const
+{
+    Snapshot s;
+    s.buckets.resize(bucketCount);
+    for (int i = 0; i < bucketCount; ++i) {
+        s.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        s.count += s.buckets[i];
+    }
+    s.sum = m_sum.load(std::memory_order_relaxed);
+    return s;
+}
+
+
+std::int64_t Histogram::Snapshot::Quantile(double q) const
+{
+    CORAL_INPUT_CHECK(q >= 0.0 && q <= 1.0);
+    return coral::util::LogBucketQuantile(buckets.data(), buckets.size(), count, q);
+}
+
+
+// =============================================================================
+// Registry
+// =============================================================================
+
+namespace
+{
+    enum class MetricType { counter, gauge, histogram };
+
+    const char* TypeName(MetricType type)
+    {
+        switch (type) {
+            case MetricType::counter:   return "counter";
+            case MetricType::gauge:     return "gauge";
+            case MetricType::histogram: return "summary";
+        }
+        assert(false);
+        return "untyped";
+    }
+
+    // A family is the set of all metrics with the same name.  Only one of
+    // the three members of Metric is non-null, as given by Family::type.
+    struct Metric
+    {
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    struct Family
+    {
+        MetricType type;
+        std::string help;
+        double unit;
+        std::map<Labels, Metric> metrics;
+    };
+
+    std::mutex g_mutex; // Protects g_families
+    std::map<std::string, Family> g_families;
+
+
+    // Returns the metric with the given name and labels, creating the family
+    // and/or the metric as necessary.  The mutex must be locked.
+    Metric& GetMetric(
+        MetricType type,
+        const std::string& name,
+        const std::string& help,
+        const Labels& labels,
+        double unit)
+    {
+        CORAL_INPUT_CHECK(!name.empty());
+        auto it = g_families.find(name);
+        if (it == g_families.end()) {
+            Family f;
+            f.type = type;
+            f.help = help;
+            f.unit = unit;
+            it = g_families.insert(std::make_pair(name, std::move(f))).first;
+        } else if (it->second.type != type) {
+            throw std::logic_error(
+                "Metric '" + name + "' already registered with another type");
+        } else if (it->second.help.empty()) {
+            it->second.help = help;
+        }
+        return it->second.metrics[labels];
+    }
+
+
+    void WriteEscaped(std::ostream& out, const std::string& s, bool quoted)
+    {
+        for (const char c : s) {
+            if (c == '\\') out << "\\\\";
+            else if (c == '\n') out << "\\n";
+            else if (c == '"' && quoted) out << "\\\"";
+            else out << c;
+        }
+    }
+
+
+    // Writes the label set, with an optional extra label at the end.
+    void WriteLabels(
+        std::ostream& out,
+        const Labels& labels,
+        const char* extraName = nullptr,
+        const std::string& extraValue = std::string())
+    {
+        if (labels.empty() && !extraName) return;
+        out << '{';
+        bool first = true;
+        for (const auto& label : labels) {
+            if (!first) out << ',';
+            out << label.first << "=\"";
+            WriteEscaped(out, label.second, true);
+            out << '"';
+            first = false;
+        }
+        if (extraName) {
+            if (!first) out << ',';
+            out << extraName << "=\"" << extraValue << '"';
+        }
+        out << '}';
+    }
+
+
+    void WriteValue(std::ostream& out, double value)
+    {
+        if (std::isnan(value)) out << "NaN";
+        else if (std::isinf(value)) out << (value > 0 ? "+Inf" : "-Inf");
+        else out << value;
+    }
+}
+
+
+Counter& GetCounter(
+    const std::string& name,
+    const std::string& help,
+    const Labels& labels,
+    double unit)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto& m = GetMetric(MetricType::counter, name, help, labels, unit);
+    if (!m.counter) m.counter = std::make_unique<Counter>();
+    return *m.counter;
+}
+
+
+Gauge& GetGauge(
+    const std::string& name,
+    const std::string& help,
+    const Labels& labels)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto& m = GetMetric(MetricType::gauge, name, help, labels, 1.0);
+    if (!m.gauge) m.gauge = std::make_unique<Gauge>();
+    return *m.gauge;
+}
+
+
+Histogram& GetHistogram(
+    const std::string& name,
+    const std::string& help,
+    const Labels& labels,
+    double unit)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto& m = GetMetric(MetricType::histogram, name, help, labels, unit);
+    if (!m.histogram) m.histogram = std::make_unique<Histogram>();
+    return *m.histogram;
+}
+
+
+void WritePrometheusText(std::ostream& out)
+{
+    const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+    std::ostringstream buffer;
+    buffer << std::setprecision(10);
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        for (const auto& family : g_families) {
+            const auto& name = family.first;
+            const auto& f = family.second;
+            buffer << "# HELP " << name << ' ';
+            WriteEscaped(buffer, f.help, false);
+            buffer << "\n# TYPE " << name << ' ' << TypeName(f.type) << '\n';
+            for (const auto& metric : f.metrics) {
+                const auto& labels = metric.first;
+                const auto& m = metric.second;
+                switch (f.type) {
+                    case MetricType::counter:
+                        buffer << name;
+                        WriteLabels(buffer, labels);
+                        buffer << ' ';
+                        if (f.unit == 1.0) buffer << m.counter->Value();
+                        else WriteValue(buffer, m.counter->Value() * f.unit);
+                        buffer << '\n';
+                        break;
+                    case MetricType::gauge:
+                        buffer << name;
+                        WriteLabels(buffer, labels);
+                        buffer << ' ';
+                        WriteValue(buffer, m.gauge->Value());
+                        buffer << '\n';
+                        break;
+                    case MetricType::histogram: {
+                        const auto s = m.histogram->Take();
+                        for (const auto q : quantiles) {
+                            std::ostringstream qs;
+                            qs << q;
+                            buffer << name;
+                            WriteLabels(buffer, labels, "quantile", qs.str());
+                            buffer << ' ';
+                            WriteValue(buffer, s.Quantile(q) * f.unit);
+                            buffer << '\n';
+                        }
+                        buffer << name << "_sum";
+                        WriteLabels(buffer, labels);
+                        buffer << ' ';
+                        WriteValue(buffer, s.sum * f.unit);
+                        buffer << '\n' << name << "_count";
+                        WriteLabels(buffer, labels);
+                        buffer << ' ' << s.count << '\n';
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    out << buffer.str();
+}
+
+
+// =============================================================================
+// Exporter
+// =============================================================================
+
+namespace
+{
+    void WriteFile(const std::string& path)
+    {
+        const auto tempPath = path + ".tmp";
+        {
+            std::ofstream out(tempPath);
+            if (!out) {
+                throw std::runtime_error("Failed to open file: " + tempPath);
+            }
+            WritePrometheusText(out);
+        }
+        boost::filesystem::rename(tempPath, path);
+    }
+
+
+    // Handles one incoming frame pair on a ZMQ_STREAM socket.  Since a
+    // scrape is a single short request, we reply to the first data we see
+    // from a peer and close the connection without parsing the request.
+    void ServeHttp(zmq::socket_t& socket)
+    {
+        zmq::message_t identity, data;
+        socket.recv(&identity);
+        if (!identity.more()) return;
+        socket.recv(&data);
+        if (data.size() == 0) return; // Connection opened or closed
+
+        std::ostringstream body;
+        WritePrometheusText(body);
+        const auto bodyText = body.str();
+        std::ostringstream response;
+        response << "HTTP/1.0 200 OK\r\n"
+                 << "Content-Type: text/plain; version=0.0.4\r\n"
+                 << "Content-Length: " << bodyText.size() << "\r\n"
+                 << "Connection: close\r\n\r\n"
+                 << bodyText;
+        const auto responseText = response.str();
+
+        socket.send(identity.data(), identity.size(), ZMQ_SNDMORE);
+        socket.send(responseText.data(), responseText.size());
+        socket.send(identity.data(), identity.size(), ZMQ_SNDMORE);
+        socket.send("", 0);
+    }
+
+
+    void ExporterThread(
+        const std::string& outputFile,
+        std::chrono::milliseconds interval,
+        zmq::socket_t inprocSocket,
+        std::unique_ptr<zmq::socket_t> httpSocket)
+    {
+        zmq::pollitem_t pollItems[] = {
+            { static_cast<void*>(inprocSocket), 0, ZMQ_POLLIN, 0 },
+            { httpSocket ? static_cast<void*>(*httpSocket) : nullptr,
+              0, ZMQ_POLLIN, 0 }
+        };
+        const auto pollItemCount = httpSocket ? 2 : 1;
+        auto nextWrite = std::chrono::steady_clock::now();
+        for (;;) {
+            const auto timeout = std::max(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    nextWrite - std::chrono::steady_clock::now()),
+                std::chrono::milliseconds(0));
+            zmq::poll(
+                pollItems,
+                pollItemCount,
+                outputFile.empty() ? -1 : boost::numeric_cast<long>(timeout.count()));
+            if (pollItems[0].revents & ZMQ_POLLIN) {
+                zmq::message_t msg;
+                inprocSocket.recv(&msg);
+                assert(!msg.more());
+                if (coral::net::zmqx::ToString(msg) == "STOP") break;
+            }
+            try {
+                if (pollItems[1].revents & ZMQ_POLLIN) ServeHttp(*httpSocket);
+                if (!outputFile.empty()
+                        && std::chrono::steady_clock::now() >= nextWrite) {
+                    WriteFile(outputFile);
+                    nextWrite = std::chrono::steady_clock::now() + interval;
+                }
+            } catch (const std::exception& e) {
+                coral::log::Log(coral::log::error,
+                    boost::format("Metrics export failed: %s") % e.what());
+                nextWrite = std::chrono::steady_clock::now() + interval;
+            }
+        }
+    }
+}
+
+
+class Exporter::Private
+{
+public:
+    Private(
+        const std::string& outputFile,
+        std::uint16_t httpPort,
+        std::chrono::milliseconds interval)
+        : m_outputFile(outputFile)
+        , m_socket(coral::net::zmqx::GlobalContext(), ZMQ_PAIR)
+    {
+        CORAL_INPUT_CHECK(interval > std::chrono::milliseconds(0));
+
+        const auto endpoint = "inproc://" + coral::util::RandomUUID();
+        m_socket.bind(endpoint);
+        auto otherSocket =
+            zmq::socket_t(coral::net::zmqx::GlobalContext(), ZMQ_PAIR);
+        otherSocket.connect(endpoint);
+
+        std::unique_ptr<zmq::socket_t> httpSocket;
+        if (httpPort != 0) {
+            httpSocket = std::make_unique<zmq::socket_t>(
+                coral::net::zmqx::GlobalContext(), ZMQ_STREAM);
+            httpSocket->setsockopt(ZMQ_LINGER, 0);
+            httpSocket->bind("tcp://127.0.0.1:" + std::to_string(httpPort));
+        }
+
+        m_thread = std::thread(&ExporterThread,
+            outputFile,
+            interval,
+            std::move(otherSocket),
+            std::move(httpSocket));
+    }
+
+    ~Private() noexcept
+    {
+        try {
+            m_socket.send("STOP", 4);
+            m_thread.join();
+            if (!m_outputFile.empty()) WriteFile(m_outputFile);
+        } catch (const std::exception& e) {
+            coral::log::Log(coral::log::error,
+                boost::format("Metrics export failed: %s") % e.what());
+        }
+    }
+
+private:
+    std::string m_outputFile;
+    zmq::socket_t m_socket;
+    std::thread m_thread;
+};
+
+
+Exporter::Exporter(
+    const std::string& outputFile,
+    std::uint16_t httpPort,
+    std::chrono::milliseconds interval)
+    : m_private(std::make_unique<Private>(outputFile, httpPort, interval))
+{
+}
+
+
+Exporter::~Exporter() noexcept
+{
+}
+
+
+}} // namespace
@@ -0,0 +1,78 @@
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <gtest/gtest.h>
+
+#include <coral/metrics.hpp>
+
+namespace cm = coral::metrics;
+
+
+TEST(coral_metrics, Counter)
+{
+    auto& c = cm::GetCounter("test_counter_total", "A counter");
+    EXPECT_EQ(0u, c.Value());
+    c.Increment();
+    c.Increment(41);
+    EXPECT_EQ(42u, c.Value());
+    EXPECT_EQ(&c, &cm::GetCounter("test_counter_total", "Ignored"));
+
+    auto& lc = cm::GetCounter("test_counter_total", "", {{"slave", "a"}});
+    EXPECT_NE(&c, &lc);
+    EXPECT_EQ(0u, lc.Value());
+
+    EXPECT_THROW(cm::GetGauge("test_counter_total", ""), std::logic_error);
+}
+
+
+TEST(coral_metrics, Gauge)
+{
+    auto& g = cm::GetGauge("test_gauge", "A gauge");
+    g.Set(1.5);
+    g.Add(-2.0);
+    EXPECT_DOUBLE_EQ(-0.5, g.Value());
+}
+
+
+TEST(coral_metrics, Histogram)
+{
+    auto& h = cm::GetHistogram("test_histogram", "A histogram");
+    EXPECT_EQ(0u, h.Take().count);
+    EXPECT_EQ(0, h.Take().Quantile(0.5));
+    for (int i = 1; i <= 1000; ++i) h.Record(i * 1000);
+    h.Record(-5);
+
+    const auto s = h.Take();
+    EXPECT_EQ(1001u, s.count);
+    EXPECT_EQ(500500000, s.sum);
+    EXPECT_EQ(0, s.Quantile(0.0));
+    EXPECT_NEAR(500000, s.Quantile(0.5), 100000);
+    EXPECT_NEAR(990000, s.Quantile(0.99), 200000);
+    EXPECT_THROW(s.Quantile(1.5), std::invalid_argument);
+}
+
+
+TEST(coral_metrics, WritePrometheusText)
+{
+    cm::GetCounter("test_export_total", "Exported \"counter\"\nhelp",
+        {{"slave", "x\"y"}}).Increment(3);
+    cm::GetCounter("test_export_seconds_total", "Scaled", {}, 1e-9)
+        .Increment(2500000000);
+    auto& h = cm::GetHistogram("test_export_seconds", "Summary", {}, 1e-9);
+    h.Record(1000000000);
+
+    std::ostringstream out;
+    cm::WritePrometheusText(out);
+    const auto text = out.str();
+    EXPECT_NE(std::string::npos, text.find(
+        "# HELP test_export_total Exported \"counter\"\\nhelp\n"
+        "# TYPE test_export_total counter\n"
+        "test_export_total{slave=\"x\\\"y\"} 3\n"));
+    EXPECT_NE(std::string::npos, text.find("test_export_seconds_total 2.5\n"));
+    EXPECT_NE(std::string::npos, text.find(
+        "# TYPE test_export_seconds summary\n"));
+    EXPECT_NE(std::string::npos, text.find(
+        "test_export_seconds{quantile=\"0.5\"} "));
+    EXPECT_NE(std::string::npos, text.find("test_export_seconds_sum 1\n"));
+    EXPECT_NE(std::string::npos, text.find("test_export_seconds_count 1\n"));
+}
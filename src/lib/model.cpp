@@ -218,19 +218,24 @@ VariableSetting::VariableSetting(
       m_hasValue(true),
       m_value(value),
       m_isConnectionChange(false),
-      m_connectedOutput()
+      m_connectedOutput(),
+      m_aggregation(NO_AGGREGATION),
+      m_transform()
 {
 }
 
 
 VariableSetting::VariableSetting(
     VariableID inputVar,
-    const coral::model::Variable& outputVar)
+    const coral::model::Variable& outputVar,
+    const LinearTransform& transform)
     : m_variable(inputVar),
       m_hasValue(false),
       m_value(),
       m_isConnectionChange(true),
-      m_connectedOutput(outputVar)
+      m_connectedOutput(outputVar),
+      m_aggregation(NO_AGGREGATION),
+      m_transform(transform)
 {
 }
 
@@ -238,16 +243,38 @@ VariableSetting::VariableSetting(
 VariableSetting::VariableSetting(
     VariableID inputVar,
     const ScalarValue& value,
-    const coral::model::Variable& outputVar)
+    const coral::model::Variable& outputVar,
+    const LinearTransform& transform)
     : m_variable(inputVar),
       m_hasValue(true),
       m_value(value),
       m_isConnectionChange(true),
-      m_connectedOutput(outputVar)
+      m_connectedOutput(outputVar),
+      m_aggregation(NO_AGGREGATION),
+      m_transform(transform)
 {
 }
 
 
+VariableSetting::VariableSetting(
+    VariableID inputVar,
+    const std::vector<coral::model::Variable>& outputVars,
+    coral::model::Aggregation aggregation,
+    const LinearTransform& transform)
+    : m_variable(inputVar),
+      m_hasValue(false),
+      m_value(),
+      m_isConnectionChange(true),
+      m_connectedOutput(),
+      m_aggregation(aggregation),
+      m_aggregatedOutputs(outputVars),
+      m_transform(transform)
+{
+    CORAL_PRECONDITION_CHECK(aggregation != NO_AGGREGATION);
+    CORAL_PRECONDITION_CHECK(!outputVars.empty());
+}
+
+
 VariableID VariableSetting::Variable() const noexcept
 {
     return m_variable;
@@ -276,10 +303,33 @@ bool VariableSetting::IsConnectionChange() const noexcept
 const coral::model::Variable& VariableSetting::ConnectedOutput() const
 {
     CORAL_PRECONDITION_CHECK(IsConnectionChange());
+    CORAL_PRECONDITION_CHECK(m_aggregation == NO_AGGREGATION);
     return m_connectedOutput;
 }
 
 
+coral::model::Aggregation VariableSetting::Aggregation() const
+{
+    CORAL_PRECONDITION_CHECK(IsConnectionChange());
+    return m_aggregation;
+}
+
+
+const std::vector<coral::model::Variable>& VariableSetting::AggregatedOutputs() const
+{
+    CORAL_PRECONDITION_CHECK(IsConnectionChange());
+    CORAL_PRECONDITION_CHECK(m_aggregation != NO_AGGREGATION);
+    return m_aggregatedOutputs;
+}
+
+
+const LinearTransform& VariableSetting::Transform() const
+{
+    CORAL_PRECONDITION_CHECK(IsConnectionChange());
+    return m_transform;
+}
+
+
 // =============================================================================
 // Free functions
 // =============================================================================
@@ -10,7 +10,11 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/net/reactor.hpp>
 
 #include <algorithm>
+#include <cassert>
+#include <cerrno>
 #include <stdexcept>
+#include <thread>
+#include <coral/metrics.hpp>
 #include <coral/util.hpp>
 
 
@@ -20,90 +24,209 @@ namespace net
 {
 
 
+// The polling mechanism.  Both implementations take constant time to add or
+// remove a socket, and report only the sockets which have incoming messages.
+#ifdef ZMQ_HAVE_POLLER
+
+class Reactor::Poller
+{
+public:
+    Poller()
+        : m_poller(zmq_poller_new()),
+          m_size(0)
+    {
+        if (m_poller == nullptr) throw zmq::error_t();
+    }
+
+    ~Poller()
+    {
+        zmq_poller_destroy(&m_poller);
+    }
+
+    void Add(SocketEntry& entry)
+    {
+        const auto rc = entry.socket
+            ? zmq_poller_add(m_poller, static_cast<void*>(*entry.socket), &entry, ZMQ_POLLIN)
+            : zmq_poller_add_fd(m_poller, entry.nativeSocket, &entry, ZMQ_POLLIN);
+        if (rc != 0) throw zmq::error_t();
+        ++m_size;
+    }
+
+    void Remove(SocketEntry& entry) noexcept
+    {
+        if (entry.socket) {
+            zmq_poller_remove(m_poller, static_cast<void*>(*entry.socket));
+        } else {
+            zmq_poller_remove_fd(m_poller, entry.nativeSocket);
+        }
+        --m_size;
+    }
+
+    void Wait(long timeout, std::vector<SocketEntry*>& ready)
+    {
+        ready.clear();
+        if (m_size == 0) {
+            // zmq_poller_wait_all() refuses to wait on an empty set.
+            if (timeout > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+            }
+            return;
+        }
+        m_events.resize(m_size);
+        const auto n = zmq_poller_wait_all(
+            m_poller, m_events.data(), static_cast<int>(m_events.size()), timeout);
+        if (n < 0) {
+            // ZeroMQ 4.2 reports a timeout with ETIMEDOUT, later versions
+            // with EAGAIN.
+            const auto e = zmq_errno();
+            if (e == EAGAIN || e == ETIMEDOUT) return;
+            throw zmq::error_t();
+        }
+        for (int i = 0; i < n; ++i) {
+            if (m_events[i].events & ZMQ_POLLIN) {
+                ready.push_back(static_cast<SocketEntry*>(m_events[i].user_data));
+            }
+        }
+    }
+
+private:
+    void* m_poller;
+    std::size_t m_size;
+    std::vector<zmq_poller_event_t> m_events;
+};
+
+#else
+
+class Reactor::Poller
+{
+public:
+    void Add(SocketEntry& entry)
+    {
+        zmq::pollitem_t pi = {
+            entry.socket ? static_cast<void*>(*entry.socket) : nullptr,
+            entry.socket ? 0 : entry.nativeSocket,
+            ZMQ_POLLIN,
+            0
+        };
+        m_items.push_back(pi);
+        m_entries.push_back(&entry);
+        entry.pollIndex = m_entries.size() - 1;
+    }
+
+    void Remove(SocketEntry& entry) noexcept
+    {
+        // Dispatch order is determined by the handlers' sequence numbers, so
+        // the order of the poll items doesn't matter.
+        const auto i = entry.pollIndex;
+        assert(m_entries[i] == &entry);
+        m_items[i] = m_items.back();
+        m_items.pop_back();
+        m_entries[i] = m_entries.back();
+        m_entries[i]->pollIndex = i;
+        m_entries.pop_back();
+    }
+
+    void Wait(long timeout, std::vector<SocketEntry*>& ready)
+    {
+        ready.clear();
+        zmq::poll(m_items.data(), m_items.size(), timeout);
+        for (std::size_t i = 0; i < m_items.size(); ++i) {
+            if (m_items[i].revents & ZMQ_POLLIN) ready.push_back(m_entries[i]);
+        }
+    }
+
+private:
+    std::vector<zmq::pollitem_t> m_items;
+    std::vector<SocketEntry*> m_entries;
+};
+
+#endif // ZMQ_HAVE_POLLER
+
+
 Reactor::Reactor()
-    : m_nextTimerID(0),
-      m_needsRebuild(false),
+    : m_nextHandlerSequence(0),
+      m_nextTimerID(0),
       m_running(false)
 { }
 
 
-void Reactor::AddSocket(zmq::socket_t& socket, SocketHandler handler)
-{
-    m_sockets.push_back(
-        std::make_pair(&socket, std::make_unique<SocketHandler>(std::move(handler))));
-    m_needsRebuild = true;
-}
+Reactor::~Reactor() = default;
 
 
-void Reactor::RemoveSocket(zmq::socket_t& socket) noexcept
+void Reactor::AddSocket(zmq::socket_t& socket, SocketHandler handler)
 {
-    // Actual removal is deferred to the next rebuild.  At this stage, we just
-    // replace the socket pointer with null.
-    for (auto it = m_sockets.begin(); it != m_sockets.end(); ++it) {
-        if (it->first == &socket) it->first = nullptr;
+    auto handlerPtr = std::make_unique<SocketHandler>(std::move(handler));
+    auto it = m_sockets.find(&socket);
+    if (it == m_sockets.end()) {
+        auto entry = std::make_unique<SocketEntry>();
+        entry->socket = &socket;
+        it = m_sockets.emplace(&socket, std::move(entry)).first;
+        if (m_poller) {
+            try {
+                m_poller->Add(*it->second);
+            } catch (...) {
+                m_sockets.erase(it);
+                throw;
+            }
+        }
     }
-    m_needsRebuild = true;
+    it->second->handlers.emplace_back(
+        m_nextHandlerSequence++,
+        std::move(handlerPtr));
 }
 
 
-void Reactor::AddNativeSocket(NativeSocket socket, NativeSocketHandler handler)
+void Reactor::RemoveSocket(zmq::socket_t& socket) noexcept
 {
-    m_nativeSockets.push_back(
-        std::make_pair(
-            socket,
-            std::make_unique<NativeSocketHandler>(std::move(handler))));
-    m_needsRebuild = true;
+    const auto it = m_sockets.find(&socket);
+    if (it == m_sockets.end()) return;
+    auto entry = std::move(it->second);
+    m_sockets.erase(it);
+    RemoveSocketEntry(std::move(entry));
 }
 
 
-namespace
+void Reactor::AddNativeSocket(NativeSocket socket, NativeSocketHandler handler)
 {
-#ifdef _WIN32
-    const SOCKET NULL_NATIVE_SOCKET = INVALID_SOCKET;
-#else
-    const int NULL_NATIVE_SOCKET = -1;
-#endif
+    auto handlerPtr = std::make_unique<NativeSocketHandler>(std::move(handler));
+    auto it = m_nativeSockets.find(socket);
+    if (it == m_nativeSockets.end()) {
+        auto entry = std::make_unique<SocketEntry>();
+        entry->nativeSocket = socket;
+        it = m_nativeSockets.emplace(socket, std::move(entry)).first;
+        if (m_poller) {
+            try {
+                m_poller->Add(*it->second);
+            } catch (...) {
+                m_nativeSockets.erase(it);
+                throw;
+            }
+        }
+    }
+    it->second->nativeHandlers.emplace_back(
+        m_nextHandlerSequence++,
+        std::move(handlerPtr));
 }
 
 
 void Reactor::RemoveNativeSocket(NativeSocket socket) noexcept
 {
-    // Actual removal is deferred to the next rebuild.  At this stage, we just
-    // replace the file descriptor with an invalid value.
-    for (auto& s : m_nativeSockets) {
-        if (s.first == socket) s.first = NULL_NATIVE_SOCKET;
-    }
-    m_needsRebuild = true;
+    const auto it = m_nativeSockets.find(socket);
+    if (it == m_nativeSockets.end()) return;
+    auto entry = std::move(it->second);
+    m_nativeSockets.erase(it);
+    RemoveSocketEntry(std::move(entry));
 }
 
 
-namespace
+void Reactor::RemoveSocketEntry(std::unique_ptr<SocketEntry> entry) noexcept
 {
-    // We use templates to work around the fact that Reactor::Timer is private.
-    template<typename T>
-    bool EventTimeGreater(const T& a, const T& b)
-    {
-        return a.nextEventTime > b.nextEventTime;
-    }
-
-    template<typename T>
-    void PushTimer(std::vector<T>& v, T t)
-    {
-        v.push_back(std::move(t));
-        std::push_heap(std::begin(v), std::end(v), EventTimeGreater<T>);
-    }
-
-    template<typename T>
-    void PopTimer(std::vector<T>& v)
-    {
-        std::pop_heap(std::begin(v), std::end(v), EventTimeGreater<T>);
-        v.pop_back();
-    }
-
-    template<typename T>
-    void HeapifyTimers(std::vector<T>& v)
-    {
-        std::make_heap(std::begin(v), std::end(v), &EventTimeGreater<T>);
+    entry->removed = true;
+    if (m_poller) {
+        m_poller->Remove(*entry);
+        // The entry may be in the list of ready sockets which is currently
+        // being dispatched, so we keep it alive until that is done.
+        m_removedSockets.push_back(std::move(entry));
     }
 }
 
@@ -123,77 +246,94 @@ int Reactor::AddTimer(
         throw std::invalid_argument("Invalid timer count");
     }
     const auto id = ++m_nextTimerID;
-    PushTimer(m_timers, Timer(
+    auto timer = std::make_unique<Timer>(
         id,
-        std::chrono::system_clock::now() + interval,
         interval,
         count,
-        std::make_unique<TimerHandler>(std::move(handler))));
+        std::make_unique<TimerHandler>(std::move(handler)));
+    auto& t = *m_timers.emplace(id, std::move(timer)).first->second;
+    RestartTimerInterval(t, std::chrono::steady_clock::now());
     return id;
 }
 
 
 void Reactor::RemoveTimer(int id)
 {
-    const auto it = std::find_if(m_timers.begin(), m_timers.end(),
-        [id](const Timer& t){ return t.id == id; });
+    const auto it = m_timers.find(id);
     if (it == m_timers.end()) {
         throw std::invalid_argument("Invalid timer ID");
     }
+    m_timerWheel.Cancel(*it->second);
     m_timers.erase(it);
-    HeapifyTimers(m_timers);
 }
 
 
 void Reactor::RestartTimerInterval(int id)
 {
-    const auto it = std::find_if(m_timers.begin(), m_timers.end(),
-        [id](const Timer& t){ return t.id == id; });
+    const auto it = m_timers.find(id);
     if (it == m_timers.end()) {
         throw std::invalid_argument("Invalid timer ID");
     }
-    RestartTimerIntervals(it, it+1);
+    RestartTimerInterval(*it->second, std::chrono::steady_clock::now());
+}
+
+
+namespace
+{
+    std::uint64_t Nanoseconds(std::chrono::steady_clock::duration d)
+    {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
 }
 
 
 void Reactor::Run()
 {
-    RestartTimerIntervals(begin(m_timers), end(m_timers));
+    // Comparing the rates of these two counters gives the reactor utilisation.
+    auto& pollTime = coral::metrics::GetCounter(
+        "coral_reactor_poll_seconds_total",
+        "Time spent by reactors waiting for events",
+        coral::metrics::Labels(), 1e-9);
+    auto& busyTime = coral::metrics::GetCounter(
+        "coral_reactor_busy_seconds_total",
+        "Time spent by reactors handling events",
+        coral::metrics::Labels(), 1e-9);
+    auto& iterations = coral::metrics::GetCounter(
+        "coral_reactor_iterations_total",
+        "Number of reactor event loop iterations");
+
+    const auto t0 = std::chrono::steady_clock::now();
+    for (const auto& t : m_timers) RestartTimerInterval(*t.second, t0);
+    m_poller = std::make_unique<Poller>();
+    const auto cleanup = coral::util::OnScopeExit([this] () {
+        m_poller.reset();
+        m_removedSockets.clear();
+    });
+    for (const auto& s : m_sockets) m_poller->Add(*s.second);
+    for (const auto& s : m_nativeSockets) m_poller->Add(*s.second);
+
     m_running = true;
     for (;;) {
-        if (m_needsRebuild) Rebuild();
-        if (m_pollItems.empty() && m_timers.empty()) break;
-
-        // More sockets may be added by the handler functions, so we
-        // need to store the current sizes for use in the loops below.
-        const auto socketCount = m_sockets.size();
-        const auto nativeSocketCount = m_nativeSockets.size();
-        assert(m_pollItems.size() == socketCount + nativeSocketCount);
-
-        zmq::poll(m_pollItems.data(), m_pollItems.size(),
-                  m_timers.empty() ? -1 : static_cast<long>(TimeToNextEvent().count()));
-        std::size_t j = 0;
-        for (std::size_t i = 0; i < socketCount; ++i, ++j) {
-            assert(j < m_pollItems.size());
-            if ((m_pollItems[j].revents & ZMQ_POLLIN) && m_sockets[i].first != nullptr) {
-                (*m_sockets[i].second)(*this, *m_sockets[i].first);
-                if (!m_running) goto endLoop;
-            }
-        }
-        for (std::size_t i = 0; i < nativeSocketCount; ++i, ++j) {
-            assert(j < m_pollItems.size());
-            if ((m_pollItems[j].revents & ZMQ_POLLIN) && m_nativeSockets[i].first != NULL_NATIVE_SOCKET) {
-                (*m_nativeSockets[i].second)(*this, m_nativeSockets[i].first);
-                if (!m_running) goto endLoop;
-            }
-        }
-        assert(j == m_pollItems.size());
-
-        while (!m_timers.empty()
-               && std::chrono::system_clock::now() >= m_timers.front().nextEventTime) {
-            PerformNextEvent();
+        if (m_sockets.empty() && m_nativeSockets.empty() && m_timers.empty()) break;
+
+        const auto pollStart = std::chrono::steady_clock::now();
+        m_poller->Wait(
+            m_timers.empty() ? -1 : static_cast<long>(TimeToNextEvent().count()),
+            m_readySockets);
+        const auto pollEnd = std::chrono::steady_clock::now();
+        pollTime.Increment(Nanoseconds(pollEnd - pollStart));
+        iterations.Increment();
+
+        DispatchReadySockets();
+        if (!m_running) break;
+
+        const auto now = std::chrono::steady_clock::now();
+        while (const auto timer = m_timerWheel.PopExpired(now)) {
+            PerformEvent(*static_cast<Timer*>(timer));
             if (!m_running) goto endLoop;
         }
+        busyTime.Increment(Nanoseconds(std::chrono::steady_clock::now() - pollEnd));
     }
 endLoop: ;
 }
@@ -205,92 +345,101 @@ void Reactor::Stop()
 }
 
 
-void Reactor::RestartTimerIntervals(
-    std::vector<Timer>::iterator begin,
-    std::vector<Timer>::iterator end)
+void Reactor::RestartTimerInterval(Timer& timer, TimePoint now) noexcept
 {
-    const auto t0 = std::chrono::system_clock::now();
-    for (auto it = begin; it != end; ++it) {
-        it->nextEventTime = t0 + it->interval;
-    }
-    HeapifyTimers(m_timers);
+    timer.nextEventTime = now + timer.interval;
+    m_timerWheel.Schedule(timer, timer.nextEventTime);
 }
 
 
 std::chrono::milliseconds Reactor::TimeToNextEvent() const
 {
-    return std::max(
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            m_timers.front().nextEventTime - std::chrono::system_clock::now()),
-        std::chrono::milliseconds(0));
+    // Round up, so we don't wake up just before the event is due.
+    const auto t = m_timerWheel.NextWakeUp() - std::chrono::steady_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t);
+    if (ms < t) ++ms;
+    return std::max(ms, std::chrono::milliseconds(0));
 }
 
 
-void Reactor::PerformNextEvent()
+void Reactor::PerformEvent(Timer& timer)
 {
-    assert (m_timers.front().nextEventTime <= std::chrono::system_clock::now());
-    assert (m_timers.front().remaining != 0);
+    assert (!timer.IsScheduled());
+    assert (timer.remaining != 0);
 
     // The handler may delete the timer, thus also deleting some information
     // we need.  Therefore, we copy that info first.  We also need to *move*
     // the handler function object out here, so it doesn't inadvertently delete
     // itself.
-    const auto id = m_timers.front().id;
-    auto handler = std::move(m_timers.front().handler);
+    const auto id = timer.id;
+    auto handler = std::move(timer.handler);
 
     // We use a scope guard, since the handler may throw.
     auto updateTimer = coral::util::OnScopeExit([&] () {
-        // The timer may already have been removed by the handler, in which case
-        // we do nothing.
-        if (m_timers.front().id == id) {
-            auto t = std::move(m_timers.front());
-            t.handler = std::move(handler);
-            PopTimer(m_timers);
-            if (t.remaining > 0) --t.remaining;
-            if (t.remaining != 0) {
-                t.nextEventTime += t.interval;
-                PushTimer(m_timers, std::move(t));
-            }
+        // The timer may have been removed by the handler, in which case we
+        // do nothing.
+        const auto it = m_timers.find(id);
+        if (it == m_timers.end()) return;
+        auto& t = *it->second;
+        t.handler = std::move(handler);
+        if (t.remaining > 0) --t.remaining;
+        if (t.remaining == 0) {
+            m_timerWheel.Cancel(t);
+            m_timers.erase(it);
+        } else if (!t.IsScheduled()) {
+            // Unless the handler restarted the interval, the next event is
+            // scheduled relative to this one, so the timer doesn't drift.
+            t.nextEventTime += t.interval;
+            m_timerWheel.Schedule(t, t.nextEventTime);
         }
     });
     (*handler)(*this, id);
 }
 
 
-void Reactor::Rebuild()
+void Reactor::DispatchReadySockets()
 {
-    // Remove null sockets from m_sockets
-    auto newEnd = std::remove_if(m_sockets.begin(), m_sockets.end(),
-        [](const SocketHandlerPair& a) { return a.first == nullptr; });
-    m_sockets.erase(newEnd, m_sockets.end());
-
-    // Remove null sockets from m_nativeSockets
-    auto newEnd2 = std::remove_if(m_nativeSockets.begin(), m_nativeSockets.end(),
-        [](const NativeSocketHandlerPair& a) { return a.first == NULL_NATIVE_SOCKET; });
-    m_nativeSockets.erase(newEnd2, m_nativeSockets.end());
-
-    // Rebuild m_pollItems
-    m_pollItems.clear();
-    for (const auto& s : m_sockets) {
-        zmq::pollitem_t pi = { static_cast<void*>(*s.first), 0, ZMQ_POLLIN, 0 };
-        m_pollItems.push_back(pi);
+    // Collect the handlers for all ready sockets, and sort them so they are
+    // called in the order they were added.
+    m_readyHandlers.clear();
+    for (const auto entry : m_readySockets) {
+        for (std::size_t i = 0; i < entry->handlers.size(); ++i) {
+            m_readyHandlers.push_back(
+                ReadyHandler{entry->handlers[i].first, entry, i});
+        }
+        for (std::size_t i = 0; i < entry->nativeHandlers.size(); ++i) {
+            m_readyHandlers.push_back(
+                ReadyHandler{entry->nativeHandlers[i].first, entry, i});
+        }
+    }
+    if (m_readySockets.size() > 1) {
+        std::sort(m_readyHandlers.begin(), m_readyHandlers.end(),
+            [](const ReadyHandler& a, const ReadyHandler& b) {
+                return a.sequence < b.sequence;
+            });
     }
-    for (const auto& s : m_nativeSockets) {
-        zmq::pollitem_t pi = { nullptr, s.first, ZMQ_POLLIN, 0 };
-        m_pollItems.push_back(pi);
+
+    // The handlers may add and remove sockets.  Handler lists only ever grow
+    // and removed entries are kept alive, so the indices remain valid.
+    for (const auto& h : m_readyHandlers) {
+        if (h.entry->removed) continue;
+        if (h.entry->socket) {
+            (*h.entry->handlers[h.index].second)(*this, *h.entry->socket);
+        } else {
+            (*h.entry->nativeHandlers[h.index].second)(*this, h.entry->nativeSocket);
+        }
+        if (!m_running) break;
     }
-    m_needsRebuild = false;
+    m_removedSockets.clear();
 }
 
 
 Reactor::Timer::Timer(
     int id_,
-    TimePoint nextEventTime_,
     std::chrono::milliseconds interval_,
     int remaining_,
     std::unique_ptr<TimerHandler> handler_)
     : id(id_),
-      nextEventTime(nextEventTime_),
       interval(interval_),
       remaining(remaining_),
       handler(std::move(handler_))
@@ -1,4 +1,5 @@
 #include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 #include <coral/net/reactor.hpp>
 
@@ -181,3 +182,45 @@ TEST(coral_net, Reactor_autostop)
     reactor.Run();
     EXPECT_EQ(2, count);
 }
+
+
+TEST(coral_net, Reactor_dispatchOrder)
+{
+    zmq::context_t ctx;
+    zmq::socket_t svr1(ctx, ZMQ_PULL);
+    svr1.bind("inproc://coral_net_Reactor_dispatchOrder_1");
+    zmq::socket_t svr2(ctx, ZMQ_PULL);
+    svr2.bind("inproc://coral_net_Reactor_dispatchOrder_2");
+    zmq::socket_t cli1(ctx, ZMQ_PUSH);
+    cli1.connect("inproc://coral_net_Reactor_dispatchOrder_1");
+    zmq::socket_t cli2(ctx, ZMQ_PUSH);
+    cli2.connect("inproc://coral_net_Reactor_dispatchOrder_2");
+    cli1.send("a", 1);
+    cli2.send("b", 1);
+
+    // Handlers for different sockets are interleaved, and must be called in
+    // the order they were added, except that removing a socket cancels its
+    // remaining handlers.
+    Reactor reactor;
+    std::vector<int> calls;
+    reactor.AddSocket(svr2, [&](Reactor&, zmq::socket_t&) {
+        calls.push_back(1);
+    });
+    reactor.AddSocket(svr1, [&](Reactor&, zmq::socket_t&) {
+        calls.push_back(2);
+    });
+    reactor.AddSocket(svr2, [&](Reactor& r, zmq::socket_t& s) {
+        calls.push_back(3);
+        zmq::message_t msg;
+        s.recv(&msg);
+        r.RemoveSocket(svr1);
+    });
+    reactor.AddSocket(svr1, [&](Reactor&, zmq::socket_t&) {
+        calls.push_back(4);
+    });
+    reactor.AddTimer(std::chrono::milliseconds(50), 1, [](Reactor& r, int) {
+        r.Stop();
+    });
+    reactor.Run();
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), calls);
+}
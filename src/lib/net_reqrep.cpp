@@ -41,7 +41,7 @@ Client::Client(
     : m_reactor{reactor}
     , m_protocolIdentifier(protocolIdentifier)
     , m_serverEndpoint{serverEndpoint}
-    , m_timeoutTimerID{NO_TIMER}
+    , m_nextRequestID{0}
 {
     CORAL_INPUT_CHECK(!protocolIdentifier.empty());
     if (protocolIdentifier == META_PROTOCOL_IDENTIFIER) {
@@ -60,7 +60,11 @@ Client::Client(
 Client::~Client() noexcept
 {
     m_reactor.RemoveSocket(m_socket.Socket());
-    if (m_timeoutTimerID != NO_TIMER) CancelTimer();
+    for (const auto& r : m_pendingRequests) {
+        if (r.second.timeoutTimerID != NO_TIMER) {
+            m_reactor.RemoveTimer(r.second.timeoutTimerID);
+        }
+    }
 }
 
 
@@ -71,24 +75,19 @@ void Client::Request(
     std::chrono::milliseconds timeout,
     ReplyHandler onComplete)
 {
-    if (m_onComplete || m_onMaxProtocolComplete) {
-        throw coral::error::PreconditionViolation(
-            "Request already in progress");
-    }
     if (protocolVersion == INVALID_PROTOCOL_VERSION) {
         throw std::invalid_argument(
             "Protocol version number is reserved for internal use");
     }
-    SendRequest(
+    const auto requestID = SendRequest(
         m_protocolIdentifier, protocolVersion,
         requestHeader, requestHeaderSize,
         requestBody, requestBodySize,
         timeout);
-    if (timeout >= std::chrono::milliseconds(0)) {
-        SetTimer(timeout);
-    }
-    m_requestProtocolVersion = protocolVersion;
-    m_onComplete = std::move(onComplete);
+    AddPendingRequest(
+        requestID,
+        PendingRequest{protocolVersion, std::move(onComplete), nullptr, NO_TIMER},
+        timeout);
 }
 
 
@@ -96,25 +95,20 @@ void Client::RequestMaxProtocol(
     std::chrono::milliseconds timeout,
     MaxProtocolReplyHandler onComplete)
 {
-    if (m_onComplete || m_onMaxProtocolComplete) {
-        throw coral::error::PreconditionViolation(
-            "Request already in progress");
-    }
     const std::uint16_t protocolVersion = 0u;
-    SendRequest(
+    const auto requestID = SendRequest(
         META_PROTOCOL_IDENTIFIER, protocolVersion,
         META_REQ_MAX_PROTOCOL_VERSION.data(), META_REQ_MAX_PROTOCOL_VERSION.size(),
         m_protocolIdentifier.data(), m_protocolIdentifier.size(),
         timeout);
-    if (timeout >= std::chrono::milliseconds(0)) {
-        SetTimer(timeout);
-    }
-    m_requestProtocolVersion = protocolVersion;
-    m_onMaxProtocolComplete = std::move(onComplete);
+    AddPendingRequest(
+        requestID,
+        PendingRequest{protocolVersion, nullptr, std::move(onComplete), NO_TIMER},
+        timeout);
 }
 
 
-void Client::SendRequest(
+std::uint32_t Client::SendRequest(
     const std::string& protocolIdentifier, std::uint16_t protocolVersion,
     const char* requestHeader, size_t requestHeaderSize,
     const char* requestBody, size_t requestBodySize,
@@ -124,7 +118,13 @@ void Client::SendRequest(
     assert(protocolVersion != INVALID_PROTOCOL_VERSION);
     assert(requestHeader != nullptr);
 
+    // The request ID is placed before the envelope delimiter.  The server
+    // treats it as part of the client's address and returns it unchanged.
+    const auto requestID = m_nextRequestID++;
     std::vector<zmq::message_t> msg;
+    msg.emplace_back(4);
+    coral::util::EncodeUint32(requestID, static_cast<char*>(msg.back().data()));
+    msg.emplace_back();
     msg.emplace_back(protocolIdentifier.size() + 2);
     std::memcpy(
         msg.back().data(),
@@ -139,7 +139,30 @@ void Client::SendRequest(
     if (!coral::net::zmqx::WaitForOutgoing(m_socket.Socket(), timeout)) {
         throw std::runtime_error("Send timed out");
     }
-    m_socket.Send(msg);
+    coral::net::zmqx::Send(m_socket.Socket(), msg);
+    return requestID;
+}
+
+
+void Client::AddPendingRequest(
+    std::uint32_t requestID,
+    PendingRequest request,
+    std::chrono::milliseconds timeout)
+{
+    assert(m_pendingRequests.count(requestID) == 0);
+    // Without a handler, there is nothing to do with the reply, so we
+    // don't wait for one.
+    if (!request.onComplete && !request.onMaxProtocolComplete) return;
+    if (timeout >= std::chrono::milliseconds(0)) {
+        request.timeoutTimerID = m_reactor.AddTimer(timeout, 1,
+            [this, requestID] (coral::net::Reactor&, int) {
+                const auto it = m_pendingRequests.find(requestID);
+                assert(it != m_pendingRequests.end());
+                it->second.timeoutTimerID = NO_TIMER;
+                CompleteWithError(requestID, make_error_code(std::errc::timed_out));
+            });
+    }
+    m_pendingRequests.insert(std::make_pair(requestID, std::move(request)));
 }
 
 
@@ -176,78 +199,81 @@ namespace
 
 void Client::ReceiveReply()
 {
-    // Receive message, but if we didn't expect one (no handlers = no request
-    // in progress), just ignore it and return.
+    // Receive message, but if it isn't a reply to a request that is still
+    // in progress (e.g. because the request has timed out), just ignore it
+    // and return.
     std::vector<zmq::message_t> msg;
-    m_socket.Receive(msg);
-    if (!m_onComplete && !m_onMaxProtocolComplete) return;
-
-    if (m_timeoutTimerID != NO_TIMER) CancelTimer();
-
-    if (msg.size() < 2 || msg[0].size() < 3) {
-        CompleteWithError(make_error_code(std::errc::bad_message));
+    coral::net::zmqx::Receive(m_socket.Socket(), msg);
+    if (msg.size() < 2 || msg[0].size() != 4 || msg[1].size() != 0) return;
+    const auto requestID =
+        coral::util::DecodeUint32(static_cast<const char*>(msg[0].data()));
+    const auto it = m_pendingRequests.find(requestID);
+    if (it == m_pendingRequests.end()) return;
+
+    if (msg.size() < 4 || msg[2].size() < 3) {
+        CompleteWithError(requestID, make_error_code(std::errc::bad_message));
         return;
     }
     const auto protocolIdentifier = std::string{
-        static_cast<const char*>(msg[0].data()),
-        msg[0].size() - 2};
+        static_cast<const char*>(msg[2].data()),
+        msg[2].size() - 2};
     const auto protocolVersion = coral::util::DecodeUint16(
-        static_cast<const char*>(msg[0].data()) + protocolIdentifier.size());
-
-    if (protocolVersion != m_requestProtocolVersion) {
-        CompleteWithError(make_error_code(std::errc::bad_message));
-    } else if (m_onComplete && protocolIdentifier == m_protocolIdentifier) {
-        coral::util::LastCall(m_onComplete,
+        static_cast<const char*>(msg[2].data()) + protocolIdentifier.size());
+
+    auto& request = it->second;
+    if (protocolVersion != request.protocolVersion) {
+        CompleteWithError(requestID, make_error_code(std::errc::bad_message));
+    } else if (request.onComplete && protocolIdentifier == m_protocolIdentifier) {
+        // The handler may send new requests or destroy the client, so it
+        // must be removed from the list before it is called.
+        if (request.timeoutTimerID != NO_TIMER) {
+            m_reactor.RemoveTimer(request.timeoutTimerID);
+        }
+        auto onComplete = std::move(request.onComplete);
+        m_pendingRequests.erase(it);
+        onComplete(
             std::error_code(),
-            static_cast<const char*>(msg[1].data()),
-            msg[1].size(),
-            msg.size() > 2 ? static_cast<const char*>(msg[2].data()) : nullptr,
-            msg.size() > 2 ? msg[2].size() : 0u);
-    } else if (m_onMaxProtocolComplete
+            static_cast<const char*>(msg[3].data()),
+            msg[3].size(),
+            msg.size() > 4 ? static_cast<const char*>(msg[4].data()) : nullptr,
+            msg.size() > 4 ? msg[4].size() : 0u);
+    } else if (request.onMaxProtocolComplete
                 && protocolIdentifier == META_PROTOCOL_IDENTIFIER) {
+        if (request.timeoutTimerID != NO_TIMER) {
+            m_reactor.RemoveTimer(request.timeoutTimerID);
+        }
+        auto onComplete = std::move(request.onMaxProtocolComplete);
+        m_pendingRequests.erase(it);
         HandleMetaMaxProtocolReply(
-            msg[1],
-            msg.size() > 2 ? &msg[2] : nullptr,
-            m_onMaxProtocolComplete);
+            msg[3],
+            msg.size() > 4 ? &msg[4] : nullptr,
+            onComplete);
     } else {
-        CompleteWithError(make_error_code(std::errc::bad_message));
+        CompleteWithError(requestID, make_error_code(std::errc::bad_message));
     }
 }
 
 
-void Client::CompleteWithError(const std::error_code& ec)
+void Client::CompleteWithError(std::uint32_t requestID, const std::error_code& ec)
 {
     assert(ec);
-    if (m_onComplete) {
-        coral::util::LastCall(m_onComplete, ec, nullptr, 0u, nullptr, 0u);
-    } else if (m_onMaxProtocolComplete) {
-        coral::util::LastCall(m_onMaxProtocolComplete, ec, INVALID_PROTOCOL_VERSION);
+    const auto it = m_pendingRequests.find(requestID);
+    assert(it != m_pendingRequests.end());
+    auto request = std::move(it->second);
+    m_pendingRequests.erase(it);
+    if (request.timeoutTimerID != NO_TIMER) {
+        m_reactor.RemoveTimer(request.timeoutTimerID);
+    }
+    if (request.onComplete) {
+        coral::util::LastCall(request.onComplete, ec, nullptr, 0u, nullptr, 0u);
+    } else if (request.onMaxProtocolComplete) {
+        coral::util::LastCall(request.onMaxProtocolComplete, ec, INVALID_PROTOCOL_VERSION);
     } else {
         assert(false);
     }
 }
 
 
-void Client::SetTimer(std::chrono::milliseconds timeout)
-{
-    assert(m_timeoutTimerID == NO_TIMER);
-    assert(timeout >= std::chrono::milliseconds(0));
-    m_timeoutTimerID = m_reactor.AddTimer(timeout, 1,
-        [this] (coral::net::Reactor&, int) {
-            m_timeoutTimerID = NO_TIMER;
-            CompleteWithError(make_error_code(std::errc::timed_out));
-        });
-}
-
-
-void Client::CancelTimer()
-{
-    assert(m_timeoutTimerID != NO_TIMER);
-    m_reactor.RemoveTimer(m_timeoutTimerID);
-    m_timeoutTimerID = NO_TIMER;
-}
-
-
 // =============================================================================
 // Server
 // =============================================================================
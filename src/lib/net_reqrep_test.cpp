@@ -1,5 +1,7 @@
 #include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 #include <coral/net/reqrep.hpp>
 #include <coral/util.hpp>
@@ -289,3 +291,61 @@ TEST(coral_net_reqrep, ReqRepMoreErrors)
     runTest1();
     reactor.Run();
 }
+
+
+TEST(coral_net_reqrep, Pipelining)
+{
+    const char* const endpoint = "inproc://coral_net_reqrep_pipelining_test";
+    auto serverThread = std::thread{&RunTestServer, endpoint};
+    auto joinServerThread = coral::util::OnScopeExit([&] () {
+        serverThread.join();
+    });
+
+    coral::net::Reactor reactor;
+    dnr::Client client{
+        reactor,
+        MY_PROTOCOL_ID,
+        coral::net::Endpoint{endpoint}};
+
+    // Send several requests without waiting for replies, including one which
+    // the server ignores, and check that each handler gets its own reply.
+    const auto timeout = std::chrono::milliseconds(1000);
+    std::vector<std::string> replies(4);
+    int replyCount = 0;
+    const auto makeHandler = [&] (std::size_t index) {
+        return [&, index] (
+            const std::error_code& ec,
+            const char* replyHeader, size_t replyHeaderSize,
+            const char* replyBody, size_t replyBodySize)
+        {
+            if (ec) {
+                replies[index] = ec == std::errc::timed_out ? "timeout" : "error";
+            } else {
+                replies[index] = std::string(replyHeader, replyHeaderSize);
+                if (replyBody) replies[index] += std::string(replyBody, replyBodySize);
+            }
+            ++replyCount;
+        };
+    };
+    client.Request(MY_PROTOCOL_VER, "HELLO", 5u, "1", 1u, timeout, makeHandler(0));
+    client.Request(2u, "PING", 4u, nullptr, 0u, std::chrono::milliseconds(100), makeHandler(1));
+    client.Request(MY_PROTOCOL_VER, "PING", 4u, nullptr, 0u, timeout, makeHandler(2));
+    client.Request(MY_PROTOCOL_VER, "HELLO", 5u, "3", 1u, timeout, makeHandler(3));
+
+    reactor.AddTimer(std::chrono::milliseconds(10), -1, [&] (coral::net::Reactor&, int id) {
+        if (replyCount < 4) return;
+        reactor.RemoveTimer(id);
+        client.Request(
+            MY_PROTOCOL_VER, "KTHXBAI", 7u, nullptr, 0u, timeout,
+            [&] (const std::error_code& ec, const char*, size_t, const char*, size_t) {
+                EXPECT_FALSE(ec);
+                reactor.Stop();
+            });
+    });
+    reactor.Run();
+
+    EXPECT_EQ("OHAI1", replies[0]);
+    EXPECT_EQ("timeout", replies[1]);
+    EXPECT_EQ("PONG", replies[2]);
+    EXPECT_EQ("OHAI3", replies[3]);
+}
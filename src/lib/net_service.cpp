@@ -9,7 +9,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #endif
 #include <coral/net/service.hpp>
 
-#include <algorithm> // std::copy
+#include <algorithm> // std::copy, std::max
 #include <cassert>
 #include <cstring>
 #include <exception>
@@ -41,27 +41,114 @@ namespace service
 
 namespace
 {
+    // The format of a beacon message is as follows:
+    //
+    //      magic string:       4 bytes
+    //      protocol version:   8-bit unsigned integer
+    //      partition ID:       32-bit unsigned integer, network byte order
+    //      service type size:  8-bit unsigned integer
+    //      service name size:  8-bit unsigned integer
+    //      payload size:       16-bit unsigned integer, network byte order
+    //      service type:       variable-length ASCII string
+    //      service name:       variable-length ASCII string
+    //      payload:            variable-length byte array
+    //
+    const char* const protocolMagic = "\0DSD"; // Dynamic Service Discovery
+    const std::size_t protocolMagicSize = 4;
+    const std::size_t minMessageSize =
+        protocolMagicSize
+        + 1  // version
+        + 4  // partition ID
+        + 1  // serviceType size
+        + 1  // serviceIdentifier size
+        + 2; // payload size
+
+    // A listener may ask services to announce themselves immediately, rather
+    // than waiting for the next beacon, by broadcasting a probe message:
+    //
+    //      magic string:       4 bytes
+    //      protocol version:   8-bit unsigned integer
+    //      partition ID:       32-bit unsigned integer, network byte order
+    //      service type size:  8-bit unsigned integer
+    //      service type:       variable-length ASCII string
+    //
+    // An empty service type matches all services.
+    const char* const probeMagic = "\0DSP";
+    const std::size_t minProbeSize =
+        protocolMagicSize
+        + 1  // version
+        + 4  // partition ID
+        + 1; // serviceType size
+
+    // Returns whether the `size`-byte message in `buffer` is a probe which
+    // matches the given partition and service type.
+    bool IsMatchingProbe(
+        const char* buffer,
+        std::size_t size,
+        std::uint32_t partitionID,
+        const std::string& serviceType)
+    {
+        if (size < minProbeSize
+                || 0 != std::memcmp(buffer, probeMagic, protocolMagicSize)
+                || buffer[protocolMagicSize] != 0
+                || coral::util::DecodeUint32(buffer + protocolMagicSize + 1) != partitionID) {
+            return false;
+        }
+        const auto probeTypeSize =
+            static_cast<unsigned char>(buffer[protocolMagicSize + 5]);
+        return size == minProbeSize + probeTypeSize
+            && (probeTypeSize == 0
+                || serviceType.compare(0, std::string::npos,
+                    buffer + minProbeSize, probeTypeSize) == 0);
+    }
+
+
     void BeaconThread(
         std::chrono::milliseconds period,
         const std::vector<char>& message,
+        std::uint32_t partitionID,
+        const std::string& serviceType,
         coral::net::udp::BroadcastSocket udpSocket,
+        bool receiveProbes,
         zmq::socket_t inprocSocket)
     {
         // Messaging loop
-        auto pollItem =
-            zmq::pollitem_t{static_cast<void*>(inprocSocket), 0, ZMQ_POLLIN, 0};
+        zmq::pollitem_t pollItems[2] = {
+            { static_cast<void*>(inprocSocket), 0, ZMQ_POLLIN, 0 },
+            { nullptr, udpSocket.NativeHandle(), ZMQ_POLLIN, 0 }
+        };
         auto nextBeacon = std::chrono::steady_clock::now();
         for (;;) {
             const auto timeout =
                 std::chrono::duration_cast<std::chrono::milliseconds>(
                     nextBeacon - std::chrono::steady_clock::now());
-            zmq::poll(&pollItem, 1, boost::numeric_cast<long>(timeout.count()));
-            if (pollItem.revents & ZMQ_POLLIN) {
+            zmq::poll(
+                pollItems,
+                receiveProbes ? 2 : 1,
+                boost::numeric_cast<long>(
+                    std::max(timeout, std::chrono::milliseconds(0)).count()));
+            if (pollItems[0].revents & ZMQ_POLLIN) {
                 zmq::message_t msg;
                 inprocSocket.recv(&msg);
                 assert(!msg.more());
                 if (coral::net::zmqx::ToString(msg) == "STOP") break;
             }
+            if (receiveProbes && (pollItems[1].revents & ZMQ_POLLIN)) {
+                // We also receive other services' beacons (and our own) here,
+                // but only probes are of interest.
+                char buffer[65535];
+                try {
+                    const auto size = udpSocket.Receive(buffer, sizeof(buffer), nullptr);
+                    if (IsMatchingProbe(buffer, size, partitionID, serviceType)) {
+                        CORAL_LOG_CAT_TRACE(coral::log::net,
+                            "Beacon: Probe received, announcing service");
+                        nextBeacon = std::chrono::steady_clock::now();
+                    }
+                } catch (const std::exception& e) {
+                    CORAL_LOG_CAT_DEBUG(coral::log::net,
+                        boost::format("Beacon: Failed to receive probe: %s") % e.what());
+                }
+            }
             if (std::chrono::steady_clock::now() >= nextBeacon) {
                 try {
                     udpSocket.Send(message.data(), message.size());
@@ -75,28 +162,6 @@ namespace
             }
         }
     }
-
-    // The format of a beacon message is as follows:
-    //
-    //      magic string:       4 bytes
-    //      protocol version:   8-bit unsigned integer
-    //      partition ID:       32-bit unsigned integer, network byte order
-    //      service type size:  8-bit unsigned integer
-    //      service name size:  8-bit unsigned integer
-    //      payload size:       16-bit unsigned integer, network byte order
-    //      service type:       variable-length ASCII string
-    //      service name:       variable-length ASCII string
-    //      payload:            variable-length byte array
-    //
-    const char* const protocolMagic = "\0DSD"; // Dynamic Service Discovery
-    const std::size_t protocolMagicSize = 4;
-    const std::size_t minMessageSize =
-        protocolMagicSize
-        + 1  // version
-        + 4  // partition ID
-        + 1  // serviceType size
-        + 1  // serviceIdentifier size
-        + 2; // payload size
 }
 
 Beacon::Beacon(
@@ -122,11 +187,22 @@ Beacon::Beacon(
     auto otherSocket = zmq::socket_t(coral::net::zmqx::GlobalContext(), ZMQ_PAIR);
     otherSocket.connect(endpoint);
 
-    // Set up the UDP socket
-    auto udpSocket = coral::net::udp::BroadcastSocket(
-        networkInterface,
-        port,
-        coral::net::udp::BroadcastSocket::onlySend);
+    // Set up the UDP socket.  We bind it to the discovery port so we can
+    // answer probes, but can still announce the service if that fails.
+    bool receiveProbes = true;
+    auto udpSocket = [&] {
+        try {
+            return coral::net::udp::BroadcastSocket(networkInterface, port);
+        } catch (const std::runtime_error& e) {
+            CORAL_LOG_CAT_DEBUG(coral::log::net,
+                boost::format("Beacon: Probes will be ignored (%s)") % e.what());
+            receiveProbes = false;
+            return coral::net::udp::BroadcastSocket(
+                networkInterface,
+                port,
+                coral::net::udp::BroadcastSocket::onlySend);
+        }
+    }();
 
     // Create the message to broadcast
     const auto messageSize =
@@ -137,7 +213,7 @@ Beacon::Beacon(
     if (messageSize > 1500) {
         // Source of the "1500 bytes" recommendation:
         // http://zguide.zeromq.org/page:all#Cooperative-Discovery-Using-UDP-Broadcasts
-        CORAL_LOG_DEBUG("Beacon packet size exceeds 1500 bytes");
+        CORAL_LOG_CAT_DEBUG(coral::log::net, "Beacon packet size exceeds 1500 bytes");
     }
     auto message = std::vector<char>(messageSize);
     std::memcpy(&message[0], protocolMagic, protocolMagicSize);
@@ -160,7 +236,10 @@ Beacon::Beacon(
     m_thread = std::thread(&BeaconThread,
         period,
         std::move(message),
+        partitionID,
+        serviceType,
         std::move(udpSocket),
+        receiveProbes,
         std::move(otherSocket));
 }
 
@@ -197,6 +276,8 @@ public:
     Impl(Impl&&) = delete;
     Impl& operator=(Impl&&) = delete;
 
+    void Probe(const std::string& serviceType);
+
 private:
     void IncomingBeacon();
 
@@ -232,6 +313,19 @@ Listener::Impl::~Impl() noexcept
 }
 
 
+void Listener::Impl::Probe(const std::string& serviceType)
+{
+    CORAL_INPUT_CHECK(serviceType.size() < 256u);
+    auto message = std::vector<char>(minProbeSize + serviceType.size());
+    std::memcpy(&message[0], probeMagic, protocolMagicSize);
+    message[protocolMagicSize] = 0;
+    coral::util::EncodeUint32(m_partitionID, &message[protocolMagicSize+1]);
+    message[protocolMagicSize + 5] = static_cast<char>(serviceType.size());
+    std::copy(serviceType.begin(), serviceType.end(), message.begin() + minProbeSize);
+    m_udpSocket.Send(message.data(), message.size());
+}
+
+
 void Listener::Impl::IncomingBeacon()
 {
     char buffer[65535];
@@ -241,22 +335,26 @@ void Listener::Impl::IncomingBeacon()
         sizeof(buffer),
         &peerAddress);
     if (msgSize < minMessageSize) {
-        CORAL_LOG_TRACE("Listener: Ignoring invalid message (too small)");
+        CORAL_LOG_CAT_TRACE(coral::log::net, "Listener: Ignoring invalid message (too small)");
+        return;
+    }
+    if (0 == std::memcmp(buffer, probeMagic, protocolMagicSize)) {
+        // Probes (including our own) are meant for beacons.
         return;
     }
     if (0 != std::memcmp(buffer, protocolMagic, protocolMagicSize)) {
-        CORAL_LOG_TRACE("Listener: Ignoring invalid message (bad format)");
+        CORAL_LOG_CAT_TRACE(coral::log::net, "Listener: Ignoring invalid message (bad format)");
         return;
     }
     if (buffer[protocolMagicSize] != 0) {
-        CORAL_LOG_TRACE(
+        CORAL_LOG_CAT_TRACE(coral::log::net,
             boost::format("Listener: Ignoring message of version %d")
             % static_cast<int>(buffer[protocolMagicSize]));
         return;
     }
     const auto partitionID = coral::util::DecodeUint32(buffer+protocolMagicSize+1);
     if (partitionID != m_partitionID) {
-        CORAL_LOG_TRACE(
+        CORAL_LOG_CAT_TRACE(coral::log::net,
             boost::format("Listener: Ignoring message from partition %d")
             % partitionID);
         return;
@@ -269,7 +367,7 @@ void Listener::Impl::IncomingBeacon()
         coral::util::DecodeUint16(buffer+protocolMagicSize+7);
     if (static_cast<std::size_t>(msgSize) !=
             minMessageSize + serviceTypeSize + serviceIdentifierSize + payloadSize) {
-        CORAL_LOG_TRACE("Listener: Ignoring invalid message (wrong size)");
+        CORAL_LOG_CAT_TRACE(coral::log::net, "Listener: Ignoring invalid message (wrong size)");
         return;
     }
     m_onNotification(
@@ -314,6 +412,12 @@ Listener& Listener::operator=(Listener&& other) noexcept
 }
 
 
+void Listener::Probe(const std::string& serviceType)
+{
+    m_impl->Probe(serviceType);
+}
+
+
 // =============================================================================
 // Tracker
 // =============================================================================
@@ -375,6 +479,11 @@ public:
         }
     }
 
+    void Probe(const std::string& serviceType)
+    {
+        m_listener.Probe(serviceType);
+    }
+
 private:
     void OnNotification(
         const ip::Address& address,
@@ -524,4 +633,10 @@ void Tracker::AddTrackedServiceType(
 }
 
 
+void Tracker::Probe(const std::string& serviceType)
+{
+    m_impl->Probe(serviceType);
+}
+
+
 }}} // namespace
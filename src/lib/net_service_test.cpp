@@ -3,8 +3,12 @@
 #endif
 #include <algorithm> // std::max
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 #include <coral/net/service.hpp>
+#include <coral/net/udp.hpp>
 
 
 TEST(coral_net_service, Listener)
@@ -289,3 +293,46 @@ TEST(coral_net_service, Tracker)
     EXPECT_TRUE(service21LostOnTime);
     EXPECT_FALSE(bug);
 }
+
+
+TEST(coral_net_service, Probe)
+{
+    // Let the OS choose a free port, and keep it reserved for the duration
+    // of the test.
+    const auto portReservation =
+        coral::net::udp::BroadcastSocket(coral::net::ip::Address{"*"}, std::uint16_t(0));
+    const auto port = portReservation.Port().ToNumber();
+    const auto beaconPeriod = std::chrono::seconds(60);
+    auto beacon1 = coral::net::service::Beacon(
+        0, "serviceType1", "service1", nullptr, 0, beaconPeriod, "*", port);
+    auto beacon2 = coral::net::service::Beacon(
+        0, "serviceType2", "service2", nullptr, 0, beaconPeriod, "*", port);
+
+    // Both beacons have sent their first announcement by now, so the next
+    // one will only come in response to a probe.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<std::string> discovered;
+    coral::net::Reactor reactor;
+    auto listener = coral::net::service::Listener{
+        reactor,
+        0,
+        coral::net::ip::Endpoint{"*", port},
+        [&] (const coral::net::ip::Address&, const std::string&, const std::string& si, const char*, std::size_t)
+        {
+            discovered.push_back(si);
+        }};
+    listener.Probe("serviceType1");
+    reactor.AddTimer(
+        std::chrono::milliseconds(500),
+        1,
+        [] (coral::net::Reactor& r, int) { r.Stop(); });
+    reactor.Run();
+
+    // Since beacon1 broadcasts on all interfaces, we may receive more than
+    // one announcement.
+    ASSERT_FALSE(discovered.empty());
+    for (const auto& si : discovered) EXPECT_EQ("service1", si);
+    beacon1.Stop();
+    beacon2.Stop();
+}
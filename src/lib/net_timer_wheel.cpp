@@ -0,0 +1,204 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/net/timer_wheel.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+
+namespace coral
+{
+namespace net
+{
+
+namespace
+{
+    const std::uint64_t slotMask = 0xFF;
+    const int overflowShift = 32;
+
+    std::chrono::milliseconds Milliseconds(std::uint64_t ticks)
+    {
+        return std::chrono::milliseconds(
+            static_cast<std::chrono::milliseconds::rep>(ticks));
+    }
+}
+
+
+TimerWheel::Node::Node() noexcept
+    : m_prev(nullptr),
+      m_next(nullptr),
+      m_expiry(0),
+      m_list(-1)
+{
+}
+
+
+TimerWheel::TimerWheel(Clock::time_point start)
+    : m_start(start),
+      m_current(0),
+      m_size(0)
+{
+    static_assert(levelBits * levelCount == overflowShift, "Inconsistent wheel size");
+    m_lists.fill(nullptr);
+}
+
+
+void TimerWheel::Schedule(Node& node, Clock::time_point expiry) noexcept
+{
+    if (node.IsScheduled()) {
+        Unlink(node);
+    } else {
+        ++m_size;
+    }
+    node.m_expiry = ToTicks(expiry, true);
+    Link(node);
+}
+
+
+void TimerWheel::Cancel(Node& node) noexcept
+{
+    if (!node.IsScheduled()) return;
+    Unlink(node);
+    --m_size;
+}
+
+
+TimerWheel::Node* TimerWheel::PopExpired(Clock::time_point now) noexcept
+{
+    const auto nowTicks = ToTicks(now, false);
+    for (;;) {
+        if (const auto node = m_lists[dueList]) {
+            Unlink(*node);
+            --m_size;
+            return node;
+        }
+        if (m_current >= nowTicks) return nullptr;
+        if (m_size == 0) {
+            // Nothing to cascade, so we may as well skip ahead.
+            m_current = nowTicks;
+            return nullptr;
+        }
+
+        // Skip straight to the next tick where something happens, since all
+        // slots in between are empty.  If this moves us into a new slot on one
+        // or more of the higher levels, those slots are cascaded, starting with
+        // the highest, so their nodes trickle down to the level(s) below.
+        m_current = std::min(nowTicks, NextWakeUpTicks());
+        int top = 0;
+        while (top < levelCount
+                && (m_current & ((std::uint64_t(1) << (levelBits * (top + 1))) - 1)) == 0) {
+            ++top;
+        }
+        if (top == levelCount) {
+            Relink(overflowList);
+            top = levelCount - 1;
+        }
+        for (int level = top; level > 0; --level) {
+            Relink(level * slotsPerLevel
+                + static_cast<int>((m_current >> (levelBits * level)) & slotMask));
+        }
+        // All nodes in the current level-0 slot expire now, so this moves
+        // them to the due list.
+        Relink(static_cast<int>(m_current & slotMask));
+    }
+}
+
+
+TimerWheel::Clock::time_point TimerWheel::NextWakeUp() const noexcept
+{
+    if (m_size == 0) return Clock::time_point::max();
+    return m_start + Milliseconds(NextWakeUpTicks());
+}
+
+
+std::uint64_t TimerWheel::NextWakeUpTicks() const noexcept
+{
+    assert(m_size > 0);
+    if (m_lists[dueList]) return m_current;
+    for (int level = 0; level < levelCount; ++level) {
+        const auto shift = levelBits * level;
+        const auto digit = static_cast<int>((m_current >> shift) & slotMask);
+        const auto base = (m_current >> (shift + levelBits)) << (shift + levelBits);
+        for (int slot = digit + 1; slot < slotsPerLevel; ++slot) {
+            if (m_lists[level * slotsPerLevel + slot]) {
+                return base + (static_cast<std::uint64_t>(slot) << shift);
+            }
+        }
+    }
+    assert(m_lists[overflowList]);
+    return ((m_current >> overflowShift) + 1) << overflowShift;
+}
+
+
+std::uint64_t TimerWheel::ToTicks(Clock::time_point t, bool roundUp)
+    const noexcept
+{
+    if (t <= m_start) return 0;
+    const auto d = t - m_start;
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(d);
+    if (roundUp && ms < d) ++ms;
+    return static_cast<std::uint64_t>(ms.count());
+}
+
+
+// Inserts `node` into the list which corresponds to its expiry time, relative
+// to the current time.  A node is put on the lowest level whose slots cover
+// the same range as the current time on all levels above it.
+void TimerWheel::Link(Node& node) noexcept
+{
+    assert(!node.IsScheduled());
+    int list = overflowList;
+    if (node.m_expiry <= m_current) {
+        list = dueList;
+    } else {
+        for (int level = 0; level < levelCount; ++level) {
+            const auto shift = levelBits * (level + 1);
+            if ((node.m_expiry >> shift) == (m_current >> shift)) {
+                list = level * slotsPerLevel
+                    + static_cast<int>((node.m_expiry >> (levelBits * level)) & slotMask);
+                break;
+            }
+        }
+    }
+    node.m_list = list;
+    node.m_prev = nullptr;
+    node.m_next = m_lists[list];
+    if (node.m_next) node.m_next->m_prev = &node;
+    m_lists[list] = &node;
+}
+
+
+void TimerWheel::Unlink(Node& node) noexcept
+{
+    assert(node.IsScheduled());
+    if (node.m_prev) {
+        node.m_prev->m_next = node.m_next;
+    } else {
+        assert(m_lists[node.m_list] == &node);
+        m_lists[node.m_list] = node.m_next;
+    }
+    if (node.m_next) node.m_next->m_prev = node.m_prev;
+    node.m_prev = nullptr;
+    node.m_next = nullptr;
+    node.m_list = -1;
+}
+
+
+void TimerWheel::Relink(int list) noexcept
+{
+    auto node = m_lists[list];
+    m_lists[list] = nullptr;
+    while (node) {
+        const auto next = node->m_next;
+        node->m_list = -1;
+        Link(*node);
+        node = next;
+    }
+}
+
+
+}} // namespace
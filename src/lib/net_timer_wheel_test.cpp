@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <coral/net/timer_wheel.hpp>
+
+using coral::net::TimerWheel;
+using std::chrono::milliseconds;
+
+
+namespace
+{
+    struct TestNode : TimerWheel::Node
+    {
+        std::int64_t expiry = 0;
+    };
+}
+
+
+TEST(coral_net, TimerWheel)
+{
+    const auto t0 = TimerWheel::Clock::now();
+    TimerWheel wheel(t0);
+    EXPECT_EQ(TimerWheel::Clock::time_point::max(), wheel.NextWakeUp());
+    EXPECT_EQ(nullptr, wheel.PopExpired(t0 + milliseconds(1000)));
+
+    // Now at 1000 ms; the wheel skips ahead when it is empty.
+    TestNode a, b, c, d;
+    wheel.Schedule(a, t0 + milliseconds(1010));
+    wheel.Schedule(b, t0 + milliseconds(1500));
+    wheel.Schedule(c, t0 + milliseconds(1000 + 100000));
+    wheel.Schedule(d, t0 + milliseconds(1000) + std::chrono::hours(24 * 60));
+    EXPECT_TRUE(a.IsScheduled());
+    EXPECT_EQ(4u, wheel.Size());
+    EXPECT_EQ(t0 + milliseconds(1010), wheel.NextWakeUp());
+
+    EXPECT_EQ(nullptr, wheel.PopExpired(t0 + milliseconds(1009)));
+    EXPECT_EQ(&a, wheel.PopExpired(t0 + milliseconds(1010)));
+    EXPECT_FALSE(a.IsScheduled());
+    EXPECT_EQ(nullptr, wheel.PopExpired(t0 + milliseconds(1010)));
+
+    // Rescheduling and cancelling.
+    wheel.Schedule(b, t0 + milliseconds(1020));
+    wheel.Cancel(c);
+    wheel.Cancel(c);
+    EXPECT_EQ(2u, wheel.Size());
+    EXPECT_EQ(&b, wheel.PopExpired(t0 + milliseconds(5000)));
+    EXPECT_EQ(nullptr, wheel.PopExpired(t0 + milliseconds(5000)));
+
+    // Expiry times are rounded up, and past times expire immediately.
+    wheel.Schedule(a, t0 + milliseconds(5000) + std::chrono::microseconds(1));
+    EXPECT_EQ(nullptr, wheel.PopExpired(t0 + milliseconds(5000)));
+    EXPECT_EQ(&a, wheel.PopExpired(t0 + milliseconds(5001)));
+    wheel.Schedule(a, t0);
+    EXPECT_EQ(&a, wheel.PopExpired(t0 + milliseconds(5001)));
+
+    wheel.Cancel(d);
+    EXPECT_EQ(0u, wheel.Size());
+}
+
+
+TEST(coral_net, TimerWheel_random)
+{
+    // Compares the wheel against a brute-force search, with expiry times
+    // that span all levels, including the overflow list.
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> shift(0, 36);
+    std::uniform_int_distribution<int> action(0, 9);
+    const auto t0 = TimerWheel::Clock::time_point();
+    TimerWheel wheel(t0);
+    std::vector<TestNode> nodes(200);
+    std::int64_t now = 0;
+
+    for (int i = 0; i < 5000; ++i) {
+        auto& node = nodes[rng() % nodes.size()];
+        const auto a = action(rng);
+        if (a < 6) {
+            const auto range = std::int64_t(1) << shift(rng);
+            node.expiry = now + static_cast<std::int64_t>(rng() % range);
+            wheel.Schedule(node, t0 + milliseconds(node.expiry));
+        } else if (a < 7) {
+            wheel.Cancel(node);
+        } else {
+            std::int64_t next = std::numeric_limits<std::int64_t>::max();
+            for (const auto& n : nodes) {
+                if (n.IsScheduled() && n.expiry < next) next = n.expiry;
+            }
+            if (next == std::numeric_limits<std::int64_t>::max()) continue;
+            ASSERT_LE(wheel.NextWakeUp(), t0 + milliseconds(next));
+            now = std::max(now, next);
+            std::size_t popped = 0;
+            while (const auto p = wheel.PopExpired(t0 + milliseconds(now))) {
+                ASSERT_LE(static_cast<TestNode*>(p)->expiry, now);
+                ++popped;
+            }
+            ASSERT_GT(popped, 0u);
+            for (const auto& n : nodes) {
+                if (n.IsScheduled()) {
+                    ASSERT_GT(n.expiry, now);
+                }
+            }
+        }
+    }
+}
@@ -57,7 +57,7 @@ public:
             listenAddress = networkInterface.ToInAddr();
             for (const auto& iface : ip::GetNetworkInterfaces()) {
                 m_broadcastAddrs.push_back(iface.broadcastAddress);
-                CORAL_LOG_TRACE(
+                CORAL_LOG_CAT_TRACE(coral::log::net,
                     boost::format("BroadcastSocket: Adding broadcast address %s.")
                         % ip::IPAddressToString(iface.broadcastAddress));
             }
@@ -86,7 +86,7 @@ public:
             }
             listenAddress = iface->address;
             m_broadcastAddrs.push_back(iface->broadcastAddress);
-            CORAL_LOG_TRACE(
+            CORAL_LOG_CAT_TRACE(coral::log::net,
                 boost::format("BroadcastSocket: Adding broadcast address %s.")
                     % ip::IPAddressToString(iface->broadcastAddress));
         }
@@ -139,9 +139,22 @@ public:
             if (0 != bind(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address))) {
                 throw std::runtime_error("Failed to bind UDP socket to local port");
             }
-            CORAL_LOG_TRACE(boost::format("BroadcastSocket: Bound to %s:%d")
+
+            // If the OS chose the port, find out which one it is.
+            if (port.ToNumber() == 0) {
+#ifdef _WIN32
+                int addressSize = static_cast<int>(sizeof(address));
+#else
+                socklen_t addressSize = sizeof(address);
+#endif
+                if (0 != getsockname(m_socket, reinterpret_cast<sockaddr*>(&address), &addressSize)) {
+                    throw std::runtime_error("Failed to get local port of UDP socket");
+                }
+                m_port = ip::Port::FromNetworkByteOrder(address.sin_port);
+            }
+            CORAL_LOG_CAT_TRACE(coral::log::net, boost::format("BroadcastSocket: Bound to %s:%d")
                 % ip::IPAddressToString(listenAddress)
-                % port.ToNumber());
+                % m_port.ToNumber());
         }
         constructionComplete = true;
     }
@@ -234,6 +247,12 @@ public:
     }
 
 
+    ip::Port Port() const noexcept
+    {
+        return m_port;
+    }
+
+
 private:
     NativeSocket m_socket;
     ip::Port m_port;
@@ -289,4 +308,10 @@ BroadcastSocket::NativeSocket BroadcastSocket::NativeHandle() const noexcept
 }
 
 
+ip::Port BroadcastSocket::Port() const noexcept
+{
+    return m_private->Port();
+}
+
+
 }}} // namespace
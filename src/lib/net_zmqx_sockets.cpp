@@ -216,6 +216,7 @@ void RepSocket::Close()
         m_socket.reset();
         m_boundEndpoint = coral::net::Endpoint{};
         m_clientEnvelope.clear();
+        m_lastClientEnvelope.clear();
     }
 }
 
@@ -241,6 +242,16 @@ namespace
             throw std::runtime_error("Invalid incoming message (not enough frames)");
         }
     }
+
+    void CopyEnvelope(
+        std::vector<zmq::message_t>& source,
+        std::vector<zmq::message_t>& target)
+    {
+        target.resize(source.size());
+        for (std::size_t i = 0; i < source.size(); ++i) {
+            target[i].copy(&source[i]);
+        }
+    }
 }
 
 
@@ -263,12 +274,27 @@ void RepSocket::Send(std::vector<zmq::message_t>& msg)
     }
     CORAL_PRECONDITION_CHECK(!m_clientEnvelope.empty());
     CORAL_INPUT_CHECK(!msg.empty());
+    CopyEnvelope(m_clientEnvelope, m_lastClientEnvelope);
     coral::net::zmqx::Send(*m_socket, m_clientEnvelope, coral::net::zmqx::SendFlag::more);
     coral::net::zmqx::Send(*m_socket, msg);
     assert(m_clientEnvelope.empty());
 }
 
 
+void RepSocket::SendToLastClient(std::vector<zmq::message_t>& msg)
+{
+    if (!m_socket) {
+        throw std::logic_error("Socket not bound/connected");
+    }
+    CORAL_PRECONDITION_CHECK(!m_lastClientEnvelope.empty());
+    CORAL_INPUT_CHECK(!msg.empty());
+    std::vector<zmq::message_t> envelope;
+    CopyEnvelope(m_lastClientEnvelope, envelope);
+    coral::net::zmqx::Send(*m_socket, envelope, coral::net::zmqx::SendFlag::more);
+    coral::net::zmqx::Send(*m_socket, msg);
+}
+
+
 zmq::socket_t& RepSocket::Socket()
 {
     return *m_socket;
@@ -27,7 +27,9 @@ zmq::context_t& GlobalContext()
     //          problem has just shifted elsewhere)
     //      http://stackoverflow.com/q/19795245
     //
-    static auto globalContext = new zmq::context_t();
+    // The socket limit is raised from the default of 1023, since a master
+    // needs several sockets per slave, and so do in-process slaves.
+    static auto globalContext = new zmq::context_t(1, 16384);
     return *globalContext;
 }
 
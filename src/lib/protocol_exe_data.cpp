@@ -6,6 +6,8 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <coral/protocol/exe_data.hpp>
 
+#include <stdexcept>
+
 #include <coral/error.hpp>
 #include <coral/protobuf.hpp>
 #include <coral/protocol/glue.hpp>
@@ -82,6 +84,125 @@ void ed::CreateMessage(
 }
 
 
+coral::model::Variable ed::ParseVariable(const std::vector<zmq::message_t>& rawMsg)
+{
+    if (rawMsg.size() != 2) {
+        throw coral::error::ProtocolViolationException(
+            "Wrong number of frames");
+    }
+    return ParseHeader(rawMsg[0]);
+}
+
+
+namespace
+{
+    // Returns `slot` if it refers to a slot for values of type `dataType`
+    // in `store`, otherwise a new one.
+    coral::bus::ValueSlot& UseSlot(
+        coral::bus::ValueStore& store,
+        coral::bus::ValueSlot& slot,
+        coral::model::DataType dataType)
+    {
+        if (slot.dataType != dataType || slot.index >= store.Size(dataType)) {
+            slot = store.Add(dataType);
+        }
+        return slot;
+    }
+}
+
+
+coral::model::StepID ed::ParseValue(
+    const std::vector<zmq::message_t>& rawMsg,
+    coral::bus::ValueStore& store,
+    coral::bus::ValueSlot& slot)
+{
+    if (rawMsg.size() != 2) {
+        throw coral::error::ProtocolViolationException(
+            "Wrong number of frames");
+    }
+    coralproto::exe_data::TimestampedValue timestampedValue;
+    coral::protobuf::ParseFromFrame(rawMsg[1], timestampedValue);
+    const auto& value = timestampedValue.value();
+    if (value.has_real_value()) {
+        const auto index = UseSlot(store, slot, coral::model::REAL_DATATYPE).index;
+        store.Reals()[index] = value.real_value();
+    } else if (value.has_integer_value()) {
+        const auto index = UseSlot(store, slot, coral::model::INTEGER_DATATYPE).index;
+        store.Integers()[index] = value.integer_value();
+    } else if (value.has_boolean_value()) {
+        const auto index = UseSlot(store, slot, coral::model::BOOLEAN_DATATYPE).index;
+        store.Booleans()[index] = value.boolean_value();
+    } else if (value.has_string_value()) {
+        const auto index = UseSlot(store, slot, coral::model::STRING_DATATYPE).index;
+        store.Strings()[index] = value.string_value();
+    } else {
+        throw coral::error::ProtocolViolationException("Empty variable value");
+    }
+    return timestampedValue.timestep_id();
+}
+
+
+void ed::CreateMessage(
+    const coral::model::Variable& variable,
+    coral::model::StepID timestepID,
+    const coral::bus::ValueStore& store,
+    coral::bus::ValueSlot slot,
+    std::vector<zmq::message_t>& rawOut)
+{
+    rawOut.clear();
+    rawOut.push_back(CreateHeader(variable));
+    coralproto::exe_data::TimestampedValue timestampedValue;
+    auto& value = *timestampedValue.mutable_value();
+    switch (slot.dataType) {
+        case coral::model::REAL_DATATYPE:
+            value.set_real_value(store.Reals()[slot.index]);
+            break;
+        case coral::model::INTEGER_DATATYPE:
+            value.set_integer_value(store.Integers()[slot.index]);
+            break;
+        case coral::model::BOOLEAN_DATATYPE:
+            value.set_boolean_value(store.Booleans()[slot.index]);
+            break;
+        case coral::model::STRING_DATATYPE:
+            value.set_string_value(store.Strings()[slot.index]);
+            break;
+        default:
+            throw std::invalid_argument("Invalid value slot");
+    }
+    timestampedValue.set_timestep_id(timestepID);
+    rawOut.emplace_back();
+    coral::protobuf::SerializeToFrame(timestampedValue, rawOut[1]);
+}
+
+
+void ed::CreateStepCompleteMessage(
+    coral::model::SlaveID slaveID,
+    coral::model::StepID timestepID,
+    std::vector<zmq::message_t>& rawOut)
+{
+    rawOut.clear();
+    rawOut.push_back(CreateHeader(
+        coral::model::Variable(slaveID, STEP_COMPLETE_VARIABLE_ID)));
+    coralproto::exe_data::StepComplete stepComplete;
+    stepComplete.set_timestep_id(timestepID);
+    rawOut.emplace_back();
+    coral::protobuf::SerializeToFrame(stepComplete, rawOut[1]);
+}
+
+
+coral::model::StepID ed::ParseStepCompleteMessage(
+    const std::vector<zmq::message_t>& rawMsg)
+{
+    if (rawMsg.size() != 2) {
+        throw coral::error::ProtocolViolationException(
+            "Wrong number of frames");
+    }
+    coralproto::exe_data::StepComplete stepComplete;
+    coral::protobuf::ParseFromFrame(rawMsg[1], stepComplete);
+    return stepComplete.timestep_id();
+}
+
+
 void ed::Subscribe(zmq::socket_t& socket, const coral::model::Variable& variable)
 {
     char header[HEADER_SIZE];
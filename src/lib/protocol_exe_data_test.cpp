@@ -18,3 +18,49 @@ TEST(coral_protocol_exe_data, CreateAndParse)
     EXPECT_EQ(msg.value,      msg2.value);
     EXPECT_EQ(msg.timestepID, msg2.timestepID);
 }
+
+
+TEST(coral_protocol_exe_data, CreateAndParse_ValueStore)
+{
+    coral::bus::ValueStore store;
+    const auto intSlot = store.Add(coral::model::INTEGER_DATATYPE);
+    store.Integers()[intSlot.index] = 42;
+
+    std::vector<zmq::message_t> raw;
+    ed::CreateMessage(coral::model::Variable(123, 456), 100, store, intSlot, raw);
+    EXPECT_EQ(coral::model::Variable(123, 456), ed::ParseVariable(raw));
+    EXPECT_EQ(42, boost::get<int>(ed::ParseMessage(raw).value));
+
+    // A value-initialised slot gets a new slot of the right type.
+    coral::bus::ValueSlot slot{};
+    EXPECT_EQ(100, ed::ParseValue(raw, store, slot));
+    EXPECT_EQ(coral::model::INTEGER_DATATYPE, slot.dataType);
+    EXPECT_EQ(1U, slot.index);
+    EXPECT_EQ(42, store.Integers()[1]);
+
+    // An existing slot of the right type is reused, while a slot of the
+    // wrong type is replaced.
+    EXPECT_EQ(100, ed::ParseValue(raw, store, slot));
+    EXPECT_EQ(1U, slot.index);
+    ed::Message msg;
+    msg.variable = coral::model::Variable(123, 456);
+    msg.value = 3.14;
+    msg.timestepID = 101;
+    ed::CreateMessage(msg, raw);
+    EXPECT_EQ(101, ed::ParseValue(raw, store, slot));
+    EXPECT_EQ(coral::model::REAL_DATATYPE, slot.dataType);
+    EXPECT_EQ(0U, slot.index);
+    EXPECT_EQ(3.14, store.Reals()[0]);
+    EXPECT_EQ(2U, store.Size(coral::model::INTEGER_DATATYPE));
+}
+
+
+TEST(coral_protocol_exe_data, CreateAndParse_StepComplete)
+{
+    std::vector<zmq::message_t> raw;
+    ed::CreateStepCompleteMessage(123, 100, raw);
+    const auto variable = ed::ParseVariable(raw);
+    EXPECT_EQ(123, variable.Slave());
+    EXPECT_EQ(ed::STEP_COMPLETE_VARIABLE_ID, variable.ID());
+    EXPECT_EQ(100, ed::ParseStepCompleteMessage(raw));
+}
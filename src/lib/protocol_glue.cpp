@@ -242,6 +242,36 @@ coral::model::Variable coral::protocol::FromProto(const coralproto::model::Varia
 }
 
 
+coralproto::execution::Aggregation coral::protocol::ToProto(
+    coral::model::Aggregation source)
+{
+    switch (source) {
+        case coral::model::SUM_AGGREGATION:     return coralproto::execution::AGGREGATE_SUM;
+        case coral::model::MIN_AGGREGATION:     return coralproto::execution::AGGREGATE_MIN;
+        case coral::model::MAX_AGGREGATION:     return coralproto::execution::AGGREGATE_MAX;
+        case coral::model::MEAN_AGGREGATION:    return coralproto::execution::AGGREGATE_MEAN;
+        default:
+            assert (!"Invalid aggregation");
+            return coralproto::execution::AGGREGATE_SUM;
+    }
+}
+
+
+coral::model::Aggregation coral::protocol::FromProto(
+    coralproto::execution::Aggregation source)
+{
+    switch (source) {
+        case coralproto::execution::AGGREGATE_SUM:  return coral::model::SUM_AGGREGATION;
+        case coralproto::execution::AGGREGATE_MIN:  return coral::model::MIN_AGGREGATION;
+        case coralproto::execution::AGGREGATE_MAX:  return coral::model::MAX_AGGREGATION;
+        case coralproto::execution::AGGREGATE_MEAN: return coral::model::MEAN_AGGREGATION;
+        default:
+            assert (!"Unknown aggregation");
+            return coral::model::NO_AGGREGATION;
+    }
+}
+
+
 void coral::protocol::ConvertToProto(
     const coral::net::SlaveLocator& source,
     coralproto::net::SlaveLocator& target)
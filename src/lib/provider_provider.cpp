@@ -8,15 +8,22 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <string>
 
+#include <boost/format.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 #include <zmq.hpp>
 
 #include <coral/bus/slave_provider_comm.hpp>
 #include <coral/error.hpp>
+#include <coral/log.hpp>
 #include <coral/net/reactor.hpp>
 #include <coral/net/service.hpp>
 #include <coral/net/zmqx.hpp>
+#include <coral/protocol/execution.hpp>
 #include <coral/util.hpp>
 
 
@@ -28,6 +35,38 @@ namespace provider
 
 namespace
 {
+    const auto TERMINATE_SLAVE_TIMEOUT = std::chrono::seconds(1);
+
+    // Tells a slave which no master is going to use to shut down, the same
+    // way a master does when it is done with a slave.  Failure is only
+    // logged, since the slave shuts itself down anyway when no master has
+    // connected to it within its inactivity timeout.
+    void TerminateSlave(const coral::net::SlaveLocator& slaveLocator) noexcept
+    {
+        try {
+            coral::net::zmqx::ReqSocket socket;
+            socket.Connect(slaveLocator.ControlEndpoint());
+            std::vector<zmq::message_t> msg;
+            coral::protocol::execution::CreateHelloMessage(msg, 0);
+            socket.Send(msg);
+            if (!coral::net::zmqx::WaitForIncoming(
+                    socket.Socket(), TERMINATE_SLAVE_TIMEOUT)) {
+                throw std::runtime_error("Slave did not reply to HELLO");
+            }
+            socket.Receive(msg);
+            coral::protocol::execution::ParseHelloMessage(msg);
+            coral::protocol::execution::CreateMessage(
+                msg, coralproto::execution::MSG_TERMINATE);
+            socket.Send(msg);
+        } catch (const std::exception& e) {
+            coral::log::Log(
+                coral::log::warning,
+                boost::format("Failed to terminate slave at %s: %s")
+                    % slaveLocator.ControlEndpoint().URL() % e.what());
+        }
+    }
+
+
     class MySlaveProviderOps : public coral::bus::SlaveProviderOps
     {
     public:
@@ -50,6 +89,85 @@ namespace
         coral::net::SlaveLocator InstantiateSlave(
             const std::string& slaveTypeUUID,
             std::chrono::milliseconds timeout) override
+        {
+            const auto st = FindSlaveType(slaveTypeUUID);
+            coral::net::SlaveLocator loc;
+            if (!st->Instantiate(timeout, loc)) {
+                throw std::runtime_error(st->InstantiationFailureDescription());
+            }
+            return loc;
+        }
+
+        std::vector<coral::net::SlaveLocator> InstantiateSlaves(
+            const std::vector<coral::bus::SlaveBatch>& slaveBatches,
+            std::chrono::milliseconds timeout) override
+        {
+            // Batches of the same type are merged, since a SlaveCreator may
+            // only be used by one thread at a time.
+            std::vector<SlaveCreator*> creators;
+            std::vector<int> counts;
+            std::vector<std::size_t> batchCreators;
+            for (const auto& batch : slaveBatches) {
+                const auto creator = FindSlaveType(batch.slaveTypeUUID);
+                const auto it = std::find(creators.begin(), creators.end(), creator);
+                batchCreators.push_back(it - creators.begin());
+                if (it == creators.end()) {
+                    creators.push_back(creator);
+                    counts.push_back(batch.count);
+                } else {
+                    counts[batchCreators.back()] += batch.count;
+                }
+            }
+
+            // Start the slaves of each type in a separate thread.
+            std::vector<std::future<std::vector<coral::net::SlaveLocator>>> results;
+            for (std::size_t i = 0; i < creators.size(); ++i) {
+                results.push_back(std::async(
+                    std::launch::async,
+                    [creator = creators[i], count = counts[i], timeout] () {
+                        std::vector<coral::net::SlaveLocator> locators;
+                        if (!creator->InstantiateBatch(count, timeout, locators)) {
+                            throw std::runtime_error(
+                                creator->InstantiationFailureDescription());
+                        }
+                        if (locators.size() != static_cast<std::size_t>(count)) {
+                            throw std::runtime_error("Wrong number of slaves instantiated");
+                        }
+                        return locators;
+                    }));
+            }
+            // If the slaves of one type could not be instantiated, the others
+            // have been started for nothing, so we shut them down again.
+            std::vector<std::vector<coral::net::SlaveLocator>> typeLocators;
+            std::exception_ptr error;
+            for (auto& r : results) {
+                try {
+                    typeLocators.push_back(r.get());
+                } catch (...) {
+                    if (!error) error = std::current_exception();
+                }
+            }
+            if (error) {
+                for (const auto& tl : typeLocators) {
+                    for (const auto& sl : tl) TerminateSlave(sl);
+                }
+                std::rethrow_exception(error);
+            }
+
+            // Distribute the locators to the batches, in order.
+            std::vector<std::size_t> used(creators.size(), 0);
+            std::vector<coral::net::SlaveLocator> locators;
+            for (std::size_t i = 0; i < slaveBatches.size(); ++i) {
+                const auto c = batchCreators[i];
+                for (int j = 0; j < slaveBatches[i].count; ++j) {
+                    locators.push_back(typeLocators[c][used[c]++]);
+                }
+            }
+            return locators;
+        }
+
+    private:
+        SlaveCreator* FindSlaveType(const std::string& slaveTypeUUID) const
         {
             const auto st = std::find_if(
                 begin(m_slaveTypes),
@@ -60,18 +178,77 @@ namespace
             if (st == end(m_slaveTypes)) {
                 throw std::runtime_error("Unknown slave type");
             }
-            coral::net::SlaveLocator loc;
-            if (!(*st)->Instantiate(timeout, loc)) {
-                throw std::runtime_error((*st)->InstantiationFailureDescription());
-            }
-            return loc;
+            return st->get();
         }
 
-    private:
         const std::vector<std::unique_ptr<SlaveCreator>> m_slaveTypes;
     };
 
 
+    // Computes a version number for the slave type catalog, i.e., the slave
+    // types offered by a provider.  It is a 32-bit FNV-1a hash of the full
+    // slave type descriptions, including variables, so it changes if a slave
+    // type is added, removed or modified.
+    class CatalogHash
+    {
+    public:
+        void Add(const std::string& s)
+        {
+            // Include the terminating null, as a separator.
+            for (const char c : s) AddByte(static_cast<unsigned char>(c));
+            AddByte(0);
+        }
+
+        void Add(std::uint32_t n)
+        {
+            for (int i = 0; i < 4; ++i) AddByte((n >> (8*i)) & 0xFF);
+        }
+
+        std::uint32_t Value() const { return m_hash; }
+
+    private:
+        void AddByte(std::uint32_t b)
+        {
+            m_hash ^= b;
+            m_hash *= 16777619u;
+        }
+
+        std::uint32_t m_hash = 2166136261u;
+    };
+
+    std::uint32_t CatalogVersion(
+        const std::vector<std::unique_ptr<SlaveCreator>>& slaveTypes)
+    {
+        std::vector<const coral::model::SlaveTypeDescription*> descriptions;
+        for (const auto& st : slaveTypes) descriptions.push_back(&st->Description());
+        std::sort(
+            descriptions.begin(),
+            descriptions.end(),
+            [] (const coral::model::SlaveTypeDescription* a,
+                const coral::model::SlaveTypeDescription* b)
+            {
+                return a->UUID() < b->UUID();
+            });
+
+        CatalogHash hash;
+        for (const auto d : descriptions) {
+            hash.Add(d->UUID());
+            hash.Add(d->Name());
+            hash.Add(d->Description());
+            hash.Add(d->Author());
+            hash.Add(d->Version());
+            for (const auto& v : d->Variables()) {
+                hash.Add(v.ID());
+                hash.Add(v.Name());
+                hash.Add(static_cast<std::uint32_t>(v.DataType()));
+                hash.Add(static_cast<std::uint32_t>(v.Causality()));
+                hash.Add(static_cast<std::uint32_t>(v.Variability()));
+            }
+        }
+        return hash.Value();
+    }
+
+
     // Ok, this is all a bit ugly, but it's for a good cause, namely to handle
     // as many errors as possible in the foreground thread (see below).
     struct BackgroundThreadData
@@ -82,6 +259,7 @@ namespace
         std::shared_ptr<zmq::socket_t> killSocket;
         std::shared_ptr<coral::net::reqrep::Server> server;
         std::shared_ptr<coral::net::service::Beacon> beacon;
+        std::shared_ptr<coral::net::service::Beacon> catalogBeacon;
     };
 
     void BackgroundThreadFunction(
@@ -90,6 +268,7 @@ namespace
     {
         try {
             objects.reactor->Run();
+            objects.catalogBeacon->Stop();
             objects.beacon->Stop();
         } catch (...) {
             if (exceptionHandler) {
@@ -127,6 +306,7 @@ SlaveProvider::SlaveProvider(
         *bg.killSocket,
         [] (coral::net::Reactor& r, zmq::socket_t&) { r.Stop(); });
 
+    const auto catalogVersion = CatalogVersion(slaveTypes);
     bg.server = std::make_shared<coral::net::reqrep::Server>(
         *bg.reactor,
         coral::net::ip::Endpoint{networkInterface, "*"}.ToEndpoint("tcp"));
@@ -134,6 +314,7 @@ SlaveProvider::SlaveProvider(
         *bg.server,
         std::make_shared<MySlaveProviderOps>(std::move(slaveTypes)));
 
+    // The beacon payload contains the server port.
     char beaconPayload[2];
     coral::util::EncodeUint16(
         coral::net::zmqx::EndpointPort(bg.server->BoundEndpoint().URL()),
@@ -148,6 +329,21 @@ SlaveProvider::SlaveProvider(
         networkInterface,
         discoveryPort);
 
+    // The catalog version is advertised by a separate beacon, which lets
+    // masters know when they need to update their cached slave type lists.
+    // Masters from before this was introduced simply don't listen for it.
+    char catalogBeaconPayload[4];
+    coral::util::EncodeUint32(catalogVersion, catalogBeaconPayload);
+    bg.catalogBeacon = std::make_shared<coral::net::service::Beacon>(
+        0,
+        "no.sintef.viproma.coral.slave_provider_catalog",
+        slaveProviderID,
+        catalogBeaconPayload,
+        sizeof(catalogBeaconPayload),
+        std::chrono::seconds(1),
+        networkInterface,
+        discoveryPort);
+
     m_thread = std::thread{&BackgroundThreadFunction, bg, exceptionHandler};
 }
 
@@ -0,0 +1,191 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/slave/instance.hpp>
+
+#include <stdexcept>
+
+
+namespace coral
+{
+namespace slave
+{
+
+
+// =============================================================================
+// VariableGroup
+// =============================================================================
+
+VariableGroup::VariableGroup(
+    coral::model::DataType dataType,
+    const coral::model::VariableID* variables,
+    std::size_t count)
+    : m_dataType(dataType)
+    , m_variables(variables, variables + count)
+{
+}
+
+
+coral::model::DataType VariableGroup::DataType() const noexcept
+{
+    return m_dataType;
+}
+
+
+const std::vector<coral::model::VariableID>& VariableGroup::Variables()
+    const noexcept
+{
+    return m_variables;
+}
+
+
+std::size_t VariableGroup::Size() const noexcept
+{
+    return m_variables.size();
+}
+
+
+// =============================================================================
+// Instance
+// =============================================================================
+
+namespace
+{
+    void CheckDataType(
+        const VariableGroup& variables,
+        coral::model::DataType dataType)
+    {
+        if (variables.DataType() != dataType) {
+            throw std::logic_error("Variable group has wrong data type");
+        }
+    }
+}
+
+
+std::unique_ptr<VariableGroup> Instance::PrepareVariables(
+    coral::model::DataType dataType,
+    const coral::model::VariableID* variables,
+    std::size_t count) const
+{
+    if (count > 0) {
+        const auto typeDescription = TypeDescription();
+        for (std::size_t i = 0; i < count; ++i) {
+            if (typeDescription.Variable(variables[i]).DataType() != dataType) {
+                throw std::logic_error(
+                    "Variable " + std::to_string(variables[i])
+                    + " does not have the requested data type");
+            }
+        }
+    }
+    return std::make_unique<VariableGroup>(dataType, variables, count);
+}
+
+
+void Instance::GetRealVariables(
+    const VariableGroup& variables,
+    double* values) const
+{
+    CheckDataType(variables, coral::model::REAL_DATATYPE);
+    const auto& ids = variables.Variables();
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        values[i] = GetRealVariable(ids[i]);
+    }
+}
+
+
+void Instance::GetIntegerVariables(
+    const VariableGroup& variables,
+    int* values) const
+{
+    CheckDataType(variables, coral::model::INTEGER_DATATYPE);
+    const auto& ids = variables.Variables();
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        values[i] = GetIntegerVariable(ids[i]);
+    }
+}
+
+
+void Instance::GetBooleanVariables(
+    const VariableGroup& variables,
+    bool* values) const
+{
+    CheckDataType(variables, coral::model::BOOLEAN_DATATYPE);
+    const auto& ids = variables.Variables();
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        values[i] = GetBooleanVariable(ids[i]);
+    }
+}
+
+
+void Instance::GetStringVariables(
+    const VariableGroup& variables,
+    std::string* values) const
+{
+    CheckDataType(variables, coral::model::STRING_DATATYPE);
+    const auto& ids = variables.Variables();
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        values[i] = GetStringVariable(ids[i]);
+    }
+}
+
+
+bool Instance::SetRealVariables(
+    const VariableGroup& variables,
+    const double* values)
+{
+    CheckDataType(variables, coral::model::REAL_DATATYPE);
+    const auto& ids = variables.Variables();
+    bool allGood = true;
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (!SetRealVariable(ids[i], values[i])) allGood = false;
+    }
+    return allGood;
+}
+
+
+bool Instance::SetIntegerVariables(
+    const VariableGroup& variables,
+    const int* values)
+{
+    CheckDataType(variables, coral::model::INTEGER_DATATYPE);
+    const auto& ids = variables.Variables();
+    bool allGood = true;
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (!SetIntegerVariable(ids[i], values[i])) allGood = false;
+    }
+    return allGood;
+}
+
+
+bool Instance::SetBooleanVariables(
+    const VariableGroup& variables,
+    const bool* values)
+{
+    CheckDataType(variables, coral::model::BOOLEAN_DATATYPE);
+    const auto& ids = variables.Variables();
+    bool allGood = true;
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (!SetBooleanVariable(ids[i], values[i])) allGood = false;
+    }
+    return allGood;
+}
+
+
+bool Instance::SetStringVariables(
+    const VariableGroup& variables,
+    const std::string* values)
+{
+    CheckDataType(variables, coral::model::STRING_DATATYPE);
+    const auto& ids = variables.Variables();
+    bool allGood = true;
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (!SetStringVariable(ids[i], values[i])) allGood = false;
+    }
+    return allGood;
+}
+
+
+}} // namespace
@@ -85,8 +85,46 @@ void LoggingInstance::Setup(
     const auto typeDescription  = TypeDescription();
     for (const auto& var : typeDescription.Variables()) {
         m_outputStream << "," << var.Name();
+        AddColumn(var);
     }
     m_outputStream << std::endl;
+    m_realValues.resize(m_realVariables.size());
+    m_integerValues.resize(m_integerVariables.size());
+    m_booleanValues = std::make_unique<bool[]>(m_booleanVariables.size());
+    m_stringValues.resize(m_stringVariables.size());
+    m_realGroup = m_instance->PrepareVariables(coral::model::REAL_DATATYPE,
+        m_realVariables.data(), m_realVariables.size());
+    m_integerGroup = m_instance->PrepareVariables(coral::model::INTEGER_DATATYPE,
+        m_integerVariables.data(), m_integerVariables.size());
+    m_booleanGroup = m_instance->PrepareVariables(coral::model::BOOLEAN_DATATYPE,
+        m_booleanVariables.data(), m_booleanVariables.size());
+    m_stringGroup = m_instance->PrepareVariables(coral::model::STRING_DATATYPE,
+        m_stringVariables.data(), m_stringVariables.size());
+}
+
+
+void LoggingInstance::AddColumn(const coral::model::VariableDescription& variable)
+{
+    std::vector<coral::model::VariableID>* variables = nullptr;
+    switch (variable.DataType()) {
+        case coral::model::REAL_DATATYPE:
+            variables = &m_realVariables;
+            break;
+        case coral::model::INTEGER_DATATYPE:
+            variables = &m_integerVariables;
+            break;
+        case coral::model::BOOLEAN_DATATYPE:
+            variables = &m_booleanVariables;
+            break;
+        case coral::model::STRING_DATATYPE:
+            variables = &m_stringVariables;
+            break;
+        default:
+            assert (false);
+            return;
+    }
+    m_columns.push_back(Column{variable.DataType(), variables->size()});
+    variables->push_back(variable.ID());
 }
 
 
@@ -102,45 +140,37 @@ void LoggingInstance::EndSimulation()
 }
 
 
-namespace
+bool LoggingInstance::DoStep(
+    coral::model::TimePoint currentT,
+    coral::model::TimeDuration deltaT)
 {
-    void PrintVariable(
-        std::ostream& out,
-        const coral::model::VariableDescription& varInfo,
-        Instance& slaveInstance)
-    {
-        out << ",";
-        switch (varInfo.DataType()) {
+    const auto ret = m_instance->DoStep(currentT, deltaT);
+
+    m_instance->GetRealVariables(*m_realGroup, m_realValues.data());
+    m_instance->GetIntegerVariables(*m_integerGroup, m_integerValues.data());
+    m_instance->GetBooleanVariables(*m_booleanGroup, m_booleanValues.get());
+    m_instance->GetStringVariables(*m_stringGroup, m_stringValues.data());
+
+    m_outputStream << std::fixed << (currentT + deltaT) << std::defaultfloat;
+    for (const auto& column : m_columns) {
+        m_outputStream << ",";
+        switch (column.dataType) {
             case coral::model::REAL_DATATYPE:
-                out << slaveInstance.GetRealVariable(varInfo.ID());
+                m_outputStream << m_realValues[column.index];
                 break;
             case coral::model::INTEGER_DATATYPE:
-                out << slaveInstance.GetIntegerVariable(varInfo.ID());
+                m_outputStream << m_integerValues[column.index];
                 break;
             case coral::model::BOOLEAN_DATATYPE:
-                out << slaveInstance.GetBooleanVariable(varInfo.ID());
+                m_outputStream << m_booleanValues[column.index];
                 break;
             case coral::model::STRING_DATATYPE:
-                out << slaveInstance.GetStringVariable(varInfo.ID());
+                m_outputStream << m_stringValues[column.index];
                 break;
             default:
                 assert (false);
         }
     }
-}
-
-
-bool LoggingInstance::DoStep(
-    coral::model::TimePoint currentT,
-    coral::model::TimeDuration deltaT)
-{
-    const auto ret = m_instance->DoStep(currentT, deltaT);
-
-    m_outputStream << std::fixed << (currentT + deltaT) << std::defaultfloat;
-    const auto typeDescription = TypeDescription();
-    for (const auto& var : typeDescription.Variables()) {
-        PrintVariable(m_outputStream, var, *this);
-    }
     m_outputStream << std::endl;
 
     return ret;
@@ -195,4 +225,77 @@ bool LoggingInstance::SetStringVariable(coral::model::VariableID varRef, const s
 }
 
 
+std::unique_ptr<VariableGroup> LoggingInstance::PrepareVariables(
+    coral::model::DataType dataType,
+    const coral::model::VariableID* variables,
+    std::size_t count) const
+{
+    return m_instance->PrepareVariables(dataType, variables, count);
+}
+
+
+void LoggingInstance::GetRealVariables(
+    const VariableGroup& variables,
+    double* values) const
+{
+    m_instance->GetRealVariables(variables, values);
+}
+
+
+void LoggingInstance::GetIntegerVariables(
+    const VariableGroup& variables,
+    int* values) const
+{
+    m_instance->GetIntegerVariables(variables, values);
+}
+
+
+void LoggingInstance::GetBooleanVariables(
+    const VariableGroup& variables,
+    bool* values) const
+{
+    m_instance->GetBooleanVariables(variables, values);
+}
+
+
+void LoggingInstance::GetStringVariables(
+    const VariableGroup& variables,
+    std::string* values) const
+{
+    m_instance->GetStringVariables(variables, values);
+}
+
+
+bool LoggingInstance::SetRealVariables(
+    const VariableGroup& variables,
+    const double* values)
+{
+    return m_instance->SetRealVariables(variables, values);
+}
+
+
+bool LoggingInstance::SetIntegerVariables(
+    const VariableGroup& variables,
+    const int* values)
+{
+    return m_instance->SetIntegerVariables(variables, values);
+}
+
+
+bool LoggingInstance::SetBooleanVariables(
+    const VariableGroup& variables,
+    const bool* values)
+{
+    return m_instance->SetBooleanVariables(variables, values);
+}
+
+
+bool LoggingInstance::SetStringVariables(
+    const VariableGroup& variables,
+    const std::string* values)
+{
+    return m_instance->SetStringVariables(variables, values);
+}
+
+
 }} // namespace
@@ -0,0 +1,241 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/timeline.hpp>
+
+#ifdef _WIN32
+#   include <process.h>
+#else
+#   include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+
+namespace coral
+{
+namespace timeline
+{
+
+
+std::atomic<bool> detail::enabled(false);
+
+
+namespace
+{
+    // Spans are stored in fixed-size chunks which are allocated as they are
+    // needed.  Writers claim a slot with an atomic increment, fill it, and
+    // then publish it by storing the name pointer.
+    const std::size_t chunkSize = 1 << 16;
+    const std::size_t maxChunks = 1024;
+
+    struct Event
+    {
+        std::atomic<const char*> name;
+        Time begin;
+        Time end;
+        std::int64_t arg;
+        std::size_t thread;
+    };
+
+    std::atomic<Event*> g_chunks[maxChunks];
+    std::atomic<std::size_t> g_next(0);
+    std::atomic<std::size_t> g_dropped(0);
+    std::atomic<Time> g_clockOffset(0);
+
+    std::mutex g_mutex; // Protects the variables below
+    std::string g_processName;
+    std::string g_outputFile;
+    bool g_atexitRegistered = false;
+
+
+    // Returns the chunk with the given index, allocating it if necessary,
+    // or null if allocation fails.
+    Event* Chunk(std::size_t index) noexcept
+    {
+        auto chunk = g_chunks[index].load(std::memory_order_acquire);
+        if (!chunk) {
+            const auto newChunk = new (std::nothrow) Event[chunkSize]();
+            if (!newChunk) return nullptr;
+            if (g_chunks[index].compare_exchange_strong(
+                    chunk, newChunk, std::memory_order_acq_rel)) {
+                chunk = newChunk;
+            } else {
+                delete[] newChunk;
+            }
+        }
+        return chunk;
+    }
+
+
+    void WriteJsonString(std::ostream& out, const std::string& s)
+    {
+        out << '"';
+        for (const char c : s) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                    << static_cast<int>(c) << std::dec << std::setfill(' ');
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+
+    void WriteOutputFile()
+    {
+        try {
+            std::string outputFile;
+            {
+                std::lock_guard<std::mutex> lock(g_mutex);
+                outputFile = g_outputFile;
+            }
+            if (outputFile.empty()) return;
+            std::ofstream out(outputFile);
+            WriteChromeTrace(out);
+        } catch (...) {
+            // There isn't much we can do at this point.
+        }
+    }
+}
+
+
+Time Now() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void Enable(const std::string& outputFile)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (IsEnabled()) {
+        throw std::logic_error("Timeline tracing already enabled");
+    }
+    g_outputFile = outputFile;
+    if (!g_atexitRegistered) {
+        std::atexit(&WriteOutputFile);
+        g_atexitRegistered = true;
+    }
+    detail::enabled.store(true);
+}
+
+
+void Disable() noexcept
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    detail::enabled.store(false);
+    g_outputFile.clear();
+    const auto count =
+        std::min(g_next.load(std::memory_order_acquire), chunkSize * maxChunks);
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto chunk = g_chunks[i / chunkSize].load(std::memory_order_acquire);
+        if (chunk) chunk[i % chunkSize].name.store(nullptr, std::memory_order_relaxed);
+    }
+    g_next.store(0, std::memory_order_release);
+    g_dropped.store(0, std::memory_order_relaxed);
+}
+
+
+void SetProcessName(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_processName = name;
+}
+
+
+void SetClockOffset(Time offset) noexcept
+{
+    g_clockOffset.store(offset, std::memory_order_relaxed);
+}
+
+
+void Record(const char* name, Time begin, Time end, std::int64_t arg) noexcept
+{
+    if (!IsEnabled()) return;
+    const auto index = g_next.fetch_add(1, std::memory_order_relaxed);
+    const auto chunk =
+        index < chunkSize * maxChunks ? Chunk(index / chunkSize) : nullptr;
+    if (!chunk) {
+        g_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    auto& event = chunk[index % chunkSize];
+    event.begin = begin;
+    event.end = end;
+    event.arg = arg;
+    event.thread = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    event.name.store(name, std::memory_order_release);
+}
+
+
+void WriteChromeTrace(std::ostream& out)
+{
+    std::string processName;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        processName = g_processName;
+    }
+    const auto pid = getpid();
+    const auto offset = g_clockOffset.load(std::memory_order_relaxed);
+    const auto count =
+        std::min(g_next.load(std::memory_order_acquire), chunkSize * maxChunks);
+
+    const auto oldFlags = out.flags();
+    const auto oldPrecision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"traceEvents\":[\n"
+        << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"tid\":0,\"args\":{\"name\":";
+    WriteJsonString(out, processName.empty() ? "coral" : processName);
+    out << "}}";
+
+    // Chrome wants small thread IDs, so we number them in order of appearance.
+    std::map<std::size_t, int> threadIDs;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto chunk = g_chunks[i / chunkSize].load(std::memory_order_acquire);
+        if (!chunk) continue;
+        const auto& event = chunk[i % chunkSize];
+        const auto name = event.name.load(std::memory_order_acquire);
+        if (!name) continue; // Still being written, or allocation failed
+        const auto tid = threadIDs.insert(
+            std::make_pair(event.thread, static_cast<int>(threadIDs.size()))
+            ).first->second;
+        out << ",\n{\"name\":";
+        WriteJsonString(out, name);
+        out << ",\"ph\":\"X\",\"pid\":" << pid
+            << ",\"tid\":" << tid
+            << ",\"ts\":" << (event.begin + offset) / 1000.0
+            << ",\"dur\":" << (event.end - event.begin) / 1000.0;
+        if (event.arg != noArg) {
+            out << ",\"args\":{\"arg\":" << event.arg << '}';
+        }
+        out << '}';
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"droppedSpans\":"
+        << g_dropped.load(std::memory_order_relaxed) << "}}" << std::endl;
+
+    out.flags(oldFlags);
+    out.precision(oldPrecision);
+}
+
+
+}} // namespace
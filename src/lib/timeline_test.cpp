@@ -0,0 +1,56 @@
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <coral/timeline.hpp>
+#include <coral/util.hpp>
+
+
+TEST(coral_timeline, Record)
+{
+    namespace tl = coral::timeline;
+
+    // Nothing is recorded before tracing is enabled.
+    tl::Record("Disabled", tl::Now(), tl::Now());
+    EXPECT_FALSE(tl::IsEnabled());
+
+    const auto outputFile = boost::filesystem::temp_directory_path()
+        / boost::filesystem::unique_path("coral_timeline_test_%%%%%%%%.json");
+    tl::Enable(outputFile.string());
+    const auto cleanup = coral::util::OnScopeExit([&outputFile] () {
+        tl::Disable();
+        tl::SetProcessName(std::string());
+        tl::SetClockOffset(0);
+        boost::system::error_code ignored;
+        boost::filesystem::remove(outputFile, ignored);
+    });
+    EXPECT_TRUE(tl::IsEnabled());
+    EXPECT_THROW(tl::Enable(outputFile.string()), std::logic_error);
+    tl::SetProcessName("test \"process\"");
+    tl::SetClockOffset(1000000);
+
+    tl::Record("Explicit", 1000, 3500, 42);
+    {
+        tl::Span span("Scoped");
+    }
+
+    std::ostringstream out;
+    tl::WriteChromeTrace(out);
+    const auto trace = out.str();
+    EXPECT_EQ(std::string::npos, trace.find("Disabled"));
+    EXPECT_NE(std::string::npos, trace.find("\"test \\\"process\\\"\""));
+    EXPECT_NE(std::string::npos, trace.find(
+        "{\"name\":\"Explicit\",\"ph\":\"X\""));
+    EXPECT_NE(std::string::npos, trace.find(
+        "\"ts\":1001.000,\"dur\":2.500,\"args\":{\"arg\":42}}"));
+    EXPECT_NE(std::string::npos, trace.find("{\"name\":\"Scoped\""));
+
+    // Disabling tracing discards the recorded spans.
+    tl::Disable();
+    EXPECT_FALSE(tl::IsEnabled());
+    std::ostringstream outAfterDisable;
+    tl::WriteChromeTrace(outAfterDisable);
+    EXPECT_EQ(std::string::npos, outAfterDisable.str().find("Explicit"));
+}
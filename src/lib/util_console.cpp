@@ -13,13 +13,16 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #endif
 
 #include <cassert>
+#include <cstdlib>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include <utility>
 
 #include <boost/filesystem.hpp>
 
 #include <coral/log.hpp>
+#include <coral/timeline.hpp>
 #include <coral/util.hpp>
 
 
@@ -156,6 +159,11 @@ void coral::util::AddLoggingOptions(
             "lowest to highest: trace, debug, info, warning, error.  Note that "
             "certain trace and debug messages are only printed if the program "
             "itself was compiled in debug mode.")
+        ("log-category", po::value<std::vector<std::string>>()->composing(),
+            "Sets the lowest level of messages to log for one category, in "
+            "addition to --log-level.  The argument has the form "
+            "<category>=<level>, where <category> is one of general, net, bus "
+            "and fmi.  May be specified multiple times.")
         ("log-file",
             "Enable logging to file.")
         ("log-file-dir", po::value<std::string>()->default_value("."),
@@ -172,6 +180,21 @@ void coral::util::UseLoggingArguments(
         coral::log::ParseLevel(arguments["log-level"].as<std::string>());
     coral::log::AddSink(coral::log::CLogPtr(), logLevel);
 
+    if (arguments.count("log-category")) {
+        for (const auto& filter :
+                arguments["log-category"].as<std::vector<std::string>>()) {
+            const auto eq = filter.find('=');
+            if (eq == std::string::npos) {
+                throw std::runtime_error(
+                    "Invalid log category filter (expected <category>=<level>): "
+                    + filter);
+            }
+            coral::log::SetCategoryLevel(
+                coral::log::ParseCategory(filter.substr(0, eq)),
+                coral::log::ParseLevel(filter.substr(eq + 1)));
+        }
+    }
+
     if (arguments.count("log-file")) {
         const auto logFileDir =
             boost::filesystem::path(arguments["log-file-dir"].as<std::string>());
@@ -189,3 +212,79 @@ void coral::util::UseLoggingArguments(
     }
 
 }
+
+
+void coral::util::UseTracingEnvironment(const std::string& traceFilePrefix)
+{
+    const auto traceDirEnv = std::getenv("CORAL_TRACE_DIR");
+    if (!traceDirEnv || !*traceDirEnv) return;
+
+    const auto traceDir = boost::filesystem::path(traceDirEnv);
+    if (!boost::filesystem::exists(traceDir)) {
+        boost::filesystem::create_directories(traceDir);
+    }
+    const auto traceFileName =
+        traceFilePrefix + "_"
+        + std::to_string(getpid()) + "_"
+        + coral::util::Timestamp()
+        + ".trace.json";
+    coral::timeline::Enable((traceDir/traceFileName).string());
+    coral::timeline::SetProcessName(traceFilePrefix);
+    CORAL_LOG_DEBUG("Timeline tracing enabled, output file: " + traceFileName);
+}
+
+
+void coral::util::AddMetricsOptions(
+    boost::program_options::options_description& options)
+{
+    namespace po = boost::program_options;
+    options.add_options()
+        ("metrics-file", po::value<std::string>(),
+            "Periodically write performance metrics to the given file, in the "
+            "Prometheus text format.")
+        ("metrics-port", po::value<std::uint16_t>(),
+            "Serve performance metrics over HTTP on the given port on the "
+            "loopback interface, for scraping by Prometheus.")
+        ("metrics-interval", po::value<int>()->default_value(1000),
+            "How often to write the metrics file, in milliseconds.")
+        ;
+}
+
+
+std::unique_ptr<coral::metrics::Exporter> coral::util::UseMetricsArguments(
+    const boost::program_options::variables_map& arguments)
+{
+    const auto outputFile = arguments.count("metrics-file")
+        ? arguments["metrics-file"].as<std::string>()
+        : std::string();
+    const auto httpPort = arguments.count("metrics-port")
+        ? arguments["metrics-port"].as<std::uint16_t>()
+        : std::uint16_t(0);
+    if (outputFile.empty() && httpPort == 0) return nullptr;
+    const auto interval = arguments["metrics-interval"].as<int>();
+    if (interval <= 0) {
+        throw std::runtime_error("Invalid metrics-interval value");
+    }
+    return std::make_unique<coral::metrics::Exporter>(
+        outputFile, httpPort, std::chrono::milliseconds(interval));
+}
+
+
+std::unique_ptr<coral::metrics::Exporter> coral::util::UseMetricsEnvironment(
+    const std::string& metricsFilePrefix)
+{
+    const auto metricsDirEnv = std::getenv("CORAL_METRICS_DIR");
+    if (!metricsDirEnv || !*metricsDirEnv) return nullptr;
+
+    const auto metricsDir = boost::filesystem::path(metricsDirEnv);
+    if (!boost::filesystem::exists(metricsDir)) {
+        boost::filesystem::create_directories(metricsDir);
+    }
+    const auto metricsFileName =
+        metricsFilePrefix + "_" + std::to_string(getpid()) + ".prom";
+    CORAL_LOG_DEBUG("Metrics export enabled, output file: " + metricsFileName);
+    return std::make_unique<coral::metrics::Exporter>(
+        (metricsDir/metricsFileName).string(),
+        0,
+        std::chrono::seconds(1));
+}
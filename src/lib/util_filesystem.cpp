@@ -6,9 +6,24 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <coral/util/filesystem.hpp>
 
+#include <cassert>
+#include <stdexcept>
+#include <system_error>
 #include <utility>
 #include <boost/filesystem.hpp>
 
+#ifdef _WIN32
+#   include <Windows.h>
+#else
+#   include <cerrno>
+#   include <fcntl.h>
+#   include <sys/file.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#include <coral/error.hpp>
+
 
 namespace coral
 {
@@ -66,4 +81,146 @@ void coral::util::TempDir::DeleteNoexcept() noexcept
 }
 
 
+#ifdef _WIN32
+
+coral::util::FileLock::FileLock(
+    const boost::filesystem::path& path,
+    FileLockMode mode,
+    bool wait)
+    : m_path{path}
+    , m_handle{CreateFileW(
+        path.wstring().c_str(),
+        GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr)}
+{
+    if (m_handle == INVALID_HANDLE_VALUE) {
+        throw std::system_error(
+            static_cast<int>(GetLastError()),
+            std::system_category(),
+            "Failed to open lock file \"" + path.string() + '"');
+    }
+    DWORD flags = 0;
+    if (mode == FileLockMode::exclusive) flags |= LOCKFILE_EXCLUSIVE_LOCK;
+    if (!wait) flags |= LOCKFILE_FAIL_IMMEDIATELY;
+    OVERLAPPED overlapped = {};
+    if (!LockFileEx(m_handle, flags, 0, MAXDWORD, MAXDWORD, &overlapped)) {
+        const auto e = GetLastError();
+        CloseHandle(m_handle);
+        m_handle = INVALID_HANDLE_VALUE;
+        if (!wait && e == ERROR_LOCK_VIOLATION) return;
+        throw std::system_error(
+            static_cast<int>(e),
+            std::system_category(),
+            "Failed to lock file \"" + path.string() + '"');
+    }
+}
+
+coral::util::FileLock::~FileLock() noexcept
+{
+    // Closing the handle releases the lock.
+    if (m_handle != INVALID_HANDLE_VALUE) CloseHandle(m_handle);
+}
+
+bool coral::util::FileLock::Locked() const noexcept
+{
+    return m_handle != INVALID_HANDLE_VALUE;
+}
+
+bool coral::util::FileLock::IsCurrent() const
+{
+    assert(Locked());
+    const auto current = CreateFileW(
+        m_path.wstring().c_str(),
+        0,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    // This also fails while the file is pending deletion.
+    if (current == INVALID_HANDLE_VALUE) return false;
+    BY_HANDLE_FILE_INFORMATION currentInfo, lockedInfo;
+    const bool ok = GetFileInformationByHandle(current, &currentInfo)
+        && GetFileInformationByHandle(m_handle, &lockedInfo);
+    const auto e = GetLastError();
+    CloseHandle(current);
+    if (!ok) {
+        throw std::system_error(
+            static_cast<int>(e),
+            std::system_category(),
+            "Failed to get information about lock file \"" + m_path.string() + '"');
+    }
+    return currentInfo.dwVolumeSerialNumber == lockedInfo.dwVolumeSerialNumber
+        && currentInfo.nFileIndexHigh == lockedInfo.nFileIndexHigh
+        && currentInfo.nFileIndexLow == lockedInfo.nFileIndexLow;
+}
+
+#else
+
+coral::util::FileLock::FileLock(
+    const boost::filesystem::path& path,
+    FileLockMode mode,
+    bool wait)
+    : m_path{path}
+    , m_fd{::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666)}
+{
+    if (m_fd < 0) {
+        throw std::runtime_error(coral::error::ErrnoMessage(
+            "Failed to open lock file \"" + path.string() + '"',
+            errno));
+    }
+    // flock() locks belong to the open file description, so unlike fcntl()
+    // locks, they also exclude each other within a single process.
+    const int operation = (mode == FileLockMode::exclusive ? LOCK_EX : LOCK_SH)
+        | (wait ? 0 : LOCK_NB);
+    int rc = 0;
+    do { rc = ::flock(m_fd, operation); } while (rc != 0 && errno == EINTR);
+    if (rc != 0) {
+        const int e = errno;
+        ::close(m_fd);
+        m_fd = -1;
+        if (!wait && e == EWOULDBLOCK) return;
+        throw std::runtime_error(coral::error::ErrnoMessage(
+            "Failed to lock file \"" + path.string() + '"',
+            e));
+    }
+}
+
+coral::util::FileLock::~FileLock() noexcept
+{
+    // Closing the file releases the lock.
+    if (m_fd >= 0) ::close(m_fd);
+}
+
+bool coral::util::FileLock::Locked() const noexcept
+{
+    return m_fd >= 0;
+}
+
+bool coral::util::FileLock::IsCurrent() const
+{
+    assert(Locked());
+    struct stat lockedStat, currentStat;
+    if (::fstat(m_fd, &lockedStat) != 0) {
+        throw std::runtime_error(coral::error::ErrnoMessage(
+            "Failed to get information about lock file \"" + m_path.string() + '"',
+            errno));
+    }
+    if (::stat(m_path.c_str(), &currentStat) != 0) {
+        if (errno == ENOENT) return false;
+        throw std::runtime_error(coral::error::ErrnoMessage(
+            "Failed to get information about lock file \"" + m_path.string() + '"',
+            errno));
+    }
+    return currentStat.st_dev == lockedStat.st_dev
+        && currentStat.st_ino == lockedStat.st_ino;
+}
+
+#endif
+
+
 }} // namespace
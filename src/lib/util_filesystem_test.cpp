@@ -34,3 +34,47 @@ TEST(coral_util_filesystem, TempDir)
     }
     EXPECT_FALSE(fs::exists(d));
 }
+
+
+TEST(coral_util_filesystem, FileLock)
+{
+    using coral::util::FileLock;
+    using coral::util::FileLockMode;
+    auto tmp = coral::util::TempDir();
+    const auto lockFile = tmp.Path() / "lock";
+    {
+        FileLock exclusive(lockFile, FileLockMode::exclusive);
+        EXPECT_TRUE(exclusive.Locked());
+        EXPECT_TRUE(boost::filesystem::exists(lockFile));
+        EXPECT_FALSE(FileLock(lockFile, FileLockMode::exclusive, false).Locked());
+        EXPECT_FALSE(FileLock(lockFile, FileLockMode::shared, false).Locked());
+    }
+    {
+        FileLock shared1(lockFile, FileLockMode::shared);
+        FileLock shared2(lockFile, FileLockMode::shared, false);
+        EXPECT_TRUE(shared1.Locked());
+        EXPECT_TRUE(shared2.Locked());
+        EXPECT_FALSE(FileLock(lockFile, FileLockMode::exclusive, false).Locked());
+    }
+    EXPECT_TRUE(FileLock(lockFile, FileLockMode::exclusive, false).Locked());
+}
+
+
+TEST(coral_util_filesystem, FileLock_IsCurrent)
+{
+    using coral::util::FileLock;
+    using coral::util::FileLockMode;
+    auto tmp = coral::util::TempDir();
+    const auto lockFile = tmp.Path() / "lock";
+    FileLock lock(lockFile, FileLockMode::exclusive);
+    EXPECT_TRUE(lock.IsCurrent());
+    boost::filesystem::remove(lockFile);
+    EXPECT_FALSE(lock.IsCurrent());
+#ifndef _WIN32
+    // On Windows, the file can't be recreated while it is pending deletion.
+    FileLock newLock(lockFile, FileLockMode::exclusive, false);
+    EXPECT_TRUE(newLock.Locked());
+    EXPECT_TRUE(newLock.IsCurrent());
+    EXPECT_FALSE(lock.IsCurrent());
+#endif
+}
@@ -0,0 +1,61 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/util/histogram.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+
+namespace coral
+{
+namespace util
+{
+
+
+int LogBucketIndex(std::int64_t value) noexcept
+{
+    assert(value >= 0);
+    if (value < 4) return static_cast<int>(value);
+    int e = 0;
+    for (auto v = value; v > 1; v >>= 1) ++e;
+    const auto sub = static_cast<int>((value >> (e - 2)) & 3);
+    return 4 * (e - 1) + sub;
+}
+
+
+std::int64_t LogBucketMax(int index) noexcept
+{
+    if (index < 4) return index;
+    const auto e = index / 4 + 1;
+    const auto sub = static_cast<std::int64_t>(index % 4);
+    return ((5 + sub) << (e - 2)) - 1;
+}
+
+
+std::int64_t LogBucketQuantile(
+    const std::uint64_t* buckets,
+    std::size_t bucketCount,
+    std::uint64_t count,
+    double q) noexcept
+{
+    assert(q >= 0.0 && q <= 1.0);
+    if (count == 0) return 0;
+    const auto rank = std::max(
+        static_cast<std::uint64_t>(std::ceil(q * count)),
+        std::uint64_t(1));
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < bucketCount; ++i) {
+        cumulative += buckets[i];
+        if (cumulative >= rank) return LogBucketMax(static_cast<int>(i));
+    }
+    assert(false);
+    return LogBucketMax(static_cast<int>(bucketCount) - 1);
+}
+
+
+}} // namespace
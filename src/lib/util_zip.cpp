@@ -6,11 +6,18 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <coral/util/zip.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cerrno>
+#include <cstdio>
 #include <cstring>
-#include <fstream>
+#include <exception>
+#include <ios>
+#include <mutex>
+#include <string>
 #include <system_error>
+#include <thread>
 #include <vector>
 
 #include <zip.h>
@@ -85,6 +92,7 @@ Archive::Archive(const boost::filesystem::path& path)
 
 Archive::Archive(Archive&& other) noexcept
     : m_archive{other.m_archive}
+    , m_path(std::move(other.m_path))
 {
     other.m_archive = nullptr;
 }
@@ -94,6 +102,7 @@ Archive& Archive::operator=(Archive&& other) noexcept
 {
     Discard();
     m_archive = other.m_archive;
+    m_path = std::move(other.m_path);
     other.m_archive = nullptr;
     return *this;
 }
@@ -118,6 +127,7 @@ void Archive::Open(const boost::filesystem::path& path)
         throw Exception(msgBuf.data());
     }
     m_archive = archive;
+    m_path = path;
 }
 
 
@@ -133,6 +143,7 @@ void Archive::Discard() noexcept
     if (m_archive) {
         zip_discard(m_archive);
         m_archive = nullptr;
+        m_path.clear();
     }
 }
 
@@ -191,21 +202,98 @@ bool Archive::IsDirEntry(EntryIndex index) const
 }
 
 
+std::uint64_t Archive::EntrySize(EntryIndex index) const
+{
+    CORAL_PRECONDITION_CHECK(IsOpen());
+    struct zip_stat zs;
+    if (zip_stat_index(m_archive, index, 0, &zs)) {
+        throw Exception(m_archive);
+    }
+    if (!(zs.valid & ZIP_STAT_SIZE)) {
+        throw Exception("Cannot determine entry size");
+    }
+    return zs.size;
+}
+
+
+std::uint32_t Archive::EntryCRC(EntryIndex index) const
+{
+    CORAL_PRECONDITION_CHECK(IsOpen());
+    struct zip_stat zs;
+    if (zip_stat_index(m_archive, index, 0, &zs)) {
+        throw Exception(m_archive);
+    }
+    if (!(zs.valid & ZIP_STAT_CRC)) {
+        throw Exception("Cannot determine entry checksum");
+    }
+    return zs.crc;
+}
+
+
 namespace
 {
-    void Copy(
-        ZipFile& source,
-        std::ostream& target,
-        std::vector<char>& buffer)
+    // The size of the buffer through which files are extracted.  The target
+    // files are unbuffered, so this is also the size of each write.
+    const std::size_t EXTRACTION_BUFFER_SIZE = 1024*1024;
+
+    // When the number of threads is chosen automatically, each thread gets
+    // at least this many bytes to extract.
+    const std::uint64_t MIN_BYTES_PER_THREAD = 16*1024*1024;
+
+    // A simple RAII class that manages a std::FILE*.
+    class OutputFile
     {
-        assert(target.good());
-        assert(!buffer.empty());
-        for (;;) {
-            const auto n = source.Read(buffer.data(), buffer.size());
-            if (n == 0) break;
-            target.write(buffer.data(), n);
+    public:
+        explicit OutputFile(const boost::filesystem::path& path)
+            : m_path(path)
+#ifdef _WIN32
+            , m_file{_wfopen(path.wstring().c_str(), L"wb")}
+#else
+            , m_file{std::fopen(path.string().c_str(), "wb")}
+#endif
+        {
+            if (m_file == nullptr) {
+                const int e = errno;
+                throw std::runtime_error(coral::error::ErrnoMessage(
+                    "Error opening file \"" + path.string() + "\" for writing",
+                    e));
+            }
+            // We always write large blocks, so buffering would only add
+            // an extra copy.
+            std::setvbuf(m_file, nullptr, _IONBF, 0);
+        }
+
+        OutputFile(const OutputFile&) = delete;
+        OutputFile& operator=(const OutputFile&) = delete;
+
+        ~OutputFile() noexcept
+        {
+            if (m_file) std::fclose(m_file);
+        }
+
+        void Write(const char* data, std::size_t size)
+        {
+            if (std::fwrite(data, 1, size, m_file) != size) Fail();
+        }
+
+        void Close()
+        {
+            const auto rc = std::fclose(m_file);
+            m_file = nullptr;
+            if (rc != 0) Fail();
         }
-    }
+
+    private:
+        void Fail()
+        {
+            throw std::runtime_error(
+                "An I/O error occurred during extraction of \""
+                + m_path.string() + '"');
+        }
+
+        boost::filesystem::path m_path;
+        std::FILE* m_file;
+    };
 
     void ExtractFileAs(
         ::zip* archive,
@@ -219,27 +307,59 @@ namespace
         assert(!buffer.empty());
 
         ZipFile srcFile(archive, index, 0);
-        std::ofstream tgtFile(
-            targetPath.string(),
-            std::ios_base::binary | std::ios_base::trunc);
-        if (!tgtFile.is_open()) {
-            const int e = errno;
-            throw std::runtime_error(coral::error::ErrnoMessage(
-                "Error opening file \"" + targetPath.string() + "\" for writing",
-                e));
-        }
-        Copy(srcFile, tgtFile, buffer);
-        if (tgtFile.fail()) {
-            throw std::runtime_error(
-                "An I/O error occurred during extraction of \""
-                + targetPath.string() + '"');
+        OutputFile tgtFile(targetPath);
+        for (;;) {
+            const auto n = srcFile.Read(buffer.data(), buffer.size());
+            if (n == 0) break;
+            tgtFile.Write(buffer.data(), n);
         }
+        tgtFile.Close();
     }
+
+    struct ExtractionTask
+    {
+        EntryIndex index;
+        std::uint64_t size;
+        boost::filesystem::path targetPath;
+    };
 }
 
 
 void Archive::ExtractAll(
     const boost::filesystem::path& targetDir) const
+{
+    ExtractAll(targetDir, 1);
+}
+
+
+void Archive::ExtractAll(
+    const boost::filesystem::path& targetDir,
+    unsigned threadCount) const
+{
+    ExtractMatching(std::vector<std::string>{std::string()}, targetDir, threadCount);
+}
+
+
+namespace
+{
+    bool HasAnyPrefix(
+        const std::string& name,
+        const std::vector<std::string>& prefixes)
+    {
+        return std::any_of(
+            prefixes.begin(),
+            prefixes.end(),
+            [&name] (const std::string& prefix) {
+                return name.compare(0, prefix.size(), prefix) == 0;
+            });
+    }
+}
+
+
+void Archive::ExtractMatching(
+    const std::vector<std::string>& prefixes,
+    const boost::filesystem::path& targetDir,
+    unsigned threadCount) const
 {
     CORAL_PRECONDITION_CHECK(IsOpen());
     if (!boost::filesystem::exists(targetDir) ||
@@ -248,22 +368,86 @@ void Archive::ExtractAll(
         throw std::ios_base::failure("Not a directory: " + targetDir.string());
     }
 
-    auto buffer = std::vector<char>(4096*16);
+    // Make a list of files and create the directories up front, so the
+    // threads only have to write files.
+    std::vector<ExtractionTask> tasks;
+    std::uint64_t totalSize = 0;
     const auto entryCount = EntryCount();
     for (EntryIndex index = 0; index < entryCount; ++index) {
         const auto entryName = EntryName(index);
-        if (!entryName.empty() && entryName.back() != '/') {
+        if (!entryName.empty() && entryName.back() != '/' &&
+            HasAnyPrefix(entryName, prefixes))
+        {
             const auto entryPath = boost::filesystem::path(entryName);
             if (entryPath.has_root_path()) {
                 throw Exception(
                     "Archive contains an entry with an absolute path: "
                     + entryName);
             }
+            struct zip_stat zs;
+            if (zip_stat_index(m_archive, index, 0, &zs)) {
+                throw Exception(m_archive);
+            }
+            const std::uint64_t size = (zs.valid & ZIP_STAT_SIZE) ? zs.size : 0;
             const auto targetPath = targetDir / entryPath;
             boost::filesystem::create_directories(targetPath.parent_path());
-            ExtractFileAs(m_archive, index, targetPath, buffer);
+            tasks.push_back(ExtractionTask{index, size, targetPath});
+            totalSize += size;
+        }
+    }
+    std::sort(
+        tasks.begin(),
+        tasks.end(),
+        [] (const ExtractionTask& a, const ExtractionTask& b) {
+            return a.size > b.size;
+        });
+
+    if (threadCount == 0) {
+        threadCount = static_cast<unsigned>(std::min<std::uint64_t>(
+            std::max(std::thread::hardware_concurrency(), 1u),
+            std::max<std::uint64_t>(totalSize / MIN_BYTES_PER_THREAD, 1)));
+    }
+    threadCount = static_cast<unsigned>(std::max<std::size_t>(
+        std::min<std::size_t>(threadCount, tasks.size()),
+        1));
+
+    std::atomic<std::size_t> nextTask{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    const auto extract = [&] (::zip* archive) noexcept {
+        try {
+            auto buffer = std::vector<char>(EXTRACTION_BUFFER_SIZE);
+            for (auto i = nextTask++; i < tasks.size() && !failed; i = nextTask++) {
+                ExtractFileAs(archive, tasks[i].index, tasks[i].targetPath, buffer);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) error = std::current_exception();
+            failed = true;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try {
+        for (unsigned t = 1; t < threadCount; ++t) {
+            threads.emplace_back([&] () {
+                try {
+                    const auto threadArchive = Archive(m_path);
+                    extract(threadArchive.m_archive);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error) error = std::current_exception();
+                    failed = true;
+                }
+            });
         }
+    } catch (const std::system_error&) {
+        // Couldn't start another thread; the ones we have will do the job.
     }
+    extract(m_archive);
+    for (auto& t : threads) t.join();
+    if (error) std::rethrow_exception(error);
 }
 
 
@@ -274,7 +458,7 @@ boost::filesystem::path Archive::ExtractFileTo(
     CORAL_PRECONDITION_CHECK(IsOpen());
     const auto entryPath = boost::filesystem::path(EntryName(index));
     const auto targetPath = targetDir / entryPath.filename();
-    auto buffer = std::vector<char>(4096*16);
+    auto buffer = std::vector<char>(EXTRACTION_BUFFER_SIZE);
     ExtractFileAs(m_archive, index, targetPath, buffer);
     return targetPath;
 }
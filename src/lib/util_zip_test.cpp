@@ -55,6 +55,11 @@ TEST(coral_util_zip, Archive)
     ASSERT_FALSE(archive.IsDirEntry(binIndex));
     ASSERT_FALSE(archive.IsDirEntry(txtIndex));
     ASSERT_THROW(archive.IsDirEntry(invIndex), dz::Exception);
+    ASSERT_EQ(binSize, archive.EntrySize(binIndex));
+    ASSERT_EQ(txtSize, archive.EntrySize(txtIndex));
+    ASSERT_EQ(0u, archive.EntryCRC(dirIndex));
+    ASSERT_NE(archive.EntryCRC(binIndex), archive.EntryCRC(txtIndex));
+    ASSERT_THROW(archive.EntrySize(invIndex), dz::Exception);
 
     // Extract entire archive
     {
@@ -74,6 +79,33 @@ TEST(coral_util_zip, Archive)
         ASSERT_THROW(archive.ExtractFileTo(binIndex, tempDir.Path()/"nonexistent"), std::runtime_error);
     }
 
+    // Extract entire archive with several threads, and with an automatically
+    // chosen number of threads
+    for (const unsigned threads : {4u, 0u}) {
+        du::TempDir tempDir;
+        archive.ExtractAll(tempDir.Path(), threads);
+        const auto dirExtracted = tempDir.Path() / dirName;
+        const auto binExtracted = tempDir.Path() / binName;
+        const auto txtExtracted = tempDir.Path() / txtName;
+        ASSERT_TRUE(fs::is_directory(dirExtracted));
+        ASSERT_EQ(binSize, fs::file_size(binExtracted));
+        ASSERT_EQ(txtSize, fs::file_size(txtExtracted));
+        ASSERT_THROW(
+            archive.ExtractAll(tempDir.Path()/"nonexistent", threads),
+            std::runtime_error);
+    }
+
+    // Extract a subdirectory only
+    {
+        du::TempDir tempDir;
+        archive.ExtractMatching({dirName}, tempDir.Path(), 0);
+        ASSERT_EQ(binSize, fs::file_size(tempDir.Path() / binName));
+        ASSERT_FALSE(fs::exists(tempDir.Path() / txtName));
+        archive.ExtractMatching({"no such entry"}, tempDir.Path(), 0);
+        archive.ExtractMatching({txtName, "images/x"}, tempDir.Path(), 0);
+        ASSERT_EQ(txtSize, fs::file_size(tempDir.Path() / txtName));
+    }
+
     // Extract individual entries
     {
         du::TempDir tempDir;
@@ -66,13 +66,42 @@ namespace
     typedef std::multimap<std::string, coral::master::ProviderCluster::SlaveType>
         SlaveTypeMap;
 
-    // Obtains the list of available slave types on the network and returns it
-    // in the form of a map where the keys are slave type names and the values
-    // are slave type descriptions.
-    SlaveTypeMap SlaveTypesByName(coral::master::ProviderCluster& providers)
+    // Returns the names of the slave types used in a system configuration.
+    std::set<std::string> SlaveTypeNames(const boost::property_tree::ptree& ptree)
     {
+        std::set<std::string> slaveTypes;
+        const auto slaveTree = ptree.get_child("slaves", boost::property_tree::ptree());
+        for (const auto& slaveNode : slaveTree) {
+            slaveTypes.insert(slaveNode.second.get<std::string>("type"));
+        }
+        return slaveTypes;
+    }
+
+
+    // Waits up to `discoveryTimeout` for the slave types used in a system
+    // configuration to become available, obtains their descriptions and
+    // returns them in the form of a map where the keys are slave type names
+    // and the values are slave type descriptions.  Full descriptions are
+    // only requested for the slave types that are used, and missing types
+    // are simply left out of the map.
+    SlaveTypeMap SlaveTypesByName(
+        coral::master::ProviderCluster& providers,
+        const boost::property_tree::ptree& ptree,
+        std::chrono::milliseconds discoveryTimeout)
+    {
+        const auto names = SlaveTypeNames(ptree);
+        providers.WaitForSlaveTypes(
+            std::vector<std::string>(names.begin(), names.end()),
+            discoveryTimeout);
+        std::vector<std::string> uuids;
+        for (const auto& st : providers.GetSlaveTypeCatalog(std::chrono::seconds(1))) {
+            if (names.count(st.description.Name())) {
+                uuids.push_back(st.description.UUID());
+            }
+        }
         SlaveTypeMap types;
-        for (const auto& st : providers.GetSlaveTypes(std::chrono::seconds(1))) {
+        if (uuids.empty()) return types;
+        for (const auto& st : providers.GetSlaveTypes(uuids, std::chrono::seconds(1))) {
             types.insert(std::make_pair(st.description.Name(), st));
         }
         return types;
@@ -125,10 +154,51 @@ namespace
     struct VariableConnection
     {
         coral::model::VariableID inputId;
-        std::string otherSlaveName;
-        coral::model::VariableID otherOutputId;
+        // The names of the slaves and the IDs of the outputs.  There is only
+        // one of them, unless `aggregation` is not NO_AGGREGATION.
+        std::vector<std::pair<std::string, coral::model::VariableID>> outputs;
+        coral::model::Aggregation aggregation;
+        coral::model::LinearTransform transform;
     };
 
+
+    bool IsTransformSetting(const std::string& key)
+    {
+        return key == "gain" || key == "offset";
+    }
+
+
+    // Parses the optional gain and offset of a connection, which are given
+    // as children of its node, e.g.:
+    //
+    //     mass.force  spring.force { gain 0.001 }
+    //
+    coral::model::LinearTransform ParseConnectionTransform(
+        const boost::property_tree::ptree& connSettings)
+    {
+        try {
+            return coral::model::LinearTransform(
+                connSettings.get<double>("gain", 1.0),
+                connSettings.get<double>("offset", 0.0));
+        } catch (const boost::property_tree::ptree_error& e) {
+            throw std::runtime_error(
+                std::string("Invalid gain or offset (") + e.what() + ")");
+        }
+    }
+
+
+    // Returns the aggregation with the given name, or NO_AGGREGATION if
+    // `name` is not the name of an aggregation.
+    coral::model::Aggregation ParseAggregation(const std::string& name)
+    {
+        if (name == "sum")  return coral::model::SUM_AGGREGATION;
+        if (name == "min")  return coral::model::MIN_AGGREGATION;
+        if (name == "max")  return coral::model::MAX_AGGREGATION;
+        if (name == "mean") return coral::model::MEAN_AGGREGATION;
+        return coral::model::NO_AGGREGATION;
+    }
+
+
     // Variable name lookup could take a long time for slave types with a
     // large number of variables, because coral::master::ProviderCluster::SlaveType
     // stores the variable descriptions in a vector.  Therefore, we cache the
@@ -233,33 +303,69 @@ namespace
         const auto connTree = ptree.get_child("connections", boost::property_tree::ptree());
         try {
             for (const auto& connNode : connTree) {
+                // A connection is either on the form
+                //     <input> <output> { <settings> }
+                // or, if the input is given an aggregate of several outputs,
+                //     <input> <aggregation> { <outputs and settings> }
+                // where the settings are optional in both cases.
                 const auto inputSpec = SplitVarSpec(connNode.first);
-                const auto outputSpec = SplitVarSpec(connNode.second.data());
+                const auto aggregation = ParseAggregation(connNode.second.data());
                 try {
+                    std::vector<std::pair<std::string, std::string>> outputSpecs;
+                    if (aggregation == coral::model::NO_AGGREGATION) {
+                        outputSpecs.push_back(SplitVarSpec(connNode.second.data()));
+                    }
+                    for (const auto& setting : connNode.second) {
+                        if (IsTransformSetting(setting.first)) continue;
+                        if (aggregation == coral::model::NO_AGGREGATION) {
+                            throw std::runtime_error(
+                                "Unknown connection setting: " + setting.first);
+                        }
+                        outputSpecs.push_back(SplitVarSpec(setting.first));
+                    }
+                    if (outputSpecs.empty()) {
+                        throw std::runtime_error("No outputs to aggregate");
+                    }
+
                     const auto inputSlaveType = GetSlaveType(slaves, inputSpec.first);
-                    const auto outputSlaveType = GetSlaveType(slaves, outputSpec.first);
                     const auto inputVarDesc = GetCachedVarDescription(
                         inputSlaveType, inputSpec.second, varDescriptionCache);
-                    const auto outputVarDesc = GetCachedVarDescription(
-                        outputSlaveType, outputSpec.second, varDescriptionCache);
-                    if (inputVarDesc->DataType() != outputVarDesc->DataType()) {
-                        throw std::runtime_error("Incompatible data types");
-                    }
                     if (inputVarDesc->Causality() != coral::model::INPUT_CAUSALITY) {
                         throw std::runtime_error("Not an input variable: " + inputVarDesc->Name());
                     }
-                    if (outputVarDesc->Causality() != coral::model::OUTPUT_CAUSALITY) {
-                        throw std::runtime_error("Not an output variable: " + outputVarDesc->Name());
-                    }
                     VariableConnection vc;
                     vc.inputId = inputVarDesc->ID();
-                    vc.otherSlaveName = outputSpec.first;
-                    vc.otherOutputId = outputVarDesc->ID();
+                    vc.aggregation = aggregation;
+                    vc.transform = ParseConnectionTransform(connNode.second);
+                    if (inputVarDesc->DataType() != coral::model::REAL_DATATYPE) {
+                        if (!vc.transform.IsIdentity()) {
+                            throw std::runtime_error(
+                                "Gain and offset can only be specified for real variables");
+                        }
+                        if (aggregation != coral::model::NO_AGGREGATION) {
+                            throw std::runtime_error(
+                                "Only real variables can be given an aggregate");
+                        }
+                    }
+                    for (const auto& outputSpec : outputSpecs) {
+                        const auto outputSlaveType = GetSlaveType(slaves, outputSpec.first);
+                        const auto outputVarDesc = GetCachedVarDescription(
+                            outputSlaveType, outputSpec.second, varDescriptionCache);
+                        if (inputVarDesc->DataType() != outputVarDesc->DataType()) {
+                            throw std::runtime_error("Incompatible data types");
+                        }
+                        if (outputVarDesc->Causality() != coral::model::OUTPUT_CAUSALITY) {
+                            throw std::runtime_error("Not an output variable: " + outputVarDesc->Name());
+                        }
+                        vc.outputs.push_back(
+                            std::make_pair(outputSpec.first, outputVarDesc->ID()));
+                        if (warningLog) {
+                            connectedVars[outputSpec.first].insert(outputSpec.second);
+                        }
+                    }
                     connections[inputSpec.first].push_back(vc);
-
                     if (warningLog) {
                         connectedVars[inputSpec.first].insert(inputSpec.second);
-                        connectedVars[outputSpec.first].insert(outputSpec.second);
                     }
                 } catch (const std::runtime_error& e) {
                     throw std::runtime_error("In connection between "
@@ -367,11 +473,12 @@ void ParseSystemConfig(
     std::vector<SimulationEvent>& scenarioOut,
     std::chrono::milliseconds commTimeout,
     std::chrono::milliseconds instantiationTimeout,
+    std::chrono::milliseconds discoveryTimeout,
     std::ostream* warningLog,
     std::function<void()> postInstantiationHook)
 {
     const auto ptree = ReadPtreeInfoFile(path);
-    const auto slaveTypes = SlaveTypesByName(providers);
+    const auto slaveTypes = SlaveTypesByName(providers, ptree, discoveryTimeout);
 
     std::map<std::string, const coral::master::ProviderCluster::SlaveType*> slaves;
     std::map<std::string, std::vector<VariableValue>> variables;
@@ -385,14 +492,36 @@ void ParseSystemConfig(
     std::vector<std::string> scenarioEventSlaveName; // We don't know IDs yet, so we keep a parallel list of names
     ParseScenarioNode(ptree, slaves, warningLog, scenario, scenarioEventSlaveName, varDescriptionCache);
 
-    // Instantiate the slaves
+    // Instantiate the slaves, with one request per slave type.
+    std::vector<coral::master::ProviderCluster::InstantiationRequest> instantiations;
+    std::map<const coral::master::ProviderCluster::SlaveType*, std::size_t> instantiationIndices;
+    for (const auto& slave : slaves) {
+        const auto index = instantiationIndices.insert(
+            std::make_pair(slave.second, instantiations.size()));
+        if (index.second) {
+            instantiations.push_back({
+                slave.second->providers.front(),
+                slave.second->description.UUID(),
+                0});
+        }
+        ++instantiations[index.first->second].count;
+    }
+    const auto locators =
+        providers.InstantiateSlaves(instantiations, instantiationTimeout);
+
+    // The locators come in the order of the requests, so we keep track of
+    // where the next one of each type is.
+    std::vector<std::size_t> nextLocator;
+    std::size_t locatorOffset = 0;
+    for (const auto& inst : instantiations) {
+        nextLocator.push_back(locatorOffset);
+        locatorOffset += inst.count;
+    }
     std::vector<coral::master::AddedSlave> slavesToAdd;
     for (const auto& slave : slaves) {
         slavesToAdd.emplace_back();
-        slavesToAdd.back().locator = providers.InstantiateSlave(
-            slave.second->providers.front(),
-            slave.second->description.UUID(),
-            instantiationTimeout);
+        slavesToAdd.back().locator =
+            locators[nextLocator[instantiationIndices[slave.second]]++];
         slavesToAdd.back().name = slave.first;
     }
     if (postInstantiationHook) postInstantiationHook();
@@ -453,11 +582,17 @@ void ParseSystemConfig(
         }
         auto& sc = slaveConfigs[index->second];
         for (const auto& conn : slaveConns.second) {
-            sc.variableSettings.emplace_back(
-                conn.inputId,
-                coral::model::Variable(
-                    slaveIDs.at(conn.otherSlaveName),
-                    conn.otherOutputId));
+            std::vector<coral::model::Variable> outputs;
+            for (const auto& output : conn.outputs) {
+                outputs.emplace_back(slaveIDs.at(output.first), output.second);
+            }
+            if (conn.aggregation == coral::model::NO_AGGREGATION) {
+                sc.variableSettings.emplace_back(
+                    conn.inputId, outputs.front(), conn.transform);
+            } else {
+                sc.variableSettings.emplace_back(
+                    conn.inputId, outputs, conn.aggregation, conn.transform);
+            }
         }
     }
     try {
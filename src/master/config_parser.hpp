@@ -39,6 +39,9 @@ struct SimulationEvent
 
 \param [in] path        The path to the configuration file.
 \param [in] execution   The execution controller.
+\param [in] discoveryTimeout
+    How long to wait for slave providers to offer the slave types used in
+    the file.  If some are still missing, an error is reported.
 
 \throws std::runtime_error if there were errors in the configuraiton file.
 */
@@ -51,6 +54,7 @@ void ParseSystemConfig(
     std::vector<SimulationEvent>& scenario,
     std::chrono::milliseconds commTimeout,
     std::chrono::milliseconds instantiationTimeout,
+    std::chrono::milliseconds discoveryTimeout,
     std::ostream* warningLog,
     std::function<void()> postInstantiationHook);
 
@@ -29,6 +29,9 @@ namespace {
     const std::string DEFAULT_NETWORK_INTERFACE = "127.0.0.1";
     const std::uint16_t DEFAULT_DISCOVERY_PORT = 10272;
 
+    // The maximum time we wait for slave providers to be discovered.
+    const auto DISCOVERY_TIMEOUT = std::chrono::seconds(5);
+
     void PrintExecConfigHelp()
     {
         std::cout <<
@@ -112,10 +115,27 @@ namespace {
             ";     <slave A>.<input variable> <slave B>.<output variable>\n"
             "; (To make the order easier to remember, mentally insert an \"equals\" sign\n"
             "; between them.)\n"
+            ";\n"
+            "; Real values can be scaled and shifted on their way from the output to\n"
+            "; the input, i.e., input = gain*output + offset, by giving a gain and/or\n"
+            "; an offset in a subsection.  Both are optional, and default to 1 and 0.\n"
             "connections {\n"
             "    mass.force        spring.force\n"
-            "    spring.position_b mass.position\n"
+            "    spring.position_b mass.position {\n"
+            "        offset 0.5   ; The spring is attached 0.5 m from the mass' centre.\n"
+            "    }\n"
             "}\n"
+            ";\n"
+            "; A real input can also be connected to several outputs, and be given\n"
+            "; their sum, min, max or mean.  The outputs are then listed in a\n"
+            "; subsection, along with the optional gain and offset, which are applied\n"
+            "; to the aggregate value:\n"
+            ";     connections {\n"
+            ";         mass.force  sum {\n"
+            ";             spring.force\n"
+            ";             damper.force\n"
+            ";         }\n"
+            ";     }\n"
             "\n"
             "; This section contains parameter changes that are to take place at a\n"
             "; specific point in time. There is one subsection for each time point.\n"
@@ -129,6 +149,32 @@ namespace {
             "    }\n"
             "}\n";
     }
+
+    // Prints the slaves which have spent the most time in DoStep(), on
+    // average, along with the time they've spent waiting for data.
+    void PrintSlowestSlaves(
+        coral::master::Execution& exec,
+        std::size_t maxCount)
+    {
+        typedef std::pair<coral::model::SlaveID, const coral::master::SlaveStepStatistics*>
+            Entry;
+        const auto stats = exec.StepStatistics();
+        std::vector<Entry> sorted;
+        for (const auto& s : stats) sorted.emplace_back(s.first, &s.second);
+        std::sort(sorted.begin(), sorted.end(), [] (const Entry& a, const Entry& b) {
+            return a.second->doStep.Mean() > b.second->doStep.Mean();
+        });
+        const auto ms = [] (std::chrono::nanoseconds d) { return d.count() * 1e-6; };
+        for (std::size_t i = 0; i < std::min(maxCount, sorted.size()); ++i) {
+            const auto& st = *sorted[i].second;
+            std::cout
+                << "    slave " << sorted[i].first
+                << ": step mean " << ms(st.doStep.Mean())
+                << " ms, p99 " << ms(st.doStep.Percentile(99))
+                << " ms; data wait mean " << ms(st.dataWait.Mean())
+                << " ms" << std::endl;
+        }
+    }
 }
 
 
@@ -138,9 +184,17 @@ int Run(const std::vector<std::string>& args)
         namespace po = boost::program_options;
         po::options_description options("Options");
         options.add_options()
+            ("broadcast-steps",
+                "Broadcast time step commands to all slaves at once, rather than "
+                "sending them to each slave in turn.  This may improve "
+                "performance for large systems.")
             ("debug-pause",
                 "Wait for a user keypress after slaves have been spawned, "
                 "to allow time to attach a debugger.")
+            ("delta-publication",
+                "Make slaves publish only those output values which have changed "
+                "since the previous time step.  This may improve performance for "
+                "models whose outputs are mostly constant.")
             ("interface", po::value<std::string>()->default_value(DEFAULT_NETWORK_INTERFACE),
                 "The IP address or (OS-specific) name of the network interface to "
                 "use for network communications, or \"*\" for all/any.")
@@ -164,6 +218,7 @@ int Run(const std::vector<std::string>& args)
                 "Display a help message about the format of system configuration files "
                 "and exit.");
         coral::util::AddLoggingOptions(options);
+        coral::util::AddMetricsOptions(options);
         po::options_description positionalOptions("Arguments");
         positionalOptions.add_options()
             ("exec-config", po::value<std::string>(),
@@ -183,6 +238,8 @@ int Run(const std::vector<std::string>& args)
             "Runs a simulation.");
         if (!argValues) return 0;
         coral::util::UseLoggingArguments(*argValues, self);
+        coral::util::UseTracingEnvironment(self);
+        const auto metricsExporter = coral::util::UseMetricsArguments(*argValues);
 
         if (argValues->count("help-exec-config")) {
             PrintExecConfigHelp();
@@ -210,12 +267,6 @@ int Run(const std::vector<std::string>& args)
             networkInterface,
             discoveryPort};
 
-        // TODO: Handle this waiting more elegantly, e.g. wait until all required
-        // slave types are available.  Also, the waiting time is related to the
-        // slave provider heartbeat time.
-        std::cout << "Looking for slave providers..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(2));
-
         std::cout << "Parsing execution configuration file '" << execConfigFile
                   << "'" << std::endl;
         const auto execConfig = ParseExecutionConfig(execConfigFile);
@@ -223,6 +274,8 @@ int Run(const std::vector<std::string>& args)
         execOptions.startTime                   = execConfig.startTime;
         execOptions.maxTime                     = execConfig.stopTime;
         execOptions.slaveVariableRecvTimeout    = execConfig.commTimeout;
+        execOptions.broadcastStepCommands       = !!argValues->count("broadcast-steps");
+        execOptions.deltaPublication            = !!argValues->count("delta-publication");
 
         std::cout << "Creating new execution" << std::endl;
         auto exec = coral::master::Execution(execName, execOptions);
@@ -247,6 +300,7 @@ int Run(const std::vector<std::string>& args)
             unsortedScenario,
             execConfig.commTimeout,
             execConfig.instantiationTimeout,
+            DISCOVERY_TIMEOUT,
             warningStream,
             debugPauseCallback);
 
@@ -324,6 +378,7 @@ int Run(const std::vector<std::string>& args)
                 const auto rti = (time - prevSimTime)
                     / ((realTime - prevRealTime).count() * clockRes);
                 std::cout << (nextPerc * 100.0) << "%  RTI=" << rti << std::endl;
+                PrintSlowestSlaves(exec, 3);
                 nextPerc += 0.05;
                 prevRealTime = realTime;
                 prevSimTime = time;
@@ -379,13 +434,10 @@ int List(const std::vector<std::string>& args)
             networkInterface,
             discoveryPort};
 
-        // TODO: Handle this waiting more elegantly, e.g. wait until all required
-        // slave types are available.  Also, the waiting time is related to the
-        // slave provider heartbeat time.
         std::cout << "Looking for slave providers..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(2));
+        providers.WaitForSlaveTypes({}, DISCOVERY_TIMEOUT);
 
-        auto slaveTypes = providers.GetSlaveTypes(std::chrono::seconds(1));
+        auto slaveTypes = providers.GetSlaveTypeCatalog(std::chrono::seconds(1));
         for (const auto& st : slaveTypes) {
             std::cout << st.description.Name() << '\n';
             //CORAL_LOG_TRACE(st.description.Name());
@@ -405,6 +457,26 @@ bool Contains(const std::string& s, char c)
 }
 
 
+// Helper function which looks up a slave type by name in the catalog and
+// returns its full description.
+coral::master::ProviderCluster::SlaveType GetSlaveType(
+    coral::master::ProviderCluster& providers,
+    const std::string& slaveType)
+{
+    const auto catalog = providers.GetSlaveTypeCatalog(std::chrono::seconds(1));
+    const auto it = std::find_if(catalog.begin(), catalog.end(),
+        [&](const coral::master::ProviderCluster::SlaveType& s) {
+            return s.description.Name() == slaveType;
+        });
+    if (it == catalog.end()) {
+        throw std::runtime_error("Unknown slave type: " + slaveType);
+    }
+    return providers.GetSlaveTypes(
+        std::vector<std::string>{it->description.UUID()},
+        std::chrono::seconds(1)).front();
+}
+
+
 int LsVars(const std::vector<std::string>& args)
 {
     try {
@@ -461,20 +533,9 @@ int LsVars(const std::vector<std::string>& args)
             networkInterface,
             discoveryPort};
 
-        // TODO: Handle this waiting more elegantly, e.g. wait until all required
-        // slave types are available.  Also, the waiting time is related to the
-        // slave provider heartbeat time.
-        std::this_thread::sleep_for(std::chrono::seconds(2));
-
-        const auto slaveTypes = providers.GetSlaveTypes(std::chrono::seconds(1));
-        const auto it = std::find_if(slaveTypes.begin(), slaveTypes.end(),
-            [&](const coral::master::ProviderCluster::SlaveType& s) {
-                return s.description.Name() == slaveType;
-            });
-        if (it == slaveTypes.end()) {
-            throw std::runtime_error("Unknown slave type: " + slaveType);
-        }
-        // `it` is now an iterator which points to the slave type.
+        providers.WaitForSlaveTypes({slaveType}, DISCOVERY_TIMEOUT);
+
+        const auto slaveTypeInfo = GetSlaveType(providers, slaveType);
 
         // Create mappings from enums to characters specified in options.
         std::map<coral::model::DataType, char> typeChar;
@@ -496,7 +557,7 @@ int LsVars(const std::vector<std::string>& args)
         variabilityChar[coral::model::CONTINUOUS_VARIABILITY] = 'u';
 
         // Finally, list the variables
-        for (const auto& v : it->description.Variables()) {
+        for (const auto& v : slaveTypeInfo.description.Variables()) {
             const auto vt = typeChar.at(v.DataType());
             const auto vc = causalityChar.at(v.Causality());
             const auto vv = variabilityChar.at(v.Variability());
@@ -554,44 +615,35 @@ int Info(const std::vector<std::string>& args)
             networkInterface,
             discoveryPort};
 
-        // TODO: Handle this waiting more elegantly, e.g. wait until all required
-        // slave types are available.  Also, the waiting time is related to the
-        // slave provider heartbeat time.
         std::cout << "Looking for slave providers..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(2));
-
-        const auto slaveTypes = providers.GetSlaveTypes(std::chrono::seconds(1));
-        const auto it = std::find_if(slaveTypes.begin(), slaveTypes.end(),
-            [&](const coral::master::ProviderCluster::SlaveType& s) {
-                return s.description.Name() == slaveType; });
-        if (it == slaveTypes.end()) {
-            throw std::runtime_error("Unknown slave type: " + slaveType);
-        }
-        std::cout << "\nname " << it->description.Name() << '\n'
-                  << "uuid " << it->description.UUID() << '\n'
-                  << "description " << it->description.Description() << '\n'
-                  << "author " << it->description.Author() << '\n'
-                  << "version " << it->description.Version() << '\n'
+        providers.WaitForSlaveTypes({slaveType}, DISCOVERY_TIMEOUT);
+
+        const auto slaveTypeInfo = GetSlaveType(providers, slaveType);
+        std::cout << "\nname " << slaveTypeInfo.description.Name() << '\n'
+                  << "uuid " << slaveTypeInfo.description.UUID() << '\n'
+                  << "description " << slaveTypeInfo.description.Description() << '\n'
+                  << "author " << slaveTypeInfo.description.Author() << '\n'
+                  << "version " << slaveTypeInfo.description.Version() << '\n'
                   << "parameters {\n";
-        for (const auto& v : it->description.Variables()) {
+        for (const auto& v : slaveTypeInfo.description.Variables()) {
             if (v.Causality() == coral::model::PARAMETER_CAUSALITY) {
                 std::cout << "  " << v.Name() << "\n";
             }
         }
         std::cout << "}\ninputs {\n";
-        for (const auto& v : it->description.Variables()) {
+        for (const auto& v : slaveTypeInfo.description.Variables()) {
             if (v.Causality() == coral::model::INPUT_CAUSALITY) {
                 std::cout << "  " << v.Name() << "\n";
             }
         }
         std::cout << "}\noutputs {\n";
-        for (const auto& v : it->description.Variables()) {
+        for (const auto& v : slaveTypeInfo.description.Variables()) {
             if (v.Causality() == coral::model::OUTPUT_CAUSALITY) {
                 std::cout << "  " << v.Name() << "\n";
             }
         }
         std::cout << "}\nproviders {\n";
-        for (const auto& p : it->providers) {
+        for (const auto& p : slaveTypeInfo.providers) {
             std::cout << "  " << p << "\n";
         }
         std::cout << "}" << std::endl;
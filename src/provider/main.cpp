@@ -4,13 +4,19 @@ This Source Code Form is subject to the terms of the Mozilla Public
 License, v. 2.0. If a copy of the MPL was not distributed with this
 file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <exception>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <boost/algorithm/string/join.hpp>
@@ -20,6 +26,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <zmq.hpp>
 
 #include <coral/fmi/fmu.hpp>
+#include <coral/fmi/import_index.hpp>
 #include <coral/fmi/importer.hpp>
 #include <coral/log.hpp>
 #include <coral/net.hpp>
@@ -42,12 +49,38 @@ namespace
 }
 
 
+// An importer which is shared by all the slave creators.  The slave provider
+// may use different slave creators concurrently, so access to the importer
+// must be serialised.
+struct SharedImporter
+{
+    explicit SharedImporter(std::shared_ptr<coral::fmi::Importer> importer_)
+        : importer(std::move(importer_))
+    { }
+
+    std::shared_ptr<coral::fmi::Importer> importer;
+    std::mutex mutex;
+};
+
+
+// Writes a message to a console stream.  The slave provider may use
+// different slave creators concurrently, so their output is written under a
+// lock, one whole message at a time.
+void PrintLocked(std::ostream& stream, const std::string& message)
+{
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    stream << message << std::flush;
+}
+
+
 struct MySlaveCreator : public coral::provider::SlaveCreator
 {
 public:
     MySlaveCreator(
-        coral::fmi::Importer& importer,
         const boost::filesystem::path& fmuPath,
+        const coral::model::SlaveTypeDescription& description,
+        std::shared_ptr<SharedImporter> importer,
         const coral::net::ip::Address& networkInterface,
         const std::string& slaveExe,
         std::chrono::seconds masterInactivityTimeout,
@@ -56,9 +89,11 @@ public:
         const std::string& logLevel,
         bool enableFileLogging,
         const std::string& logFileDir,
-        bool createConsoles)
+        bool createConsoles,
+        int warmSlaveCount)
         : m_fmuPath{fmuPath}
-        , m_fmu{importer.Import(fmuPath)}
+        , m_description(description)
+        , m_importer{importer}
         , m_networkInterface{networkInterface}
         , m_slaveExe(slaveExe)
         , m_masterInactivityTimeout{masterInactivityTimeout}
@@ -68,12 +103,16 @@ public:
         , m_enableFileLogging(enableFileLogging)
         , m_logFileDir(logFileDir)
         , m_createConsoles(createConsoles)
+        , m_warmSlaveCount(warmSlaveCount)
     {
+        // The warm pool is filled the first time a slave of this type is
+        // requested, so that we don't import and unpack every FMU, and
+        // start slaves for all of them, before we even start offering them.
     }
 
     const coral::model::SlaveTypeDescription& Description() const override
     {
-        return m_fmu->Description();
+        return m_description;
     }
 
     bool Instantiate(
@@ -82,71 +121,53 @@ public:
     {
         m_instantiationFailureDescription.clear();
         try {
-            auto slaveStatusSocket = zmq::socket_t(coral::net::zmqx::GlobalContext(), ZMQ_PULL);
-            const auto slaveStatusPort = coral::net::zmqx::BindToEphemeralPort(slaveStatusSocket);
-            const auto slaveStatusEp = "tcp://localhost:" + boost::lexical_cast<std::string>(slaveStatusPort);
-
-            std::vector<std::string> args;
-            args.push_back(m_fmuPath.string());
-            args.push_back("--coralslaveprovider-endpoint=" + slaveStatusEp);
-            args.push_back("--hangaround-time=" + std::to_string(m_masterInactivityTimeout.count()));
-            args.push_back("--interface=" + m_networkInterface.ToString());
-            if (!m_enableOutput) {
-                args.push_back("--no-output");
-            }
-            args.push_back("--output-dir=" + m_outputDir);
-            args.push_back("--log-level=" + m_logLevel);
-            if (m_enableFileLogging) {
-                args.push_back("--log-file");
-                args.push_back("--log-file-dir=" + m_logFileDir);
-            }
+            auto slave = TakeSlave();
+            PrintLocked(std::clog, "Waiting for verification of slave for "
+                + m_fmuPath.string() + "...\n");
+            slaveLocator = AwaitSlave(slave, timeout);
+            PrintLocked(std::clog, "Slave for " + m_fmuPath.string() + " OK\n");
+            RefillPool();
+            return true;
+        } catch (const std::exception& e) {
+            m_instantiationFailureDescription = e.what();
+            RefillPool();
+            return false;
+        }
+    }
 
-            auto processOptions = coral::util::ProcessOptions::none;
-            if (m_createConsoles) processOptions |= coral::util::ProcessOptions::createNewConsole;
-
-            std::cout << "\nStarting slave...\n"
-                << "  FMU       : " << m_fmuPath << '\n'
-                << std::flush;
-            CORAL_LOG_DEBUG(boost::format("Starting process: %s %s")
-                % m_slaveExe % boost::algorithm::join(args, " "));
-            coral::util::SpawnProcess(m_slaveExe, args, processOptions);
-
-            std::clog << "Waiting for verification..." << std::flush;
-            std::vector<zmq::message_t> slaveStatus;
-            const auto feedbackTimedOut = !coral::net::zmqx::WaitForIncoming(
-                slaveStatusSocket,
-                timeout);
-            if (feedbackTimedOut) {
-                throw std::runtime_error(
-                    "Slave took more than "
-                    + boost::lexical_cast<std::string>(timeout.count())
-                    + " milliseconds to start; presumably it has failed altogether");
+    bool InstantiateBatch(
+        int count,
+        std::chrono::milliseconds timeout,
+        std::vector<coral::net::SlaveLocator>& slaveLocators) override
+    {
+        // Start all the slaves before waiting for any of them, so they
+        // start up in parallel.  Each one still gets at least `timeout` to
+        // report in, since we don't start waiting for it until the ones
+        // before it have done so.
+        m_instantiationFailureDescription.clear();
+        try {
+            std::vector<SlaveProcess> slaves;
+            for (int i = 0; i < count; ++i) {
+                slaves.push_back(TakeSlave());
             }
-            coral::net::zmqx::Receive(slaveStatusSocket, slaveStatus);
-            if (coral::net::zmqx::ToString(slaveStatus[0]) == "ERROR" &&
-                    slaveStatus.size() == 2) {
-                throw std::runtime_error(coral::net::zmqx::ToString(slaveStatus[1]));
-            } else if (coral::net::zmqx::ToString(slaveStatus[0]) != "OK" ||
-                    slaveStatus.size() < 3 ||
-                    slaveStatus[1].size() == 0 ||
-                    slaveStatus[2].size() == 0) {
-                throw std::runtime_error("Invalid data received from slave executable");
+            PrintLocked(std::clog, "Waiting for verification of "
+                + std::to_string(count) + " slaves for "
+                + m_fmuPath.string() + "...\n");
+            std::vector<coral::net::SlaveLocator> newLocators;
+            for (auto& slave : slaves) {
+                newLocators.push_back(AwaitSlave(slave, timeout));
             }
-            // At this point, we know that slaveStatus contains three frames, where
-            // the first one is "OK", signifying that the slave seems to be up and
-            // running.  The following two contains the endpoints to which the slave
-            // is bound.
-            slaveLocator = coral::net::SlaveLocator{
-                coral::net::ip::Endpoint{coral::net::zmqx::ToString(slaveStatus[1])}
-                    .ToEndpoint("tcp"),
-                coral::net::ip::Endpoint{coral::net::zmqx::ToString(slaveStatus[2])}
-                    .ToEndpoint("tcp")
-            };
-
-            std::clog << "OK" << std::endl;
+            PrintLocked(std::clog, std::to_string(count) + " slaves for "
+                + m_fmuPath.string() + " OK\n");
+            slaveLocators.insert(
+                slaveLocators.end(),
+                newLocators.begin(),
+                newLocators.end());
+            RefillPool();
             return true;
         } catch (const std::exception& e) {
             m_instantiationFailureDescription = e.what();
+            RefillPool();
             return false;
         }
     }
@@ -157,7 +178,152 @@ public:
     }
 
 private:
+    // A slave process which has been started.  Once it has reported in on
+    // its status socket, it has loaded the FMU and is waiting for a master
+    // to connect.
+    struct SlaveProcess
+    {
+        std::unique_ptr<zmq::socket_t> statusSocket;
+        std::chrono::steady_clock::time_point startTime;
+    };
+
+    // Returns a slave from the warm pool, or starts a new slave if the pool
+    // is empty.
+    SlaveProcess TakeSlave()
+    {
+        // A warm slave shuts itself down if no master connects to it within
+        // the inactivity timeout, so we only hand out those which have used
+        // less than half of it.  The others are simply left to expire.
+        const auto now = std::chrono::steady_clock::now();
+        while (!m_warmSlaves.empty()) {
+            auto slave = std::move(m_warmSlaves.front());
+            m_warmSlaves.pop_front();
+            if (m_masterInactivityTimeout < std::chrono::seconds(0) ||
+                    now - slave.startTime < m_masterInactivityTimeout / 2) {
+                CORAL_LOG_DEBUG(boost::format("Using warm slave for %s (%d left)")
+                    % m_fmuPath.string() % m_warmSlaves.size());
+                return slave;
+            }
+            CORAL_LOG_DEBUG("Discarding expired warm slave");
+        }
+        return StartSlave();
+    }
+
+    // Starts new slaves until the warm pool is full.  This doesn't wait for
+    // them; they load the FMU in the background and report in on their
+    // status sockets, where the message waits until they are taken.
+    void RefillPool()
+    {
+        try {
+            while (static_cast<int>(m_warmSlaves.size()) < m_warmSlaveCount) {
+                m_warmSlaves.push_back(StartSlave());
+            }
+        } catch (const std::exception& e) {
+            coral::log::Log(
+                coral::log::warning,
+                boost::format("Failed to start warm slave: %s") % e.what());
+        }
+    }
+
+    // Returns the directory which holds the unpacked FMU, importing it first
+    // if necessary.  We hold on to the FMU object, which keeps the directory
+    // from being removed from the cache while we may still start slaves.
+    const boost::filesystem::path& UnpackedFMUDir()
+    {
+        if (!m_fmu) {
+            std::lock_guard<std::mutex> lock(m_importer->mutex);
+            auto fmu = m_importer->importer->Import(m_fmuPath);
+            m_importer->importer->CompleteUnpacking(*fmu);
+            m_fmu = std::move(fmu);
+        }
+        return m_fmu->Directory();
+    }
+
+    // Starts a slave process.  The slave is given the directory of the
+    // unpacked FMU, so it doesn't have to look at the FMU file at all.
+    SlaveProcess StartSlave()
+    {
+        const auto& unpackedFMUDir = UnpackedFMUDir();
+        auto slaveStatusSocket = std::make_unique<zmq::socket_t>(
+            coral::net::zmqx::GlobalContext(), ZMQ_PULL);
+        const auto slaveStatusPort = coral::net::zmqx::BindToEphemeralPort(*slaveStatusSocket);
+        const auto slaveStatusEp = "tcp://localhost:" + boost::lexical_cast<std::string>(slaveStatusPort);
+
+        std::vector<std::string> args;
+        args.push_back("--unpacked-fmu=" + unpackedFMUDir.string());
+        args.push_back("--coralslaveprovider-endpoint=" + slaveStatusEp);
+        args.push_back("--hangaround-time=" + std::to_string(m_masterInactivityTimeout.count()));
+        args.push_back("--interface=" + m_networkInterface.ToString());
+        if (!m_enableOutput) {
+            args.push_back("--no-output");
+        }
+        args.push_back("--output-dir=" + m_outputDir);
+        args.push_back("--log-level=" + m_logLevel);
+        if (m_enableFileLogging) {
+            args.push_back("--log-file");
+            args.push_back("--log-file-dir=" + m_logFileDir);
+        }
+
+        auto processOptions = coral::util::ProcessOptions::none;
+        if (m_createConsoles) processOptions |= coral::util::ProcessOptions::createNewConsole;
+
+        PrintLocked(std::cout, "\nStarting slave...\n"
+            "  FMU       : " + m_fmuPath.string() + '\n');
+        CORAL_LOG_DEBUG(boost::format("Starting process: %s %s")
+            % m_slaveExe % boost::algorithm::join(args, " "));
+        SlaveProcess slave;
+        slave.startTime = std::chrono::steady_clock::now();
+        coral::util::SpawnProcess(m_slaveExe, args, processOptions);
+        slave.statusSocket = std::move(slaveStatusSocket);
+        return slave;
+    }
+
+    // Waits for a slave started with StartSlave() to report that it is up
+    // and running, and returns its locator.  Throws on failure.
+    coral::net::SlaveLocator AwaitSlave(
+        SlaveProcess& slave,
+        std::chrono::milliseconds timeout)
+    {
+        auto& slaveStatusSocket = *slave.statusSocket;
+        std::vector<zmq::message_t> slaveStatus;
+        const auto feedbackTimedOut = !coral::net::zmqx::WaitForIncoming(
+            slaveStatusSocket,
+            timeout);
+        if (feedbackTimedOut) {
+            throw std::runtime_error(
+                "Slave took more than "
+                + boost::lexical_cast<std::string>(timeout.count())
+                + " milliseconds to start; presumably it has failed altogether");
+        }
+        coral::net::zmqx::Receive(slaveStatusSocket, slaveStatus);
+        if (coral::net::zmqx::ToString(slaveStatus[0]) == "ERROR" &&
+                slaveStatus.size() == 2) {
+            throw std::runtime_error(coral::net::zmqx::ToString(slaveStatus[1]));
+        } else if (coral::net::zmqx::ToString(slaveStatus[0]) != "OK" ||
+                slaveStatus.size() < 3 ||
+                slaveStatus[1].size() == 0 ||
+                slaveStatus[2].size() == 0) {
+            throw std::runtime_error("Invalid data received from slave executable");
+        }
+        CORAL_LOG_DEBUG(boost::format("Slave for %s was ready %d ms after it was started")
+            % m_fmuPath.string()
+            % std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - slave.startTime).count());
+        // At this point, we know that slaveStatus contains three frames, where
+        // the first one is "OK", signifying that the slave seems to be up and
+        // running.  The following two contains the endpoints to which the slave
+        // is bound.
+        return coral::net::SlaveLocator{
+            coral::net::ip::Endpoint{coral::net::zmqx::ToString(slaveStatus[1])}
+                .ToEndpoint("tcp"),
+            coral::net::ip::Endpoint{coral::net::zmqx::ToString(slaveStatus[2])}
+                .ToEndpoint("tcp")
+        };
+    }
+
     boost::filesystem::path m_fmuPath;
+    coral::model::SlaveTypeDescription m_description;
+    std::shared_ptr<SharedImporter> m_importer;
     std::shared_ptr<coral::fmi::FMU> m_fmu;
     coral::net::ip::Address m_networkInterface;
     std::string m_slaveExe;
@@ -168,7 +334,9 @@ private:
     bool m_enableFileLogging;
     std::string m_logFileDir;
     bool m_createConsoles;
+    int m_warmSlaveCount;
 
+    std::deque<SlaveProcess> m_warmSlaves;
     std::string m_instantiationFailureDescription;
 };
 
@@ -189,17 +357,110 @@ void ScanDirectoryForFMUs(
 }
 
 
+// Obtains the slave type descriptions of the given FMUs.  Descriptions are
+// taken from `index` when possible, and the remaining FMUs are imported in
+// parallel, each thread with its own importer.  Imports which fail are
+// retried one at a time with `importer`, in case the failure was caused by
+// two FMUs with the same GUID being unpacked simultaneously.  On return,
+// `descriptions[i]` is null if FMU `i` couldn't be imported, in which case
+// `errors[i]` contains the reason.
+void LoadDescriptions(
+    const std::vector<std::string>& fmuPaths,
+    coral::fmi::Importer& importer,
+    const boost::filesystem::path& fmuCacheDir,
+    coral::fmi::ImportIndex& index,
+    std::vector<std::unique_ptr<coral::model::SlaveTypeDescription>>& descriptions,
+    std::vector<std::string>& errors)
+{
+    descriptions.clear();
+    descriptions.resize(fmuPaths.size());
+    errors.clear();
+    errors.resize(fmuPaths.size());
+
+    std::vector<std::size_t> toImport;
+    for (std::size_t i = 0; i < fmuPaths.size(); ++i) {
+        if (const auto d = index.Find(fmuPaths[i])) {
+            descriptions[i] = std::make_unique<coral::model::SlaveTypeDescription>(*d);
+        } else {
+            toImport.push_back(i);
+        }
+    }
+    if (toImport.empty()) return;
+
+    const auto threadCount = std::min<std::size_t>(
+        std::max(std::thread::hardware_concurrency(), 1u),
+        toImport.size());
+    std::cout << "Importing " << toImport.size() << " new or changed FMUs using "
+        << threadCount << " threads..." << std::endl;
+    std::atomic<std::size_t> next{0};
+    const auto importSome = [&] () {
+        try {
+            const auto threadImporter = coral::fmi::Importer::Create(
+                fmuCacheDir, coral::fmi::UnpackMode::selective);
+            for (auto k = next++; k < toImport.size(); k = next++) {
+                const auto i = toImport[k];
+                try {
+                    descriptions[i] = std::make_unique<coral::model::SlaveTypeDescription>(
+                        threadImporter->Import(fmuPaths[i])->Description());
+                } catch (const std::exception& e) {
+                    errors[i] = e.what();
+                }
+            }
+        } catch (const std::exception& e) {
+            // The remaining FMUs are imported by other threads, or retried
+            // below.
+            coral::log::Log(coral::log::warning, e.what());
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1; t < threadCount; ++t) {
+        threads.emplace_back(importSome);
+    }
+    importSome();
+    for (auto& t : threads) t.join();
+
+    for (const auto i : toImport) {
+        if (!descriptions[i]) {
+            try {
+                descriptions[i] = std::make_unique<coral::model::SlaveTypeDescription>(
+                    importer.Import(fmuPaths[i])->Description());
+                errors[i].clear();
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+                continue;
+            }
+        }
+        index.Insert(fmuPaths[i], *descriptions[i]);
+    }
+    try {
+        index.Save();
+    } catch (const std::exception& e) {
+        coral::log::Log(
+            coral::log::warning,
+            boost::format("Failed to save FMU index: %s") % e.what());
+    }
+}
+
+
 int main(int argc, const char** argv)
 {
 try {
     const auto fmuCacheDir = boost::filesystem::temp_directory_path() / "coral" / "cache";
-    auto importer = coral::fmi::Importer::Create(fmuCacheDir);
+    const auto fmuIndexFile = fmuCacheDir / "slaveprovider_index";
+    auto importer = coral::fmi::Importer::Create(
+        fmuCacheDir, coral::fmi::UnpackMode::selective);
 
     namespace po = boost::program_options;
     po::options_description options("Options");
     options.add_options()
+        ("cache-size-limit", po::value<std::uint64_t>()->default_value(0),
+            "The maximum size of the cache which contains unpacked FMU "
+            "contents, in MiB.  When the FMUs have been loaded, the least "
+            "recently used FMUs which are not in use are removed from the "
+            "cache until it is below this size.  Zero means no limit.")
         ("clean-cache",
-            "Clear the cache which contains previously unpacked FMU contents. "
+            "Clear the cache which contains previously unpacked FMU contents "
+            "and the index of previously loaded FMUs. "
             "The program will exit immediately after performing this action.")
         ("interface", po::value<std::string>()->default_value(DEFAULT_NETWORK_INTERFACE),
             "The IP address or (OS-specific) name of the network interface to "
@@ -221,7 +482,13 @@ try {
         ("timeout", po::value<int>()->default_value(3600),
             "The number of seconds slaves should wait for commands from a master "
             "before assuming that the connection is broken and shutting themselves "
-            "down.  The special value -1 means \"never\".");
+            "down.  The special value -1 means \"never\".")
+        ("warm-slaves", po::value<int>()->default_value(0),
+            "The number of slaves of each type to start ahead of time.  These "
+            "load their FMU and then wait for a master, so that they are ready "
+            "as soon as one is requested.  The pool for a slave type is filled "
+            "the first time a slave of that type is requested, and refilled "
+            "whenever slaves are handed out.");
     coral::util::AddLoggingOptions(options);
     po::options_description positionalOptions("Arguments");
     positionalOptions.add_options()
@@ -242,6 +509,7 @@ try {
     coral::util::UseLoggingArguments(*optionValues, MY_NAME);
     if (optionValues->count("clean-cache")) {
         importer->CleanCache();
+        boost::filesystem::remove(fmuIndexFile);
         return 0;
     }
     if (!optionValues->count("fmu")) throw std::runtime_error("No FMUs specified");
@@ -260,6 +528,12 @@ try {
     const auto logLevel = (*optionValues)["log-level"].as<std::string>();
     const auto enableFileLogging = optionValues->count("log-file") > 0;
     const auto logFileDir = (*optionValues)["log-file-dir"].as<std::string>();
+    const auto warmSlaveCount = (*optionValues)["warm-slaves"].as<int>();
+    if (warmSlaveCount < 0) {
+        throw std::runtime_error("Invalid warm-slaves value");
+    }
+    const auto cacheSizeLimit =
+        (*optionValues)["cache-size-limit"].as<std::uint64_t>() * 1024 * 1024;
 
     std::string slaveExe;
     if (optionValues->count("slave-exe")) {
@@ -287,13 +561,24 @@ try {
         }
     }
 
+    coral::fmi::ImportIndex fmuIndex(fmuIndexFile);
+    std::vector<std::unique_ptr<coral::model::SlaveTypeDescription>> descriptions;
+    std::vector<std::string> importErrors;
+    LoadDescriptions(
+        fmuPaths, *importer, fmuCacheDir, fmuIndex, descriptions, importErrors);
+    if (cacheSizeLimit > 0) importer->CleanCache(cacheSizeLimit);
+
+    const auto sharedImporter = std::make_shared<SharedImporter>(importer);
     std::vector<std::unique_ptr<coral::provider::SlaveCreator>> fmus;
     int failedFMUS = 0;
-    for (const auto& p : fmuPaths) {
+    for (std::size_t i = 0; i < fmuPaths.size(); ++i) {
+        const auto& p = fmuPaths[i];
         try {
+            if (!descriptions[i]) throw std::runtime_error(importErrors[i]);
             fmus.push_back(std::make_unique<MySlaveCreator>(
-                *importer,
                 p,
+                *descriptions[i],
+                sharedImporter,
                 networkInterface,
                 slaveExe,
                 timeout,
@@ -302,7 +587,8 @@ try {
                 logLevel,
                 enableFileLogging,
                 logFileDir,
-                createConsoles));
+                createConsoles,
+                warmSlaveCount));
             std::cout << "FMU loaded: " << p << std::endl;
         } catch (const std::runtime_error& e) {
             ++failedFMUS;
@@ -60,6 +60,9 @@ try {
             "Disable file output of variable values.")
         ("output-dir,o", po::value<std::string>()->default_value("."),
             "The directory where output files should be written.")
+        ("unpacked-fmu", po::value<std::string>(),
+            "The directory of an FMU which has already been unpacked, to use "
+            "instead of an FMU file.")
         ("coralslaveprovider-endpoint", po::value<std::string>(),
             "For use by coralslaveprovider: An endpoint on which the provider "
             "is listening for status messages.");
@@ -80,6 +83,8 @@ try {
         "Creates and executes an instance of an FMU for co-simulation.");
     if (!optionValues) return 0;
     coral::util::UseLoggingArguments(*optionValues, MY_NAME);
+    coral::util::UseTracingEnvironment(MY_NAME);
+    const auto metricsExporter = coral::util::UseMetricsEnvironment(MY_NAME);
 
     if (optionValues->count("coralslaveprovider-endpoint")) {
         CORAL_LOG_DEBUG("Assuming started by slave provider");
@@ -108,10 +113,13 @@ try {
     const auto enableOutput = !optionValues->count("no-output");
     const auto outputDir = (*optionValues)["output-dir"].as<std::string>();
 
-    if (!optionValues->count("fmu")) {
+    const bool unpacked = optionValues->count("unpacked-fmu") > 0;
+    if (!unpacked && !optionValues->count("fmu")) {
         throw std::runtime_error("No FMU specified");
     }
-    const auto fmuPath = (*optionValues)["fmu"].as<std::string>();
+    const auto fmuPath = unpacked
+        ? (*optionValues)["unpacked-fmu"].as<std::string>()
+        : (*optionValues)["fmu"].as<std::string>();
 
     CORAL_LOG_DEBUG(boost::format("PID: %d") % getpid());
     coral::log::Log(coral::log::info, boost::format("FMU: %s") % fmuPath);
@@ -119,8 +127,11 @@ try {
     CORAL_LOG_TRACE(boost::format("Hangaround time: %d s") % hangaroundTime.count());
 
     const auto fmuCacheDir = boost::filesystem::temp_directory_path() / "coral" / "cache";
-    auto fmuImporter = coral::fmi::Importer::Create(fmuCacheDir);
-    auto fmu = fmuImporter->Import(fmuPath);
+    auto fmuImporter = coral::fmi::Importer::Create(
+        fmuCacheDir, coral::fmi::UnpackMode::selective);
+    auto fmu = unpacked
+        ? fmuImporter->ImportUnpacked(fmuPath)
+        : fmuImporter->Import(fmuPath);
     coral::log::Log(coral::log::info, boost::format("Model name: %s")
         % fmu->Description().Name());
 